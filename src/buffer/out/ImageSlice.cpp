@@ -45,23 +45,27 @@ til::CoordType ImageSlice::PixelWidth() const noexcept
 
 std::span<const RGBQUAD> ImageSlice::Pixels() const noexcept
 {
-    return _pixelBuffer;
+    if (!_tile)
+    {
+        return {};
+    }
+    return _tile->pixels;
 }
 
 const RGBQUAD* ImageSlice::Pixels(const til::CoordType columnBegin) const noexcept
 {
     const auto pixelOffset = (columnBegin - _columnBegin) * _cellSize.width;
-    return &til::at(_pixelBuffer, pixelOffset);
+    return &til::at(_tile->pixels, pixelOffset);
 }
 
 RGBQUAD* ImageSlice::MutablePixels(const til::CoordType columnBegin, const til::CoordType columnEnd)
 {
     // IF the buffer is empty or isn't large enough for the requested range, we'll need to resize it.
-    if (_pixelBuffer.empty() || columnBegin < _columnBegin || columnEnd > _columnEnd)
+    if (!_hasPixels() || columnBegin < _columnBegin || columnEnd > _columnEnd)
     {
         const auto oldColumnBegin = _columnBegin;
         const auto oldPixelWidth = _pixelWidth;
-        const auto existingData = !_pixelBuffer.empty();
+        const auto existingData = _hasPixels();
         _columnBegin = existingData ? std::min(_columnBegin, columnBegin) : columnBegin;
         _columnEnd = existingData ? std::max(_columnEnd, columnEnd) : columnEnd;
         _pixelWidth = (_columnEnd - _columnBegin) * _cellSize.width;
@@ -73,7 +77,7 @@ RGBQUAD* ImageSlice::MutablePixels(const til::CoordType columnBegin, const til::
             auto newPixelBuffer = std::vector<RGBQUAD>(bufferSize);
             const auto newPixelOffset = (oldColumnBegin - _columnBegin) * _cellSize.width;
             auto newIterator = std::next(newPixelBuffer.data(), newPixelOffset);
-            auto oldIterator = _pixelBuffer.data();
+            auto oldIterator = _tile->pixels.data();
             // Because widths are rounded up to multiples of 4, it's possible
             // that the old width will extend past the right border of the new
             // buffer, so the range that we copy must be clamped to fit.
@@ -84,16 +88,52 @@ RGBQUAD* ImageSlice::MutablePixels(const til::CoordType columnBegin, const til::
                 std::advance(oldIterator, oldPixelWidth);
                 std::advance(newIterator, _pixelWidth);
             }
-            _pixelBuffer = std::move(newPixelBuffer);
+            // The old tile may still be shared with other slices, so rather
+            // than modifying it, the resized buffer becomes a new tile.
+            _tile = std::make_shared<Tile>(Tile{ .pixels = std::move(newPixelBuffer) });
         }
         else
         {
             // Otherwise we just initialize the buffer to the correct size.
-            _pixelBuffer.resize(bufferSize);
+            _tile = std::make_shared<Tile>(Tile{ .pixels = std::vector<RGBQUAD>(bufferSize) });
         }
     }
     const auto pixelOffset = (columnBegin - _columnBegin) * _cellSize.width;
-    return &til::at(_pixelBuffer, pixelOffset);
+    return &til::at(_mutablePixelBuffer(), pixelOffset);
+}
+
+size_t ImageSlice::PixelBytes() const noexcept
+{
+    return _tile ? _tile->pixels.size() * sizeof(RGBQUAD) : 0;
+}
+
+bool ImageSlice::SharesPixelsWith(const ImageSlice& other) const noexcept
+{
+    return _tile && _tile == other._tile;
+}
+
+bool ImageSlice::OwnsPixels() const noexcept
+{
+    // This is true when there are no other slices referencing our tile, so
+    // releasing this slice would also release the memory used by its pixels.
+    return _tile && _tile.use_count() == 1;
+}
+
+bool ImageSlice::_hasPixels() const noexcept
+{
+    return _tile && !_tile->pixels.empty();
+}
+
+std::vector<RGBQUAD>& ImageSlice::_mutablePixelBuffer()
+{
+    // This is where the copy-on-write happens. If the tile is referenced by
+    // any other slice, or has been interned by the ImageStore, we need to make
+    // our own copy of the pixels before they can be modified.
+    if (_tile.use_count() > 1 || _tile->interned)
+    {
+        _tile = std::make_shared<Tile>(Tile{ .pixels = _tile->pixels });
+    }
+    return _tile->pixels;
 }
 
 void ImageSlice::CopyBlock(const TextBuffer& srcBuffer, const til::rect srcRect, TextBuffer& dstBuffer, const til::rect dstRect)
@@ -123,6 +163,8 @@ void ImageSlice::CopyBlock(const TextBuffer& srcBuffer, const til::rect srcRect,
 
 void ImageSlice::CopyRow(const ROW& srcRow, ROW& dstRow)
 {
+    // Copying a slice only copies the reference to its pixel tile. The pixels
+    // themselves won't be duplicated unless one of the slices is modified.
     const auto srcSlice = srcRow.GetImageSlice();
     dstRow.SetImageSlice(srcSlice ? std::make_unique<ImageSlice>(*srcSlice) : nullptr);
 }
@@ -259,7 +301,7 @@ bool ImageSlice::_eraseCells(const til::CoordType columnBegin, const til::CoordT
         {
             const auto eraseOffset = (eraseBegin - _columnBegin) * _cellSize.width;
             const auto eraseLength = (eraseEnd - eraseBegin) * _cellSize.width;
-            auto eraseIterator = std::next(_pixelBuffer.data(), eraseOffset);
+            auto eraseIterator = std::next(_mutablePixelBuffer().data(), eraseOffset);
             for (auto y = 0; y < _cellSize.height; y++)
             {
                 std::memset(eraseIterator, 0, eraseLength * sizeof(RGBQUAD));
@@ -269,3 +311,77 @@ bool ImageSlice::_eraseCells(const til::CoordType columnBegin, const til::CoordT
         return false;
     }
 }
+
+void ImageStore::Intern(ImageSlice& slice)
+{
+    if (!slice._hasPixels() || slice._tile->interned)
+    {
+        return;
+    }
+
+    // If there's an existing tile with identical content, the slice can just
+    // take a reference to that, and its own copy of the pixels is released.
+    const auto& pixels = slice._tile->pixels;
+    const auto hash = til::hasher{}.write(pixels.data(), pixels.size()).finalize();
+    const auto [begin, end] = _tiles.equal_range(hash);
+    size_t candidates = 0;
+    for (auto it = begin; it != end && candidates < MaxDedupCandidates; ++it, ++candidates)
+    {
+        auto tile = it->second.lock();
+        if (tile && tile->pixels.size() == pixels.size() && std::memcmp(tile->pixels.data(), pixels.data(), pixels.size() * sizeof(RGBQUAD)) == 0)
+        {
+            slice._tile = std::move(tile);
+            return;
+        }
+    }
+
+    slice._tile->hash = hash;
+    slice._tile->interned = true;
+    _tiles.emplace(hash, slice._tile);
+    _internedBytes += pixels.size() * sizeof(RGBQUAD);
+
+    // Tiles are only held weakly, so we periodically need to clear out the
+    // entries of those that have since been released.
+    if (_tiles.size() >= _pruneThreshold)
+    {
+        _prune();
+        _pruneThreshold = std::max<size_t>(64, _tiles.size() * 2);
+    }
+}
+
+size_t ImageStore::TileCount() noexcept
+{
+    _prune();
+    return _tiles.size();
+}
+
+size_t ImageStore::PixelBytes() noexcept
+{
+    _prune();
+    size_t total = 0;
+    for (const auto& [hash, weakTile] : _tiles)
+    {
+        if (const auto tile = weakTile.lock())
+        {
+            total += tile->pixels.size() * sizeof(RGBQUAD);
+        }
+    }
+    _measuredBytes = total;
+    _internedBytes = 0;
+    return total;
+}
+
+// Unlike PixelBytes(), this doesn't need to visit every tile, but it doesn't
+// account for the tiles that have been released since PixelBytes() was last
+// called. It's meant for checking cheaply whether we might be over a budget.
+size_t ImageStore::PixelBytesUpperBound() const noexcept
+{
+    return _measuredBytes + _internedBytes;
+}
+
+void ImageStore::_prune() noexcept
+{
+    std::erase_if(_tiles, [](const auto& entry) noexcept {
+        return entry.second.expired();
+    });
+}
@@ -7,12 +7,17 @@ Module Name:
 
 Abstract:
 - This serves as a structure to represent a slice of an image covering one textbuffer row.
+- The pixels of a slice are held in a reference counted tile, so copying a slice
+  (when scrolling or reflowing the buffer) only copies a reference. The tile is
+  only duplicated when one of the slices sharing it is written to.
+- The ImageStore is owned by the TextBuffer, and deduplicates identical tiles.
 --*/
 
 #pragma once
 
 #include "til.h"
 #include <span>
+#include <unordered_map>
 #include <vector>
 
 class ROW;
@@ -23,6 +28,15 @@ class ImageSlice
 public:
     using Pointer = std::unique_ptr<ImageSlice>;
 
+    struct Tile
+    {
+        std::vector<RGBQUAD> pixels;
+        size_t hash = 0;
+        // Interned tiles may be shared with slices we don't know about, so
+        // they must be treated as immutable, even when there's one owner.
+        bool interned = false;
+    };
+
     ImageSlice(const ImageSlice& rhs) = default;
     ImageSlice(const til::size cellSize) noexcept;
 
@@ -37,6 +51,10 @@ public:
     const RGBQUAD* Pixels(const til::CoordType columnBegin) const noexcept;
     RGBQUAD* MutablePixels(const til::CoordType columnBegin, const til::CoordType columnEnd);
 
+    size_t PixelBytes() const noexcept;
+    bool SharesPixelsWith(const ImageSlice& other) const noexcept;
+    bool OwnsPixels() const noexcept;
+
     static void CopyBlock(const TextBuffer& srcBuffer, const til::rect srcRect, TextBuffer& dstBuffer, const til::rect dstRect);
     static void CopyRow(const ROW& srcRow, ROW& dstRow);
     static void CopyCells(const ROW& srcRow, const til::CoordType srcColumn, ROW& dstRow, const til::CoordType dstColumnBegin, const til::CoordType dstColumnEnd);
@@ -45,13 +63,38 @@ public:
     static void EraseCells(ROW& row, const til::CoordType columnBegin, const til::CoordType columnEnd);
 
 private:
+    friend class ImageStore;
+
+    bool _hasPixels() const noexcept;
+    std::vector<RGBQUAD>& _mutablePixelBuffer();
     bool _copyCells(const ImageSlice& srcSlice, const til::CoordType srcColumn, const til::CoordType dstColumnBegin, const til::CoordType dstColumnEnd);
     bool _eraseCells(const til::CoordType columnBegin, const til::CoordType columnEnd);
 
     uint64_t _revision = 0;
     til::size _cellSize;
-    std::vector<RGBQUAD> _pixelBuffer;
+    std::shared_ptr<Tile> _tile;
     til::CoordType _columnBegin = 0;
     til::CoordType _columnEnd = 0;
     til::CoordType _pixelWidth = 0;
 };
+
+class ImageStore
+{
+public:
+    void Intern(ImageSlice& slice);
+    size_t TileCount() noexcept;
+    size_t PixelBytes() noexcept;
+    size_t PixelBytesUpperBound() const noexcept;
+
+private:
+    // A hash collision is rare, so a slice is compared with at most this many tiles of the same hash.
+    static constexpr size_t MaxDedupCandidates = 4;
+
+    void _prune() noexcept;
+
+    std::unordered_multimap<size_t, std::weak_ptr<ImageSlice::Tile>> _tiles;
+    size_t _pruneThreshold = 64;
+    // The result of the last PixelBytes() call, and what has been interned since.
+    size_t _measuredBytes = 0;
+    size_t _internedBytes = 0;
+};
@@ -89,3 +89,19 @@ struct ScrollMark
     til::CoordType row{ 0 };
     ScrollbarData data;
 };
+
+// The text of a command and its output, as returned by
+// TextBuffer::GetCommandContext(). This is plain text, without any attributes,
+// in which each row that didn't wrap ends in a "\n".
+struct CommandContext
+{
+    // Data from the row
+    ScrollbarData data;
+
+    std::wstring command;
+    // If the output didn't fit into the requested budget, this is only its
+    // beginning, outputTail is its end, and the rows in between were dropped.
+    std::wstring output;
+    std::wstring outputTail;
+    bool truncated{ false };
+};
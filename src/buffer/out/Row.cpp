@@ -4,7 +4,9 @@
 #include "precomp.h"
 #include "Row.hpp"
 
+#include <bit>
 #include <isa_availability.h>
+#include <til/hash.h>
 
 #include "../../types/inc/CodepointWidthDetector.hpp"
 
@@ -1163,6 +1165,104 @@ DelimiterClass ROW::DelimiterClassAt(til::CoordType column, const std::wstring_v
     }
 }
 
+// Routine Description:
+// - Finds the first column at or after the given one, which contains a RegularChar
+//   (if regular is true) or any other DelimiterClass (if regular is false).
+// Arguments:
+// - column - the column to start searching at
+// - regular - whether to search for a RegularChar or for the lack thereof
+// - wordDelimiters - the delimiters defined as a part of the DelimiterClass::DelimiterChar
+// Return Value:
+// - the found column, or size() if there's none
+til::CoordType ROW::FindRegularChar(til::CoordType column, bool regular, const std::wstring_view& wordDelimiters) const
+{
+    if (column >= _columnCount)
+    {
+        return _columnCount;
+    }
+
+    const auto& bits = _getRegularChars(wordDelimiters);
+    const auto invert = regular ? uint64_t{ 0 } : ~uint64_t{ 0 };
+    const auto col = static_cast<size_t>(std::max(0, column));
+    auto idx = col / 64;
+    auto word = (bits[idx] ^ invert) & (~uint64_t{ 0 } << (col % 64));
+
+    while (!word)
+    {
+        if (++idx >= bits.size())
+        {
+            return _columnCount;
+        }
+        word = bits[idx] ^ invert;
+    }
+
+    // The padding bits past _columnCount are unset, which means that inverted
+    // they'll match. That's why we need to clamp the result to _columnCount.
+    return std::min<til::CoordType>(gsl::narrow_cast<til::CoordType>(idx * 64 + std::countr_zero(word)), _columnCount);
+}
+
+// Routine Description:
+// - Same as FindRegularChar(), but searches for the last matching column at or before the given one.
+// Return Value:
+// - the found column, or -1 if there's none
+til::CoordType ROW::FindRegularCharBackward(til::CoordType column, bool regular, const std::wstring_view& wordDelimiters) const
+{
+    if (column < 0 || _columnCount == 0)
+    {
+        return -1;
+    }
+
+    const auto& bits = _getRegularChars(wordDelimiters);
+    const auto invert = regular ? uint64_t{ 0 } : ~uint64_t{ 0 };
+    const auto col = static_cast<size_t>(std::min<til::CoordType>(column, _columnCount - 1));
+    auto idx = col / 64;
+    auto word = (bits[idx] ^ invert) & (~uint64_t{ 0 } >> (63 - col % 64));
+
+    while (!word)
+    {
+        if (idx == 0)
+        {
+            return -1;
+        }
+        word = bits[--idx] ^ invert;
+    }
+
+    return gsl::narrow_cast<til::CoordType>(idx * 64 + 63 - std::countl_zero(word));
+}
+
+uint64_t ROW::GetGeneration() const noexcept
+{
+    return _generation;
+}
+
+void ROW::SetGeneration(uint64_t generation) noexcept
+{
+    _generation = generation;
+}
+
+// Returns the bitmap of RegularChar columns (see _regularChars), rebuilding it if the row changed since.
+const std::vector<uint64_t>& ROW::_getRegularChars(const std::wstring_view& wordDelimiters) const
+{
+    const auto delimiters = til::hash(wordDelimiters);
+    const auto words = (size_t{ _columnCount } + 63) / 64;
+
+    if (_regularChars.size() != words || _regularCharsGeneration != _generation || _regularCharsDelimiters != delimiters)
+    {
+        _regularChars.assign(words, 0);
+        for (uint16_t col = 0; col < _columnCount; ++col)
+        {
+            if (DelimiterClassAt(col, wordDelimiters) == DelimiterClass::RegularChar)
+            {
+                _regularChars[col / 64] |= uint64_t{ 1 } << (col % 64);
+            }
+        }
+        _regularCharsGeneration = _generation;
+        _regularCharsDelimiters = delimiters;
+    }
+
+    return _regularChars;
+}
+
 template<typename T>
 constexpr uint16_t ROW::_clampedColumn(T v) const noexcept
 {
@@ -168,6 +168,11 @@ public:
     til::CoordType GetLeadingColumnAtCharOffset(ptrdiff_t offset) const noexcept;
     til::CoordType GetTrailingColumnAtCharOffset(ptrdiff_t offset) const noexcept;
     DelimiterClass DelimiterClassAt(til::CoordType column, const std::wstring_view& wordDelimiters) const noexcept;
+    til::CoordType FindRegularChar(til::CoordType column, bool regular, const std::wstring_view& wordDelimiters) const;
+    til::CoordType FindRegularCharBackward(til::CoordType column, bool regular, const std::wstring_view& wordDelimiters) const;
+
+    uint64_t GetGeneration() const noexcept;
+    void SetGeneration(uint64_t generation) noexcept;
 
     auto AttrBegin() const noexcept { return _attr.begin(); }
     auto AttrEnd() const noexcept { return _attr.end(); }
@@ -241,6 +246,7 @@ private:
     constexpr uint16_t _clampedColumnInclusive(T v) const noexcept;
 
     uint16_t _charSize() const noexcept;
+    const std::vector<uint64_t>& _getRegularChars(const std::wstring_view& wordDelimiters) const;
     template<typename T>
     wchar_t _uncheckedChar(T off) const noexcept;
     template<typename T>
@@ -312,6 +318,15 @@ private:
 
     // Stores any image content covering the row.
     ImageSlice::Pointer _imageSlice;
+
+    // TextBuffer assigns a new generation to the row whenever it hands out mutable access to it.
+    uint64_t _generation = 0;
+    // A bitmap with 1 bit per column, which is set if the column contains a DelimiterClass::RegularChar.
+    // It's built lazily by _getRegularChars() for accessibility word navigation and is only valid as
+    // long as the _generation and the (hash of the) word delimiters it was built with are unchanged.
+    mutable std::vector<uint64_t> _regularChars;
+    mutable uint64_t _regularCharsGeneration = 0;
+    mutable size_t _regularCharsDelimiters = 0;
 };
 
 #ifdef UNIT_TESTING
@@ -149,6 +149,8 @@ void TextBuffer::_decommit() noexcept
     _destroy();
     VirtualFree(_buffer.get(), 0, MEM_DECOMMIT);
     _commitWatermark = _buffer.get();
+    // All ROWs are constructed anew, so they can go back to their natural order.
+    _rowIndex.clear();
 }
 
 // Constructs ROWs between [_commitWatermark,until).
@@ -200,6 +202,12 @@ ROW& TextBuffer::_getRow(til::CoordType y) const
         offset += _height;
     }
 
+    // ScrollRows() may have reordered the rows. See _rowIndex.
+    if (!_rowIndex.empty())
+    {
+        offset = til::at(_rowIndex, offset);
+    }
+
     // We add 1 to the row offset, because row "0" is the one returned by GetScratchpadRow().
     // See GetScratchpadRow() for more explanation.
 #pragma warning(suppress : 26492) // Don't use const_cast to cast away const or volatile (type.3).
@@ -231,7 +239,10 @@ const ROW& TextBuffer::GetRowByOffset(const til::CoordType index) const
 ROW& TextBuffer::GetMutableRowByOffset(const til::CoordType index)
 {
     _lastMutationId++;
-    return _getRow(index);
+    auto& row = _getRow(index);
+    // This invalidates any data the row caches about its contents.
+    row.SetGeneration(_lastMutationId);
+    return row;
 }
 
 // Returns a row filled with whitespace and the current attributes, for you to freely use.
@@ -251,6 +262,43 @@ ROW& TextBuffer::GetScratchpadRow(const TextAttribute& attributes)
     return r;
 }
 
+// Returns the amount of memory that has been committed for the ROWs of this buffer so far.
+size_t TextBuffer::GetCommittedMemory() const noexcept
+{
+    return gsl::narrow_cast<size_t>(_commitWatermark - _buffer.get());
+}
+
+// Returns true if the rows in the range [beg,end) contain nothing but blank cells
+// in the given attributes, as if they had just been erased. Rows that haven't been
+// committed yet are checked against the attributes they'll be constructed with,
+// so that this doesn't commit any memory itself.
+bool TextBuffer::IsBlank(const til::CoordType beg, const til::CoordType end, const TextAttribute& attributes) const
+{
+    // Offsets are committed up to the _commitWatermark, minus the scratchpad row. See _getRow().
+    const auto committedOffsets = (_commitWatermark - _buffer.get()) / gsl::narrow_cast<ptrdiff_t>(_bufferRowStride) - 1;
+
+    for (auto y = beg; y < end; y++)
+    {
+        if ((_firstRow + y) % _height >= committedOffsets)
+        {
+            if (_initialAttributes != attributes)
+            {
+                return false;
+            }
+            continue;
+        }
+
+        const auto& row = GetRowByOffset(y);
+        const auto& runs = row.Attributes().runs();
+        if (row.ContainsText() || runs.size() != 1 || runs.front().value != attributes ||
+            row.GetImageSlice() || row.GetLineRendition() != LineRendition::SingleWidth)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 #pragma warning(pop)
 #pragma endregion
 
@@ -613,17 +661,50 @@ void TextBuffer::FillRect(const til::rect& rect, const std::wstring_view& fill,
             .sourceColumnBegin = rect.left,
         };
 
+        // The dirty columns may extend past the rect if we overwrote half of a
+        // wide glyph, so we accumulate them and trigger a single redraw at the end.
+        auto dirtyLeft = til::CoordTypeMax;
+        auto dirtyRight = til::CoordTypeMin;
+
         for (auto y = rect.top; y < rect.bottom; ++y)
         {
             auto& r = GetMutableRowByOffset(y);
             r.CopyTextFrom(state);
             r.ReplaceAttributes(rect.left, rect.right, attributes);
             ImageSlice::EraseCells(r, rect.left, rect.right);
-            TriggerRedraw(Viewport::FromExclusive({ state.columnBeginDirty, y, state.columnEndDirty, y + 1 }));
+            dirtyLeft = std::min(dirtyLeft, state.columnBeginDirty);
+            dirtyRight = std::max(dirtyRight, state.columnEndDirty);
+        }
+
+        if (dirtyLeft < dirtyRight)
+        {
+            TriggerRedraw(Viewport::FromExclusive({ dirtyLeft, rect.top, dirtyRight, rect.bottom }));
         }
     }
 }
 
+// Replaces the attributes of every cell in the given rect with func(attribute).
+// The attributes are transformed a run at a time, so func is only called once per
+// distinct run in each row, no matter how wide the rect is.
+void TextBuffer::ChangeAttributes(const til::rect& rect, const std::function<TextAttribute(const TextAttribute&)>& func)
+{
+    if (!rect)
+    {
+        return;
+    }
+
+    for (auto y = rect.top; y < rect.bottom; ++y)
+    {
+        auto& attributes = GetMutableRowByOffset(y).Attributes();
+        const auto size = attributes.size();
+        const auto left = std::clamp<til::CoordType>(rect.left, 0, size);
+        const auto right = std::clamp<til::CoordType>(rect.right, 0, size);
+        attributes.transform(gsl::narrow_cast<uint16_t>(left), gsl::narrow_cast<uint16_t>(right), func);
+    }
+
+    TriggerRedraw(Viewport::FromExclusive(rect));
+}
+
 // Routine Description:
 // - Writes cells to the output buffer. Writes at the cursor.
 // Arguments:
@@ -803,6 +884,14 @@ void TextBuffer::ScrollRows(const til::CoordType firstRow, til::CoordType size,
     // A negative size doesn't make any sense anyways.
     size = std::max(0, size);
 
+    // If the source and target overlap, we can rotate the row order instead of copying
+    // every single row. This is what makes scrolling within margins (IL/DL, DECSTBM, etc.)
+    // cheap, as they usually move a large number of rows by just a single line.
+    if (std::abs(delta) < size && _rotateRows(firstRow, size, delta))
+    {
+        return;
+    }
+
     til::CoordType y = 0;
     til::CoordType end = 0;
     til::CoordType step = 0;
@@ -862,6 +951,63 @@ void TextBuffer::ScrollRows(const til::CoordType firstRow, til::CoordType size,
     }
 }
 
+// Implements ScrollRows() for overlapping source and target ranges by rotating the
+// affected entries of _rowIndex. The ROWs that are rotated out of the target end up
+// in the rows that the source vacated. ScrollRows() has always left the original
+// contents in those, which we restore by copying them back from their new location.
+// This way we only copy abs(delta) rows instead of size many.
+// Returns false if the affected range is too large for this approach.
+bool TextBuffer::_rotateRows(const til::CoordType firstRow, const til::CoordType size, const til::CoordType delta)
+{
+    const auto beg = std::min(firstRow, firstRow + delta);
+    const auto end = std::max(firstRow, firstRow + delta) + size;
+    if (beg < 0 || end > _height)
+    {
+        return false;
+    }
+
+    // All ROWs in the range must have been constructed before we can move them around,
+    // because _estimateOffsetOfLastCommittedRow() relies on all rows from the top of
+    // the buffer to the _commitWatermark to be committed.
+    const auto lastOffset = (_firstRow + end - 1) % _height;
+    const auto wraps = lastOffset < (_firstRow + beg) % _height;
+    _getRowByOffsetDirect(wraps ? _height : gsl::narrow_cast<size_t>(lastOffset) + 1);
+
+    if (_rowIndex.empty())
+    {
+        _rowIndex.resize(_height);
+        std::iota(_rowIndex.begin(), _rowIndex.end(), uint16_t{ 0 });
+    }
+
+    // The range may wrap around the end of the circular buffer, which is
+    // why this rotates it via 3 reversals instead of using std::rotate().
+    const auto reverse = [&](til::CoordType lo, til::CoordType hi) {
+        for (hi--; lo < hi; lo++, hi--)
+        {
+            std::swap(til::at(_rowIndex, (_firstRow + lo) % _height), til::at(_rowIndex, (_firstRow + hi) % _height));
+        }
+    };
+    const auto split = delta < 0 ? beg - delta : end - delta;
+    reverse(beg, split);
+    reverse(split, end);
+    reverse(beg, end);
+
+    // The vacated rows are either at the top or bottom of the range and the
+    // rows that originally occupied them are now abs(delta) rows further in.
+    const auto vacatedBeg = delta < 0 ? end + delta : beg;
+    const auto vacatedEnd = delta < 0 ? end : beg + delta;
+    for (auto y = vacatedBeg; y < vacatedEnd; y++)
+    {
+        const auto& srcRow = GetRowByOffset(y + delta);
+        auto& dstRow = GetMutableRowByOffset(y);
+        dstRow.CopyFrom(srcRow);
+        dstRow.SetScrollbarData(srcRow.GetScrollbarData());
+        ImageSlice::CopyRow(srcRow, dstRow);
+    }
+
+    return true;
+}
+
 void TextBuffer::CopyRow(const til::CoordType srcRowIndex, const til::CoordType dstRowIndex, TextBuffer& dstBuffer) const
 {
     auto& dstRow = dstBuffer.GetMutableRowByOffset(dstRowIndex);
@@ -870,6 +1016,87 @@ void TextBuffer::CopyRow(const til::CoordType srcRowIndex, const til::CoordType
     ImageSlice::CopyRow(srcRow, dstRow);
 }
 
+// Copies the content of srcRect to dstOrigin in dstBuffer, which may be this buffer.
+// Unlike copying cell by cell, this copies the text and attributes of each row as
+// a single range and triggers a single redraw for the entire destination area.
+// The source is clipped to the line width of each row (which matters for double
+// width lines), and the destination is clipped to the size of dstBuffer.
+void TextBuffer::CopyRect(const til::rect& srcRect, const til::point dstOrigin, TextBuffer& dstBuffer) const
+{
+    const auto dstSize = dstBuffer.GetSize().Dimensions();
+    const auto width = std::min(srcRect.width(), dstSize.width - dstOrigin.x);
+    const auto height = std::min(srcRect.height(), dstSize.height - dstOrigin.y);
+    if (width <= 0 || height <= 0)
+    {
+        return;
+    }
+
+    // When copying downwards within the same buffer we have to walk the rows
+    // bottom-up, so that we don't overwrite source rows before we've read them.
+    const auto bottomUp = &dstBuffer == this && dstOrigin.y > srcRect.top;
+
+    for (auto i = 0; i < height; ++i)
+    {
+        const auto offset = bottomUp ? height - 1 - i : i;
+        const auto srcY = srcRect.top + offset;
+        const auto dstY = dstOrigin.y + offset;
+
+        // If the source columns are offscreen (which can occur on double width
+        // lines), then we shouldn't copy anything to the destination.
+        const auto count = std::min(width, GetLineWidth(srcY) - srcRect.left);
+        if (count <= 0)
+        {
+            continue;
+        }
+
+        const auto& srcRow = GetRowByOffset(srcY);
+        auto& dstRow = dstBuffer.GetMutableRowByOffset(dstY);
+        const auto srcAttributes = srcRow.Attributes().slice(gsl::narrow_cast<uint16_t>(srcRect.left), gsl::narrow_cast<uint16_t>(srcRect.left + count));
+
+        // A row can't copy text from itself, so horizontal moves within
+        // a row have to go through the scratchpad row first.
+        const ROW* source = &srcRow;
+        if (&srcRow == &dstRow)
+        {
+            auto& scratchpad = dstBuffer.GetScratchpadRow();
+            scratchpad.CopyFrom(srcRow);
+            source = &scratchpad;
+        }
+
+        auto srcColumn = srcRect.left;
+        auto dstColumn = dstOrigin.x;
+
+        // CopyTextFrom() refuses to start in the middle of a wide glyph,
+        // so an orphaned trailing half is copied as whitespace instead.
+        if (source->DbcsAttrAt(srcColumn) == DbcsAttribute::Trailing)
+        {
+            RowWriteState state{
+                .text = L" ",
+                .columnBegin = dstColumn,
+                .columnLimit = dstColumn + 1,
+            };
+            dstRow.ReplaceText(state);
+            ++srcColumn;
+            ++dstColumn;
+        }
+
+        RowCopyTextFromState state{
+            .source = *source,
+            .columnBegin = dstColumn,
+            .columnLimit = dstOrigin.x + count,
+            .sourceColumnBegin = srcColumn,
+            .sourceColumnLimit = srcRect.left + count,
+        };
+        dstRow.CopyTextFrom(state);
+        dstRow.Attributes().replace(gsl::narrow_cast<uint16_t>(dstOrigin.x), gsl::narrow_cast<uint16_t>(dstOrigin.x + count), srcAttributes);
+    }
+
+    const auto dstRect = til::rect{ dstOrigin, til::size{ width, height } };
+    ImageSlice::CopyBlock(*this, til::rect{ srcRect.origin(), dstRect.size() }, dstBuffer, dstRect);
+    // Overwriting half of a wide glyph can dirty the column on either side.
+    dstBuffer.TriggerRedraw(Viewport::FromExclusive({ std::max(0, dstRect.left - 1), dstRect.top, dstRect.right + 1, dstRect.bottom }));
+}
+
 Cursor& TextBuffer::GetCursor() noexcept
 {
     return _cursor;
@@ -1046,6 +1273,7 @@ void TextBuffer::ResizeTraditional(til::size newSize)
     _buffer = std::move(newBuffer._buffer);
     _bufferEnd = newBuffer._bufferEnd;
     _commitWatermark = newBuffer._commitWatermark;
+    _rowIndex = std::move(newBuffer._rowIndex);
     _initialAttributes = newBuffer._initialAttributes;
     _bufferRowStride = newBuffer._bufferRowStride;
     _bufferOffsetChars = newBuffer._bufferOffsetChars;
@@ -1141,6 +1369,70 @@ DelimiterClass TextBuffer::_GetDelimiterClassAt(const til::point pos, const std:
     return GetRowByOffset(realPos.y).DelimiterClassAt(realPos.x, wordDelimiters);
 }
 
+// Method Description:
+// - Finds the first position at or after pos (but before stop), which contains a RegularChar
+//   (if regular is true) or any other DelimiterClass (if regular is false). This is the
+//   equivalent of repeatedly calling _GetDelimiterClassAt() and IncrementInBounds(),
+//   but scans the rows' cached bitmaps of RegularChar columns instead.
+// Arguments:
+// - pos - the position to start searching at
+// - stop - the position to stop searching at (exclusive)
+// - regular - whether to search for a RegularChar or for the lack thereof
+// - wordDelimiters - the delimiters defined as a part of the DelimiterClass::DelimiterChar
+// Return Value:
+// - the found position, or stop if there's none
+til::point TextBuffer::_FindRegularChar(til::point pos, const til::point stop, const bool regular, const std::wstring_view wordDelimiters) const
+{
+    const auto width = GetSize().Width();
+
+    while (pos < stop)
+    {
+        // For double width lines each buffer column covers 2 screen columns. See ScreenToBufferPosition().
+        const auto scale = IsDoubleWidthLine(pos.y) ? 1 : 0;
+        const auto& row = GetRowByOffset(pos.y);
+        const auto col = row.FindRegularChar(pos.x >> scale, regular, wordDelimiters);
+        const auto x = col == (pos.x >> scale) ? pos.x : col << scale;
+
+        if (x < width)
+        {
+            return std::min(til::point{ x, pos.y }, stop);
+        }
+
+        pos = { 0, pos.y + 1 };
+    }
+
+    return stop;
+}
+
+// Method Description:
+// - Same as _FindRegularChar(), but searches backwards from pos to the buffer origin (inclusive).
+// Return Value:
+// - the found position, or nullopt if there's none
+std::optional<til::point> TextBuffer::_FindRegularCharBackward(til::point pos, const bool regular, const std::wstring_view wordDelimiters) const
+{
+    const auto right = GetSize().RightInclusive();
+
+    for (;;)
+    {
+        const auto scale = IsDoubleWidthLine(pos.y) ? 1 : 0;
+        const auto& row = GetRowByOffset(pos.y);
+        const auto col = row.FindRegularCharBackward(pos.x >> scale, regular, wordDelimiters);
+
+        if (col >= 0)
+        {
+            // The last screen column covered by a buffer column is (col << scale) + scale.
+            return til::point{ col == (pos.x >> scale) ? pos.x : (col << scale) + scale, pos.y };
+        }
+
+        if (pos.y <= 0)
+        {
+            return std::nullopt;
+        }
+
+        pos = { right, pos.y - 1 };
+    }
+}
+
 til::point TextBuffer::GetWordStart2(til::point pos, const std::wstring_view wordDelimiters, bool includeWhitespace, std::optional<til::point> limitOptional) const
 {
     const auto bufferSize{ GetSize() };
@@ -1411,36 +1703,29 @@ til::point TextBuffer::GetWordStart(const til::point target, const std::wstring_
 // - The til::point for the first character on the current/previous READABLE "word" (inclusive)
 til::point TextBuffer::_GetWordStartForAccessibility(const til::point target, const std::wstring_view wordDelimiters) const
 {
-    auto result = target;
     const auto bufferSize = GetSize();
 
     // ignore left boundary. Continue until readable text found
-    while (_GetDelimiterClassAt(result, wordDelimiters) != DelimiterClass::RegularChar)
+    auto result = _FindRegularCharBackward(target, true, wordDelimiters);
+    if (!result)
     {
-        if (result == bufferSize.Origin())
-        {
-            //looped around and hit origin (no word between origin and target)
-            return result;
-        }
-        bufferSize.DecrementInBounds(result);
+        //looped around and hit origin (no word between origin and target)
+        return bufferSize.Origin();
     }
 
     // make sure we expand to the left boundary or the beginning of the word
-    while (_GetDelimiterClassAt(result, wordDelimiters) == DelimiterClass::RegularChar)
+    result = _FindRegularCharBackward(*result, false, wordDelimiters);
+    if (!result)
     {
-        if (result == bufferSize.Origin())
-        {
-            // first char in buffer is a RegularChar
-            // we can't move any further back
-            return result;
-        }
-        bufferSize.DecrementInBounds(result);
+        // first char in buffer is a RegularChar
+        // we can't move any further back
+        return bufferSize.Origin();
     }
 
     // move off of delimiter
-    bufferSize.IncrementInBounds(result);
+    bufferSize.IncrementInBounds(*result);
 
-    return result;
+    return *result;
 }
 
 // Method Description:
@@ -1556,17 +1841,14 @@ til::point TextBuffer::_GetWordEndForAccessibility(const til::point target, cons
     }
     else
     {
-        while (result != limit && result != bufferSize.BottomRightInclusive() && _GetDelimiterClassAt(result, wordDelimiters) == DelimiterClass::RegularChar)
-        {
-            // Iterate through readable text
-            bufferSize.IncrementInBounds(result);
-        }
+        const auto bottomRight = bufferSize.BottomRightInclusive();
+        const auto stop = bufferSize.CompareInBounds(limit, bottomRight, true) < 0 ? limit : bottomRight;
 
-        while (result != limit && result != bufferSize.BottomRightInclusive() && _GetDelimiterClassAt(result, wordDelimiters) != DelimiterClass::RegularChar)
-        {
-            // expand to the beginning of the NEXT word
-            bufferSize.IncrementInBounds(result);
-        }
+        // Iterate through readable text
+        result = _FindRegularChar(result, stop, false, wordDelimiters);
+
+        // expand to the beginning of the NEXT word
+        result = _FindRegularChar(result, stop, true, wordDelimiters);
 
         // Special case: we tried to move one past the end of the buffer
         // Manually increment onto the EndExclusive point.
@@ -2134,9 +2416,10 @@ std::tuple<til::CoordType, til::CoordType, bool> TextBuffer::_RowCopyHelper(cons
 // - Retrieves the text data from the buffer and presents it in a clipboard-ready format.
 // Arguments:
 // - req - the copy request having the bounds of the selected region and other related configuration flags.
+// - maxLength - the maximum length of the returned text. Rows past this limit aren't visited at all.
 // Return Value:
 // - The text data from the selected region of the text buffer. Empty if the copy request is invalid.
-std::wstring TextBuffer::GetPlainText(const CopyRequest& req) const
+std::wstring TextBuffer::GetPlainText(const CopyRequest& req, const size_t maxLength) const
 {
     if (req.beg > req.end)
     {
@@ -2145,7 +2428,7 @@ std::wstring TextBuffer::GetPlainText(const CopyRequest& req) const
 
     std::wstring selectedText;
 
-    for (auto iRow = req.beg.y; iRow <= req.end.y; ++iRow)
+    for (auto iRow = req.beg.y; iRow <= req.end.y && selectedText.size() < maxLength; ++iRow)
     {
         const auto& row = GetRowByOffset(iRow);
         const auto& [rowBeg, rowEnd, addLineBreak] = _RowCopyHelper(req, iRow, row);
@@ -2159,6 +2442,11 @@ std::wstring TextBuffer::GetPlainText(const CopyRequest& req) const
         }
     }
 
+    if (selectedText.size() > maxLength)
+    {
+        selectedText.resize(maxLength);
+    }
+
     return selectedText;
 }
 
@@ -3204,6 +3492,9 @@ void TextBuffer::Reflow(TextBuffer& oldBuffer, TextBuffer& newBuffer, const View
 
     newBuffer.CopyProperties(oldBuffer);
     newBuffer.CopyHyperlinkMaps(oldBuffer);
+    // The image slices in the new buffer share their tiles with the old one,
+    // so the store is carried over to continue deduplicating against them.
+    newBuffer._imageStore = std::move(oldBuffer._imageStore);
 
     assert(newCursorPos.x >= 0 && newCursorPos.x < newWidth);
     assert(newCursorPos.y >= 0 && newCursorPos.y < newHeight);
@@ -3317,6 +3608,52 @@ void TextBuffer::CopyHyperlinkMaps(const TextBuffer& other)
     _currentHyperlinkId = other._currentHyperlinkId;
 }
 
+ImageStore& TextBuffer::GetImageStore() noexcept
+{
+    return _imageStore;
+}
+
+// Releases the image content of the oldest rows, up to (but not including) the
+// given end row, once the pixels held in the image store exceed the budget.
+// This is how images that have scrolled far into the history get evicted.
+// Since eviction has to walk the rows from the top, it frees a quarter of the
+// budget more than necessary, so that it doesn't happen again for every image
+// that follows. Within the budget, this doesn't visit any row or tile at all.
+void TextBuffer::TrimImageContent(const til::CoordType endRow, const size_t maxPixelBytes)
+{
+    if (_imageStore.PixelBytesUpperBound() <= maxPixelBytes)
+    {
+        return;
+    }
+
+    auto pixelBytes = _imageStore.PixelBytes();
+    if (pixelBytes <= maxPixelBytes)
+    {
+        return;
+    }
+
+    const auto targetPixelBytes = maxPixelBytes - maxPixelBytes / 4;
+    const auto rowLimit = std::min(endRow, _estimateOffsetOfLastCommittedRow() + 1);
+    for (til::CoordType y = 0; y < rowLimit && pixelBytes > targetPixelBytes; y++)
+    {
+        const auto slice = GetRowByOffset(y).GetImageSlice();
+        if (slice)
+        {
+            // Tiles that are shared with other rows won't be released until
+            // those rows are also trimmed, so they don't count towards the
+            // memory we've freed until then.
+            if (slice->OwnsPixels())
+            {
+                pixelBytes -= std::min(pixelBytes, slice->PixelBytes());
+            }
+            GetMutableRowByOffset(y).SetImageSlice(nullptr);
+        }
+    }
+
+    // Measure what's left, so that the next call can return early again.
+    _imageStore.PixelBytes();
+}
+
 // Searches through the entire (committed) text buffer for `needle` and returns the coordinates in absolute coordinates.
 // The end coordinates of the returned ranges are considered inclusive.
 std::optional<std::vector<til::point_span>> TextBuffer::SearchText(const std::wstring_view& needle, SearchFlag flags) const
@@ -3451,6 +3788,87 @@ std::vector<MarkExtents> TextBuffer::GetMarkExtents(size_t limit) const
     return marks;
 }
 
+// Get the command and output of the `limit` most recent shell integration marks
+// that have a command, in top-down order. This is meant for handing "the last
+// command and its output" to something like an AI prompt, so it returns plain
+// text, and output longer than `maxOutputLength` characters is cut down to its
+// beginning and its end, which is where errors and summaries usually are.
+// Callers with a token budget can assume about 4 characters per token.
+//
+// Like GetMarkExtents(limit), this scans upwards from the bottom and stops at
+// the last mark it needs, so the scrollback above that doesn't cost anything.
+// Unlike it, only the rows at the beginning and end of long output are read,
+// and marks whose rows didn't change since the previous call are served from
+// a cache, without iterating over their runs at all.
+std::vector<CommandContext> TextBuffer::GetCommandContext(const size_t limit, const size_t maxOutputLength) const
+{
+    std::vector<CommandContext> contexts;
+    std::vector<CommandContextCacheEntry> cache;
+    if (limit == 0u)
+    {
+        return contexts;
+    }
+
+    const auto bottom = _estimateOffsetOfLastCommittedRow();
+    auto lastPromptY = bottom;
+    auto hasNextPrompt = false;
+    for (auto promptY = bottom; promptY >= 0 && contexts.size() < limit; promptY--)
+    {
+        const auto& row = GetRowByOffset(promptY);
+        const auto& rowPromptData = row.GetScrollbarData();
+        // Skip the "Default" marks that came from the UI, same as GetMarkExtents().
+        if (!rowPromptData.has_value() || rowPromptData->category == MarkCategory::Default)
+        {
+            continue;
+        }
+
+        const auto distance = lastPromptY - promptY;
+        const auto cached = std::find_if(_commandContextCache.begin(), _commandContextCache.end(), [&](const auto& entry) {
+            return entry.promptRow == &row && entry.distance == distance && entry.maxOutputLength == maxOutputLength;
+        });
+        const auto cacheHit = cached != _commandContextCache.end() &&
+                              promptY + cached->rows - 1 <= bottom &&
+                              cached->generations == _generationsOfRows(promptY, promptY + cached->rows - 1);
+
+        if (cacheHit)
+        {
+            cache.emplace_back(std::move(*cached));
+        }
+        else
+        {
+            const auto mark = _scrollMarkExtentForRow(promptY, lastPromptY);
+            // If the output ends on the next mark's row, that row is part of this mark as well.
+            const auto lastRow = hasNextPrompt ? std::max(lastPromptY - 1, mark.GetExtent().second.y) : bottom;
+
+            auto& entry = cache.emplace_back(CommandContextCacheEntry{
+                .promptRow = &row,
+                .distance = distance,
+                .rows = lastRow - promptY + 1,
+                .generations = _generationsOfRows(promptY, lastRow),
+                .maxOutputLength = maxOutputLength,
+            });
+            if (mark.HasCommand())
+            {
+                entry.context = _commandContextForMark(mark, maxOutputLength);
+            }
+        }
+
+        if (const auto& context = cache.back().context)
+        {
+            contexts.emplace_back(*context);
+        }
+
+        lastPromptY = promptY;
+        hasNextPrompt = true;
+    }
+
+    // Only keep the marks we just visited, so that the cache can't grow past `limit` (plus any marks without a command).
+    _commandContextCache = std::move(cache);
+
+    std::reverse(contexts.begin(), contexts.end());
+    return contexts;
+}
+
 // Remove all marks between `start` & `end`, inclusive.
 void TextBuffer::ClearMarksInRange(
     const til::point start,
@@ -3580,6 +3998,113 @@ MarkExtents TextBuffer::_scrollMarkExtentForRow(const til::CoordType rowOffset,
     return mark;
 }
 
+// Returns the text of the row `y` that lies within [beg, end), without trailing
+// whitespace, unless the row wrapped and the text continues on the next row.
+static std::wstring_view contextTextForRow(const ROW& row, const til::CoordType y, const til::point beg, const til::point end) noexcept
+{
+    const auto rowBeg = y == beg.y ? row.AdjustToGlyphStart(beg.x) : 0;
+    auto rowEnd = y == end.y ? row.AdjustToGlyphEnd(end.x) : row.GetReadableColumnCount();
+    if (!row.WasWrapForced())
+    {
+        rowEnd = std::min(rowEnd, row.GetLastNonSpaceColumn());
+    }
+    return row.GetText(rowBeg, std::max(rowBeg, rowEnd));
+}
+
+static void trimTrailingWhitespace(std::wstring& text) noexcept
+{
+    const auto end = text.find_last_not_of(L" \n");
+    text.erase(end == std::wstring::npos ? 0 : end + 1);
+}
+
+// Collect the plain text of the command and output of the given mark.
+// See GetCommandContext().
+CommandContext TextBuffer::_commandContextForMark(const MarkExtents& mark, const size_t maxOutputLength) const
+{
+    CommandContext context{
+        .data = mark.data,
+    };
+
+    // Appends the rows within [beg, end) to `text`, until it's longer than `maxLength`.
+    const auto appendRows = [&](std::wstring& text, const til::point beg, const til::point end, const size_t maxLength) {
+        for (auto y = beg.y; y <= end.y && text.size() <= maxLength; y++)
+        {
+            const auto& row = GetRowByOffset(y);
+            text.append(contextTextForRow(row, y, beg, end));
+            if (y != end.y && !row.WasWrapForced())
+            {
+                text.push_back(L'\n');
+            }
+        }
+    };
+
+    appendRows(context.command, mark.end, *mark.commandEnd, SIZE_T_MAX);
+    trimTrailingWhitespace(context.command);
+
+    if (!mark.HasOutput())
+    {
+        return context;
+    }
+
+    const auto end = *mark.outputEnd;
+    auto beg = *mark.commandEnd;
+    // The output usually starts right after the command, at the end of its row.
+    // Start on the next row then, instead of with an empty line.
+    if (beg.y < end.y && contextTextForRow(GetRowByOffset(beg.y), beg.y, beg, end).empty())
+    {
+        beg = { 0, beg.y + 1 };
+    }
+    appendRows(context.output, beg, end, maxOutputLength);
+    if (context.output.size() <= maxOutputLength)
+    {
+        trimTrailingWhitespace(context.output);
+        return context;
+    }
+
+    // The output doesn't fit. Read half the budget worth of rows from the bottom up
+    // and shorten the beginning to the rest of the budget. Since the whole output
+    // is longer than the budget, the two can't overlap.
+    context.truncated = true;
+
+    const auto tailLength = maxOutputLength / 2;
+    std::vector<std::wstring_view> tailRows;
+    size_t tailRowsLength = 0;
+    for (auto y = end.y; y >= beg.y && tailRowsLength < tailLength; y--)
+    {
+        const auto& row = GetRowByOffset(y);
+        const auto text = contextTextForRow(row, y, beg, end);
+        const auto lineBreak = y != end.y && !row.WasWrapForced();
+        tailRows.emplace_back(lineBreak ? std::wstring_view{ L"\n" } : std::wstring_view{});
+        tailRows.emplace_back(text);
+        tailRowsLength += text.size() + (lineBreak ? 1 : 0);
+    }
+
+    context.outputTail.reserve(tailRowsLength);
+    for (auto it = tailRows.rbegin(); it != tailRows.rend(); ++it)
+    {
+        context.outputTail.append(*it);
+    }
+    if (context.outputTail.size() > tailLength)
+    {
+        context.outputTail.erase(0, context.outputTail.size() - tailLength);
+    }
+    trimTrailingWhitespace(context.outputTail);
+
+    context.output.resize(maxOutputLength - std::min(maxOutputLength, context.outputTail.size()));
+    return context;
+}
+
+// Hashes the generation of each of the given rows, which changes whenever any of them is modified.
+size_t TextBuffer::_generationsOfRows(const til::CoordType top, const til::CoordType bottomInclusive) const
+{
+    til::hasher hasher;
+    for (auto y = top; y <= bottomInclusive; y++)
+    {
+        hasher.write(GetRowByOffset(y).GetGeneration());
+    }
+    return hasher.finalize();
+}
+
 std::wstring TextBuffer::_commandForRow(const til::CoordType rowOffset,
                                         const til::CoordType bottomInclusive,
                                         const bool clipAtCursor) const
@@ -57,6 +57,8 @@ filling in the last row, and updating the screen.
 #include "../buffer/out/textBufferCellIterator.hpp"
 #include "../buffer/out/textBufferTextIterator.hpp"
 
+#include <til/flat_hash_map.h>
+
 struct URegularExpression;
 enum class SearchFlag : unsigned int;
 
@@ -109,6 +111,7 @@ public:
     void Replace(til::CoordType row, const TextAttribute& attributes, RowWriteState& state);
     void Insert(til::CoordType row, const TextAttribute& attributes, RowWriteState& state);
     void FillRect(const til::rect& rect, const std::wstring_view& fill, const TextAttribute& attributes);
+    void ChangeAttributes(const til::rect& rect, const std::function<TextAttribute(const TextAttribute&)>& func);
 
     OutputCellIterator Write(const OutputCellIterator givenIt);
 
@@ -133,9 +136,12 @@ public:
     const til::CoordType GetFirstRowIndex() const noexcept;
 
     const Microsoft::Console::Types::Viewport GetSize() const noexcept;
+    size_t GetCommittedMemory() const noexcept;
+    bool IsBlank(const til::CoordType beg, const til::CoordType end, const TextAttribute& attributes) const;
 
     void ScrollRows(const til::CoordType firstRow, const til::CoordType size, const til::CoordType delta);
     void CopyRow(const til::CoordType srcRow, const til::CoordType dstRow, TextBuffer& dstBuffer) const;
+    void CopyRect(const til::rect& srcRect, const til::point dstOrigin, TextBuffer& dstBuffer) const;
 
     til::CoordType TotalRowCount() const noexcept;
 
@@ -199,6 +205,9 @@ public:
     std::wstring GetCustomIdFromId(uint16_t id) const;
     void CopyHyperlinkMaps(const TextBuffer& OtherBuffer);
 
+    ImageStore& GetImageStore() noexcept;
+    void TrimImageContent(const til::CoordType endRow, const size_t maxPixelBytes);
+
     std::wstring GetPlainText(til::point start, til::point end) const;
 
     struct CopyRequest
@@ -270,7 +279,7 @@ public:
         }
     };
 
-    std::wstring GetPlainText(const CopyRequest& req) const;
+    std::wstring GetPlainText(const CopyRequest& req, size_t maxLength = std::numeric_limits<size_t>::max()) const;
 
     std::wstring GetWithControlSequences(const CopyRequest& req) const;
 
@@ -304,6 +313,7 @@ public:
     // Mark handling
     std::vector<ScrollMark> GetMarkRows() const;
     std::vector<MarkExtents> GetMarkExtents(size_t limit = SIZE_T_MAX) const;
+    std::vector<CommandContext> GetCommandContext(size_t limit, size_t maxOutputLength) const;
     void ClearMarksInRange(const til::point start, const til::point end);
     void ClearAllMarks();
     std::wstring CurrentCommand() const;
@@ -324,10 +334,13 @@ private:
     ROW& _getRowByOffsetDirect(size_t offset);
     ROW& _getRow(til::CoordType y) const;
     til::CoordType _estimateOffsetOfLastCommittedRow() const noexcept;
+    bool _rotateRows(til::CoordType firstRow, til::CoordType size, til::CoordType delta);
 
     void _SetFirstRowIndex(const til::CoordType FirstRowIndex) noexcept;
     void _ExpandTextRow(til::inclusive_rect& selectionRow) const;
     DelimiterClass _GetDelimiterClassAt(const til::point pos, const std::wstring_view wordDelimiters) const;
+    til::point _FindRegularChar(til::point pos, const til::point stop, const bool regular, const std::wstring_view wordDelimiters) const;
+    std::optional<til::point> _FindRegularCharBackward(til::point pos, const bool regular, const std::wstring_view wordDelimiters) const;
     til::point _GetDelimiterClassRunStart(til::point pos, const std::wstring_view wordDelimiters) const;
     til::point _GetDelimiterClassRunEnd(til::point pos, const std::wstring_view wordDelimiters) const;
     til::point _GetWordStartForAccessibility(const til::point target, const std::wstring_view wordDelimiters) const;
@@ -338,6 +351,8 @@ private:
 
     std::wstring _commandForRow(const til::CoordType rowOffset, const til::CoordType bottomInclusive, const bool clipAtCursor = false) const;
     MarkExtents _scrollMarkExtentForRow(const til::CoordType rowOffset, const til::CoordType bottomInclusive) const;
+    CommandContext _commandContextForMark(const MarkExtents& mark, const size_t maxOutputLength) const;
+    size_t _generationsOfRows(const til::CoordType top, const til::CoordType bottomInclusive) const;
     bool _createPromptMarkIfNeeded();
 
     std::tuple<til::CoordType, til::CoordType, bool> _RowCopyHelper(const CopyRequest& req, const til::CoordType iRow, const ROW& row) const;
@@ -348,10 +363,12 @@ private:
 
     Microsoft::Console::Render::Renderer* _renderer = nullptr;
 
-    std::unordered_map<uint16_t, std::wstring> _hyperlinkMap;
-    std::unordered_map<std::wstring, uint16_t> _hyperlinkCustomIdMap;
+    til::flat_hash_map<uint16_t, std::wstring> _hyperlinkMap;
+    til::flat_hash_map<std::wstring, uint16_t> _hyperlinkCustomIdMap;
     uint16_t _currentHyperlinkId = 1;
 
+    ImageStore _imageStore;
+
     // This block describes the state of the underlying virtual memory buffer that holds all ROWs, text and attributes.
     // Initially memory is only allocated with MEM_RESERVE to reduce the private working set of conhost.
     // ROWs are laid out like this in memory:
@@ -384,6 +401,11 @@ private:
     // In other words, _commitWatermark itself will either point exactly onto the next ROW
     // that should be committed or be equal to _bufferEnd when all ROWs are committed.
     std::byte* _commitWatermark = nullptr;
+    // Maps the circular row offsets (see _getRow) to the ROWs in the memory arena. It's empty as long as the
+    // rows are in their natural order, which is the case until ScrollRows() rotates a range of them.
+    // Since only the ROWs up to the _commitWatermark are ever rotated, the table will always map
+    // committed offsets to committed ROWs and uncommitted offsets to themselves.
+    std::vector<uint16_t> _rowIndex;
     // This will MEM_COMMIT 128 rows more than we need, to avoid us from having to call VirtualAlloc too often.
     // This equates to roughly the following commit chunk sizes at these column counts:
     // *  80 columns (the usual minimum) =  60KB chunks,  4.1MB buffer at 9001 rows
@@ -413,6 +435,24 @@ private:
     til::CoordType _firstRow = 0; // indexes top row (not necessarily 0)
     uint64_t _lastMutationId = 0;
 
+    // GetCommandContext() keeps the context of the marks it visited, until any of the
+    // rows between the mark and the next one change (see ROW::GetGeneration()).
+    struct CommandContextCacheEntry
+    {
+        // The ROW objects don't move when the buffer scrolls, unlike their offsets.
+        const ROW* promptRow = nullptr;
+        // The number of rows from the mark to the next one, or to the last committed row.
+        til::CoordType distance = 0;
+        // The number of rows that `generations` is the hash of. This excludes the next mark's
+        // row, unless the output ends on it, so that typing the next command keeps the entry valid.
+        til::CoordType rows = 0;
+        size_t generations = 0;
+        size_t maxOutputLength = 0;
+        // Empty if the mark doesn't have a command.
+        std::optional<CommandContext> context;
+    };
+    mutable std::vector<CommandContextCacheEntry> _commandContextCache;
+
     Cursor _cursor;
     bool _isActiveBuffer = false;
 
@@ -0,0 +1,183 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+#include "WexTestClass.h"
+
+#include "../textBuffer.hpp"
+#include "../../renderer/inc/DummyRenderer.hpp"
+
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+namespace
+{
+    // A 1000x1000 pixel image, which covers 100x50 cells at this cell size.
+    constexpr til::size cellSize{ 10, 20 };
+    constexpr til::CoordType imageColumns = 100;
+    constexpr til::CoordType imageRows = 50;
+    constexpr size_t imageBytes = size_t{ imageColumns } * cellSize.width * imageRows * cellSize.height * sizeof(RGBQUAD);
+
+    void writeImageRow(TextBuffer& buffer, const til::CoordType y, const til::CoordType imageRow)
+    {
+        auto& row = buffer.GetMutableRowByOffset(y);
+        const auto slice = row.SetImageSlice(std::make_unique<ImageSlice>(cellSize));
+        const auto pixels = slice->MutablePixels(0, imageColumns);
+        const auto pixelCount = gsl::narrow_cast<size_t>(slice->PixelWidth() * cellSize.height);
+        for (size_t i = 0; i < pixelCount; i++)
+        {
+            pixels[i] = RGBQUAD{
+                .rgbBlue = gsl::narrow_cast<BYTE>(i),
+                .rgbGreen = gsl::narrow_cast<BYTE>(i >> 8),
+                .rgbRed = gsl::narrow_cast<BYTE>(imageRow),
+                .rgbReserved = 255,
+            };
+        }
+    }
+
+    void writeImage(TextBuffer& buffer, const til::CoordType top)
+    {
+        for (auto y = 0; y < imageRows; y++)
+        {
+            writeImageRow(buffer, top + y, y);
+            buffer.GetImageStore().Intern(*buffer.GetMutableRowByOffset(top + y).GetMutableImageSlice());
+        }
+    }
+}
+
+class ImageSliceTests
+{
+    TEST_CLASS(ImageSliceTests);
+
+    TEST_METHOD(CopyRowSharesPixels)
+    {
+        DummyRenderer renderer;
+        TextBuffer buffer{ { imageColumns, 4 }, TextAttribute{}, 0, false, &renderer };
+
+        writeImageRow(buffer, 0, 0);
+        ImageSlice::CopyRow(buffer.GetRowByOffset(0), buffer.GetMutableRowByOffset(1));
+
+        const auto srcSlice = buffer.GetRowByOffset(0).GetImageSlice();
+        const auto dstSlice = buffer.GetRowByOffset(1).GetImageSlice();
+        VERIFY_IS_NOT_NULL(dstSlice);
+        VERIFY_IS_TRUE(dstSlice->SharesPixelsWith(*srcSlice));
+
+        Log::Comment(L"Writing to the copy must not affect the original");
+        const auto originalPixel = srcSlice->Pixels()[0];
+        buffer.GetMutableRowByOffset(1).GetMutableImageSlice()->MutablePixels(0, 1)[0] = RGBQUAD{};
+        VERIFY_IS_FALSE(dstSlice->SharesPixelsWith(*srcSlice));
+        VERIFY_ARE_EQUAL(originalPixel.rgbReserved, srcSlice->Pixels()[0].rgbReserved);
+        VERIFY_ARE_EQUAL(BYTE{ 0 }, dstSlice->Pixels()[0].rgbReserved);
+    }
+
+    TEST_METHOD(EraseDetachesSharedPixels)
+    {
+        DummyRenderer renderer;
+        TextBuffer buffer{ { imageColumns, 4 }, TextAttribute{}, 0, false, &renderer };
+
+        writeImageRow(buffer, 0, 0);
+        ImageSlice::CopyRow(buffer.GetRowByOffset(0), buffer.GetMutableRowByOffset(1));
+        ImageSlice::EraseCells(buffer.GetMutableRowByOffset(1), 0, 10);
+
+        const auto srcSlice = buffer.GetRowByOffset(0).GetImageSlice();
+        const auto dstSlice = buffer.GetRowByOffset(1).GetImageSlice();
+        VERIFY_IS_FALSE(dstSlice->SharesPixelsWith(*srcSlice));
+        VERIFY_ARE_EQUAL(BYTE{ 255 }, srcSlice->Pixels()[0].rgbReserved);
+        VERIFY_ARE_EQUAL(BYTE{ 0 }, dstSlice->Pixels()[0].rgbReserved);
+    }
+
+    TEST_METHOD(InternDeduplicatesIdenticalRows)
+    {
+        DummyRenderer renderer;
+        TextBuffer buffer{ { imageColumns, 4 }, TextAttribute{}, 0, false, &renderer };
+        auto& imageStore = buffer.GetImageStore();
+
+        writeImageRow(buffer, 0, 7);
+        writeImageRow(buffer, 1, 7);
+        writeImageRow(buffer, 2, 8);
+        for (auto y = 0; y < 3; y++)
+        {
+            imageStore.Intern(*buffer.GetMutableRowByOffset(y).GetMutableImageSlice());
+        }
+
+        const auto slice0 = buffer.GetRowByOffset(0).GetImageSlice();
+        const auto slice1 = buffer.GetRowByOffset(1).GetImageSlice();
+        const auto slice2 = buffer.GetRowByOffset(2).GetImageSlice();
+        VERIFY_IS_TRUE(slice1->SharesPixelsWith(*slice0));
+        VERIFY_IS_FALSE(slice2->SharesPixelsWith(*slice0));
+        VERIFY_ARE_EQUAL(size_t{ 2 }, imageStore.TileCount());
+
+        Log::Comment(L"Interned tiles are copied on write, even with a single owner");
+        buffer.GetMutableRowByOffset(2).GetMutableImageSlice()->MutablePixels(0, 1)[0] = RGBQUAD{};
+        VERIFY_IS_TRUE(slice2->OwnsPixels());
+        VERIFY_ARE_EQUAL(size_t{ 1 }, imageStore.TileCount());
+
+        Log::Comment(L"Released tiles are dropped from the store");
+        buffer.GetMutableRowByOffset(0).SetImageSlice(nullptr);
+        buffer.GetMutableRowByOffset(1).SetImageSlice(nullptr);
+        VERIFY_ARE_EQUAL(size_t{ 0 }, imageStore.TileCount());
+    }
+
+    TEST_METHOD(ScrollImageThroughHistory)
+    {
+        DummyRenderer renderer;
+        TextBuffer buffer{ { imageColumns, 10000 }, TextAttribute{}, 0, false, &renderer };
+        auto& imageStore = buffer.GetImageStore();
+
+        Log::Comment(L"Output the same image until it has covered all 10k rows");
+        for (auto top = 0; top + imageRows <= 10000; top += imageRows)
+        {
+            writeImage(buffer, top);
+        }
+        auto pixelBytes = imageStore.PixelBytes();
+        Log::Comment(NoThrowString().Format(L"Image memory after output: %zu KiB (%zu KiB per image)", pixelBytes / 1024, imageBytes / 1024));
+        VERIFY_ARE_EQUAL(imageBytes, pixelBytes);
+
+        Log::Comment(L"Scroll the entire buffer a row at a time");
+        for (auto i = 0; i < imageRows; i++)
+        {
+            buffer.ScrollRows(1, 9999, -1);
+        }
+        pixelBytes = imageStore.PixelBytes();
+        Log::Comment(NoThrowString().Format(L"Image memory after scrolling: %zu KiB", pixelBytes / 1024));
+        VERIFY_ARE_EQUAL(imageBytes, pixelBytes);
+
+        for (auto y = 0; y < imageRows; y++)
+        {
+            const auto original = buffer.GetRowByOffset(y + imageRows).GetImageSlice();
+            VERIFY_IS_TRUE(buffer.GetRowByOffset(y).GetImageSlice()->SharesPixelsWith(*original));
+        }
+    }
+
+    TEST_METHOD(TrimImageContent)
+    {
+        DummyRenderer renderer;
+        TextBuffer buffer{ { imageColumns, 200 }, TextAttribute{}, 0, false, &renderer };
+        auto& imageStore = buffer.GetImageStore();
+
+        Log::Comment(L"Output two distinct images");
+        for (auto y = 0; y < 2 * imageRows; y++)
+        {
+            writeImageRow(buffer, y, y);
+            imageStore.Intern(*buffer.GetMutableRowByOffset(y).GetMutableImageSlice());
+        }
+        VERIFY_ARE_EQUAL(2 * imageBytes, imageStore.PixelBytes());
+
+        Log::Comment(L"Nothing is trimmed within the budget");
+        buffer.TrimImageContent(2 * imageRows, 2 * imageBytes);
+        VERIFY_ARE_EQUAL(2 * imageBytes, imageStore.PixelBytes());
+        VERIFY_IS_NOT_NULL(buffer.GetRowByOffset(0).GetImageSlice());
+
+        Log::Comment(L"Over the budget, the oldest rows are trimmed until we're within 3/4 of it");
+        buffer.TrimImageContent(2 * imageRows, imageBytes * 3 / 2);
+        VERIFY_ARE_EQUAL(imageBytes, imageStore.PixelBytes());
+        VERIFY_IS_NULL(buffer.GetRowByOffset(imageRows - 1).GetImageSlice());
+        VERIFY_IS_NOT_NULL(buffer.GetRowByOffset(imageRows).GetImageSlice());
+
+        Log::Comment(L"Rows past the end row are never trimmed");
+        buffer.TrimImageContent(imageRows + 1, 0);
+        VERIFY_IS_NULL(buffer.GetRowByOffset(imageRows).GetImageSlice());
+        VERIFY_IS_NOT_NULL(buffer.GetRowByOffset(imageRows + 1).GetImageSlice());
+    }
+};
@@ -4,6 +4,46 @@
 using namespace winrt;
 using namespace Microsoft::Terminal::AI;
 
+namespace
+{
+    // How many passages of the agent's documents are added to a prompt, at most.
+    constexpr size_t MaxDocumentMatches = 4;
+    // Passages that are less similar to the prompt than this are more noise than help.
+    constexpr float MinimumDocumentScore = 0.2f;
+
+    // Turns `key`, like an agent's name or a directory, into a file name. The key itself
+    // may contain anything, including characters that aren't valid in a path or a "..".
+    std::wstring cacheFileName(std::wstring_view key)
+    {
+        static constexpr std::wstring_view digits{ L"0123456789abcdef" };
+        auto hash = til::hash(key);
+        std::wstring name(sizeof(hash) * 2, L'0');
+        for (auto it = name.rbegin(); it != name.rend(); ++it, hash >>= 4)
+        {
+            *it = digits[hash & 15];
+        }
+        return name;
+    }
+
+    // Agents with the same name share their index, and so does an agent that's reloaded with the
+    // one it had before, which a sync may still be using. The store can only be opened once.
+    std::shared_ptr<DocumentIndex> openDocumentIndex(const std::filesystem::path& directory)
+    {
+        static std::mutex lock;
+        static std::map<std::filesystem::path, std::weak_ptr<DocumentIndex>> indices;
+
+        const std::lock_guard guard{ lock };
+        auto& entry = indices[directory];
+        auto index = entry.lock();
+        if (!index)
+        {
+            index = std::make_shared<DocumentIndex>(directory, std::make_shared<HashingEmbedder>());
+            entry = index;
+        }
+        return index;
+    }
+}
+
 AIAgent::AIAgent(std::wstring_view agentName)
 {
     _definition.name = agentName;
@@ -14,6 +54,20 @@ AIAgent::AIAgent(std::wstring_view agentName)
 void AIAgent::LoadAgent(std::wstring_view agentPath)
 {
     _loadAgentDefinition(agentPath);
+    _loadDocuments();
+    
+    try
+    {
+        std::lock_guard lock{ _turnLock };
+        _conversation.Clear();
+        _conversation.SetSystemMessage(_definition.instructions);
+        _conversation.SetTools(_toolDefinitions());
+    }
+    catch (...)
+    {
+        LOG_CAUGHT_EXCEPTION();
+        _FireErrorOccurred(L"Failed to load agent tools");
+    }
     
     // Initialize the AI engine
     try
@@ -37,17 +91,25 @@ void AIAgent::LoadAgent(std::wstring_view agentPath)
 
 winrt::fire_and_forget AIAgent::ExecuteAgentAsync(std::wstring_view userInput)
 {
+    // The view may not outlive the first suspension point.
+    const std::wstring input{ userInput };
+
+    // Searching the documents embeds the input and scans the index, which mustn't block the caller.
+    co_await winrt::resume_background();
+
     try
     {
+        const auto prompt = _groundPrompt(input);
+
         // Check if the agent has tools available
-        if (!_definition.tools.empty())
+        if (_streamingProvider || !_definition.tools.empty())
         {
-            co_await _processWithTools(userInput);
+            _processWithTools(prompt);
         }
         else
         {
             // Process directly with AI engine if no tools are configured
-            co_await _aiEngine->ChatAsync(userInput);
+            co_await _aiEngine->ChatAsync(prompt);
         }
     }
     catch (...)
@@ -58,10 +120,7 @@ winrt::fire_and_forget AIAgent::ExecuteAgentAsync(std::wstring_view userInput)
 
 void AIAgent::_loadAgentDefinition(std::wstring_view agentPath)
 {
-    // TODO: Implement loading agent definition from file
-    // This would parse a JSON/YAML file containing agent configuration
-    
-    // For now, set up a basic agent definition
+    // Defaults for whatever the definition file doesn't specify.
     _definition.description = L"AI agent for terminal assistance";
     _definition.instructions = L"You are a helpful AI assistant integrated into the terminal.";
     _definition.tools.clear();
@@ -70,6 +129,72 @@ void AIAgent::_loadAgentDefinition(std::wstring_view agentPath)
     // Example: Add some default tools
     _definition.tools.push_back(L"example_function");
     
+    // The definition is a JSON file like:
+    //   { "description": "...", "instructions": "...", "tools": [ "..." ], "documents": [ "notes.md" ] }
+    // Relative document paths are relative to the directory of the definition.
+    try
+    {
+        const std::filesystem::path path{ agentPath };
+        const auto jsonContent = til::io::read_file_as_utf8_string_if_exists(path);
+        if (!jsonContent.empty())
+        {
+            Json::Value root;
+            std::string errs;
+            const std::unique_ptr<Json::CharReader> reader{ Json::CharReaderBuilder{}.newCharReader() };
+            
+            if (!reader->parse(jsonContent.data(), jsonContent.data() + jsonContent.size(), &root, &errs))
+            {
+                LOG_HR_MSG(E_INVALIDARG, "Failed to parse agent definition: %hs", errs.c_str());
+            }
+            else
+            {
+                if (root.isMember("description") && root["description"].isString())
+                {
+                    _definition.description = til::u8u16(root["description"].asString());
+                }
+                
+                if (root.isMember("instructions") && root["instructions"].isString())
+                {
+                    _definition.instructions = til::u8u16(root["instructions"].asString());
+                }
+                
+                if (root.isMember("tools") && root["tools"].isArray())
+                {
+                    _definition.tools.clear();
+                    for (const auto& tool : root["tools"])
+                    {
+                        if (tool.isString())
+                        {
+                            _definition.tools.emplace_back(til::u8u16(tool.asString()));
+                        }
+                    }
+                }
+                
+                if (root.isMember("documents") && root["documents"].isArray())
+                {
+                    for (const auto& document : root["documents"])
+                    {
+                        if (!document.isString())
+                        {
+                            continue;
+                        }
+                        std::filesystem::path documentPath{ til::u8u16(document.asString()) };
+                        if (documentPath.is_relative())
+                        {
+                            documentPath = path.parent_path() / documentPath;
+                        }
+                        _definition.documents.emplace_back(documentPath.lexically_normal().wstring());
+                    }
+                }
+            }
+        }
+    }
+    catch (...)
+    {
+        LOG_CAUGHT_EXCEPTION();
+        _FireErrorOccurred(L"Failed to load agent definition");
+    }
+    
     // Load functions if tools are defined
     if (!_definition.tools.empty() && _functionEngine)
     {
@@ -90,16 +215,206 @@ void AIAgent::_loadAgentDefinition(std::wstring_view agentPath)
             functionsDir = L"./functions";
         }
         
-        _functionEngine->LoadFunctions(functionsDir);
+        // The parsed manifests are kept next to settings.json, so that a restart only parses what changed.
+        // Each directory gets its own cache, since resolving one drops the entries of all other files.
+        _functionEngine->LoadFunctions(functionsDir, CacheDirectory() / L"functions" / (cacheFileName(functionsDir) + L".bin"));
     }
 }
 
-winrt::fire_and_forget AIAgent::_processWithTools(std::wstring_view userInput)
+void AIAgent::SetStreamingProvider(std::shared_ptr<IStreamingProvider> provider)
 {
-    // TODO: Implement intelligent tool selection and execution
-    // This would analyze the user input, determine which tools to use,
-    // execute them via the function calling engine, and integrate results
-    
-    // For now, just pass to the AI engine
-    co_await _aiEngine->ChatAsync(userInput);
+    _streamingProvider = std::move(provider);
+}
+
+void AIAgent::SetModel(std::wstring_view model)
+{
+    _model = model;
+}
+
+void AIAgent::SetToolExecutor(AgentToolExecutor executor)
+{
+    _toolExecutor = std::move(executor);
+}
+
+AgentTurnStats AIAgent::LastTurnStats() const
+{
+    std::lock_guard lock{ _statsLock };
+    return _lastTurnStats;
+}
+
+// Describes the loaded functions in the format of the "tools" of a chat completions request.
+Json::Value AIAgent::_toolDefinitions()
+{
+    Json::Value tools{ Json::arrayValue };
+    if (_definition.tools.empty() || !_functionEngine)
+    {
+        return tools;
+    }
+
+    const std::unique_ptr<Json::CharReader> reader{ Json::CharReaderBuilder{}.newCharReader() };
+    for (const auto& function : _functionEngine->GetAvailableFunctions())
+    {
+        Json::Value tool;
+        tool["type"] = "function";
+        tool["function"]["name"] = til::u16u8(function.name);
+        tool["function"]["description"] = til::u16u8(function.description);
+
+        const auto parameters = til::u16u8(function.parameters);
+        Json::Value schema;
+        if (parameters.empty() || !reader->parse(parameters.data(), parameters.data() + parameters.size(), &schema, nullptr))
+        {
+            schema["type"] = "object";
+            schema["properties"] = Json::Value{ Json::objectValue };
+        }
+        tool["function"]["parameters"] = std::move(schema);
+        tools.append(std::move(tool));
+    }
+    return tools;
+}
+
+std::vector<std::wstring> AIAgent::_executeTools(const std::vector<StreamToolCall>& calls)
+{
+    if (_toolExecutor)
+    {
+        return _toolExecutor(calls);
+    }
+
+    std::vector<FunctionCallingEngine::FunctionCall> functionCalls;
+    functionCalls.reserve(calls.size());
+    for (const auto& call : calls)
+    {
+        functionCalls.push_back({ call.name, call.arguments });
+    }
+
+    std::vector<std::wstring> outputs;
+    outputs.reserve(calls.size());
+    for (const auto& result : _functionEngine->ExecuteFunctions(functionCalls))
+    {
+        // The model should know when a tool failed, so that it doesn't take its output at face value.
+        auto& output = outputs.emplace_back(til::u8u16(result.output));
+        if (result.timedOut)
+        {
+            output.append(L"\n(timed out)");
+        }
+        else if (result.exitCode != 0)
+        {
+            output.append(L"\n(exit code ").append(std::to_wstring(result.exitCode)).append(L")");
+        }
+    }
+    return outputs;
+}
+
+winrt::fire_and_forget AIAgent::_processWithTools(std::wstring prompt)
+{
+    const auto provider = _streamingProvider;
+    if (!provider)
+    {
+        // Without a provider there's no model that could call the tools,
+        // so just pass it to the AI engine.
+        _aiEngine->ChatAsync(prompt);
+        co_return;
+    }
+
+    co_await winrt::resume_background();
+
+    AgentTurnResult result;
+    {
+        std::lock_guard lock{ _turnLock };
+        try
+        {
+            _conversation.Append(L"user", prompt);
+            result = RunAgentTurn(*provider, _conversation, _model, [this](const auto& calls) { return _executeTools(calls); }, [this](std::wstring_view token) {
+                TokenReceived(*this, winrt::hstring{ token });
+                return true;
+            });
+        }
+        catch (...)
+        {
+            LOG_CAUGHT_EXCEPTION();
+            result.error = L"Agent turn failed";
+        }
+    }
+
+    {
+        std::lock_guard lock{ _statsLock };
+        _lastTurnStats = result.stats;
+    }
+
+    if (!result.error.empty())
+    {
+        _FireErrorOccurred(winrt::hstring{ result.error });
+        co_return;
+    }
+
+    _FireResponseReceived(winrt::hstring{ result.text });
+}
+
+void AIAgent::_loadDocuments()
+{
+    _documentIndex.reset();
+    if (_definition.documents.empty())
+    {
+        return;
+    }
+
+    try
+    {
+        // Each agent gets its own index next to settings.json, so that only documents that changed are embedded again.
+        _documentIndex = openDocumentIndex(CacheDirectory() / L"agents" / cacheFileName(_definition.name));
+        _syncDocumentsAsync();
+    }
+    catch (...)
+    {
+        LOG_CAUGHT_EXCEPTION();
+        _FireErrorOccurred(L"Failed to index agent documents");
+    }
+}
+
+winrt::fire_and_forget AIAgent::_syncDocumentsAsync()
+{
+    const auto index = _documentIndex;
+    const std::vector<std::filesystem::path> documents{ _definition.documents.begin(), _definition.documents.end() };
+
+    co_await winrt::resume_background();
+
+    try
+    {
+        // Searches already work with whatever was indexed before, while this catches up.
+        index->Sync(documents);
+    }
+    CATCH_LOG();
+}
+
+// Prepends the passages of the agent's documents that are most relevant to
+// `userInput`, so that the model can answer from them.
+std::wstring AIAgent::_groundPrompt(std::wstring_view userInput) const
+{
+    std::wstring prompt;
+
+    if (_documentIndex)
+    {
+        try
+        {
+            for (const auto& match : _documentIndex->Search(userInput, MaxDocumentMatches))
+            {
+                if (match.score < MinimumDocumentScore)
+                {
+                    break;
+                }
+                if (prompt.empty())
+                {
+                    prompt.append(L"Relevant excerpts from local documents:\n\n");
+                }
+                prompt.append(L"From ").append(match.document).append(L":\n").append(match.text).append(L"\n\n");
+            }
+        }
+        CATCH_LOG();
+    }
+
+    if (!prompt.empty())
+    {
+        prompt.append(L"Request: ");
+    }
+    prompt.append(userInput);
+    return prompt;
 }
\ No newline at end of file
@@ -2,7 +2,9 @@
 
 #include "pch.h"
 #include "AIEngine.h"
+#include "AgentTurn.h"
 #include "FunctionCallingEngine.h"
+#include "DocumentIndex.h"
 
 namespace Microsoft::Terminal::AI
 {
@@ -24,17 +26,42 @@ namespace Microsoft::Terminal::AI
         void LoadAgent(std::wstring_view agentPath);
         winrt::fire_and_forget ExecuteAgentAsync(std::wstring_view userInput);
         
+        // With a streaming provider, the agent runs the tool calls the model asks for itself,
+        // and answers in a single turn. Otherwise requests are passed to the AI engine.
+        void SetStreamingProvider(std::shared_ptr<IStreamingProvider> provider);
+        void SetModel(std::wstring_view model);
+        // Replaces the function calling engine as the executor of tool calls.
+        void SetToolExecutor(AgentToolExecutor executor);
+        AgentTurnStats LastTurnStats() const;
+        
         // Events for agent responses and errors
         winrt::event<winrt::Windows::Foundation::TypedEventHandler<AIAgent, winrt::hstring>> ResponseReceived;
         winrt::event<winrt::Windows::Foundation::TypedEventHandler<AIAgent, winrt::hstring>> ErrorOccurred;
+        // Fires for each token of an answer as it arrives, before ResponseReceived fires with the full text.
+        winrt::event<winrt::Windows::Foundation::TypedEventHandler<AIAgent, winrt::hstring>> TokenReceived;
         
     private:
         AgentDefinition _definition;
+        std::wstring _model{ L"gpt-4" };
+        std::shared_ptr<IStreamingProvider> _streamingProvider;
+        AgentToolExecutor _toolExecutor;
+        // Guards _conversation, so that turns run one after another.
+        std::mutex _turnLock;
+        ConversationContext _conversation;
+        mutable std::mutex _statsLock;
+        AgentTurnStats _lastTurnStats;
         std::unique_ptr<FunctionCallingEngine> _functionEngine;
         std::unique_ptr<AIEngine> _aiEngine;
+        // Shared with the background sync, which may outlive a reload.
+        std::shared_ptr<DocumentIndex> _documentIndex;
         
         void _loadAgentDefinition(std::wstring_view agentPath);
-        winrt::fire_and_forget _processWithTools(std::wstring_view userInput);
+        void _loadDocuments();
+        winrt::fire_and_forget _syncDocumentsAsync();
+        std::wstring _groundPrompt(std::wstring_view userInput) const;
+        Json::Value _toolDefinitions();
+        std::vector<std::wstring> _executeTools(const std::vector<StreamToolCall>& calls);
+        winrt::fire_and_forget _processWithTools(std::wstring prompt);
         
         // Helper methods to fire events
         void _FireResponseReceived(const winrt::hstring& response)
@@ -8,6 +8,7 @@ namespace Microsoft::Terminal::AI
 {
     AIChatEngine::AIChatEngine()
     {
+        _context.SetTokenBudget(_contextWindowForModel(_model));
     }
     
     winrt::fire_and_forget AIChatEngine::InitializeAsync()
@@ -18,9 +19,12 @@ namespace Microsoft::Terminal::AI
         _initialized = true;
         
         // Set default system message for chat
-        if (_systemMessage.empty())
         {
-            _systemMessage = L"You are a helpful AI assistant integrated into Windows Terminal. You help users with terminal tasks, provide command suggestions, and answer questions about computing topics.";
+            std::lock_guard lock{ _contextLock };
+            if (_context.SystemMessage().empty())
+            {
+                _context.SetSystemMessage(L"You are a helpful AI assistant integrated into Windows Terminal. You help users with terminal tasks, provide command suggestions, and answer questions about computing topics.");
+            }
         }
         
         _FireResponseReceived(L"AI Chat Engine initialized successfully");
@@ -40,19 +44,128 @@ namespace Microsoft::Terminal::AI
             co_return;
         }
         
-        // Add user message to conversation history
-        _conversationHistory.push_back(_formatChatMessage(L"user", message));
+        // The view may not outlive the first suspension point.
+        const std::wstring text{ message };
+        const auto generation = ++_responseGeneration;
         
-        // Simulate API processing delay
-        co_await winrt::resume_after(std::chrono::milliseconds(500));
+        StreamingRequest request{ _model };
+        {
+            std::lock_guard lock{ _contextLock };
+            _context.Append(L"user", text);
+            request.body = _context.BuildRequestPayload(_model, true);
+        }
+        
+        auto provider = _remoteProvider();
+        if (!provider)
+        {
+            // Without a remote provider, stream the locally generated response instead.
+            provider = std::make_shared<MockStreamingProvider>(MockStreamingProvider::FormatResponse(_generateChatResponse(text)), 64);
+        }
         
-        // Generate response (this would normally call the actual API)
-        auto response = _generateChatResponse(message);
+        co_await winrt::resume_background();
+        
+        StreamResult result;
+        try
+        {
+            result = StreamChatCompletion(*provider, request, [&](std::wstring_view token) {
+                if (_responseGeneration.load(std::memory_order_relaxed) != generation)
+                {
+                    return false;
+                }
+                TokenReceived(*this, winrt::hstring{ token });
+                return true;
+            });
+        }
+        catch (...)
+        {
+            LOG_CAUGHT_EXCEPTION();
+            result.error = L"Streaming request failed";
+        }
         
-        // Add assistant response to conversation history
-        _conversationHistory.push_back(_formatChatMessage(L"assistant", response));
+        // Keep whatever was received, even if the response was cancelled midway.
+        if (!result.text.empty())
+        {
+            std::lock_guard lock{ _contextLock };
+            _context.Append(L"assistant", result.text);
+        }
+        
+        if (result.cancelled || _responseGeneration.load(std::memory_order_relaxed) != generation)
+        {
+            co_return;
+        }
+        
+        if (!result.error.empty())
+        {
+            _FireErrorOccurred(winrt::hstring{ result.error });
+            co_return;
+        }
         
-        _FireResponseReceived(winrt::hstring(response));
+        ResponseCompleted(*this, winrt::hstring{ result.text });
+    }
+    
+    winrt::fire_and_forget AIChatEngine::ProcessCommandAsync(std::wstring_view command, ResponseCacheMode cacheMode)
+    {
+        if (!_initialized)
+        {
+            _FireErrorOccurred(L"AI Chat Engine not initialized");
+            co_return;
+        }
+        
+        if (command.empty())
+        {
+            _FireErrorOccurred(L"Command cannot be empty");
+            co_return;
+        }
+        
+        // The view may not outlive the first suspension point.
+        const std::wstring text{ command };
+        const auto providerName = _provider;
+        const auto model = _model;
+        
+        StreamingRequest request{ model };
+        std::wstring systemMessage;
+        {
+            std::lock_guard lock{ _contextLock };
+            systemMessage = _context.SystemMessage();
+        }
+        {
+            ConversationContext context;
+            context.SetSystemMessage(systemMessage);
+            context.Append(L"user", text);
+            request.body = context.BuildRequestPayload(model, true);
+        }
+        
+        auto provider = _remoteProvider();
+        // Locally generated responses must not end up in the cache under the key of the real provider.
+        const auto cacheable = provider != nullptr;
+        if (!provider)
+        {
+            provider = std::make_shared<MockStreamingProvider>(MockStreamingProvider::FormatResponse(_generateChatResponse(text)), 64);
+        }
+        
+        co_await winrt::resume_background();
+        
+        try
+        {
+            // Only the request that actually goes upstream streams its tokens.
+            // Cache hits and requests that were coalesced with it complete at once.
+            const ResponseCache::Fetch fetch = [&]() {
+                const auto result = StreamChatCompletion(*provider, request, [&](std::wstring_view token) {
+                    TokenReceived(*this, winrt::hstring{ token });
+                    return true;
+                });
+                // Errors must not be cached.
+                THROW_HR_IF_MSG(E_FAIL, !result.error.empty(), "%ls", result.error.c_str());
+                return result.text;
+            };
+            const auto response = cacheable ? _cachedResponse({ providerName, model, systemMessage, text, {} }, cacheMode, fetch) : fetch();
+            ResponseCompleted(*this, winrt::hstring{ response });
+        }
+        catch (...)
+        {
+            LOG_CAUGHT_EXCEPTION();
+            _FireErrorOccurred(L"Command request failed");
+        }
     }
     
     winrt::fire_and_forget AIChatEngine::ExecuteCommandAsync(std::wstring_view command)
@@ -70,26 +183,55 @@ namespace Microsoft::Terminal::AI
     void AIChatEngine::SetProvider(std::wstring_view provider)
     {
         _provider = provider;
+        _httpProvider = nullptr;
     }
     
     void AIChatEngine::SetModel(std::wstring_view model)
     {
         _model = model;
+        
+        std::lock_guard lock{ _contextLock };
+        _context.SetTokenBudget(_contextWindowForModel(_model));
     }
     
     void AIChatEngine::SetAPIKey(std::wstring_view apiKey)
     {
         _apiKey = apiKey;
+        _httpProvider = nullptr;
+    }
+    
+    void AIChatEngine::SetStreamingProvider(std::shared_ptr<IStreamingProvider> provider)
+    {
+        _streamingProvider = std::move(provider);
+    }
+    
+    void AIChatEngine::CancelResponse() noexcept
+    {
+        ++_responseGeneration;
     }
     
     void AIChatEngine::ClearConversationHistory()
     {
-        _conversationHistory.clear();
+        std::lock_guard lock{ _contextLock };
+        _context.Clear();
     }
     
     void AIChatEngine::SetSystemMessage(std::wstring_view systemMessage)
     {
-        _systemMessage = systemMessage;
+        std::lock_guard lock{ _contextLock };
+        _context.SetSystemMessage(systemMessage);
+    }
+    
+    void AIChatEngine::SetTokenizer(std::shared_ptr<const ITokenizer> tokenizer)
+    {
+        std::lock_guard lock{ _contextLock };
+        _context.SetTokenizer(std::move(tokenizer));
+    }
+    
+    void AIChatEngine::SetSummarizer(ConversationContext::Summarizer summarizer)
+    {
+        std::lock_guard lock{ _contextLock };
+        _context.SetSummarizer(std::move(summarizer));
     }
     
     bool AIChatEngine::IsReady() const
@@ -97,20 +239,48 @@ namespace Microsoft::Terminal::AI
         return _initialized;
     }
     
-    winrt::fire_and_forget AIChatEngine::_makeAPIRequest(std::wstring_view endpoint, std::wstring_view payload)
+    // Returns the provider that requests are sent to: the one set via SetStreamingProvider(),
+    // OpenAI via the shared HTTP transport if an API key was given, or null otherwise.
+    std::shared_ptr<IStreamingProvider> AIChatEngine::_remoteProvider()
     {
-        // TODO: Implement actual API request logic here
-        // This would make HTTP requests to OpenAI, Azure, or other providers
-        co_await winrt::resume_after(std::chrono::milliseconds(100));
+        if (_streamingProvider)
+        {
+            return _streamingProvider;
+        }
         
-        // For now, this is a placeholder for future implementation
-        UNREFERENCED_PARAMETER(endpoint);
-        UNREFERENCED_PARAMETER(payload);
+        if (_apiKey.empty() || _provider != L"openai")
+        {
+            return nullptr;
+        }
+        
+        if (!_httpProvider)
+        {
+            _httpProvider = std::make_shared<HttpStreamingProvider>(HttpTransport::Shared(), HttpEndpoint{ L"api.openai.com" }, L"/v1/chat/completions", _apiKey);
+        }
+        return _httpProvider;
     }
     
-    std::wstring AIChatEngine::_formatChatMessage(std::wstring_view role, std::wstring_view content)
+    // Returns the number of prompt tokens available for the given model,
+    // leaving room for a response of up to 1024 tokens.
+    size_t AIChatEngine::_contextWindowForModel(std::wstring_view model) noexcept
     {
-        return std::wstring(role) + L": " + std::wstring(content);
+        static constexpr size_t responseReserve = 1024;
+        
+        size_t window = 8192;
+        if (model.starts_with(L"gpt-4o") || model.starts_with(L"gpt-4-turbo"))
+        {
+            window = 128000;
+        }
+        else if (model.starts_with(L"gpt-4-32k"))
+        {
+            window = 32768;
+        }
+        else if (model.starts_with(L"gpt-3.5-turbo"))
+        {
+            window = 16385;
+        }
+        
+        return window - responseReserve;
     }
     
     std::wstring AIChatEngine::_generateChatResponse(std::wstring_view message)
@@ -2,6 +2,9 @@
 
 #include "pch.h"
 #include "AIEngine.h"
+#include "AIStreaming.h"
+#include "ConversationContext.h"
+#include "HttpTransport.h"
 
 namespace Microsoft::Terminal::AI
 {
@@ -13,16 +16,29 @@ namespace Microsoft::Terminal::AI
         
         winrt::fire_and_forget InitializeAsync() override;
         winrt::fire_and_forget ChatAsync(std::wstring_view message) override;
+        // Unlike ChatAsync(), commands are answered without the conversation history,
+        // so that repeating one can be answered from the response cache.
+        winrt::fire_and_forget ProcessCommandAsync(std::wstring_view command, ResponseCacheMode cacheMode = ResponseCacheMode::Use) override;
         winrt::fire_and_forget ExecuteCommandAsync(std::wstring_view command) override;
         
         // AIChat specific features
         void SetProvider(std::wstring_view provider);
         void SetModel(std::wstring_view model);
         void SetAPIKey(std::wstring_view apiKey);
+        void SetStreamingProvider(std::shared_ptr<IStreamingProvider> provider);
+        
+        // Streaming responses: TokenReceived fires for each partial token as it arrives,
+        // followed by ResponseCompleted with the full text once the stream has ended.
+        // ChatAsync() implicitly cancels any response that's still in flight.
+        void CancelResponse() noexcept;
+        winrt::event<winrt::Windows::Foundation::TypedEventHandler<AIEngine, winrt::hstring>> TokenReceived;
+        winrt::event<winrt::Windows::Foundation::TypedEventHandler<AIEngine, winrt::hstring>> ResponseCompleted;
         
         // Conversation management
         void ClearConversationHistory();
         void SetSystemMessage(std::wstring_view systemMessage);
+        void SetTokenizer(std::shared_ptr<const ITokenizer> tokenizer);
+        void SetSummarizer(ConversationContext::Summarizer summarizer);
         
         bool IsReady() const override;
         
@@ -30,12 +46,16 @@ namespace Microsoft::Terminal::AI
         std::wstring _provider{ L"openai" };
         std::wstring _model{ L"gpt-4" };
         std::wstring _apiKey;
-        std::vector<std::wstring> _conversationHistory;
-        std::wstring _systemMessage;
+        // Guards _context, which is appended to from both the caller and the streaming thread.
+        std::mutex _contextLock;
+        ConversationContext _context;
+        std::shared_ptr<IStreamingProvider> _streamingProvider;
+        std::shared_ptr<IStreamingProvider> _httpProvider;
+        std::atomic<uint32_t> _responseGeneration{ 0 };
         bool _initialized = false;
         
-        winrt::fire_and_forget _makeAPIRequest(std::wstring_view endpoint, std::wstring_view payload);
-        std::wstring _formatChatMessage(std::wstring_view role, std::wstring_view content);
+        std::shared_ptr<IStreamingProvider> _remoteProvider();
+        static size_t _contextWindowForModel(std::wstring_view model) noexcept;
         std::wstring _generateChatResponse(std::wstring_view message);
     };
 }
\ No newline at end of file
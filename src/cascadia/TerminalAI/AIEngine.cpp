@@ -6,6 +6,27 @@ using namespace winrt::Windows::Foundation;
 
 namespace Microsoft::Terminal::AI
 {
+    std::filesystem::path CacheDirectory()
+    {
+        const std::filesystem::path settingsDirectory{ std::wstring_view{ winrt::Microsoft::Terminal::Settings::Model::CascadiaSettings::SettingsDirectory() } };
+        return settingsDirectory / L"cache";
+    }
+    
+    const std::shared_ptr<ResponseCache>& AIEngine::SharedResponseCache()
+    {
+        static const auto cache = []() {
+            // Falls back to a cache that's only kept in memory, if there's no settings directory.
+            std::filesystem::path logPath;
+            try
+            {
+                logPath = CacheDirectory() / L"responses.log";
+            }
+            CATCH_LOG();
+            return std::make_shared<ResponseCache>(std::move(logPath));
+        }();
+        return cache;
+    }
+    
     BasicAIEngine::BasicAIEngine()
     {
     }
@@ -19,7 +40,8 @@ namespace Microsoft::Terminal::AI
         _FireResponseReceived(L"AI Engine initialized successfully");
     }
     
-    winrt::fire_and_forget BasicAIEngine::ProcessCommandAsync(std::wstring_view command)
+    // The responses are canned, so there's nothing worth caching.
+    winrt::fire_and_forget BasicAIEngine::ProcessCommandAsync(std::wstring_view command, ResponseCacheMode /*cacheMode*/)
     {
         if (!_initialized)
         {
@@ -27,11 +49,13 @@ namespace Microsoft::Terminal::AI
             co_return;
         }
         
+        // The view may not outlive the first suspension point.
+        const std::wstring text{ command };
+        
         // Simulate processing delay
         co_await winrt::resume_after(std::chrono::milliseconds(200));
         
-        auto response = _generateBasicResponse(command);
-        _FireResponseReceived(response);
+        _FireResponseReceived(_generateBasicResponse(text));
     }
     
     winrt::fire_and_forget BasicAIEngine::ChatAsync(std::wstring_view message)
@@ -42,21 +66,24 @@ namespace Microsoft::Terminal::AI
             co_return;
         }
         
+        // The view may not outlive the first suspension point.
+        const std::wstring text{ message };
+        
         // Simulate chat processing
         co_await winrt::resume_after(std::chrono::milliseconds(300));
         
         std::wstring response = L"AI: ";
-        if (message == L"hello" || message == L"hi")
+        if (text == L"hello" || text == L"hi")
         {
             response += L"Hello! How can I help you with your terminal tasks?";
         }
-        else if (message.find(L"help") != std::wstring::npos)
+        else if (text.find(L"help") != std::wstring::npos)
         {
             response += L"I can help you with command suggestions, explanations, and terminal navigation.";
         }
         else
         {
-            response += L"I understand you said: " + std::wstring(message) + L". How can I assist you further?";
+            response += L"I understand you said: " + text + L". How can I assist you further?";
         }
         
         _FireResponseReceived(winrt::hstring(response));
@@ -70,13 +97,17 @@ namespace Microsoft::Terminal::AI
             co_return;
         }
         
+        // The views may not outlive the first suspension point.
+        const std::wstring name{ functionName };
+        const std::wstring arguments{ args };
+        
         // Simulate function execution
         co_await winrt::resume_after(std::chrono::milliseconds(150));
         
-        std::wstring response = L"Executed function: " + std::wstring(functionName);
-        if (!args.empty())
+        std::wstring response = L"Executed function: " + name;
+        if (!arguments.empty())
         {
-            response += L" with args: " + std::wstring(args);
+            response += L" with args: " + arguments;
         }
         
         _FireResponseReceived(winrt::hstring(response));
@@ -1,9 +1,13 @@
 #pragma once
 
 #include "pch.h"
+#include "ResponseCache.h"
 
 namespace Microsoft::Terminal::AI
 {
+    // The directory next to settings.json that caches are persisted in.
+    std::filesystem::path CacheDirectory();
+    
     // Core AI engine interface for terminal AI integration
     class AIEngine
     {
@@ -13,10 +17,12 @@ namespace Microsoft::Terminal::AI
         // Initialize the AI engine with configuration
         virtual winrt::fire_and_forget InitializeAsync() = 0;
         
-        // Process a command with AI assistance
-        virtual winrt::fire_and_forget ProcessCommandAsync(std::wstring_view command) = 0;
+        // Process a command with AI assistance. Responses are served from the response cache, if
+        // the engine has one, unless `cacheMode` says otherwise.
+        virtual winrt::fire_and_forget ProcessCommandAsync(std::wstring_view command, ResponseCacheMode cacheMode = ResponseCacheMode::Use) = 0;
         
-        // Start an AI chat session
+        // Start an AI chat session. Callers don't keep `message` alive, so implementations
+        // must copy it before their first suspension point.
         virtual winrt::fire_and_forget ChatAsync(std::wstring_view message) = 0;
         
         // Execute an AI function with arguments
@@ -25,11 +31,38 @@ namespace Microsoft::Terminal::AI
         // Check if the engine is initialized and ready
         virtual bool IsReady() const = 0;
         
+        // Null disables caching. Unless this is called, engines use the process-wide cache from
+        // SharedResponseCache(), which is only loaded once the first cacheable request comes in.
+        void SetResponseCache(std::shared_ptr<ResponseCache> cache) noexcept
+        {
+            _responseCache = std::move(cache);
+            _hasResponseCache = true;
+        }
+        
+        const std::shared_ptr<ResponseCache>& GetResponseCache() const
+        {
+            return _hasResponseCache ? _responseCache : SharedResponseCache();
+        }
+        
+        // The cache shared by all engines, persisted next to settings.json.
+        static const std::shared_ptr<ResponseCache>& SharedResponseCache();
+        
         // Events for AI responses and errors
         winrt::event<winrt::Windows::Foundation::TypedEventHandler<AIEngine, winrt::hstring>> ResponseReceived;
         winrt::event<winrt::Windows::Foundation::TypedEventHandler<AIEngine, winrt::hstring>> ErrorOccurred;
         
     protected:
+        std::shared_ptr<ResponseCache> _responseCache;
+        bool _hasResponseCache = false;
+        
+        // Returns the cached response to `request`, or fetches it. Call off the UI thread, since
+        // this blocks while an identical request is in flight, and may load the cache from disk.
+        std::wstring _cachedResponse(const ResponseCacheRequest& request, ResponseCacheMode cacheMode, const ResponseCache::Fetch& fetch) const
+        {
+            const auto& cache = GetResponseCache();
+            return cache ? cache->GetOrFetch(request, fetch, cacheMode) : fetch();
+        }
+        
         // Helper method to fire response received event
         void _FireResponseReceived(const winrt::hstring& response)
         {
@@ -50,7 +83,7 @@ namespace Microsoft::Terminal::AI
         BasicAIEngine();
         
         winrt::fire_and_forget InitializeAsync() override;
-        winrt::fire_and_forget ProcessCommandAsync(std::wstring_view command) override;
+        winrt::fire_and_forget ProcessCommandAsync(std::wstring_view command, ResponseCacheMode cacheMode = ResponseCacheMode::Use) override;
         winrt::fire_and_forget ChatAsync(std::wstring_view message) override;
         winrt::fire_and_forget ExecuteFunctionAsync(std::wstring_view functionName, std::wstring_view args) override;
         bool IsReady() const override;
@@ -0,0 +1,532 @@
+#include "pch.h"
+#include "AIStreaming.h"
+
+#include <thread>
+
+namespace Microsoft::Terminal::AI
+{
+    void SseParser::Feed(std::string_view chunk, const EventCallback& callback)
+    {
+        size_t pos = 0;
+
+        // The previous chunk ended in a CR. If this one starts with the matching LF, it's a CRLF.
+        if (_skipLF && !chunk.empty())
+        {
+            _skipLF = false;
+            if (chunk.front() == '\n')
+            {
+                pos = 1;
+            }
+        }
+
+        while (pos < chunk.size())
+        {
+            const auto end = chunk.find_first_of("\r\n", pos);
+            if (end == std::string_view::npos)
+            {
+                _line.append(chunk.substr(pos));
+                break;
+            }
+
+            const auto piece = chunk.substr(pos, end - pos);
+            if (_line.empty())
+            {
+                // Fast path: the whole line is contained in this chunk.
+                _processLine(piece, callback);
+            }
+            else
+            {
+                _line.append(piece);
+                _processLine(_line, callback);
+                _line.clear();
+            }
+
+            pos = end + 1;
+            if (chunk[end] == '\r')
+            {
+                if (pos == chunk.size())
+                {
+                    _skipLF = true;
+                }
+                else if (chunk[pos] == '\n')
+                {
+                    ++pos;
+                }
+            }
+        }
+    }
+
+    void SseParser::Reset() noexcept
+    {
+        _line.clear();
+        _event.type.clear();
+        _event.data.clear();
+        _event.id.clear();
+        _hasData = false;
+        _skipLF = false;
+    }
+
+    void SseParser::_processLine(std::string_view line, const EventCallback& callback)
+    {
+        // An empty line dispatches the event. Events without any data are dropped.
+        if (line.empty())
+        {
+            if (_hasData)
+            {
+                callback(_event);
+            }
+
+            // The last event ID intentionally persists across events.
+            _event.type.clear();
+            _event.data.clear();
+            _hasData = false;
+            return;
+        }
+
+        // Comments are commonly used as keep-alives.
+        if (line.front() == ':')
+        {
+            return;
+        }
+
+        const auto colon = line.find(':');
+        const auto field = line.substr(0, colon);
+        std::string_view value;
+        if (colon != std::string_view::npos)
+        {
+            value = line.substr(colon + 1);
+            if (!value.empty() && value.front() == ' ')
+            {
+                value.remove_prefix(1);
+            }
+        }
+
+        if (field == "data")
+        {
+            if (_hasData)
+            {
+                _event.data.push_back('\n');
+            }
+            _event.data.append(value);
+            _hasData = true;
+        }
+        else if (field == "event")
+        {
+            _event.type.assign(value);
+        }
+        else if (field == "id")
+        {
+            _event.id.assign(value);
+        }
+        // "retry" and unknown fields are ignored.
+    }
+
+    StreamChunk ParseChatCompletionChunk(std::string_view data)
+    {
+        if (data == "[DONE]")
+        {
+            return { StreamChunkKind::Done, {} };
+        }
+
+        Json::Value root;
+        std::string errors;
+        const std::unique_ptr<Json::CharReader> reader{ Json::CharReaderBuilder{}.newCharReader() };
+        if (!reader->parse(data.data(), data.data() + data.size(), &root, &errors) || !root.isObject())
+        {
+            return { StreamChunkKind::Error, "Malformed stream chunk" };
+        }
+
+        if (const auto& error = root["error"]; error.isObject())
+        {
+            const auto& message = error["message"];
+            return { StreamChunkKind::Error, message.isString() ? message.asString() : "Unknown error" };
+        }
+
+        const auto& choices = root["choices"];
+        if (!choices.isArray() || choices.empty() || !choices[0].isObject())
+        {
+            return {};
+        }
+
+        const auto& delta = choices[0]["delta"];
+        if (!delta.isObject())
+        {
+            return {};
+        }
+
+        StreamChunk chunk;
+
+        if (const auto& content = delta["content"]; content.isString())
+        {
+            chunk.kind = StreamChunkKind::Content;
+            chunk.text = content.asString();
+        }
+
+        if (const auto& toolCalls = delta["tool_calls"]; toolCalls.isArray())
+        {
+            for (const auto& toolCall : toolCalls)
+            {
+                if (!toolCall.isObject())
+                {
+                    continue;
+                }
+
+                auto& call = chunk.toolCalls.emplace_back();
+                const auto& index = toolCall["index"];
+                call.index = index.isUInt() ? index.asUInt() : chunk.toolCalls.size() - 1;
+                if (const auto& id = toolCall["id"]; id.isString())
+                {
+                    call.id = id.asString();
+                }
+                if (const auto& function = toolCall["function"]; function.isObject())
+                {
+                    if (const auto& name = function["name"]; name.isString())
+                    {
+                        call.name = name.asString();
+                    }
+                    if (const auto& arguments = function["arguments"]; arguments.isString())
+                    {
+                        call.arguments = arguments.asString();
+                    }
+                }
+            }
+
+            if (!chunk.toolCalls.empty())
+            {
+                chunk.kind = StreamChunkKind::ToolCall;
+            }
+        }
+
+        return chunk;
+    }
+
+    MockStreamingProvider::MockStreamingProvider(std::string body, size_t chunkSize, std::chrono::milliseconds chunkDelay) :
+        _body{ std::move(body) },
+        _chunkSize{ std::max<size_t>(chunkSize, 1) },
+        _chunkDelay{ chunkDelay }
+    {
+    }
+
+    std::string MockStreamingProvider::FormatResponse(std::wstring_view response)
+    {
+        Json::StreamWriterBuilder builder;
+        builder["indentation"] = "";
+        builder["emitUTF8"] = true;
+
+        const auto utf8 = til::u16u8(response);
+        std::string body;
+
+        // Split after each space, so that concatenating the deltas yields the original text.
+        size_t pos = 0;
+        while (pos < utf8.size())
+        {
+            const auto space = utf8.find(' ', pos);
+            const auto end = space == std::string::npos ? utf8.size() : space + 1;
+
+            Json::Value chunk;
+            chunk["object"] = "chat.completion.chunk";
+            chunk["choices"][0]["index"] = 0;
+            chunk["choices"][0]["delta"]["content"] = utf8.substr(pos, end - pos);
+
+            body.append("data: ");
+            body.append(Json::writeString(builder, chunk));
+            body.append("\n\n");
+            pos = end;
+        }
+
+        body.append("data: [DONE]\n\n");
+        return body;
+    }
+
+    std::string MockStreamingProvider::FormatToolCalls(const std::vector<StreamToolCall>& calls, size_t fragmentSize)
+    {
+        Json::StreamWriterBuilder builder;
+        builder["indentation"] = "";
+        builder["emitUTF8"] = true;
+
+        fragmentSize = std::max<size_t>(fragmentSize, 1);
+        std::string body;
+
+        const auto appendDelta = [&](const Json::Value& toolCall) {
+            Json::Value chunk;
+            chunk["object"] = "chat.completion.chunk";
+            chunk["choices"][0]["index"] = 0;
+            chunk["choices"][0]["delta"]["tool_calls"][0] = toolCall;
+
+            body.append("data: ");
+            body.append(Json::writeString(builder, chunk));
+            body.append("\n\n");
+        };
+
+        for (size_t i = 0; i < calls.size(); i++)
+        {
+            const auto& call = calls[i];
+
+            Json::Value toolCall;
+            toolCall["index"] = static_cast<Json::UInt>(i);
+            toolCall["id"] = til::u16u8(call.id);
+            toolCall["type"] = "function";
+            toolCall["function"]["name"] = til::u16u8(call.name);
+            toolCall["function"]["arguments"] = "";
+            appendDelta(toolCall);
+
+            const auto arguments = til::u16u8(call.arguments);
+            size_t pos = 0;
+            while (pos < arguments.size())
+            {
+                // Fragments must not end in the middle of a UTF-8 sequence, since each is a JSON string of its own.
+                auto end = std::min(pos + fragmentSize, arguments.size());
+                while (end < arguments.size() && (arguments[end] & 0xC0) == 0x80)
+                {
+                    end++;
+                }
+
+                Json::Value fragment;
+                fragment["index"] = static_cast<Json::UInt>(i);
+                fragment["function"]["arguments"] = arguments.substr(pos, end - pos);
+                appendDelta(fragment);
+                pos = end;
+            }
+        }
+
+        body.append("data: [DONE]\n\n");
+        return body;
+    }
+
+    void MockStreamingProvider::Stream(const StreamingRequest& /*request*/, const ChunkCallback& onChunk)
+    {
+        const std::string_view body{ _body };
+        for (size_t pos = 0; pos < body.size(); pos += _chunkSize)
+        {
+            if (_chunkDelay.count() > 0)
+            {
+                std::this_thread::sleep_for(_chunkDelay);
+            }
+            if (!onChunk(body.substr(pos, _chunkSize)))
+            {
+                return;
+            }
+        }
+    }
+
+    ReplayStreamingProvider::ReplayStreamingProvider(std::vector<std::string> responses, ReplayPacing pacing) :
+        _responses{ std::move(responses) },
+        _pacing{ pacing }
+    {
+        // Split each response after each blank line, which is where an event ends.
+        _events.reserve(_responses.size());
+        for (const std::string_view body : _responses)
+        {
+            auto& events = _events.emplace_back();
+            size_t beg = 0;
+            size_t pos = 0;
+            while ((pos = body.find('\n', pos)) != std::string_view::npos)
+            {
+                pos++;
+                if (body.substr(pos, 1) == "\n")
+                {
+                    pos += 1;
+                }
+                else if (body.substr(pos, 2) == "\r\n")
+                {
+                    pos += 2;
+                }
+                else
+                {
+                    continue;
+                }
+                events.emplace_back(body.substr(beg, pos - beg));
+                beg = pos;
+            }
+            if (beg < body.size())
+            {
+                events.emplace_back(body.substr(beg));
+            }
+        }
+    }
+
+    std::vector<std::string> ReplayStreamingProvider::SplitRecording(std::string_view recording)
+    {
+        std::vector<std::string> responses;
+        SseParser parser;
+        size_t beg = 0;
+        size_t pos = 0;
+
+        // Feed the recording a line at a time, so that we know where the [DONE] event ended.
+        while (pos < recording.size())
+        {
+            auto end = recording.find('\n', pos);
+            end = end == std::string_view::npos ? recording.size() : end + 1;
+
+            auto done = false;
+            parser.Feed(recording.substr(pos, end - pos), [&](const SseEvent& event) {
+                done = ParseChatCompletionChunk(event.data).kind == StreamChunkKind::Done;
+            });
+            pos = end;
+
+            if (done)
+            {
+                responses.emplace_back(recording.substr(beg, pos - beg));
+                beg = pos;
+            }
+        }
+
+        // A response that was cut short is replayed as is.
+        if (recording.find_first_not_of(" \t\r\n", beg) != std::string_view::npos)
+        {
+            responses.emplace_back(recording.substr(beg));
+        }
+        return responses;
+    }
+
+    std::vector<std::string> ReplayStreamingProvider::LoadRecording(const std::filesystem::path& path)
+    {
+        const auto recording = til::io::read_file_as_utf8_string_if_exists(path);
+        THROW_HR_IF(HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND), recording.empty());
+        return SplitRecording(recording);
+    }
+
+    void ReplayStreamingProvider::Stream(const StreamingRequest& /*request*/, const ChunkCallback& onChunk)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        _requests.fetch_add(1, std::memory_order_relaxed);
+        if (_events.empty())
+        {
+            return;
+        }
+
+        const auto& events = _events[_next.fetch_add(1, std::memory_order_relaxed) % _events.size()];
+        for (size_t i = 0; i < events.size(); i++)
+        {
+            // Each event is due at a fixed time after the request, so that delays don't add up
+            // when the consumer is slow or the thread wakes up late.
+            auto due = _pacing.firstEventDelay;
+            if (_pacing.eventsPerSecond > 0)
+            {
+                due += std::chrono::microseconds{ static_cast<int64_t>(i * 1e6 / _pacing.eventsPerSecond) };
+            }
+            if (due.count() > 0)
+            {
+                std::this_thread::sleep_until(start + due);
+            }
+
+            if (!onChunk(events[i]))
+            {
+                return;
+            }
+        }
+    }
+
+    size_t ReplayStreamingProvider::Requests() const noexcept
+    {
+        return _requests.load(std::memory_order_relaxed);
+    }
+
+    void ReplayStreamingProvider::Rewind() noexcept
+    {
+        _next.store(0, std::memory_order_relaxed);
+    }
+
+    StreamResult StreamChatCompletion(IStreamingProvider& provider, const StreamingRequest& request, const std::function<bool(std::wstring_view)>& onToken)
+    {
+        // The pieces of a tool call as they arrived, by the index the provider gave it.
+        struct PendingToolCall
+        {
+            std::string id;
+            std::string name;
+            std::string arguments;
+        };
+
+        StreamResult result;
+        SseParser parser;
+        std::wstring token;
+        std::vector<PendingToolCall> toolCalls;
+        bool finished = false;
+
+        const auto onContent = [&](const std::string& text) {
+            if (text.empty() || FAILED_LOG(til::u8u16(text, token)))
+            {
+                return;
+            }
+            result.text.append(token);
+            result.tokens++;
+            if (!onToken(token))
+            {
+                result.cancelled = true;
+                finished = true;
+            }
+        };
+
+        const auto onEvent = [&](const SseEvent& event) {
+            if (finished)
+            {
+                return;
+            }
+
+            const auto chunk = ParseChatCompletionChunk(event.data);
+            switch (chunk.kind)
+            {
+            case StreamChunkKind::Content:
+                onContent(chunk.text);
+                break;
+            case StreamChunkKind::ToolCall:
+                for (const auto& delta : chunk.toolCalls)
+                {
+                    // Indices count up from 0. Anything else would make us allocate whatever the provider says.
+                    if (delta.index > toolCalls.size())
+                    {
+                        result.error = L"Malformed tool call";
+                        finished = true;
+                        return;
+                    }
+                    if (delta.index == toolCalls.size())
+                    {
+                        toolCalls.emplace_back();
+                    }
+                    auto& call = toolCalls[delta.index];
+                    call.id.append(delta.id);
+                    call.name.append(delta.name);
+                    call.arguments.append(delta.arguments);
+                }
+                onContent(chunk.text);
+                break;
+            case StreamChunkKind::Error:
+                result.error = til::u8u16(chunk.text);
+                finished = true;
+                break;
+            case StreamChunkKind::Done:
+                finished = true;
+                break;
+            default:
+                break;
+            }
+        };
+
+        provider.Stream(request, [&](std::string_view bytes) {
+            parser.Feed(bytes, onEvent);
+            return !finished;
+        });
+
+        if (result.cancelled || !result.error.empty())
+        {
+            return result;
+        }
+
+        result.toolCalls.reserve(toolCalls.size());
+        for (const auto& pending : toolCalls)
+        {
+            auto& call = result.toolCalls.emplace_back();
+            if (FAILED_LOG(til::u8u16(pending.id, call.id)) ||
+                FAILED_LOG(til::u8u16(pending.name, call.name)) ||
+                FAILED_LOG(til::u8u16(pending.arguments, call.arguments)) ||
+                call.name.empty())
+            {
+                result.toolCalls.clear();
+                result.error = L"Malformed tool call";
+                break;
+            }
+        }
+
+        return result;
+    }
+}
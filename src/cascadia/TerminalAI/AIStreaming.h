@@ -0,0 +1,165 @@
+#pragma once
+
+#include "pch.h"
+
+namespace Microsoft::Terminal::AI
+{
+    // A single server-sent event. `type` is empty for the default "message" event.
+    struct SseEvent
+    {
+        std::string type;
+        std::string data;
+        std::string id;
+    };
+
+    // Incremental text/event-stream parser.
+    // Chunks may be split at arbitrary byte offsets (including in the middle of a
+    // UTF-8 sequence or a CRLF pair) - incomplete lines are buffered until the next Feed().
+    class SseParser
+    {
+    public:
+        using EventCallback = std::function<void(const SseEvent&)>;
+
+        void Feed(std::string_view chunk, const EventCallback& callback);
+        void Reset() noexcept;
+
+    private:
+        std::string _line;
+        SseEvent _event;
+        bool _hasData = false;
+        bool _skipLF = false;
+
+        void _processLine(std::string_view line, const EventCallback& callback);
+    };
+
+    enum class StreamChunkKind
+    {
+        Content,
+        ToolCall,
+        Done,
+        Error,
+        Other,
+    };
+
+    // A piece of a tool call. The first delta of each call carries its ID and name,
+    // the following ones carry consecutive fragments of the JSON arguments.
+    struct StreamToolCallDelta
+    {
+        size_t index = 0;
+        std::string id;
+        std::string name;
+        std::string arguments;
+    };
+
+    struct StreamChunk
+    {
+        StreamChunkKind kind = StreamChunkKind::Other;
+        std::string text;
+        std::vector<StreamToolCallDelta> toolCalls;
+    };
+
+    // Interprets the data of an OpenAI-style "chat.completion.chunk" event.
+    // `text` holds the UTF-8 delta for Content and the message for Error chunks.
+    // ToolCall chunks may carry content as well.
+    StreamChunk ParseChatCompletionChunk(std::string_view data);
+
+    // A tool call the model asked for, assembled from its deltas.
+    struct StreamToolCall
+    {
+        std::wstring id;
+        std::wstring name;
+        // Usually a JSON object.
+        std::wstring arguments;
+    };
+
+    struct StreamingRequest
+    {
+        std::wstring model;
+        // The UTF-8 JSON request body, see ConversationContext::BuildRequestPayload().
+        std::string body;
+    };
+
+    // A provider delivers the raw response body of a streaming chat request as it arrives.
+    class IStreamingProvider
+    {
+    public:
+        // Returning false from the callback cancels the request.
+        using ChunkCallback = std::function<bool(std::string_view)>;
+
+        virtual ~IStreamingProvider() = default;
+        virtual void Stream(const StreamingRequest& request, const ChunkCallback& onChunk) = 0;
+    };
+
+    // Serves a canned event stream in fixed-size chunks, optionally paced by a delay.
+    // Used in place of a remote endpoint until a real transport is hooked up, and by the tests.
+    class MockStreamingProvider : public IStreamingProvider
+    {
+    public:
+        MockStreamingProvider(std::string body, size_t chunkSize, std::chrono::milliseconds chunkDelay = {});
+
+        // Formats `response` as an event stream with one chat.completion.chunk per word.
+        static std::string FormatResponse(std::wstring_view response);
+        // Formats the tool calls as an event stream, with the arguments split into `fragmentSize` pieces, like providers do.
+        static std::string FormatToolCalls(const std::vector<StreamToolCall>& calls, size_t fragmentSize = 8);
+
+        void Stream(const StreamingRequest& request, const ChunkCallback& onChunk) override;
+
+    private:
+        std::string _body;
+        size_t _chunkSize;
+        std::chrono::milliseconds _chunkDelay;
+    };
+
+    struct ReplayPacing
+    {
+        // The delay until the first event of each response is delivered.
+        std::chrono::microseconds firstEventDelay{};
+        // The rate at which the following events are delivered. Providers send about one
+        // event per token, so this is the token rate. 0 delivers them all at once.
+        double eventsPerSecond = 0;
+    };
+
+    // Replays recorded event streams, like the bodies captured from a provider's chat completions
+    // endpoint. Each request is answered with the next recorded response, in order, and the
+    // recording starts over after the last one, so that one recording can drive repeated runs.
+    // Each event is delivered as a chunk of its own on a fixed schedule relative to the request,
+    // so the replay is the same every time, apart from how precisely the thread wakes up.
+    class ReplayStreamingProvider : public IStreamingProvider
+    {
+    public:
+        explicit ReplayStreamingProvider(std::vector<std::string> responses, ReplayPacing pacing = {});
+
+        // Splits a recording of consecutive responses after each "[DONE]" event.
+        static std::vector<std::string> SplitRecording(std::string_view recording);
+        // Reads a recording file. Throws if it doesn't exist.
+        static std::vector<std::string> LoadRecording(const std::filesystem::path& path);
+
+        void Stream(const StreamingRequest& request, const ChunkCallback& onChunk) override;
+
+        size_t Requests() const noexcept;
+        // Answers the next request with the first response again.
+        void Rewind() noexcept;
+
+    private:
+        std::vector<std::string> _responses;
+        // The events of each response, as views into _responses, so that replaying doesn't allocate.
+        std::vector<std::vector<std::string_view>> _events;
+        ReplayPacing _pacing;
+        std::atomic<size_t> _requests{ 0 };
+        std::atomic<size_t> _next{ 0 };
+    };
+
+    struct StreamResult
+    {
+        std::wstring text;
+        std::wstring error;
+        std::vector<StreamToolCall> toolCalls;
+        size_t tokens = 0;
+        bool cancelled = false;
+    };
+
+    // Runs `request` against `provider` and forwards each decoded token to `onToken` as it arrives.
+    // Returning false from `onToken` cancels the stream. The accumulated text is returned either way.
+    // Tool calls are only returned once the stream completed, since their arguments arrive in pieces.
+    StreamResult StreamChatCompletion(IStreamingProvider& provider, const StreamingRequest& request, const std::function<bool(std::wstring_view)>& onToken);
+}
@@ -0,0 +1,299 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include "AIStreaming.h"
+
+#include <chrono>
+
+using namespace Microsoft::Terminal::AI;
+using namespace WEX::Common;
+using namespace WEX::Logging;
+
+namespace
+{
+    std::vector<SseEvent> parseAll(std::initializer_list<std::string_view> chunks)
+    {
+        std::vector<SseEvent> events;
+        SseParser parser;
+        for (const auto chunk : chunks)
+        {
+            parser.Feed(chunk, [&](const SseEvent& event) { events.push_back(event); });
+        }
+        return events;
+    }
+}
+
+class AIStreamingTests
+{
+    TEST_CLASS(AIStreamingTests);
+
+    TEST_METHOD(ParseEventFields)
+    {
+        const auto events = parseAll({ ": keep-alive\n", "event: delta\nid: 7\ndata: a\ndata:b\n\n", "data\n\n", "event: empty\n\n" });
+
+        VERIFY_ARE_EQUAL(size_t(2), events.size());
+        VERIFY_ARE_EQUAL(std::string{ "delta" }, events[0].type);
+        VERIFY_ARE_EQUAL(std::string{ "7" }, events[0].id);
+        VERIFY_ARE_EQUAL(std::string{ "a\nb" }, events[0].data);
+
+        // The last event ID persists, the type doesn't.
+        VERIFY_ARE_EQUAL(std::string{}, events[1].type);
+        VERIFY_ARE_EQUAL(std::string{ "7" }, events[1].id);
+        VERIFY_ARE_EQUAL(std::string{}, events[1].data);
+    }
+
+    TEST_METHOD(ParseLineEndings)
+    {
+        Log::Comment(L"CRLF, CR and LF terminated lines, with a CRLF pair split across chunks");
+        const auto events = parseAll({ "data: 1\r\n\r\ndata: 2\r\r", "data: 3\r", "\n\r", "\ndata: 4\n\n" });
+
+        VERIFY_ARE_EQUAL(size_t(4), events.size());
+        VERIFY_ARE_EQUAL(std::string{ "1" }, events[0].data);
+        VERIFY_ARE_EQUAL(std::string{ "2" }, events[1].data);
+        VERIFY_ARE_EQUAL(std::string{ "3" }, events[2].data);
+        VERIFY_ARE_EQUAL(std::string{ "4" }, events[3].data);
+    }
+
+    TEST_METHOD(ParseChatCompletionChunks)
+    {
+        auto chunk = ParseChatCompletionChunk(R"({"choices":[{"index":0,"delta":{"content":"Hi"}}]})");
+        VERIFY_ARE_EQUAL(StreamChunkKind::Content, chunk.kind);
+        VERIFY_ARE_EQUAL(std::string{ "Hi" }, chunk.text);
+
+        chunk = ParseChatCompletionChunk(R"({"choices":[{"index":0,"delta":{"role":"assistant"}}]})");
+        VERIFY_ARE_EQUAL(StreamChunkKind::Other, chunk.kind);
+
+        chunk = ParseChatCompletionChunk(R"({"error":{"message":"rate limited"}})");
+        VERIFY_ARE_EQUAL(StreamChunkKind::Error, chunk.kind);
+        VERIFY_ARE_EQUAL(std::string{ "rate limited" }, chunk.text);
+
+        chunk = ParseChatCompletionChunk(R"({"choices":)");
+        VERIFY_ARE_EQUAL(StreamChunkKind::Error, chunk.kind);
+
+        chunk = ParseChatCompletionChunk("[DONE]");
+        VERIFY_ARE_EQUAL(StreamChunkKind::Done, chunk.kind);
+    }
+
+    TEST_METHOD(StreamSplitAtEveryOffset)
+    {
+        static constexpr std::wstring_view response{ L"Grüße • café ✓ — 𝄞 done" };
+        const auto body = MockStreamingProvider::FormatResponse(response);
+
+        // Chunk sizes of 1-7 split every multi-byte sequence at least once.
+        for (size_t chunkSize = 1; chunkSize < 8; chunkSize++)
+        {
+            MockStreamingProvider provider{ body, chunkSize };
+            std::wstring received;
+            const auto result = StreamChatCompletion(provider, {}, [&](std::wstring_view token) {
+                received.append(token);
+                return true;
+            });
+
+            VERIFY_ARE_EQUAL(response, std::wstring_view{ received });
+            VERIFY_ARE_EQUAL(response, std::wstring_view{ result.text });
+            VERIFY_ARE_EQUAL(size_t(7), result.tokens);
+            VERIFY_IS_FALSE(result.cancelled);
+            VERIFY_IS_TRUE(result.error.empty());
+        }
+    }
+
+    TEST_METHOD(CancelMidStream)
+    {
+        MockStreamingProvider provider{ MockStreamingProvider::FormatResponse(L"one two three four five six"), 16 };
+
+        size_t calls = 0;
+        const auto result = StreamChatCompletion(provider, {}, [&](std::wstring_view) {
+            return ++calls < 3;
+        });
+
+        VERIFY_IS_TRUE(result.cancelled);
+        VERIFY_ARE_EQUAL(size_t(3), calls);
+        VERIFY_ARE_EQUAL(std::wstring{ L"one two three " }, result.text);
+    }
+
+    TEST_METHOD(StreamErrorEvent)
+    {
+        MockStreamingProvider provider{ "data: {\"choices\":[{\"delta\":{\"content\":\"partial\"}}]}\n\ndata: {\"error\":{\"message\":\"overloaded\"}}\n\n", 32 };
+
+        const auto result = StreamChatCompletion(provider, {}, [](std::wstring_view) { return true; });
+
+        VERIFY_ARE_EQUAL(std::wstring{ L"partial" }, result.text);
+        VERIFY_ARE_EQUAL(std::wstring{ L"overloaded" }, result.error);
+    }
+
+    TEST_METHOD(StreamToolCalls)
+    {
+        const std::vector<StreamToolCall> calls{
+            { L"call_1", L"list_files", LR"({"path":"C:\\Users","glob":"*.txt"})" },
+            { L"call_2", L"read_file", LR"({"path":"grüße.md"})" },
+        };
+        const auto body = MockStreamingProvider::FormatToolCalls(calls, 3);
+
+        // Split the stream at every offset, to cover deltas that arrive in pieces.
+        for (size_t split = 0; split <= body.size(); split += 7)
+        {
+            MockStreamingProvider provider{ body, std::max<size_t>(split, 1) };
+            size_t tokens = 0;
+            const auto result = StreamChatCompletion(provider, {}, [&](std::wstring_view) {
+                tokens++;
+                return true;
+            });
+
+            VERIFY_ARE_EQUAL(size_t(0), tokens);
+            VERIFY_IS_TRUE(result.error.empty());
+            VERIFY_ARE_EQUAL(calls.size(), result.toolCalls.size());
+            for (size_t i = 0; i < calls.size(); i++)
+            {
+                VERIFY_ARE_EQUAL(calls[i].id, result.toolCalls[i].id);
+                VERIFY_ARE_EQUAL(calls[i].name, result.toolCalls[i].name);
+                VERIFY_ARE_EQUAL(calls[i].arguments, result.toolCalls[i].arguments);
+            }
+        }
+
+        Log::Comment(L"Content that accompanies a tool call is streamed as usual");
+        auto chunk = ParseChatCompletionChunk(R"({"choices":[{"delta":{"content":"Let me check.","tool_calls":[{"index":0,"id":"call_1","function":{"name":"ls","arguments":""}}]}}]})");
+        VERIFY_ARE_EQUAL(StreamChunkKind::ToolCall, chunk.kind);
+        VERIFY_ARE_EQUAL(std::string{ "Let me check." }, chunk.text);
+        VERIFY_ARE_EQUAL(size_t(1), chunk.toolCalls.size());
+        VERIFY_ARE_EQUAL(std::string{ "ls" }, chunk.toolCalls[0].name);
+
+        Log::Comment(L"Calls that skip an index or have no name are rejected");
+        MockStreamingProvider skipped{ "data: {\"choices\":[{\"delta\":{\"tool_calls\":[{\"index\":5,\"id\":\"a\",\"function\":{\"name\":\"ls\"}}]}}]}\n\ndata: [DONE]\n\n", 64 };
+        auto result = StreamChatCompletion(skipped, {}, [](std::wstring_view) { return true; });
+        VERIFY_IS_TRUE(result.toolCalls.empty());
+        VERIFY_ARE_EQUAL(std::wstring{ L"Malformed tool call" }, result.error);
+
+        MockStreamingProvider unnamed{ "data: {\"choices\":[{\"delta\":{\"tool_calls\":[{\"index\":0,\"id\":\"a\"}]}}]}\n\ndata: [DONE]\n\n", 64 };
+        result = StreamChatCompletion(unnamed, {}, [](std::wstring_view) { return true; });
+        VERIFY_IS_TRUE(result.toolCalls.empty());
+        VERIFY_ARE_EQUAL(std::wstring{ L"Malformed tool call" }, result.error);
+    }
+
+    TEST_METHOD(ReplayRecording)
+    {
+        const auto first = MockStreamingProvider::FormatToolCalls({ { L"call_1", L"ls", L"{}" } });
+        const auto second = MockStreamingProvider::FormatResponse(L"one two three");
+        const auto responses = ReplayStreamingProvider::SplitRecording(first + "\r\n" + second + "data: {\"choices\":[{\"delta\":{\"content\":\"cut\"}}]}\n\n");
+
+        VERIFY_ARE_EQUAL(size_t(3), responses.size());
+        VERIFY_ARE_EQUAL(first, responses[0]);
+        VERIFY_ARE_EQUAL("\r\n" + second, responses[1]);
+
+        ReplayStreamingProvider provider{ responses };
+        const auto stream = [&]() {
+            return StreamChatCompletion(provider, {}, [](std::wstring_view) { return true; });
+        };
+
+        VERIFY_ARE_EQUAL(size_t(1), stream().toolCalls.size());
+        VERIFY_ARE_EQUAL(std::wstring{ L"one two three" }, stream().text);
+        VERIFY_ARE_EQUAL(std::wstring{ L"cut" }, stream().text);
+        Log::Comment(L"The recording starts over after the last response");
+        VERIFY_ARE_EQUAL(size_t(1), stream().toolCalls.size());
+        provider.Rewind();
+        VERIFY_ARE_EQUAL(size_t(1), stream().toolCalls.size());
+        VERIFY_ARE_EQUAL(size_t(5), provider.Requests());
+
+        Log::Comment(L"Each event is delivered as a chunk of its own");
+        ReplayStreamingProvider chunks{ { second } };
+        std::vector<std::string> delivered;
+        chunks.Stream({}, [&](std::string_view chunk) {
+            delivered.emplace_back(chunk);
+            return true;
+        });
+        VERIFY_ARE_EQUAL(size_t(4), delivered.size());
+        VERIFY_ARE_EQUAL(std::string{ "data: [DONE]\n\n" }, delivered.back());
+
+        Log::Comment(L"A missing recording throws");
+        VERIFY_THROWS(ReplayStreamingProvider::LoadRecording(std::filesystem::temp_directory_path() / L"AIStreamingTests-missing.sse"), wil::ResultException);
+    }
+
+    TEST_METHOD(ReplayAtTokenRate)
+    {
+        using clock = std::chrono::steady_clock;
+
+        std::wstring response;
+        for (auto i = 0; i < 50; i++)
+        {
+            response.append(L"token ");
+        }
+
+        ReplayPacing pacing;
+        pacing.firstEventDelay = std::chrono::milliseconds{ 50 };
+        pacing.eventsPerSecond = 1000;
+        ReplayStreamingProvider provider{ { MockStreamingProvider::FormatResponse(response) }, pacing };
+
+        const auto start = clock::now();
+        clock::time_point firstToken{};
+        const auto result = StreamChatCompletion(provider, {}, [&](std::wstring_view) {
+            if (firstToken == clock::time_point{})
+            {
+                firstToken = clock::now();
+            }
+            return true;
+        });
+        const auto end = clock::now();
+
+        // 51 events at 1000/s after a 50ms delay: the last one is due 100ms after the request.
+        const auto ttft = std::chrono::duration<double, std::milli>(firstToken - start).count();
+        const auto total = std::chrono::duration<double, std::milli>(end - start).count();
+        Log::Comment(NoThrowString().Format(L"time to first token: %.2fms, total: %.2fms", ttft, total));
+        VERIFY_ARE_EQUAL(size_t(50), result.tokens);
+        VERIFY_IS_GREATER_THAN_OR_EQUAL(ttft, 50.0);
+        VERIFY_IS_GREATER_THAN_OR_EQUAL(total, 100.0);
+
+        Log::Comment(L"Cancelling stops the replay right away");
+        const auto cancelStart = clock::now();
+        StreamChatCompletion(provider, {}, [](std::wstring_view) { return false; });
+        const auto cancelled = std::chrono::duration<double, std::milli>(clock::now() - cancelStart).count();
+        VERIFY_IS_LESS_THAN(cancelled, total);
+    }
+
+    TEST_METHOD(StreamingPerformance)
+    {
+        using clock = std::chrono::steady_clock;
+
+        std::wstring response;
+        for (auto i = 0; i < 2000; i++)
+        {
+            response.append(L"token ");
+        }
+        const auto body = MockStreamingProvider::FormatResponse(response);
+
+        Log::Comment(L"Paced stream: the first token must arrive long before the last chunk");
+        {
+            MockStreamingProvider provider{ body, body.size() / 20, std::chrono::milliseconds{ 5 } };
+            const auto start = clock::now();
+            clock::time_point firstToken{};
+            const auto result = StreamChatCompletion(provider, {}, [&](std::wstring_view) {
+                if (firstToken == clock::time_point{})
+                {
+                    firstToken = clock::now();
+                }
+                return true;
+            });
+            const auto end = clock::now();
+
+            const auto ttft = std::chrono::duration<double, std::milli>(firstToken - start).count();
+            const auto total = std::chrono::duration<double, std::milli>(end - start).count();
+            Log::Comment(NoThrowString().Format(L"time to first token: %.2fms, total: %.2fms", ttft, total));
+            VERIFY_ARE_EQUAL(size_t(2000), result.tokens);
+            VERIFY_IS_LESS_THAN(ttft * 4, total);
+        }
+
+        Log::Comment(L"Unpaced stream: parser and decoder throughput");
+        {
+            MockStreamingProvider provider{ body, 1024 };
+            static constexpr auto iterations = 20;
+            size_t tokens = 0;
+            const auto start = clock::now();
+            for (auto i = 0; i < iterations; i++)
+            {
+                tokens += StreamChatCompletion(provider, {}, [](std::wstring_view) { return true; }).tokens;
+            }
+            const auto seconds = std::chrono::duration<double>(clock::now() - start).count();
+            Log::Comment(NoThrowString().Format(L"%.0f tokens/s", tokens / seconds));
+            VERIFY_ARE_EQUAL(size_t(2000 * iterations), tokens);
+        }
+    }
+};
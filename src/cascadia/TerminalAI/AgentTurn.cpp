@@ -0,0 +1,68 @@
+#include "pch.h"
+#include "AgentTurn.h"
+
+namespace Microsoft::Terminal::AI
+{
+    AgentTurnResult RunAgentTurn(IStreamingProvider& provider, ConversationContext& context, std::wstring_view model, const AgentToolExecutor& executeTools, const std::function<bool(std::wstring_view)>& onToken, const AgentTurnOptions& options)
+    {
+        using namespace std::chrono;
+
+        const auto start = steady_clock::now();
+        const auto elapsed = [&]() {
+            return duration_cast<microseconds>(steady_clock::now() - start);
+        };
+
+        AgentTurnResult result;
+        auto& stats = result.stats;
+        StreamingRequest request{ std::wstring{ model } };
+
+        for (size_t round = 0;; round++)
+        {
+            request.body = context.BuildRequestPayload(model, true);
+            stats.modelRequests++;
+
+            auto stream = StreamChatCompletion(provider, request, [&](std::wstring_view token) {
+                if (stats.tokens++ == 0)
+                {
+                    stats.timeToFirstToken = elapsed();
+                }
+                return onToken(token);
+            });
+
+            if (stream.cancelled || !stream.error.empty() || stream.toolCalls.empty())
+            {
+                // Keep whatever was received, even if the response was cancelled midway.
+                if (!stream.text.empty())
+                {
+                    context.Append(L"assistant", stream.text);
+                }
+                result.text = std::move(stream.text);
+                result.error = std::move(stream.error);
+                result.cancelled = stream.cancelled;
+                break;
+            }
+
+            if (round == options.maxToolRounds)
+            {
+                result.error = L"Too many tool calls";
+                break;
+            }
+
+            const auto toolStart = steady_clock::now();
+            auto outputs = executeTools(stream.toolCalls);
+            outputs.resize(stream.toolCalls.size());
+
+            context.AppendToolCalls(stream.text, stream.toolCalls);
+            for (size_t i = 0; i < outputs.size(); i++)
+            {
+                context.AppendToolResult(stream.toolCalls[i].id, outputs[i]);
+            }
+
+            stats.toolCalls += stream.toolCalls.size();
+            stats.toolTime += duration_cast<microseconds>(steady_clock::now() - toolStart);
+        }
+
+        stats.latency = elapsed();
+        return result;
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "pch.h"
+#include "AIStreaming.h"
+#include "ConversationContext.h"
+
+namespace Microsoft::Terminal::AI
+{
+    struct AgentTurnOptions
+    {
+        // How often the model may call tools before the turn is given up on.
+        size_t maxToolRounds = 8;
+    };
+
+    // Where the time of a turn went. All durations are measured from the start of the turn.
+    struct AgentTurnStats
+    {
+        // Until the first token of text arrived.
+        std::chrono::microseconds timeToFirstToken{};
+        // Until the answer was complete.
+        std::chrono::microseconds latency{};
+        // Spent running tools, from the end of each stream that asked for them until the next request.
+        std::chrono::microseconds toolTime{};
+        size_t modelRequests = 0;
+        size_t toolCalls = 0;
+        size_t tokens = 0;
+    };
+
+    // Runs the tool calls of a single model response and returns their results, in the same order.
+    using AgentToolExecutor = std::function<std::vector<std::wstring>(const std::vector<StreamToolCall>& calls)>;
+
+    struct AgentTurnResult
+    {
+        std::wstring text;
+        std::wstring error;
+        bool cancelled = false;
+        AgentTurnStats stats;
+    };
+
+    // Answers the last user message in `context`: Streams a response, runs the tools it asks for,
+    // appends the calls and their results to `context` and asks again, until the model answers
+    // with text. The answer is appended to `context` as well. `onToken` receives each token
+    // of text as it arrives and may cancel the turn by returning false.
+    AgentTurnResult RunAgentTurn(IStreamingProvider& provider, ConversationContext& context, std::wstring_view model, const AgentToolExecutor& executeTools, const std::function<bool(std::wstring_view)>& onToken, const AgentTurnOptions& options = {});
+}
@@ -0,0 +1,226 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include "AgentTurn.h"
+#include "AIAgent.h"
+
+#include <chrono>
+#include <thread>
+
+#ifdef _DEBUG
+#include <crtdbg.h>
+#endif
+
+using namespace Microsoft::Terminal::AI;
+using namespace WEX::Common;
+using namespace WEX::Logging;
+
+namespace
+{
+    // A turn in which the model checks the repository before it answers.
+    std::vector<std::string> gitStatusRecording()
+    {
+        return {
+            MockStreamingProvider::FormatToolCalls({ { L"call_1", L"git_status", LR"({"path":"."})" } }),
+            MockStreamingProvider::FormatResponse(L"The working tree is clean, there is nothing to commit."),
+        };
+    }
+
+    std::vector<std::wstring> gitStatus(const std::vector<StreamToolCall>& calls)
+    {
+        return std::vector<std::wstring>(calls.size(), L"nothing to commit, working tree clean");
+    }
+
+    struct Percentiles
+    {
+        double p50 = 0;
+        double p95 = 0;
+    };
+
+    Percentiles percentiles(std::vector<double> samples)
+    {
+        std::sort(samples.begin(), samples.end());
+        return { samples[samples.size() / 2], samples[std::min(samples.size() - 1, samples.size() * 95 / 100)] };
+    }
+
+#ifdef _DEBUG
+    // Counts the allocations of all threads, like the ones of the thread pool the agent runs on.
+    std::atomic<size_t> allocations{ 0 };
+
+    int __cdecl countAllocations(int allocType, void*, size_t, int, long, const unsigned char*, int)
+    {
+        if (allocType == _HOOK_ALLOC || allocType == _HOOK_REALLOC)
+        {
+            allocations.fetch_add(1, std::memory_order_relaxed);
+        }
+        return TRUE;
+    }
+#endif
+}
+
+// The replay harness for the agent pipeline. Like the other TerminalAI tests it's
+// compiled into TerminalAI.lib, but no test project or pipeline runs it yet, and it
+// only builds on Windows: the code under test depends on WinRT, WIL and TAEF.
+class AgentTurnTests
+{
+    TEST_CLASS(AgentTurnTests);
+
+    TEST_METHOD(ToolCallRoundTrip)
+    {
+        ReplayStreamingProvider provider{ gitStatusRecording() };
+        ConversationContext context;
+        context.Append(L"user", L"Anything to commit?");
+
+        std::vector<StreamToolCall> executed;
+        std::wstring streamed;
+        const auto result = RunAgentTurn(
+            provider, context, L"gpt-4", [&](const std::vector<StreamToolCall>& calls) {
+                executed.insert(executed.end(), calls.begin(), calls.end());
+                return gitStatus(calls);
+            },
+            [&](std::wstring_view token) {
+                streamed.append(token);
+                return true;
+            });
+
+        VERIFY_IS_TRUE(result.error.empty());
+        VERIFY_ARE_EQUAL(std::wstring{ L"The working tree is clean, there is nothing to commit." }, result.text);
+        VERIFY_ARE_EQUAL(result.text, streamed);
+        VERIFY_ARE_EQUAL(size_t(1), executed.size());
+        VERIFY_ARE_EQUAL(std::wstring{ L"git_status" }, executed[0].name);
+        VERIFY_ARE_EQUAL(std::wstring{ LR"({"path":"."})" }, executed[0].arguments);
+
+        VERIFY_ARE_EQUAL(size_t(2), result.stats.modelRequests);
+        VERIFY_ARE_EQUAL(size_t(1), result.stats.toolCalls);
+        VERIFY_ARE_EQUAL(size_t(10), result.stats.tokens);
+        VERIFY_IS_LESS_THAN_OR_EQUAL(result.stats.timeToFirstToken, result.stats.latency);
+
+        Log::Comment(L"The call, its result and the answer are part of the conversation");
+        VERIFY_ARE_EQUAL(size_t(4), context.MessageCount());
+        const auto payload = context.BuildRequestPayload(L"gpt-4", true);
+        VERIFY_IS_TRUE(payload.find(R"("tool_call_id":"call_1")") != std::string::npos);
+        VERIFY_IS_TRUE(payload.find("there is nothing to commit.") != std::string::npos);
+    }
+
+    TEST_METHOD(ToolRoundLimit)
+    {
+        ReplayStreamingProvider provider{ { MockStreamingProvider::FormatToolCalls({ { L"call_1", L"ls", L"{}" } }) } };
+        ConversationContext context;
+        context.Append(L"user", L"list");
+
+        AgentTurnOptions options;
+        options.maxToolRounds = 2;
+        const auto result = RunAgentTurn(provider, context, L"gpt-4", gitStatus, [](std::wstring_view) { return true; }, options);
+
+        VERIFY_ARE_EQUAL(std::wstring{ L"Too many tool calls" }, result.error);
+        VERIFY_ARE_EQUAL(size_t(3), result.stats.modelRequests);
+        VERIFY_ARE_EQUAL(size_t(2), result.stats.toolCalls);
+    }
+
+    TEST_METHOD(CancelTurn)
+    {
+        ReplayStreamingProvider provider{ gitStatusRecording() };
+        ConversationContext context;
+        context.Append(L"user", L"Anything to commit?");
+
+        const auto result = RunAgentTurn(provider, context, L"gpt-4", gitStatus, [](std::wstring_view) { return false; });
+
+        VERIFY_IS_TRUE(result.cancelled);
+        VERIFY_ARE_EQUAL(std::wstring{ L"The " }, result.text);
+        VERIFY_ARE_EQUAL(size_t(2), provider.Requests());
+        VERIFY_ARE_EQUAL(size_t(4), context.MessageCount());
+    }
+
+    TEST_METHOD(AgentPipelineBenchmark)
+    {
+        using clock = std::chrono::steady_clock;
+        static constexpr auto iterations = 20;
+        static constexpr auto toolDelay = std::chrono::milliseconds{ 5 };
+
+        // Roughly what a hosted model looks like: a short wait for the first event, then ~200 tokens/s.
+        ReplayPacing pacing;
+        pacing.firstEventDelay = std::chrono::milliseconds{ 20 };
+        pacing.eventsPerSecond = 200;
+        const auto provider = std::make_shared<ReplayStreamingProvider>(gitStatusRecording(), pacing);
+
+        AIAgent agent{ L"benchmark" };
+        agent.SetStreamingProvider(provider);
+        agent.SetToolExecutor([](const std::vector<StreamToolCall>& calls) {
+            std::this_thread::sleep_for(toolDelay);
+            return gitStatus(calls);
+        });
+
+        std::mutex lock;
+        std::condition_variable cv;
+        std::optional<std::wstring> response;
+        agent.ResponseReceived.add([&](auto&&, const winrt::hstring& text) {
+            std::lock_guard guard{ lock };
+            response.emplace(text);
+            cv.notify_all();
+        });
+        agent.ErrorOccurred.add([&](auto&&, const winrt::hstring& error) {
+            std::lock_guard guard{ lock };
+            response.emplace(L"error: " + std::wstring{ error });
+            cv.notify_all();
+        });
+
+#ifdef _DEBUG
+        const auto previousHook = _CrtSetAllocHook(countAllocations);
+        const auto restoreHook = wil::scope_exit([&]() { _CrtSetAllocHook(previousHook); });
+#endif
+
+        std::vector<double> ttft, latency, toolTime, allocationsPerTurn;
+        for (auto i = 0; i < iterations; i++)
+        {
+            // Each turn replays the recording from the start, so that every turn calls the tool.
+            provider->Rewind();
+            response.reset();
+#ifdef _DEBUG
+            allocations.store(0, std::memory_order_relaxed);
+#endif
+
+            const auto start = clock::now();
+            agent.ExecuteAgentAsync(L"Anything to commit?");
+            {
+                std::unique_lock guard{ lock };
+                VERIFY_IS_TRUE(cv.wait_for(guard, std::chrono::seconds{ 10 }, [&]() { return response.has_value(); }));
+            }
+            const auto end = clock::now();
+
+            VERIFY_ARE_EQUAL(std::wstring{ L"The working tree is clean, there is nothing to commit." }, *response);
+
+            const auto stats = agent.LastTurnStats();
+            VERIFY_ARE_EQUAL(size_t(2), stats.modelRequests);
+            VERIFY_ARE_EQUAL(size_t(1), stats.toolCalls);
+
+            ttft.emplace_back(std::chrono::duration<double, std::milli>(stats.timeToFirstToken).count());
+            latency.emplace_back(std::chrono::duration<double, std::milli>(end - start).count());
+            toolTime.emplace_back(std::chrono::duration<double, std::milli>(stats.toolTime).count());
+#ifdef _DEBUG
+            allocationsPerTurn.emplace_back(static_cast<double>(allocations.load(std::memory_order_relaxed)));
+#endif
+        }
+
+        const auto logPercentiles = [](const wchar_t* name, const std::vector<double>& samples, const wchar_t* unit) {
+            const auto p = percentiles(samples);
+            Log::Comment(NoThrowString().Format(L"%ls: p50 %.2f%ls, p95 %.2f%ls", name, p.p50, unit, p.p95, unit));
+        };
+        logPercentiles(L"time to first token", ttft, L"ms");
+        logPercentiles(L"turn latency", latency, L"ms");
+        logPercentiles(L"tool overhead", toolTime, L"ms");
+        if (allocationsPerTurn.empty())
+        {
+            Log::Comment(L"allocations: only counted in debug builds");
+        }
+        else
+        {
+            logPercentiles(L"allocations", allocationsPerTurn, L"");
+        }
+
+        VERIFY_ARE_EQUAL(size_t(2 * iterations), provider->Requests());
+        // The replay alone takes ~110ms per turn. Anything near a second means the pipeline itself got slow.
+        VERIFY_IS_LESS_THAN(percentiles(latency).p50, 1000.0);
+        VERIFY_IS_GREATER_THAN_OR_EQUAL(percentiles(toolTime).p50, 5.0);
+    }
+};
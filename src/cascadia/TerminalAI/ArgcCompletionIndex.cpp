@@ -0,0 +1,121 @@
+#include "pch.h"
+#include "ArgcCompletionIndex.h"
+
+namespace Microsoft::Terminal::AI
+{
+    std::wstring_view CommandLineTokenizer::Next() noexcept
+    {
+        size_t begin = 0;
+        while (begin < _rest.size() && IsWhitespace(til::at(_rest, begin)))
+        {
+            begin++;
+        }
+
+        auto end = begin;
+        while (end < _rest.size() && !IsWhitespace(til::at(_rest, end)))
+        {
+            end++;
+        }
+
+        const auto token = _rest.substr(begin, end - begin);
+        _rest = _rest.substr(end);
+        return token;
+    }
+
+    std::wstring_view CommandLineTokenizer::LastToken(std::wstring_view text) noexcept
+    {
+        auto begin = text.size();
+        while (begin > 0 && !IsWhitespace(til::at(text, begin - 1)))
+        {
+            begin--;
+        }
+        return text.substr(begin);
+    }
+
+    void ArgcCompletionIndex::Clear() noexcept
+    {
+        _strings.clear();
+        _commands.clear();
+        _words.clear();
+    }
+
+    void ArgcCompletionIndex::AddCommand(std::wstring_view name, std::wstring_view description, std::span<const std::wstring> subcommands, std::span<const std::wstring> flags, std::span<const std::wstring> options)
+    {
+        auto& command = _commands.emplace_back();
+        command.name = _append(name);
+        command.description = _append(description);
+
+        // Same order as WordKind.
+        const std::span<const std::wstring> words[]{ subcommands, flags, options };
+        for (size_t kind = 0; kind < WordKindCount; ++kind)
+        {
+            til::at(command.words, kind) = gsl::narrow<uint32_t>(_words.size());
+            _appendWords(til::at(words, kind));
+        }
+        til::at(command.words, WordKindCount) = gsl::narrow<uint32_t>(_words.size());
+    }
+
+    void ArgcCompletionIndex::Build()
+    {
+        const auto less = [this](const auto& lhs, const auto& rhs) noexcept {
+            return _view(_key(lhs)) < _view(_key(rhs));
+        };
+
+        std::sort(_commands.begin(), _commands.end(), less);
+        for (const auto& command : _commands)
+        {
+            for (size_t kind = 0; kind < WordKindCount; ++kind)
+            {
+                std::sort(_words.begin() + til::at(command.words, kind), _words.begin() + til::at(command.words, kind + 1), less);
+            }
+        }
+
+        _strings.shrink_to_fit();
+        _commands.shrink_to_fit();
+        _words.shrink_to_fit();
+    }
+
+    size_t ArgcCompletionIndex::CommandCount() const noexcept
+    {
+        return _commands.size();
+    }
+
+    const ArgcCompletionIndex::Command* ArgcCompletionIndex::FindCommand(std::wstring_view name) const noexcept
+    {
+        const auto it = _lowerBound(_commands.begin(), _commands.end(), name);
+        return it != _commands.end() && _view(it->name) == name ? &*it : nullptr;
+    }
+
+    std::wstring_view ArgcCompletionIndex::Name(const Command& command) const noexcept
+    {
+        return _view(command.name);
+    }
+
+    std::wstring_view ArgcCompletionIndex::Description(const Command& command) const noexcept
+    {
+        return _view(command.description);
+    }
+
+    bool ArgcCompletionIndex::Contains(const Command& command, WordKind kind, std::wstring_view word) const noexcept
+    {
+        const auto k = static_cast<size_t>(kind);
+        const auto end = _words.begin() + til::at(command.words, k + 1);
+        const auto it = _lowerBound(_words.begin() + til::at(command.words, k), end, word);
+        return it != end && _view(*it) == word;
+    }
+
+    ArgcCompletionIndex::StringRef ArgcCompletionIndex::_append(std::wstring_view text)
+    {
+        const StringRef ref{ gsl::narrow<uint32_t>(_strings.size()), gsl::narrow<uint32_t>(text.size()) };
+        _strings.append(text);
+        return ref;
+    }
+
+    void ArgcCompletionIndex::_appendWords(std::span<const std::wstring> words)
+    {
+        for (const auto& word : words)
+        {
+            _words.emplace_back(_append(word));
+        }
+    }
+}
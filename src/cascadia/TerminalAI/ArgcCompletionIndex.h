@@ -0,0 +1,143 @@
+#pragma once
+
+#include "pch.h"
+
+namespace Microsoft::Terminal::AI
+{
+    // Splits a command line at whitespace without copying it.
+    class CommandLineTokenizer
+    {
+    public:
+        explicit constexpr CommandLineTokenizer(std::wstring_view text) noexcept :
+            _rest{ text }
+        {
+        }
+
+        // Returns the next token, or an empty view at the end of the input.
+        std::wstring_view Next() noexcept;
+        // The input after the last token returned by Next(), including leading whitespace.
+        constexpr std::wstring_view Rest() const noexcept
+        {
+            return _rest;
+        }
+
+        // The token the cursor is in at the end of `text`. Empty if `text` ends in whitespace.
+        static std::wstring_view LastToken(std::wstring_view text) noexcept;
+        static constexpr bool IsWhitespace(wchar_t ch) noexcept
+        {
+            return ch == L' ' || ch == L'\t' || ch == L'\r' || ch == L'\n' || ch == L'\v' || ch == L'\f';
+        }
+
+    private:
+        std::wstring_view _rest;
+    };
+
+    // The completion candidates of all known commands, compiled into sorted string tables.
+    // All strings live in a single buffer. Commands are sorted by name and the subcommands,
+    // flags and options of each command are sorted within their own ranges, so a prefix
+    // query is a binary search followed by a scan over the matches.
+    class ArgcCompletionIndex
+    {
+    public:
+        // In the order in which they're suggested.
+        enum class WordKind : uint8_t
+        {
+            Subcommand,
+            Flag,
+            Option,
+        };
+        static constexpr size_t WordKindCount = 3;
+
+        // A string in the index's buffer.
+        struct StringRef
+        {
+            uint32_t offset = 0;
+            uint32_t length = 0;
+        };
+
+        struct Command
+        {
+            StringRef name;
+            StringRef description;
+            // The words of kind k are _words[words[k], words[k + 1]).
+            std::array<uint32_t, WordKindCount + 1> words{};
+        };
+
+        void Clear() noexcept;
+        // Adds a command. Build() must be called before the next query.
+        void AddCommand(std::wstring_view name, std::wstring_view description, std::span<const std::wstring> subcommands, std::span<const std::wstring> flags, std::span<const std::wstring> options);
+        void Build();
+
+        size_t CommandCount() const noexcept;
+        const Command* FindCommand(std::wstring_view name) const noexcept;
+        std::wstring_view Name(const Command& command) const noexcept;
+        std::wstring_view Description(const Command& command) const noexcept;
+
+        // Calls `callback(const Command&)` for each command that starts with `prefix`, sorted by name.
+        // Returning false from the callback stops the enumeration.
+        template<typename Callback>
+        void ForEachCommand(std::wstring_view prefix, Callback&& callback) const
+        {
+            for (auto it = _lowerBound(_commands.begin(), _commands.end(), prefix); it != _commands.end() && _startsWith(it->name, prefix); ++it)
+            {
+                if (!callback(*it))
+                {
+                    return;
+                }
+            }
+        }
+
+        // Calls `callback(std::wstring_view word)` for each word of the given kind that starts with `prefix`, sorted.
+        // Returning false from the callback stops the enumeration.
+        template<typename Callback>
+        void ForEachWord(const Command& command, WordKind kind, std::wstring_view prefix, Callback&& callback) const
+        {
+            const auto k = static_cast<size_t>(kind);
+            const auto begin = _words.begin() + til::at(command.words, k);
+            const auto end = _words.begin() + til::at(command.words, k + 1);
+            for (auto it = _lowerBound(begin, end, prefix); it != end && _startsWith(*it, prefix); ++it)
+            {
+                if (!callback(_view(*it)))
+                {
+                    return;
+                }
+            }
+        }
+
+        // Whether `word` is one of the command's words of the given kind.
+        bool Contains(const Command& command, WordKind kind, std::wstring_view word) const noexcept;
+
+    private:
+        std::wstring _strings;
+        std::vector<Command> _commands;
+        std::vector<StringRef> _words;
+
+        StringRef _append(std::wstring_view text);
+        void _appendWords(std::span<const std::wstring> words);
+
+        std::wstring_view _view(const StringRef& ref) const noexcept
+        {
+            return { _strings.data() + ref.offset, ref.length };
+        }
+        static const StringRef& _key(const StringRef& ref) noexcept
+        {
+            return ref;
+        }
+        static const StringRef& _key(const Command& command) noexcept
+        {
+            return command.name;
+        }
+        bool _startsWith(const StringRef& ref, std::wstring_view prefix) const noexcept
+        {
+            return _view(ref).starts_with(prefix);
+        }
+
+        template<typename It>
+        It _lowerBound(It begin, It end, std::wstring_view value) const noexcept
+        {
+            return std::lower_bound(begin, end, value, [this](const auto& entry, std::wstring_view v) noexcept {
+                return _view(_key(entry)) < v;
+            });
+        }
+    };
+}
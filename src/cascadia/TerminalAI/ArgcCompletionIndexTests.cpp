@@ -0,0 +1,197 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include "ArgcCompletionIndex.h"
+#include "ArgcParser.h"
+
+#include <chrono>
+
+using namespace Microsoft::Terminal::AI;
+using namespace WEX::Common;
+using namespace WEX::Logging;
+
+namespace
+{
+    using WordKind = ArgcCompletionIndex::WordKind;
+
+    std::vector<std::wstring> commandsWithPrefix(const ArgcCompletionIndex& index, std::wstring_view prefix)
+    {
+        std::vector<std::wstring> names;
+        index.ForEachCommand(prefix, [&](const ArgcCompletionIndex::Command& command) {
+            names.emplace_back(index.Name(command));
+            return true;
+        });
+        return names;
+    }
+
+    std::vector<std::wstring> wordsWithPrefix(const ArgcCompletionIndex& index, std::wstring_view command, WordKind kind, std::wstring_view prefix)
+    {
+        std::vector<std::wstring> words;
+        index.ForEachWord(*index.FindCommand(command), kind, prefix, [&](std::wstring_view word) {
+            words.emplace_back(word);
+            return true;
+        });
+        return words;
+    }
+}
+
+class ArgcCompletionIndexTests
+{
+    TEST_CLASS(ArgcCompletionIndexTests);
+
+    TEST_METHOD(Tokenizer)
+    {
+        CommandLineTokenizer tokenizer{ L"  git\tcommit  -m \"x y\"  " };
+        VERIFY_ARE_EQUAL(std::wstring_view{ L"git" }, tokenizer.Next());
+        VERIFY_ARE_EQUAL(std::wstring_view{ L"\tcommit  -m \"x y\"  " }, tokenizer.Rest());
+        VERIFY_ARE_EQUAL(std::wstring_view{ L"commit" }, tokenizer.Next());
+        VERIFY_ARE_EQUAL(std::wstring_view{ L"-m" }, tokenizer.Next());
+        VERIFY_ARE_EQUAL(std::wstring_view{ L"\"x" }, tokenizer.Next());
+        VERIFY_ARE_EQUAL(std::wstring_view{ L"y\"" }, tokenizer.Next());
+        VERIFY_IS_TRUE(tokenizer.Next().empty());
+        VERIFY_IS_TRUE(tokenizer.Rest().empty());
+
+        VERIFY_ARE_EQUAL(std::wstring_view{ L"--col" }, CommandLineTokenizer::LastToken(L"ls -l --col"));
+        VERIFY_ARE_EQUAL(std::wstring_view{ L"ls" }, CommandLineTokenizer::LastToken(L"ls"));
+        VERIFY_IS_TRUE(CommandLineTokenizer::LastToken(L"ls -l ").empty());
+    }
+
+    TEST_METHOD(PrefixQueries)
+    {
+        const std::vector<std::wstring> none;
+        const std::vector<std::wstring> subcommands{ L"status", L"add", L"stash", L"commit" };
+        const std::vector<std::wstring> flags{ L"--version", L"-v" };
+        const std::vector<std::wstring> options{ L"--git-dir", L"--work-tree" };
+
+        ArgcCompletionIndex index;
+        index.AddCommand(L"git", L"Git", subcommands, flags, options);
+        index.AddCommand(L"gh", L"GitHub", none, none, none);
+        index.AddCommand(L"grep", L"Search", none, flags, none);
+        index.AddCommand(L"ls", L"List", none, none, none);
+        index.Build();
+
+        VERIFY_ARE_EQUAL(size_t(4), index.CommandCount());
+        VERIFY_IS_TRUE((commandsWithPrefix(index, L"g") == std::vector<std::wstring>{ L"gh", L"git", L"grep" }));
+        VERIFY_IS_TRUE((commandsWithPrefix(index, L"gi") == std::vector<std::wstring>{ L"git" }));
+        VERIFY_IS_TRUE(commandsWithPrefix(index, L"x").empty());
+        VERIFY_ARE_EQUAL(size_t(4), commandsWithPrefix(index, L"").size());
+
+        VERIFY_IS_NOT_NULL(index.FindCommand(L"git"));
+        VERIFY_IS_NULL(index.FindCommand(L"gi"));
+        VERIFY_ARE_EQUAL(std::wstring_view{ L"GitHub" }, index.Description(*index.FindCommand(L"gh")));
+
+        Log::Comment(L"Each kind of word is a separate sorted range");
+        VERIFY_IS_TRUE((wordsWithPrefix(index, L"git", WordKind::Subcommand, L"st") == std::vector<std::wstring>{ L"stash", L"status" }));
+        VERIFY_IS_TRUE((wordsWithPrefix(index, L"git", WordKind::Flag, L"-") == std::vector<std::wstring>{ L"--version", L"-v" }));
+        VERIFY_IS_TRUE((wordsWithPrefix(index, L"git", WordKind::Option, L"--w") == std::vector<std::wstring>{ L"--work-tree" }));
+        VERIFY_IS_TRUE(wordsWithPrefix(index, L"gh", WordKind::Flag, L"").empty());
+        VERIFY_IS_TRUE(index.Contains(*index.FindCommand(L"grep"), WordKind::Flag, L"-v"));
+        VERIFY_IS_FALSE(index.Contains(*index.FindCommand(L"grep"), WordKind::Option, L"-v"));
+    }
+
+    TEST_METHOD(RankedCompletions)
+    {
+        const auto parser = CreateArgcParser();
+        VERIFY_IS_NOT_NULL(parser);
+
+        auto completions = parser->GetCompletions(L"git ");
+        VERIFY_ARE_EQUAL(size_t(7), completions.size());
+        VERIFY_ARE_EQUAL(std::wstring{ L"add" }, completions.front().completion);
+        VERIFY_ARE_EQUAL(std::wstring{ L"Subcommand of git" }, completions.front().description);
+        VERIFY_ARE_EQUAL(std::wstring{ L"--git-dir" }, completions.back().completion);
+        VERIFY_ARE_EQUAL(std::wstring{ L"option" }, completions.back().type);
+        VERIFY_IS_TRUE(std::is_sorted(completions.begin(), completions.end(), [](const auto& a, const auto& b) { return a.priority > b.priority; }));
+
+        Log::Comment(L"Only the token at the end of the line is completed");
+        completions = parser->GetCompletions(L"git status --v");
+        VERIFY_ARE_EQUAL(size_t(1), completions.size());
+        VERIFY_ARE_EQUAL(std::wstring{ L"--version" }, completions[0].completion);
+
+        Log::Comment(L"A limit returns the best suggestions");
+        completions = parser->GetCompletions(L"ls -", 2);
+        VERIFY_ARE_EQUAL(size_t(2), completions.size());
+        VERIFY_ARE_EQUAL(std::wstring{ L"-a" }, completions[0].completion);
+        VERIFY_ARE_EQUAL(std::wstring{ L"-h" }, completions[1].completion);
+
+        completions = parser->GetCompletions(L"g");
+        VERIFY_ARE_EQUAL(size_t(2), completions.size());
+        VERIFY_ARE_EQUAL(std::wstring{ L"git" }, completions[0].completion);
+        VERIFY_ARE_EQUAL(std::wstring{ L"grep" }, completions[1].completion);
+
+        Log::Comment(L"The index picks up new definitions");
+        VERIFY_IS_TRUE(parser->AddCommandDefinition(L"gzip", L"Compress files"));
+        completions = parser->GetCompletions(L"gz");
+        VERIFY_ARE_EQUAL(size_t(1), completions.size());
+        VERIFY_ARE_EQUAL(std::wstring{ L"Compress files" }, completions[0].description);
+
+        VERIFY_IS_TRUE(parser->GetCompletions(L"unknown -").empty());
+    }
+
+    TEST_METHOD(CompletionPerformance)
+    {
+        using clock = std::chrono::steady_clock;
+        static constexpr auto commandCount = 1000;
+        static constexpr auto optionCount = 50;
+        static constexpr auto iterations = 10000;
+
+        std::vector<std::wstring> subcommands;
+        std::vector<std::wstring> flags;
+        std::vector<std::wstring> options;
+        for (auto i = 0; i < optionCount; i++)
+        {
+            const auto n = std::to_wstring(i);
+            subcommands.emplace_back(L"sub" + n);
+            flags.emplace_back(L"--flag-" + n);
+            options.emplace_back(L"--option-" + n);
+        }
+
+        const auto buildStart = clock::now();
+        ArgcCompletionIndex index;
+        for (auto i = 0; i < commandCount; i++)
+        {
+            // Reverse order, so that Build() has something to sort.
+            index.AddCommand(L"command" + std::to_wstring(commandCount - i), L"A generated command", subcommands, flags, options);
+        }
+        index.Build();
+        const auto buildTime = std::chrono::duration<double, std::milli>(clock::now() - buildStart).count();
+
+        // One query per keystroke: the command name, then one of its options.
+        static constexpr std::wstring_view lines[]{ L"comm", L"command5", L"command500 ", L"command500 --option-4", L"command999 --flag-" };
+        size_t matches = 0;
+        const auto queryStart = clock::now();
+        for (auto i = 0; i < iterations; i++)
+        {
+            for (const auto line : lines)
+            {
+                CommandLineTokenizer tokenizer{ line };
+                const auto first = tokenizer.Next();
+                if (tokenizer.Rest().empty())
+                {
+                    index.ForEachCommand(first, [&](const auto&) {
+                        return ++matches % 64 != 0;
+                    });
+                }
+                else if (const auto command = index.FindCommand(first))
+                {
+                    const auto last = CommandLineTokenizer::LastToken(tokenizer.Rest());
+                    for (const auto kind : { WordKind::Subcommand, WordKind::Flag, WordKind::Option })
+                    {
+                        index.ForEachWord(*command, kind, last, [&](std::wstring_view) {
+                            ++matches;
+                            return true;
+                        });
+                    }
+                }
+            }
+        }
+        const auto queryTime = std::chrono::duration<double, std::micro>(clock::now() - queryStart).count() / (iterations * std::size(lines));
+
+        Log::Comment(NoThrowString().Format(L"%d commands with %d subcommands, flags and options each: built in %.2fms", commandCount, optionCount, buildTime));
+        Log::Comment(NoThrowString().Format(L"%.3fus per query, %zu matches", queryTime, matches));
+
+        VERIFY_ARE_EQUAL(size_t(commandCount), index.CommandCount());
+        VERIFY_IS_NOT_NULL(index.FindCommand(L"command1000"));
+        VERIFY_IS_TRUE((wordsWithPrefix(index, L"command500", WordKind::Option, L"--option-4") == std::vector<std::wstring>{ L"--option-4", L"--option-40", L"--option-41", L"--option-42", L"--option-43", L"--option-44", L"--option-45", L"--option-46", L"--option-47", L"--option-48", L"--option-49" }));
+    }
+};
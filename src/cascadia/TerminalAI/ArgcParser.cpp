@@ -1,8 +1,58 @@
 #include "pch.h"
 #include "ArgcParser.h"
+#include "DefinitionCache.h"
 
 using namespace Microsoft::Terminal::AI;
 
+namespace
+{
+    // Bump whenever _analyzeArgcScript() or _serializeCommandInfo() change, to invalidate existing caches.
+    constexpr uint32_t ArgcCacheVersion = 1;
+
+    std::wstring_view trim(std::wstring_view text) noexcept
+    {
+        while (!text.empty() && CommandLineTokenizer::IsWhitespace(text.front()))
+        {
+            text.remove_prefix(1);
+        }
+        while (!text.empty() && CommandLineTokenizer::IsWhitespace(text.back()))
+        {
+            text.remove_suffix(1);
+        }
+        return text;
+    }
+
+    // Strips Argc's modifiers off a parameter name, as in `--path!`, `--file*`, `--mode[a|b]` or `--out=x`.
+    std::wstring_view argcParameterName(std::wstring_view spec) noexcept
+    {
+        return spec.substr(0, spec.find_first_of(L"!*+=[,"));
+    }
+
+    // Returns the name of the shell function defined on this line (`name() {` or `function name {`), if any.
+    std::wstring_view shellFunctionName(std::wstring_view line) noexcept
+    {
+        CommandLineTokenizer tokenizer{ line };
+        auto token = tokenizer.Next();
+        const auto isKeyword = token == L"function";
+        if (isKeyword)
+        {
+            token = tokenizer.Next();
+        }
+
+        const auto paren = token.find(L'(');
+        if (paren != std::wstring_view::npos)
+        {
+            return token.substr(0, paren);
+        }
+        // Either `function name {` or `name () {`.
+        if (isKeyword || trim(tokenizer.Rest()).starts_with(L'('))
+        {
+            return token;
+        }
+        return {};
+    }
+}
+
 ArgcParser::ArgcParser()
 {
 }
@@ -24,6 +74,7 @@ bool ArgcParser::Initialize()
         _commandInfo[L"ls"] = { L"ls", L"List directory contents", {L"-l", L"-a", L"-h"}, {L"--color"}, {L"path"}, {} };
         _commandInfo[L"grep"] = { L"grep", L"Search text patterns", {L"-i", L"-v", L"-n"}, {L"--include", L"--exclude"}, {L"pattern", L"file"}, {} };
         _commandInfo[L"git"] = { L"git", L"Git version control", {L"--version"}, {L"--git-dir"}, {L"command"}, {L"add", L"commit", L"push", L"pull", L"status"} };
+        _completionIndexDirty = true;
         
         _initialized = true;
         return true;
@@ -46,44 +97,36 @@ ArgcParser::ParsedCommand ArgcParser::ParseCommand(std::wstring_view commandLine
     try
     {
         // Basic command line parsing
-        std::wistringstream iss(std::wstring(commandLine));
-        std::wstring token;
-        std::vector<std::wstring> tokens;
-        
-        while (iss >> token)
-        {
-            tokens.push_back(token);
-        }
-
-        if (tokens.empty())
+        CommandLineTokenizer tokenizer{ commandLine };
+        const auto command = tokenizer.Next();
+        if (command.empty())
         {
             return result;
         }
 
-        result.command = tokens[0];
+        result.command = command;
         
         // Check if this is a known Argc command
-        auto it = _commandInfo.find(result.command);
+        auto it = _commandInfo.find(command);
         if (it != _commandInfo.end())
         {
             result.isValid = true;
             result.description = it->second.description;
             
-            // Parse arguments, options, and flags
-            for (size_t i = 1; i < tokens.size(); ++i)
+            // Parse arguments, options, and flags. `next` is one token of lookahead for option values.
+            auto token = tokenizer.Next();
+            while (!token.empty())
             {
-                const auto& token = tokens[i];
+                auto next = tokenizer.Next();
                 
                 if (token.starts_with(L"--"))
                 {
                     // Long option or flag
                     auto equalPos = token.find(L'=');
-                    if (equalPos != std::wstring::npos)
+                    if (equalPos != std::wstring_view::npos)
                     {
                         // Option with value
-                        auto optionName = token.substr(0, equalPos);
-                        auto optionValue = token.substr(equalPos + 1);
-                        result.options[optionName] = optionValue;
+                        result.options[std::wstring{ token.substr(0, equalPos) }] = token.substr(equalPos + 1);
                     }
                     else
                     {
@@ -91,45 +134,49 @@ ArgcParser::ParsedCommand ArgcParser::ParseCommand(std::wstring_view commandLine
                         bool isFlag = std::find(it->second.flags.begin(), it->second.flags.end(), token) != it->second.flags.end();
                         if (isFlag)
                         {
-                            result.flags.push_back(token);
+                            result.flags.emplace_back(token);
                         }
-                        else if (i + 1 < tokens.size() && !tokens[i + 1].starts_with(L"-"))
+                        else if (!next.empty() && !next.starts_with(L"-"))
                         {
                             // Option with separate value
-                            result.options[token] = tokens[++i];
+                            result.options[std::wstring{ token }] = next;
+                            next = tokenizer.Next();
                         }
                         else
                         {
-                            result.flags.push_back(token);
+                            result.flags.emplace_back(token);
                         }
                     }
                 }
                 else if (token.starts_with(L"-") && token.length() > 1)
                 {
                     // Short option or flag
-                    if (i + 1 < tokens.size() && !tokens[i + 1].starts_with(L"-"))
+                    if (!next.empty() && !next.starts_with(L"-"))
                     {
                         // Option with value
-                        result.options[token] = tokens[++i];
+                        result.options[std::wstring{ token }] = next;
+                        next = tokenizer.Next();
                     }
                     else
                     {
-                        result.flags.push_back(token);
+                        result.flags.emplace_back(token);
                     }
                 }
                 else
                 {
                     // Positional argument
-                    result.arguments.push_back(token);
+                    result.arguments.emplace_back(token);
                 }
+                
+                token = next;
             }
         }
         else
         {
             // Unknown command, treat as simple parsing
-            for (size_t i = 1; i < tokens.size(); ++i)
+            for (auto token = tokenizer.Next(); !token.empty(); token = tokenizer.Next())
             {
-                result.arguments.push_back(tokens[i]);
+                result.arguments.emplace_back(token);
             }
         }
     }
@@ -141,115 +188,75 @@ ArgcParser::ParsedCommand ArgcParser::ParseCommand(std::wstring_view commandLine
     return result;
 }
 
-std::vector<ArgcParser::CompletionSuggestion> ArgcParser::GetCompletions(std::wstring_view partialCommand)
+std::vector<ArgcParser::CompletionSuggestion> ArgcParser::GetCompletions(std::wstring_view partialCommand, size_t maxResults)
 {
     std::vector<CompletionSuggestion> suggestions;
     
-    if (!_initialized || partialCommand.empty())
+    if (!_initialized || partialCommand.empty() || maxResults == 0)
     {
         return suggestions;
     }
 
     try
     {
-        std::wistringstream iss(std::wstring(partialCommand));
-        std::wstring firstToken;
-        iss >> firstToken;
+        const auto& index = _getCompletionIndex();
+        CommandLineTokenizer tokenizer{ partialCommand };
+        const auto firstToken = tokenizer.Next();
         
-        if (iss.eof())
+        if (tokenizer.Rest().empty())
         {
-            // Completing command name
-            for (const auto& [command, info] : _commandInfo)
-            {
-                if (command.starts_with(firstToken))
-                {
-                    CompletionSuggestion suggestion;
-                    suggestion.completion = command;
-                    suggestion.description = info.description;
-                    suggestion.type = L"command";
-                    suggestion.priority = 100;
-                    suggestions.push_back(suggestion);
-                }
-            }
+            // Completing command name. The index is sorted by name.
+            index.ForEachCommand(firstToken, [&](const ArgcCompletionIndex::Command& command) {
+                auto& suggestion = suggestions.emplace_back();
+                suggestion.completion = index.Name(command);
+                suggestion.description = index.Description(command);
+                suggestion.type = L"command";
+                suggestion.priority = 100;
+                return suggestions.size() < maxResults;
+            });
         }
-        else
+        else if (const auto command = index.FindCommand(firstToken))
         {
-            // Completing arguments, options, or flags for known command
-            auto it = _commandInfo.find(firstToken);
-            if (it != _commandInfo.end())
+            // Completing arguments, options, or flags for known command.
+            // An empty last token (the line ends in whitespace) matches everything.
+            const auto lastToken = CommandLineTokenizer::LastToken(tokenizer.Rest());
+            const auto name = index.Name(*command);
+
+            // Subcommands, flags and options, in order of priority.
+            static constexpr struct
             {
-                std::wstring remaining;
-                std::getline(iss, remaining);
-                if (!remaining.empty() && remaining[0] == L' ')
-                {
-                    remaining = remaining.substr(1);
-                }
-                
-                // Get the last token for completion
-                std::wstring lastToken;
-                if (!remaining.empty())
-                {
-                    std::wistringstream remainingStream(remaining);
-                    std::wstring token;
-                    while (remainingStream >> token)
-                    {
-                        lastToken = token;
-                    }
-                }
-                
-                // Suggest flags
-                for (const auto& flag : it->second.flags)
-                {
-                    if (lastToken.empty() || flag.starts_with(lastToken))
-                    {
-                        CompletionSuggestion suggestion;
-                        suggestion.completion = flag;
-                        suggestion.description = L"Flag for " + it->second.name;
-                        suggestion.type = L"flag";
-                        suggestion.priority = 80;
-                        suggestions.push_back(suggestion);
-                    }
-                }
-                
-                // Suggest options
-                for (const auto& option : it->second.options)
-                {
-                    if (lastToken.empty() || option.starts_with(lastToken))
-                    {
-                        CompletionSuggestion suggestion;
-                        suggestion.completion = option;
-                        suggestion.description = L"Option for " + it->second.name;
-                        suggestion.type = L"option";
-                        suggestion.priority = 70;
-                        suggestions.push_back(suggestion);
-                    }
-                }
-                
-                // Suggest subcommands
-                for (const auto& subcommand : it->second.subcommands)
+                ArgcCompletionIndex::WordKind kind;
+                std::wstring_view description;
+                std::wstring_view type;
+                int priority;
+            } kinds[]{
+                { ArgcCompletionIndex::WordKind::Subcommand, L"Subcommand of ", L"command", 90 },
+                { ArgcCompletionIndex::WordKind::Flag, L"Flag for ", L"flag", 80 },
+                { ArgcCompletionIndex::WordKind::Option, L"Option for ", L"option", 70 },
+            };
+
+            for (const auto& kind : kinds)
+            {
+                index.ForEachWord(*command, kind.kind, lastToken, [&](std::wstring_view word) {
+                    auto& suggestion = suggestions.emplace_back();
+                    suggestion.completion = word;
+                    suggestion.description.reserve(kind.description.size() + name.size());
+                    suggestion.description.append(kind.description).append(name);
+                    suggestion.type = kind.type;
+                    suggestion.priority = kind.priority;
+                    return suggestions.size() < maxResults;
+                });
+                if (suggestions.size() >= maxResults)
                 {
-                    if (lastToken.empty() || subcommand.starts_with(lastToken))
-                    {
-                        CompletionSuggestion suggestion;
-                        suggestion.completion = subcommand;
-                        suggestion.description = L"Subcommand of " + it->second.name;
-                        suggestion.type = L"command";
-                        suggestion.priority = 90;
-                        suggestions.push_back(suggestion);
-                    }
+                    break;
                 }
             }
         }
-        
-        // Sort by priority (higher first)
-        std::sort(suggestions.begin(), suggestions.end(), 
-                  [](const CompletionSuggestion& a, const CompletionSuggestion& b) {
-                      return a.priority > b.priority;
-                  });
     }
     catch (...)
     {
         // Return empty suggestions on error
+        suggestions.clear();
     }
 
     return suggestions;
@@ -262,7 +269,7 @@ std::wstring ArgcParser::GenerateHelp(std::wstring_view command)
         return L"Argc parser not initialized";
     }
 
-    auto it = _commandInfo.find(std::wstring(command));
+    auto it = _commandInfo.find(command);
     if (it == _commandInfo.end())
     {
         return L"Unknown command: " + std::wstring(command);
@@ -328,14 +335,51 @@ bool ArgcParser::IsValidCommand(std::wstring_view command)
         return false;
     }
     
-    return _commandInfo.find(std::wstring(command)) != _commandInfo.end();
+    return _commandInfo.contains(command);
 }
 
-bool ArgcParser::LoadCommandDefinitions(std::wstring_view definitionsPath)
+bool ArgcParser::LoadCommandDefinitions(std::wstring_view definitionsPath, const std::filesystem::path& cachePath)
 {
-    // For now, return true as we have built-in definitions
-    // In a full implementation, this would load from Argc script files
-    return true;
+    if (!_initialized)
+    {
+        return false;
+    }
+
+    try
+    {
+        const std::filesystem::path directory{ definitionsPath };
+        if (!std::filesystem::is_directory(directory))
+        {
+            return false;
+        }
+
+        const auto sources = EnumerateDefinitionSources(directory, L".sh");
+        DefinitionCache cache{ cachePath, ArgcCacheVersion };
+        const auto payloads = cache.Resolve(sources, [](const std::filesystem::path& path) {
+            ArgcCommandInfo info;
+            info.name = path.stem().wstring();
+            const auto content = til::u8u16(til::io::read_file_as_utf8_string_if_exists(path));
+            // Scripts without any tags are cached as such, so they aren't read again either.
+            return _analyzeArgcScript(content, info) ? _serializeCommandInfo(info) : std::string{};
+        });
+
+        for (const auto& payload : payloads)
+        {
+            ArgcCommandInfo info;
+            if (!payload.empty() && _deserializeCommandInfo(payload, info))
+            {
+                auto name = info.name;
+                _commandInfo.insert_or_assign(std::move(name), std::move(info));
+            }
+        }
+
+        _completionIndexDirty = true;
+        return true;
+    }
+    catch (...)
+    {
+        return false;
+    }
 }
 
 bool ArgcParser::AddCommandDefinition(std::wstring_view name, std::wstring_view definition)
@@ -353,7 +397,8 @@ bool ArgcParser::AddCommandDefinition(std::wstring_view name, std::wstring_view
         
         // Basic parsing of definition - in a full implementation,
         // this would parse Argc comment tags
-        _commandInfo[std::wstring(name)] = info;
+        _commandInfo[name] = info;
+        _completionIndexDirty = true;
         return true;
     }
     catch (...)
@@ -375,26 +420,25 @@ std::vector<std::wstring> ArgcParser::GetAvailableCommands()
     {
         commands.push_back(command);
     }
+
+    // _commandInfo is unordered.
+    std::sort(commands.begin(), commands.end());
     
     return commands;
 }
 
 bool ArgcParser::_parseArgcScript(std::wstring_view scriptContent, std::wstring_view commandName)
 {
-    // Placeholder for full Argc script parsing
-    // In a complete implementation, this would parse comment tags like:
-    // # @describe "Command description"
-    // # @flag -f --flag "Flag description"  
-    // # @option --option "Option description"
-    // # @arg argument "Argument description"
-    return true;
-}
+    ArgcCommandInfo info;
+    info.name = commandName;
+    if (!_analyzeArgcScript(scriptContent, info))
+    {
+        return false;
+    }
 
-std::vector<std::wstring> ArgcParser::_extractArgcTags(std::wstring_view scriptContent)
-{
-    std::vector<std::wstring> tags;
-    // Placeholder for extracting @ tags from Argc scripts
-    return tags;
+    _commandInfo.insert_or_assign(std::wstring{ commandName }, std::move(info));
+    _completionIndexDirty = true;
+    return true;
 }
 
 ArgcParser::ParsedCommand ArgcParser::_parseWithArgcRules(std::wstring_view commandLine, std::wstring_view commandName)
@@ -414,10 +458,129 @@ bool ArgcParser::_isArgcCommand(std::wstring_view command)
     return IsValidCommand(command);
 }
 
+// Extracts the Argc comment tags of a script:
+//   # @describe Command description
+//   # @flag -f --force Flag description
+//   # @option -o --output <FILE> Option description
+//   # @arg target! Argument description
+//   # @cmd Subcommand description, followed by the function implementing it
+// Only the tags of the command itself are recorded, not those of its subcommands.
+// Returns false if the script doesn't contain any tags.
 bool ArgcParser::_analyzeArgcScript(std::wstring_view scriptContent, ArgcCommandInfo& info)
 {
-    // Placeholder for analyzing Argc scripts to extract command information
-    return true;
+    auto foundTags = false;
+    auto inSubcommands = false;
+    auto pendingSubcommand = false;
+
+    for (auto rest = scriptContent; !rest.empty();)
+    {
+        const auto newline = rest.find(L'\n');
+        const auto line = rest.substr(0, newline);
+        rest = newline == std::wstring_view::npos ? std::wstring_view{} : rest.substr(newline + 1);
+
+        CommandLineTokenizer tokenizer{ line };
+        const auto first = tokenizer.Next();
+        if (first.empty())
+        {
+            continue;
+        }
+
+        if (!first.starts_with(L'#'))
+        {
+            if (pendingSubcommand)
+            {
+                // Nested subcommands are named `parent::child`.
+                const auto name = shellFunctionName(line);
+                if (!name.empty() && name.find(L"::") == std::wstring_view::npos)
+                {
+                    info.subcommands.emplace_back(name);
+                }
+                pendingSubcommand = false;
+            }
+            continue;
+        }
+
+        // Both `# @tag` and `#@tag`.
+        const auto tag = first.size() > 1 ? first.substr(1) : tokenizer.Next();
+        if (!tag.starts_with(L'@'))
+        {
+            continue;
+        }
+        foundTags = true;
+
+        if (tag == L"@cmd")
+        {
+            inSubcommands = true;
+            pendingSubcommand = true;
+        }
+        else if (inSubcommands)
+        {
+            continue;
+        }
+        else if (tag == L"@describe")
+        {
+            if (info.description.empty())
+            {
+                info.description = trim(tokenizer.Rest());
+            }
+        }
+        else if (tag == L"@flag" || tag == L"@option")
+        {
+            auto& names = tag == L"@flag" ? info.flags : info.options;
+            // The names come first: `-o --output <FILE> description`.
+            for (auto token = tokenizer.Next(); token.starts_with(L'-'); token = tokenizer.Next())
+            {
+                names.emplace_back(argcParameterName(token));
+            }
+        }
+        else if (tag == L"@arg")
+        {
+            if (const auto name = argcParameterName(tokenizer.Next()); !name.empty())
+            {
+                info.arguments.emplace_back(name);
+            }
+        }
+    }
+
+    return foundTags;
+}
+
+std::string ArgcParser::_serializeCommandInfo(const ArgcCommandInfo& info)
+{
+    DefinitionWriter writer;
+    writer.Write(info.name);
+    writer.Write(info.description);
+    writer.Write(info.flags);
+    writer.Write(info.options);
+    writer.Write(info.arguments);
+    writer.Write(info.subcommands);
+    return writer.Take();
+}
+
+bool ArgcParser::_deserializeCommandInfo(std::string_view payload, ArgcCommandInfo& info)
+{
+    DefinitionReader reader{ payload };
+    return reader.Read(info.name) &&
+           reader.Read(info.description) &&
+           reader.Read(info.flags) &&
+           reader.Read(info.options) &&
+           reader.Read(info.arguments) &&
+           reader.Read(info.subcommands);
+}
+
+const ArgcCompletionIndex& ArgcParser::_getCompletionIndex()
+{
+    if (_completionIndexDirty)
+    {
+        _completionIndex.Clear();
+        for (const auto& [name, info] : _commandInfo)
+        {
+            _completionIndex.AddCommand(name, info.description, info.subcommands, info.flags, info.options);
+        }
+        _completionIndex.Build();
+        _completionIndexDirty = false;
+    }
+    return _completionIndex;
 }
 
 std::unique_ptr<ArgcParser> Microsoft::Terminal::AI::CreateArgcParser()
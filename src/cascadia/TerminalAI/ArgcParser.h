@@ -1,6 +1,7 @@
 #pragma once
 
 #include "pch.h"
+#include "ArgcCompletionIndex.h"
 
 namespace Microsoft::Terminal::AI
 {
@@ -37,8 +38,9 @@ namespace Microsoft::Terminal::AI
         // Parse a command line using Argc rules
         ParsedCommand ParseCommand(std::wstring_view commandLine);
 
-        // Get completion suggestions for partial command
-        std::vector<CompletionSuggestion> GetCompletions(std::wstring_view partialCommand);
+        // Get completion suggestions for partial command, highest priority first.
+        // Suggestions are produced in that order, so a limit cuts the work short.
+        std::vector<CompletionSuggestion> GetCompletions(std::wstring_view partialCommand, size_t maxResults = SIZE_MAX);
 
         // Generate help text for a command
         std::wstring GenerateHelp(std::wstring_view command);
@@ -46,8 +48,10 @@ namespace Microsoft::Terminal::AI
         // Check if a command is recognized by Argc
         bool IsValidCommand(std::wstring_view command);
 
-        // Load command definitions from Argc scripts
-        bool LoadCommandDefinitions(std::wstring_view definitionsPath);
+        // Load command definitions from the Argc scripts (*.sh) in a directory.
+        // The tags extracted from each script are cached in `cachePath`, if given,
+        // so that only scripts that changed since the last call are parsed again.
+        bool LoadCommandDefinitions(std::wstring_view definitionsPath, const std::filesystem::path& cachePath = {});
 
         // Add a custom command definition
         bool AddCommandDefinition(std::wstring_view name, std::wstring_view definition);
@@ -62,7 +66,6 @@ namespace Microsoft::Terminal::AI
 
         // Internal helper methods
         bool _parseArgcScript(std::wstring_view scriptContent, std::wstring_view commandName);
-        std::vector<std::wstring> _extractArgcTags(std::wstring_view scriptContent);
         ParsedCommand _parseWithArgcRules(std::wstring_view commandLine, std::wstring_view commandName);
         std::wstring _generateArgcEvaluation(std::wstring_view command, std::wstring_view args);
         bool _isArgcCommand(std::wstring_view command);
@@ -78,8 +81,15 @@ namespace Microsoft::Terminal::AI
             std::vector<std::wstring> subcommands;
         };
         
-        std::map<std::wstring, ArgcCommandInfo> _commandInfo;
-        bool _analyzeArgcScript(std::wstring_view scriptContent, ArgcCommandInfo& info);
+        til::flat_hash_map<std::wstring, ArgcCommandInfo> _commandInfo;
+        static bool _analyzeArgcScript(std::wstring_view scriptContent, ArgcCommandInfo& info);
+        static std::string _serializeCommandInfo(const ArgcCommandInfo& info);
+        static bool _deserializeCommandInfo(std::string_view payload, ArgcCommandInfo& info);
+
+        // _commandInfo compiled for prefix queries. Rebuilt on the first query after a change.
+        ArgcCompletionIndex _completionIndex;
+        bool _completionIndexDirty = true;
+        const ArgcCompletionIndex& _getCompletionIndex();
     };
 
     // Factory function for creating ArgcParser instances
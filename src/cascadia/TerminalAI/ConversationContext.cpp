@@ -0,0 +1,376 @@
+#include "pch.h"
+#include "ConversationContext.h"
+
+#include <til/unicode.h>
+
+namespace Microsoft::Terminal::AI
+{
+    size_t ApproximateTokenizer::CountTokens(std::wstring_view text) const
+    {
+        return (text.size() + 3) / 4;
+    }
+
+    ConversationContext::ConversationContext(std::shared_ptr<const ITokenizer> tokenizer, size_t tokenBudget) :
+        _tokenizer{ tokenizer ? std::move(tokenizer) : std::make_shared<ApproximateTokenizer>() },
+        _tokenBudget{ tokenBudget }
+    {
+    }
+
+    void ConversationContext::SetTokenizer(std::shared_ptr<const ITokenizer> tokenizer)
+    {
+        _tokenizer = tokenizer ? std::move(tokenizer) : std::make_shared<ApproximateTokenizer>();
+        _retokenize();
+        _trim();
+    }
+
+    void ConversationContext::SetTokenBudget(size_t tokenBudget)
+    {
+        _tokenBudget = tokenBudget;
+        _trim();
+    }
+
+    void ConversationContext::SetSummarizer(Summarizer summarizer)
+    {
+        _summarizer = std::move(summarizer);
+    }
+
+    void ConversationContext::SetSystemMessage(std::wstring_view systemMessage)
+    {
+        _assign(_system, systemMessage.empty() ? Message{} : _makeMessage(L"system", systemMessage));
+        _trim();
+    }
+
+    void ConversationContext::SetTools(const Json::Value& tools)
+    {
+        THROW_HR_IF(E_INVALIDARG, !tools.isNull() && !tools.isArray());
+
+        Message message;
+        if (!tools.empty())
+        {
+            Json::StreamWriterBuilder builder;
+            builder["indentation"] = "";
+            builder["emitUTF8"] = true;
+            message.fragment = Json::writeString(builder, tools);
+            message.content = til::u8u16(message.fragment);
+            message.tokens = _tokenizer->CountTokens(message.content);
+        }
+        _assign(_tools, std::move(message));
+        _trim();
+    }
+
+    void ConversationContext::Append(std::wstring_view role, std::wstring_view content)
+    {
+        _push(_makeMessage(role, content));
+    }
+
+    void ConversationContext::AppendToolCalls(std::wstring_view content, const std::vector<StreamToolCall>& calls)
+    {
+        Json::Value value;
+        value["role"] = "assistant";
+        // Providers expect null rather than "" when the model only called tools.
+        value["content"] = content.empty() ? Json::Value{} : Json::Value{ til::u16u8(content) };
+        auto& toolCalls = value["tool_calls"] = Json::Value{ Json::arrayValue };
+        for (const auto& call : calls)
+        {
+            Json::Value toolCall;
+            toolCall["id"] = til::u16u8(call.id);
+            toolCall["type"] = "function";
+            toolCall["function"]["name"] = til::u16u8(call.name);
+            toolCall["function"]["arguments"] = til::u16u8(call.arguments);
+            toolCalls.append(std::move(toolCall));
+        }
+
+        Message message;
+        message.role = L"assistant";
+        message.content = content;
+        message.toolCalls = calls;
+        _push(_makeMessage(std::move(message), std::move(value)));
+    }
+
+    void ConversationContext::AppendToolResult(std::wstring_view toolCallId, std::wstring_view content)
+    {
+        Message message;
+        message.role = L"tool";
+        // A result can't be evicted without the call it answers and the request that led to it,
+        // since they're all part of the newest turn. An output that doesn't fit gets cut down instead.
+        const auto available = _newestTurnHeadroom();
+        message.content = _tokenizer->CountTokens(content) > available ? _truncate(content, available) : std::wstring{ content };
+
+        Json::Value value;
+        value["role"] = "tool";
+        value["tool_call_id"] = til::u16u8(toolCallId);
+        value["content"] = til::u16u8(message.content);
+        _push(_makeMessage(std::move(message), std::move(value)));
+    }
+
+    void ConversationContext::Clear() noexcept
+    {
+        _messages.clear();
+        _summary = {};
+        _totalTokens = _system.tokens + _tools.tokens;
+        _fragmentBytes = _system.fragment.size() + _tools.fragment.size();
+        _evictedCount = 0;
+    }
+
+    std::wstring_view ConversationContext::SystemMessage() const noexcept
+    {
+        return _system.content;
+    }
+
+    std::wstring_view ConversationContext::Summary() const noexcept
+    {
+        return _summary.content;
+    }
+
+    size_t ConversationContext::TokenBudget() const noexcept
+    {
+        return _tokenBudget;
+    }
+
+    size_t ConversationContext::TotalTokens() const noexcept
+    {
+        return _totalTokens;
+    }
+
+    size_t ConversationContext::MessageCount() const noexcept
+    {
+        return _messages.size();
+    }
+
+    size_t ConversationContext::EvictedCount() const noexcept
+    {
+        return _evictedCount;
+    }
+
+    std::string ConversationContext::BuildRequestPayload(std::wstring_view model, bool stream) const
+    {
+        Json::StreamWriterBuilder builder;
+        builder["indentation"] = "";
+        builder["emitUTF8"] = true;
+        const auto modelJson = Json::writeString(builder, Json::Value{ til::u16u8(model) });
+
+        std::string payload;
+        payload.reserve(64 + modelJson.size() + _fragmentBytes + _messages.size() + 2);
+        payload.append(R"({"model":)");
+        payload.append(modelJson);
+        if (!_tools.fragment.empty())
+        {
+            payload.append(R"(,"tools":)");
+            payload.append(_tools.fragment);
+        }
+        payload.append(stream ? R"(,"stream":true,"messages":[)" : R"(,"stream":false,"messages":[)");
+
+        auto first = true;
+        const auto appendFragment = [&](const Message& message) {
+            if (message.fragment.empty())
+            {
+                return;
+            }
+            if (!first)
+            {
+                payload.push_back(',');
+            }
+            payload.append(message.fragment);
+            first = false;
+        };
+
+        appendFragment(_system);
+        appendFragment(_summary);
+        for (const auto& message : _messages)
+        {
+            appendFragment(message);
+        }
+
+        payload.append("]}");
+        return payload;
+    }
+
+    ConversationContext::Message ConversationContext::_makeMessage(std::wstring_view role, std::wstring_view content) const
+    {
+        Json::Value value;
+        value["role"] = til::u16u8(role);
+        value["content"] = til::u16u8(content);
+
+        Message message;
+        message.role = role;
+        message.content = content;
+        return _makeMessage(std::move(message), std::move(value));
+    }
+
+    // Serializes `value` as the fragment of `message` and counts its tokens.
+    ConversationContext::Message ConversationContext::_makeMessage(Message message, Json::Value value) const
+    {
+        Json::StreamWriterBuilder builder;
+        builder["indentation"] = "";
+        builder["emitUTF8"] = true;
+
+        message.fragment = Json::writeString(builder, value);
+        message.tokens = _countTokens(message);
+        return message;
+    }
+
+    size_t ConversationContext::_countTokens(const Message& message) const
+    {
+        auto tokens = _tokenizer->CountTokens(message.content) + MessageOverheadTokens;
+        for (const auto& call : message.toolCalls)
+        {
+            tokens += _tokenizer->CountTokens(call.name) + _tokenizer->CountTokens(call.arguments);
+        }
+        return tokens;
+    }
+
+    void ConversationContext::_push(Message message)
+    {
+        _totalTokens += message.tokens;
+        _fragmentBytes += message.fragment.size();
+        _messages.emplace_back(std::move(message));
+        _trim();
+    }
+
+    // Replaces a fixed slot (the system message or the summary) and updates the running totals.
+    void ConversationContext::_assign(Message& slot, Message message)
+    {
+        _totalTokens -= slot.tokens;
+        _fragmentBytes -= slot.fragment.size();
+        slot = std::move(message);
+        _totalTokens += slot.tokens;
+        _fragmentBytes += slot.fragment.size();
+    }
+
+    void ConversationContext::_retokenize()
+    {
+        _totalTokens = 0;
+        for (auto message : { &_system, &_summary })
+        {
+            if (!message->fragment.empty())
+            {
+                message->tokens = _countTokens(*message);
+                _totalTokens += message->tokens;
+            }
+        }
+        // The tools aren't a message, so they don't come with the framing overhead.
+        if (!_tools.fragment.empty())
+        {
+            _tools.tokens = _tokenizer->CountTokens(_tools.content);
+            _totalTokens += _tools.tokens;
+        }
+        for (auto& message : _messages)
+        {
+            message.tokens = _countTokens(message);
+            _totalTokens += message.tokens;
+        }
+    }
+
+    // Returns how many tokens the content of another message may take, so that
+    // the newest turn still fits into the budget once all older ones are evicted.
+    size_t ConversationContext::_newestTurnHeadroom() const noexcept
+    {
+        auto used = _system.tokens + _tools.tokens + MessageOverheadTokens;
+        for (auto it = _messages.rbegin(); it != _messages.rend(); ++it)
+        {
+            used += it->tokens;
+            if (it->role == L"user")
+            {
+                break;
+            }
+        }
+        return _tokenBudget > used ? _tokenBudget - used : 0;
+    }
+
+    // Cuts the middle out of `content`, so that it takes at most `maxTokens` (if that's possible
+    // at all). Tool output tends to be the most useful at either end, like a command and its error.
+    std::wstring ConversationContext::_truncate(std::wstring_view content, size_t maxTokens) const
+    {
+        static constexpr std::wstring_view marker{ L"\n[...]\n" };
+
+        const auto build = [&](size_t keep) {
+            auto head = keep - keep / 2;
+            auto tail = keep / 2;
+            // Don't split surrogate pairs.
+            if (head > 0 && til::is_leading_surrogate(content[head - 1]))
+            {
+                head--;
+            }
+            if (tail > 0 && til::is_trailing_surrogate(content[content.size() - tail]))
+            {
+                tail--;
+            }
+
+            std::wstring text;
+            text.reserve(head + marker.size() + tail);
+            text.append(content.substr(0, head));
+            text.append(marker);
+            text.append(content.substr(content.size() - tail));
+            return text;
+        };
+
+        // Find the most characters we can keep. Tokenizers aren't quite monotonic,
+        // but for a cut this coarse it's close enough.
+        size_t lo = 0;
+        size_t hi = content.size();
+        while (lo < hi)
+        {
+            const auto mid = lo + (hi - lo + 1) / 2;
+            if (_tokenizer->CountTokens(build(mid)) <= maxTokens)
+            {
+                lo = mid;
+            }
+            else
+            {
+                hi = mid - 1;
+            }
+        }
+        return build(lo);
+    }
+
+    // Returns whether there's a turn before the newest one, which _evictOldestTurn() may evict.
+    bool ConversationContext::_hasOlderTurn() const noexcept
+    {
+        return _messages.size() > 1 && std::any_of(_messages.begin() + 1, _messages.end(), [](const Message& message) {
+                   return message.role == L"user";
+               });
+    }
+
+    // Evicts the oldest message along with any replies to it, up to the next user message,
+    // so that the remaining context always starts with a complete turn. A reply on its own,
+    // like the result of a tool call without the call, may not be valid at the start.
+    // Only call this if _hasOlderTurn().
+    void ConversationContext::_evictOldestTurn()
+    {
+        std::wstring summary{ _summary.content };
+
+        do
+        {
+            auto& message = _messages.front();
+            if (_summarizer)
+            {
+                summary = _summarizer(summary, message.role, message.content);
+            }
+            _totalTokens -= message.tokens;
+            _fragmentBytes -= message.fragment.size();
+            _messages.pop_front();
+            _evictedCount++;
+        } while (_messages.front().role != L"user");
+
+        if (_summarizer)
+        {
+            _assign(_summary, summary.empty() ? Message{} : _makeMessage(L"system", summary));
+        }
+    }
+
+    void ConversationContext::_trim()
+    {
+        // The newest turn is always kept, even if it exceeds the budget on its own,
+        // because the replies in it make no sense without the message they reply to.
+        while (_totalTokens > _tokenBudget && _hasOlderTurn())
+        {
+            _evictOldestTurn();
+        }
+
+        // A summary that doesn't fit anymore is worse than none at all.
+        if (_totalTokens > _tokenBudget && !_summary.fragment.empty())
+        {
+            _assign(_summary, {});
+        }
+    }
+}
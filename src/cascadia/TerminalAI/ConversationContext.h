@@ -0,0 +1,101 @@
+#pragma once
+
+#include "pch.h"
+#include "AIStreaming.h"
+
+namespace Microsoft::Terminal::AI
+{
+    // Estimates how many model tokens a piece of text occupies.
+    class ITokenizer
+    {
+    public:
+        virtual ~ITokenizer() = default;
+        virtual size_t CountTokens(std::wstring_view text) const = 0;
+    };
+
+    // The usual rule of thumb for English text and code: about 4 characters per token.
+    class ApproximateTokenizer : public ITokenizer
+    {
+    public:
+        size_t CountTokens(std::wstring_view text) const override;
+    };
+
+    // Holds the messages sent along with each chat request and keeps them within a token budget.
+    //
+    // Each message is tokenized and serialized exactly once, when it's appended. The running
+    // token total is updated incrementally and the request payload is built by concatenating
+    // the cached fragments. Once the budget is exceeded, the oldest turns are evicted
+    // (and optionally folded into a running summary), so the per-turn cost stays constant
+    // no matter how long the session gets.
+    class ConversationContext
+    {
+    public:
+        // Folds an evicted message into the running summary and returns the new summary.
+        using Summarizer = std::function<std::wstring(std::wstring_view summary, std::wstring_view role, std::wstring_view content)>;
+
+        // Fixed per-message cost of the chat message framing.
+        static constexpr size_t MessageOverheadTokens = 4;
+
+        explicit ConversationContext(std::shared_ptr<const ITokenizer> tokenizer = nullptr, size_t tokenBudget = 8192);
+
+        void SetTokenizer(std::shared_ptr<const ITokenizer> tokenizer);
+        void SetTokenBudget(size_t tokenBudget);
+        void SetSummarizer(Summarizer summarizer);
+        void SetSystemMessage(std::wstring_view systemMessage);
+        // Sets the JSON array of tools the model may call. Null or an empty array removes them.
+        void SetTools(const Json::Value& tools);
+
+        void Append(std::wstring_view role, std::wstring_view content);
+        // Appends an assistant message that asks for the given tool calls. Their results
+        // must follow, one AppendToolResult() per call, before the next assistant message.
+        void AppendToolCalls(std::wstring_view content, const std::vector<StreamToolCall>& calls);
+        // Appends the result of a tool call. An output that doesn't fit into the budget
+        // along with the rest of the newest turn has its middle cut out.
+        void AppendToolResult(std::wstring_view toolCallId, std::wstring_view content);
+        void Clear() noexcept;
+
+        std::wstring_view SystemMessage() const noexcept;
+        std::wstring_view Summary() const noexcept;
+        size_t TokenBudget() const noexcept;
+        size_t TotalTokens() const noexcept;
+        size_t MessageCount() const noexcept;
+        size_t EvictedCount() const noexcept;
+
+        // Returns the UTF-8 JSON body of a chat completions request.
+        std::string BuildRequestPayload(std::wstring_view model, bool stream) const;
+
+    private:
+        struct Message
+        {
+            std::wstring role;
+            std::wstring content;
+            std::vector<StreamToolCall> toolCalls;
+            std::string fragment;
+            size_t tokens = 0;
+        };
+
+        std::shared_ptr<const ITokenizer> _tokenizer;
+        Summarizer _summarizer;
+        size_t _tokenBudget;
+
+        Message _system;
+        Message _summary;
+        Message _tools;
+        std::deque<Message> _messages;
+        size_t _totalTokens = 0;
+        size_t _fragmentBytes = 0;
+        size_t _evictedCount = 0;
+
+        Message _makeMessage(std::wstring_view role, std::wstring_view content) const;
+        Message _makeMessage(Message message, Json::Value value) const;
+        size_t _countTokens(const Message& message) const;
+        void _push(Message message);
+        void _assign(Message& slot, Message message);
+        void _retokenize();
+        size_t _newestTurnHeadroom() const noexcept;
+        std::wstring _truncate(std::wstring_view content, size_t maxTokens) const;
+        bool _hasOlderTurn() const noexcept;
+        void _evictOldestTurn();
+        void _trim();
+    };
+}
@@ -0,0 +1,239 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include "ConversationContext.h"
+
+#include <chrono>
+
+using namespace Microsoft::Terminal::AI;
+using namespace WEX::Common;
+using namespace WEX::Logging;
+
+namespace
+{
+    // One token per character makes the budget arithmetic in the tests easy to follow.
+    class CharTokenizer : public ITokenizer
+    {
+    public:
+        size_t CountTokens(std::wstring_view text) const override
+        {
+            calls++;
+            return text.size();
+        }
+
+        mutable size_t calls = 0;
+    };
+
+    constexpr auto overhead = ConversationContext::MessageOverheadTokens;
+}
+
+class ConversationContextTests
+{
+    TEST_CLASS(ConversationContextTests);
+
+    TEST_METHOD(RunningTotal)
+    {
+        const auto tokenizer = std::make_shared<CharTokenizer>();
+        ConversationContext context{ tokenizer, 1000 };
+
+        context.SetSystemMessage(L"sys");
+        context.Append(L"user", L"hello");
+        context.Append(L"assistant", L"hi there");
+        VERIFY_ARE_EQUAL(3 + 5 + 8 + 3 * overhead, context.TotalTokens());
+        VERIFY_ARE_EQUAL(size_t(2), context.MessageCount());
+
+        Log::Comment(L"Every message is tokenized exactly once");
+        VERIFY_ARE_EQUAL(size_t(3), tokenizer->calls);
+        (void)context.BuildRequestPayload(L"gpt-4", true);
+        VERIFY_ARE_EQUAL(size_t(3), tokenizer->calls);
+
+        context.SetSystemMessage(L"system");
+        VERIFY_ARE_EQUAL(6 + 5 + 8 + 3 * overhead, context.TotalTokens());
+
+        context.Clear();
+        VERIFY_ARE_EQUAL(6 + overhead, context.TotalTokens());
+        VERIFY_ARE_EQUAL(size_t(0), context.MessageCount());
+    }
+
+    TEST_METHOD(RequestPayload)
+    {
+        ConversationContext context;
+        context.SetSystemMessage(L"Be brief.");
+        context.Append(L"user", L"Say \"héllo\"");
+        context.Append(L"assistant", L"héllo");
+
+        const auto payload = context.BuildRequestPayload(L"gpt-4", true);
+        VERIFY_ARE_EQUAL(std::string{ R"({"model":"gpt-4","stream":true,"messages":[{"content":"Be brief.","role":"system"},{"content":"Say \"héllo\"","role":"user"},{"content":"héllo","role":"assistant"}]})" }, payload);
+
+        Json::Value root;
+        const std::unique_ptr<Json::CharReader> reader{ Json::CharReaderBuilder{}.newCharReader() };
+        VERIFY_IS_TRUE(reader->parse(payload.data(), payload.data() + payload.size(), &root, nullptr));
+        VERIFY_ARE_EQUAL(3u, root["messages"].size());
+        VERIFY_ARE_EQUAL(std::string{ "h\xc3\xa9llo" }, root["messages"][2]["content"].asString());
+    }
+
+    TEST_METHOD(ToolMessages)
+    {
+        const auto tokenizer = std::make_shared<CharTokenizer>();
+        ConversationContext context{ tokenizer, 1000 };
+
+        Json::Value tools{ Json::arrayValue };
+        tools[0]["type"] = "function";
+        tools[0]["function"]["name"] = "ls";
+        context.SetTools(tools);
+        const auto toolTokens = std::string_view{ R"([{"function":{"name":"ls"},"type":"function"}])" }.size();
+        VERIFY_ARE_EQUAL(toolTokens, context.TotalTokens());
+
+        context.Append(L"user", L"list");
+        context.AppendToolCalls(L"", { { L"call_1", L"ls", LR"({"path":"."})" } });
+        context.AppendToolResult(L"call_1", L"a.txt");
+        VERIFY_ARE_EQUAL(toolTokens + 4 + (2 + 12) + 5 + 3 * overhead, context.TotalTokens());
+
+        const auto payload = context.BuildRequestPayload(L"gpt-4", true);
+        VERIFY_ARE_EQUAL(std::string{ R"({"model":"gpt-4","tools":[{"function":{"name":"ls"},"type":"function"}],"stream":true,"messages":[)"
+                                      R"({"content":"list","role":"user"},)"
+                                      R"({"content":null,"role":"assistant","tool_calls":[{"function":{"arguments":"{\"path\":\".\"}","name":"ls"},"id":"call_1","type":"function"}]},)"
+                                      R"({"content":"a.txt","role":"tool","tool_call_id":"call_1"}]})" },
+                         payload);
+
+        Log::Comment(L"Tool calls are evicted along with the turn they belong to");
+        context.Append(L"assistant", L"a.txt");
+        context.Append(L"user", L"again");
+        context.SetTokenBudget(toolTokens + 5 + overhead);
+        VERIFY_ARE_EQUAL(size_t(1), context.MessageCount());
+        VERIFY_ARE_EQUAL(size_t(4), context.EvictedCount());
+
+        Log::Comment(L"Removing the tools removes them from the payload");
+        context.SetTools({});
+        VERIFY_ARE_EQUAL(5 + overhead, context.TotalTokens());
+        VERIFY_IS_TRUE(context.BuildRequestPayload(L"gpt-4", true).find("tools") == std::string::npos);
+        VERIFY_THROWS(context.SetTools(Json::Value{ "ls" }), wil::ResultException);
+    }
+
+    TEST_METHOD(OversizedToolResult)
+    {
+        ConversationContext context{ std::make_shared<CharTokenizer>(), 100 };
+        context.Append(L"user", L"hello");
+        context.Append(L"assistant", L"hi");
+
+        context.Append(L"user", L"list");
+        context.AppendToolCalls(L"", { { L"call_1", L"ls", L"{}" } });
+        context.AppendToolResult(L"call_1", L"start" + std::wstring(1000, L'x') + L"end");
+
+        Log::Comment(L"The output is cut down to what's left of the budget, instead of evicting the call it answers");
+        VERIFY_ARE_EQUAL(size_t(3), context.MessageCount());
+        VERIFY_ARE_EQUAL(size_t(100), context.TotalTokens());
+
+        const auto payload = context.BuildRequestPayload(L"gpt-4", false);
+        VERIFY_IS_TRUE(payload.find(R"("messages":[{"content":"list","role":"user"},)") != std::string::npos);
+        VERIFY_IS_TRUE(payload.find(R"("content":"startxxx)") != std::string::npos);
+        VERIFY_IS_TRUE(payload.find(R"(xxx\n[...]\nxxx)") != std::string::npos);
+        VERIFY_IS_TRUE(payload.find(R"(xxxend","role":"tool")") != std::string::npos);
+
+        Log::Comment(L"A result is never left at the start without its call");
+        context.Append(L"assistant", L"done");
+        context.SetTokenBudget(50);
+        VERIFY_ARE_EQUAL(size_t(4), context.MessageCount());
+        VERIFY_IS_TRUE(context.BuildRequestPayload(L"gpt-4", false).find(R"("messages":[{"content":"list","role":"user"},)") != std::string::npos);
+    }
+
+    TEST_METHOD(TrimOldestTurns)
+    {
+        ConversationContext context{ std::make_shared<CharTokenizer>(), 4 * (10 + overhead) };
+        context.SetSystemMessage(L"0123456789");
+
+        for (auto i = 0; i < 3; i++)
+        {
+            context.Append(L"user", L"question" + std::to_wstring(i) + L"!");
+            context.Append(L"assistant", L"answer " + std::to_wstring(i) + L"..");
+        }
+
+        Log::Comment(L"Only the system message and the last turn fit, whole turns are evicted");
+        VERIFY_ARE_EQUAL(size_t(2), context.MessageCount());
+        VERIFY_ARE_EQUAL(size_t(4), context.EvictedCount());
+        VERIFY_ARE_EQUAL(3 * (10 + overhead), context.TotalTokens());
+        VERIFY_IS_TRUE(context.BuildRequestPayload(L"m", false).find("question2!") != std::string::npos);
+        VERIFY_IS_TRUE(context.BuildRequestPayload(L"m", false).find("question1!") == std::string::npos);
+
+        Log::Comment(L"The newest turn is kept even if it doesn't fit on its own");
+        context.Append(L"user", std::wstring(100, L'x'));
+        VERIFY_ARE_EQUAL(size_t(1), context.MessageCount());
+        context.Append(L"assistant", L"ok");
+        VERIFY_ARE_EQUAL(size_t(2), context.MessageCount());
+        VERIFY_IS_GREATER_THAN(context.TotalTokens(), context.TokenBudget());
+
+        Log::Comment(L"Shrinking the budget trims immediately");
+        context.Append(L"user", L"hi");
+        context.Append(L"assistant", L"ok");
+        context.Append(L"user", L"hi");
+        VERIFY_ARE_EQUAL(size_t(3), context.MessageCount());
+        context.SetTokenBudget(30);
+        VERIFY_ARE_EQUAL(size_t(1), context.MessageCount());
+        VERIFY_IS_LESS_THAN_OR_EQUAL(context.TotalTokens(), size_t(30));
+    }
+
+    TEST_METHOD(SummarizeEvictedTurns)
+    {
+        ConversationContext context{ std::make_shared<CharTokenizer>(), 100 };
+        context.SetSummarizer([](std::wstring_view summary, std::wstring_view role, std::wstring_view content) {
+            if (role != L"user")
+            {
+                return std::wstring{ summary };
+            }
+            return std::wstring{ summary.empty() ? L"Asked:" : summary } + L" " + std::wstring{ content.substr(0, 2) };
+        });
+
+        for (auto i = 0; i < 10; i++)
+        {
+            context.Append(L"user", L"q" + std::to_wstring(i) + std::wstring(10, L'.'));
+            context.Append(L"assistant", std::wstring(10, L'a'));
+        }
+
+        VERIFY_IS_LESS_THAN_OR_EQUAL(context.TotalTokens(), size_t(100));
+        VERIFY_IS_TRUE(context.Summary().starts_with(L"Asked: q0 q1"));
+        VERIFY_IS_TRUE(context.BuildRequestPayload(L"m", true).find("Asked: q0") != std::string::npos);
+    }
+
+    TEST_METHOD(LongSessionPerformance)
+    {
+        using clock = std::chrono::steady_clock;
+        static constexpr auto turns = 1000;
+
+        const auto question = std::wstring(200, L'q');
+        const auto answer = std::wstring(1200, L'a');
+
+        // Measures the cost of one turn: append both messages and build the next request body.
+        ConversationContext context{ nullptr, 8192 - 1024 };
+        context.SetSystemMessage(L"You are a helpful AI assistant integrated into Windows Terminal.");
+
+        std::vector<double> turnMicroseconds;
+        turnMicroseconds.reserve(turns);
+        size_t payloadBytes = 0;
+        for (auto i = 0; i < turns; i++)
+        {
+            const auto start = clock::now();
+            context.Append(L"user", question);
+            payloadBytes = context.BuildRequestPayload(L"gpt-4", true).size();
+            context.Append(L"assistant", answer);
+            turnMicroseconds.emplace_back(std::chrono::duration<double, std::micro>(clock::now() - start).count());
+        }
+
+        const auto average = [&](size_t begin, size_t end) {
+            double sum = 0;
+            for (auto i = begin; i < end; i++)
+            {
+                sum += turnMicroseconds[i];
+            }
+            return sum / (end - begin);
+        };
+        const auto early = average(0, 100);
+        const auto late = average(turns - 100, turns);
+
+        Log::Comment(NoThrowString().Format(L"turns 1-100: %.2fus/turn, turns 901-1000: %.2fus/turn", early, late));
+        Log::Comment(NoThrowString().Format(L"%zu messages kept, %zu evicted, %zu tokens, %zu byte payload", context.MessageCount(), context.EvictedCount(), context.TotalTokens(), payloadBytes));
+
+        VERIFY_IS_LESS_THAN_OR_EQUAL(context.TotalTokens(), context.TokenBudget());
+        VERIFY_ARE_EQUAL(size_t(2 * turns), context.MessageCount() + context.EvictedCount());
+    }
+};
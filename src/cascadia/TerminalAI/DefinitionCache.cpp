@@ -0,0 +1,322 @@
+#include "pch.h"
+#include "DefinitionCache.h"
+#include "ThreadPoolBatch.h"
+
+using namespace Microsoft::Terminal::AI;
+
+namespace
+{
+    // The cache file consists of a header followed by one record per file:
+    //   Header: magic, FormatVersion, the caller's version, record count (all uint32_t)
+    //   Record: path length (uint32_t, in wchar_t), size (uint64_t), last write time (int64_t),
+    //           payload length (uint32_t, in bytes), path, payload
+    // Fields are copied with memcpy, as nothing is aligned. The file never
+    // leaves the machine that wrote it, so it's stored in native byte order.
+    constexpr uint32_t Magic = 0x43445457; // "WTDC"
+    constexpr uint32_t FormatVersion = 1;
+    constexpr size_t RecordHeaderSize = 2 * sizeof(uint32_t) + sizeof(uint64_t) + sizeof(int64_t);
+
+    template<typename T>
+    void append(std::string& buffer, const T& value)
+    {
+        buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    template<typename T>
+    bool consume(std::string_view& rest, T& value) noexcept
+    {
+        if (rest.size() < sizeof(value))
+        {
+            return false;
+        }
+        memcpy(&value, rest.data(), sizeof(value));
+        rest.remove_prefix(sizeof(value));
+        return true;
+    }
+
+    bool consume(std::string_view& rest, std::wstring& value, uint32_t length)
+    {
+        const auto bytes = size_t{ length } * sizeof(wchar_t);
+        if (rest.size() < bytes)
+        {
+            return false;
+        }
+        value.resize(length);
+        memcpy(value.data(), rest.data(), bytes);
+        rest.remove_prefix(bytes);
+        return true;
+    }
+}
+
+std::vector<DefinitionSource> Microsoft::Terminal::AI::EnumerateDefinitionSources(const std::filesystem::path& directory, std::wstring_view extension)
+{
+    std::vector<DefinitionSource> sources;
+
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator{ directory, ec })
+    {
+        // On Windows the directory listing already contains the size and the last write time,
+        // so this doesn't touch the files themselves.
+        if (!entry.is_regular_file(ec) || entry.path().extension() != extension)
+        {
+            continue;
+        }
+
+        auto& source = sources.emplace_back();
+        source.path = entry.path();
+        source.size = entry.file_size(ec);
+        source.lastWriteTime = entry.last_write_time(ec).time_since_epoch().count();
+    }
+
+    std::sort(sources.begin(), sources.end(), [](const auto& a, const auto& b) { return a.path < b.path; });
+    return sources;
+}
+
+void DefinitionWriter::Write(uint32_t value)
+{
+    append(_buffer, value);
+}
+
+void DefinitionWriter::Write(uint64_t value)
+{
+    append(_buffer, value);
+}
+
+void DefinitionWriter::Write(std::wstring_view value)
+{
+    append(_buffer, gsl::narrow<uint32_t>(value.size()));
+    _buffer.append(reinterpret_cast<const char*>(value.data()), value.size() * sizeof(wchar_t));
+}
+
+void DefinitionWriter::Write(std::span<const std::wstring> values)
+{
+    append(_buffer, gsl::narrow<uint32_t>(values.size()));
+    for (const auto& value : values)
+    {
+        Write(value);
+    }
+}
+
+std::string DefinitionWriter::Take() noexcept
+{
+    return std::move(_buffer);
+}
+
+bool DefinitionReader::Read(uint32_t& value) noexcept
+{
+    return consume(_rest, value);
+}
+
+bool DefinitionReader::Read(uint64_t& value) noexcept
+{
+    return consume(_rest, value);
+}
+
+bool DefinitionReader::Read(std::wstring& value)
+{
+    auto rest = _rest;
+    uint32_t length = 0;
+    std::wstring result;
+    if (!consume(rest, length) || !consume(rest, result, length))
+    {
+        return false;
+    }
+    value = std::move(result);
+    _rest = rest;
+    return true;
+}
+
+bool DefinitionReader::Read(std::vector<std::wstring>& values)
+{
+    auto rest = _rest;
+    uint32_t count = 0;
+    if (!consume(rest, count))
+    {
+        return false;
+    }
+
+    // Every string takes at least 4 bytes. This keeps a corrupt count from reserving gigabytes.
+    if (count > rest.size() / sizeof(uint32_t))
+    {
+        return false;
+    }
+
+    DefinitionReader reader{ rest };
+    std::vector<std::wstring> result(count);
+    for (auto& value : result)
+    {
+        if (!reader.Read(value))
+        {
+            return false;
+        }
+    }
+
+    values = std::move(result);
+    _rest = reader._rest;
+    return true;
+}
+
+DefinitionCache::DefinitionCache(std::filesystem::path cachePath, uint32_t version) :
+    _cachePath{ std::move(cachePath) },
+    _version{ version }
+{
+}
+
+std::vector<std::string> DefinitionCache::Resolve(std::span<const DefinitionSource> sources, const ParseCallback& parse)
+{
+    _stats = {};
+
+    std::string buffer;
+    const auto entries = _load(buffer);
+
+    std::vector<std::string> payloads(sources.size());
+    std::vector<size_t> changed;
+    for (size_t i = 0; i < sources.size(); ++i)
+    {
+        const auto& source = til::at(sources, i);
+        const auto it = entries.find(source.path.wstring());
+        if (it != entries.end() && it->second.size == source.size && it->second.lastWriteTime == source.lastWriteTime)
+        {
+            payloads[i] = it->second.payload;
+        }
+        else
+        {
+            changed.emplace_back(i);
+        }
+    }
+
+    // Files that failed to parse aren't cached, so that they're retried next time.
+    // (Not a std::vector<bool>, as its elements can't be written concurrently.)
+    std::vector<uint8_t> failed(sources.size());
+    RunOnThreadPool(changed.size(), [&](size_t i) {
+        const auto index = changed[i];
+        try
+        {
+            payloads[index] = parse(til::at(sources, index).path);
+        }
+        catch (...)
+        {
+            LOG_CAUGHT_EXCEPTION();
+            failed[index] = true;
+        }
+    });
+
+    _stats.hits = sources.size() - changed.size();
+    _stats.parsed = changed.size();
+
+    // Files that were deleted leave an entry behind that Resolve() didn't use.
+    if (!changed.empty() || entries.size() != _stats.hits)
+    {
+        _save(sources, payloads, failed);
+    }
+
+    return payloads;
+}
+
+DefinitionCache::Stats DefinitionCache::LastStats() const noexcept
+{
+    return _stats;
+}
+
+// Reads the cache file into `buffer` and indexes it. The entries point into `buffer`.
+// A missing, outdated or damaged cache file simply results in an empty cache.
+til::flat_hash_map<std::wstring, DefinitionCache::Entry> DefinitionCache::_load(std::string& buffer) const
+{
+    til::flat_hash_map<std::wstring, Entry> entries;
+    if (_cachePath.empty())
+    {
+        return entries;
+    }
+
+    try
+    {
+        buffer = til::io::read_file_as_utf8_string_if_exists(_cachePath);
+    }
+    catch (...)
+    {
+        LOG_CAUGHT_EXCEPTION();
+        return entries;
+    }
+
+    std::string_view rest{ buffer };
+    uint32_t magic = 0;
+    uint32_t formatVersion = 0;
+    uint32_t version = 0;
+    uint32_t count = 0;
+    if (!consume(rest, magic) || !consume(rest, formatVersion) || !consume(rest, version) || !consume(rest, count) ||
+        magic != Magic || formatVersion != FormatVersion || version != _version ||
+        count > rest.size() / RecordHeaderSize)
+    {
+        return entries;
+    }
+
+    entries.reserve(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint32_t pathLength = 0;
+        uint32_t payloadLength = 0;
+        Entry entry;
+        std::wstring path;
+        if (!consume(rest, pathLength) || !consume(rest, entry.size) || !consume(rest, entry.lastWriteTime) ||
+            !consume(rest, payloadLength) || !consume(rest, path, pathLength) || rest.size() < payloadLength)
+        {
+            entries.clear();
+            return entries;
+        }
+
+        entry.payload = rest.substr(0, payloadLength);
+        rest.remove_prefix(payloadLength);
+        entries.insert_or_assign(std::move(path), entry);
+    }
+
+    return entries;
+}
+
+void DefinitionCache::_save(std::span<const DefinitionSource> sources, const std::vector<std::string>& payloads, const std::vector<uint8_t>& failed) const
+{
+    if (_cachePath.empty())
+    {
+        return;
+    }
+
+    try
+    {
+        size_t capacity = 4 * sizeof(uint32_t);
+        uint32_t count = 0;
+        for (size_t i = 0; i < sources.size(); ++i)
+        {
+            capacity += RecordHeaderSize + til::at(sources, i).path.native().size() * sizeof(wchar_t) + payloads[i].size();
+            count += failed[i] ? 0 : 1;
+        }
+
+        std::string buffer;
+        buffer.reserve(capacity);
+        append(buffer, Magic);
+        append(buffer, FormatVersion);
+        append(buffer, _version);
+        append(buffer, count);
+
+        for (size_t i = 0; i < sources.size(); ++i)
+        {
+            if (failed[i])
+            {
+                continue;
+            }
+
+            const auto& source = til::at(sources, i);
+            const auto path = source.path.wstring();
+            append(buffer, gsl::narrow<uint32_t>(path.size()));
+            append(buffer, source.size);
+            append(buffer, source.lastWriteTime);
+            append(buffer, gsl::narrow<uint32_t>(payloads[i].size()));
+            buffer.append(reinterpret_cast<const char*>(path.data()), path.size() * sizeof(wchar_t));
+            buffer.append(payloads[i]);
+        }
+
+        std::error_code ec;
+        std::filesystem::create_directories(_cachePath.parent_path(), ec);
+        til::io::write_utf8_string_to_file_atomic(_cachePath, buffer);
+    }
+    // The cache is only an optimization. The next start will just parse everything again.
+    CATCH_LOG();
+}
\ No newline at end of file
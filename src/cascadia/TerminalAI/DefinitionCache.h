@@ -0,0 +1,95 @@
+#pragma once
+
+#include "pch.h"
+
+namespace Microsoft::Terminal::AI
+{
+    // A file the definitions are extracted from, along with what the directory listing said about it.
+    struct DefinitionSource
+    {
+        std::filesystem::path path;
+        uint64_t size = 0;
+        int64_t lastWriteTime = 0;
+    };
+
+    // Lists the regular files in `directory` with the given extension (including the dot), sorted by path.
+    // Returns an empty list if the directory doesn't exist.
+    std::vector<DefinitionSource> EnumerateDefinitionSources(const std::filesystem::path& directory, std::wstring_view extension);
+
+    // Serializes the definitions extracted from a single file into a cache payload.
+    class DefinitionWriter
+    {
+    public:
+        void Write(uint32_t value);
+        void Write(uint64_t value);
+        void Write(std::wstring_view value);
+        void Write(std::span<const std::wstring> values);
+        std::string Take() noexcept;
+
+    private:
+        std::string _buffer;
+    };
+
+    // Reads a payload written by DefinitionWriter, field by field in the same order.
+    // Reading past the end of the payload fails and leaves `value` untouched.
+    class DefinitionReader
+    {
+    public:
+        explicit constexpr DefinitionReader(std::string_view payload) noexcept :
+            _rest{ payload }
+        {
+        }
+
+        bool Read(uint32_t& value) noexcept;
+        bool Read(uint64_t& value) noexcept;
+        bool Read(std::wstring& value);
+        bool Read(std::vector<std::wstring>& values);
+
+    private:
+        std::string_view _rest;
+    };
+
+    // A persistent cache of whatever was extracted from a set of files, like the tags of
+    // Argc scripts or the contents of function manifests, so that startup only has to
+    // parse the files that changed. Entries are keyed by path and validated by the file's
+    // size and last write time. The cache file is read with a single read and only
+    // rewritten if anything changed.
+    class DefinitionCache
+    {
+    public:
+        // Turns the contents of a file into a payload. Called concurrently from thread pool threads.
+        using ParseCallback = std::function<std::string(const std::filesystem::path&)>;
+
+        struct Stats
+        {
+            size_t hits = 0;
+            size_t parsed = 0;
+        };
+
+        // `version` identifies the payload format of the caller. A cache file written
+        // with a different version is ignored. An empty `cachePath` disables persistence.
+        DefinitionCache(std::filesystem::path cachePath, uint32_t version);
+
+        // Returns the payload of each of `sources`, in order. Unchanged files are served from the
+        // cache and the rest are passed to `parse` in parallel. Files for which `parse` throws get an
+        // empty payload and aren't cached. Entries for files that aren't in `sources` anymore are dropped.
+        std::vector<std::string> Resolve(std::span<const DefinitionSource> sources, const ParseCallback& parse);
+
+        Stats LastStats() const noexcept;
+
+    private:
+        struct Entry
+        {
+            uint64_t size = 0;
+            int64_t lastWriteTime = 0;
+            std::string_view payload;
+        };
+
+        std::filesystem::path _cachePath;
+        uint32_t _version = 0;
+        Stats _stats;
+
+        til::flat_hash_map<std::wstring, Entry> _load(std::string& buffer) const;
+        void _save(std::span<const DefinitionSource> sources, const std::vector<std::string>& payloads, const std::vector<uint8_t>& failed) const;
+    };
+}
\ No newline at end of file
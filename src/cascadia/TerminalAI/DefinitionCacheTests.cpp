@@ -0,0 +1,238 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include "ArgcParser.h"
+#include "DefinitionCache.h"
+#include "TestUtilities.h"
+
+#include <chrono>
+#include <fstream>
+
+using namespace Microsoft::Terminal::AI;
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace TerminalAIUnitTests;
+
+namespace
+{
+    std::filesystem::path cachePath(const ScratchDirectory& directory)
+    {
+        return directory.Path() / L"cache" / L"definitions.bin";
+    }
+
+    // Returns the contents of each file.
+    std::string readDefinition(const std::filesystem::path& path)
+    {
+        return til::io::read_file_as_utf8_string_if_exists(path);
+    }
+
+    std::string argcScript(int i)
+    {
+        const auto n = std::to_string(i);
+        return "#!/usr/bin/env bash\n"
+               "set -e\n"
+               "\n"
+               "# @describe Generated tool " + n + ".\n"
+               "# @flag -v --verbose Print more\n"
+               "# @option --path! The path to operate on\n"
+               "# @option -f --format[json|text] The output format\n"
+               "# @arg target The target\n"
+               "\n"
+               "# @cmd Lists things\n"
+               "list() {\n"
+               "    ls \"$argc_path\"\n"
+               "}\n"
+               "\n"
+               "# @cmd Shows one thing\n"
+               "# @option --id Which one\n"
+               "show() {\n"
+               "    cat \"$argc_path/$argc_id\"\n"
+               "}\n"
+               "\n"
+               "eval \"$(argc --argc-eval \"$0\" \"$@\")\"\n";
+    }
+}
+
+class DefinitionCacheTests
+{
+    TEST_CLASS(DefinitionCacheTests);
+
+    TEST_METHOD(PayloadRoundTrip)
+    {
+        const std::vector<std::wstring> values{ L"a", L"", L"ünïcode" };
+
+        DefinitionWriter writer;
+        writer.Write(42u);
+        writer.Write(L"name");
+        writer.Write(values);
+        const auto payload = writer.Take();
+
+        uint32_t number = 0;
+        std::wstring name;
+        std::vector<std::wstring> read;
+        DefinitionReader reader{ payload };
+        VERIFY_IS_TRUE(reader.Read(number));
+        VERIFY_IS_TRUE(reader.Read(name));
+        VERIFY_IS_TRUE(reader.Read(read));
+        VERIFY_ARE_EQUAL(42u, number);
+        VERIFY_ARE_EQUAL(std::wstring{ L"name" }, name);
+        VERIFY_IS_TRUE(read == values);
+        VERIFY_IS_FALSE(reader.Read(number));
+
+        Log::Comment(L"Truncated payloads are rejected");
+        for (size_t length = 0; length < payload.size(); ++length)
+        {
+            DefinitionReader truncated{ std::string_view{ payload }.substr(0, length) };
+            const auto complete = truncated.Read(number) && truncated.Read(name) && truncated.Read(read);
+            VERIFY_IS_FALSE(complete);
+        }
+    }
+
+    TEST_METHOD(OnlyChangedFilesAreParsed)
+    {
+        ScratchDirectory directory{ L"DefinitionCacheTests" };
+        directory.Write(L"a.sh", "a");
+        const auto b = directory.Write(L"b.sh", "b");
+        const auto c = directory.Write(L"c.sh", "c");
+        directory.Write(L"ignored.txt", "ignored");
+
+        CallCounter parser;
+        auto sources = EnumerateDefinitionSources(directory.Path(), L".sh");
+        VERIFY_ARE_EQUAL(size_t(3), sources.size());
+
+        {
+            DefinitionCache cache{ cachePath(directory), 1 };
+            const auto payloads = cache.Resolve(sources, parser.Count(readDefinition));
+            VERIFY_IS_TRUE((payloads == std::vector<std::string>{ "a", "b", "c" }));
+            VERIFY_ARE_EQUAL(size_t(3), parser.calls.load());
+            VERIFY_IS_TRUE(std::filesystem::exists(cachePath(directory)));
+        }
+
+        Log::Comment(L"A second start reads nothing but the cache");
+        parser.calls = 0;
+        DefinitionCache cache{ cachePath(directory), 1 };
+        auto payloads = cache.Resolve(sources, parser.Count(readDefinition));
+        VERIFY_IS_TRUE((payloads == std::vector<std::string>{ "a", "b", "c" }));
+        VERIFY_ARE_EQUAL(size_t(0), parser.calls.load());
+        VERIFY_ARE_EQUAL(size_t(3), cache.LastStats().hits);
+
+        Log::Comment(L"A file with a new size or a new last write time is parsed again");
+        directory.Write(L"b.sh", "bb");
+        std::ofstream{ c, std::ios::binary } << "C";
+        std::filesystem::last_write_time(c, std::filesystem::last_write_time(c) + std::chrono::seconds{ 10 });
+        sources = EnumerateDefinitionSources(directory.Path(), L".sh");
+        parser.calls = 0;
+        payloads = cache.Resolve(sources, parser.Count(readDefinition));
+        VERIFY_IS_TRUE((payloads == std::vector<std::string>{ "a", "bb", "C" }));
+        VERIFY_ARE_EQUAL(size_t(2), parser.calls.load());
+
+        Log::Comment(L"Deleted files are dropped from the cache");
+        std::filesystem::remove(b);
+        sources = EnumerateDefinitionSources(directory.Path(), L".sh");
+        payloads = cache.Resolve(sources, parser.Count(readDefinition));
+        VERIFY_IS_TRUE((payloads == std::vector<std::string>{ "a", "C" }));
+        const auto cacheSize = std::filesystem::file_size(cachePath(directory));
+        parser.calls = 0;
+        payloads = cache.Resolve(sources, parser.Count(readDefinition));
+        VERIFY_ARE_EQUAL(size_t(0), parser.calls.load());
+        VERIFY_ARE_EQUAL(cacheSize, std::filesystem::file_size(cachePath(directory)));
+    }
+
+    TEST_METHOD(UnusableCachesAreIgnored)
+    {
+        ScratchDirectory directory{ L"DefinitionCacheTests" };
+        directory.Write(L"a.sh", "a");
+        directory.Write(L"b.sh", "b");
+        const auto sources = EnumerateDefinitionSources(directory.Path(), L".sh");
+
+        CallCounter parser;
+        DefinitionCache{ cachePath(directory), 1 }.Resolve(sources, parser.Count(readDefinition));
+
+        Log::Comment(L"A cache written by a different version");
+        parser.calls = 0;
+        DefinitionCache{ cachePath(directory), 2 }.Resolve(sources, parser.Count(readDefinition));
+        VERIFY_ARE_EQUAL(size_t(2), parser.calls.load());
+
+        Log::Comment(L"A truncated cache");
+        const auto content = til::io::read_file_as_utf8_string_if_exists(cachePath(directory));
+        std::ofstream{ cachePath(directory), std::ios::binary }.write(content.data(), content.size() - 1);
+        parser.calls = 0;
+        auto payloads = DefinitionCache{ cachePath(directory), 2 }.Resolve(sources, parser.Count(readDefinition));
+        VERIFY_IS_TRUE((payloads == std::vector<std::string>{ "a", "b" }));
+        VERIFY_ARE_EQUAL(size_t(2), parser.calls.load());
+
+        Log::Comment(L"Files that fail to parse aren't cached");
+        DefinitionCache cache{ cachePath(directory), 3 };
+        payloads = cache.Resolve(sources, [](const std::filesystem::path& path) -> std::string {
+            if (path.filename() == L"b.sh")
+            {
+                throw std::runtime_error{ "parse error" };
+            }
+            return "a";
+        });
+        VERIFY_IS_TRUE((payloads == std::vector<std::string>{ "a", "" }));
+        parser.calls = 0;
+        payloads = cache.Resolve(sources, parser.Count(readDefinition));
+        VERIFY_IS_TRUE((payloads == std::vector<std::string>{ "a", "b" }));
+        VERIFY_ARE_EQUAL(size_t(1), parser.calls.load());
+    }
+
+    TEST_METHOD(ArgcScriptTags)
+    {
+        ScratchDirectory directory{ L"DefinitionCacheTests" };
+        directory.Write(L"tool.sh", argcScript(1));
+        directory.Write(L"plain.sh", "#!/bin/sh\n# Not an Argc script.\necho hi\n");
+
+        for (const auto warm : { false, true })
+        {
+            const auto parser = CreateArgcParser();
+            VERIFY_IS_TRUE(parser->LoadCommandDefinitions(directory.Path().wstring(), cachePath(directory)));
+            VERIFY_IS_TRUE(parser->IsValidCommand(L"tool"), warm ? L"warm" : L"cold");
+            VERIFY_IS_FALSE(parser->IsValidCommand(L"plain"));
+
+            const auto help = parser->GenerateHelp(L"tool");
+            VERIFY_IS_TRUE(help.find(L"Generated tool 1.") != std::wstring::npos);
+            VERIFY_IS_TRUE(help.find(L"<target>") != std::wstring::npos);
+
+            std::vector<std::wstring> completions;
+            for (const auto& suggestion : parser->GetCompletions(L"tool "))
+            {
+                completions.emplace_back(suggestion.completion);
+            }
+            // The --id option belongs to the `show` subcommand.
+            VERIFY_IS_TRUE((completions == std::vector<std::wstring>{ L"list", L"show", L"--verbose", L"-v", L"--format", L"--path", L"-f" }));
+        }
+    }
+
+    TEST_METHOD(StartupPerformance)
+    {
+        static constexpr auto scriptCount = 500;
+
+        ScratchDirectory directory{ L"DefinitionCacheTests" };
+        for (auto i = 0; i < scriptCount; i++)
+        {
+            directory.Write(L"tool" + std::to_wstring(i) + L".sh", argcScript(i));
+        }
+        const auto scripts = directory.Path().wstring();
+
+        const auto load = [&](const std::filesystem::path& cachePath) {
+            const auto parser = CreateArgcParser();
+            const auto start = clock::now();
+            VERIFY_IS_TRUE(parser->LoadCommandDefinitions(scripts, cachePath));
+            const auto elapsed = millisecondsSince(start);
+            VERIFY_IS_TRUE(parser->IsValidCommand(L"tool" + std::to_wstring(scriptCount - 1)));
+            return elapsed;
+        };
+
+        // The first run warms up the file system cache, so the numbers below only compare parsing.
+        std::ignore = load({});
+        const auto uncached = load({});
+        const auto cold = load(cachePath(directory));
+        const auto warm = load(cachePath(directory));
+
+        Log::Comment(NoThrowString().Format(L"%d scripts: %.1fms without a cache, %.1fms cold, %.1fms warm", scriptCount, uncached, cold, warm));
+        Log::Comment(NoThrowString().Format(L"Cache size: %zu bytes", gsl::narrow_cast<size_t>(std::filesystem::file_size(cachePath(directory)))));
+        VERIFY_IS_LESS_THAN(warm, cold);
+    }
+};
\ No newline at end of file
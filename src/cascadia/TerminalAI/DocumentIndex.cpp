@@ -0,0 +1,793 @@
+#include "pch.h"
+#include "DocumentIndex.h"
+#include "DefinitionCache.h"
+#include "ThreadPoolBatch.h"
+
+using namespace Microsoft::Terminal::AI;
+
+namespace
+{
+    constexpr uint32_t MetadataVersion = 2;
+    constexpr std::wstring_view MetadataFileName{ L"documents.bin" };
+    constexpr std::wstring_view VectorFileName{ L"vectors.bin" };
+    // The metadata log is rewritten once it's more than twice the size of its live records and larger than this.
+    constexpr size_t MetadataCompactionMinimumBytes = 64 * 1024;
+
+    constexpr uint32_t DocumentFileFlag = 1;
+    constexpr uint32_t DocumentRemovedFlag = 2;
+
+    constexpr uint64_t FnvOffsetBasis = 0xcbf29ce484222325;
+    constexpr uint64_t FnvPrime = 0x100000001b3;
+
+    // Anything outside of ASCII counts as part of a word, which keeps non-Latin scripts searchable.
+    constexpr bool isWordCharacter(wchar_t ch) noexcept
+    {
+        return ch >= 0x80 || (ch >= L'0' && ch <= L'9') || (ch >= L'a' && ch <= L'z') || (ch >= L'A' && ch <= L'Z') || ch == L'_';
+    }
+
+    constexpr bool isWhitespace(wchar_t ch) noexcept
+    {
+        return ch == L' ' || ch == L'\t' || ch == L'\r' || ch == L'\n';
+    }
+
+    constexpr wchar_t toLower(wchar_t ch) noexcept
+    {
+        return ch >= L'A' && ch <= L'Z' ? ch + (L'a' - L'A') : ch;
+    }
+
+    // FNV-1a has poor low bits for short inputs, which is all that's used after the modulo.
+    constexpr uint64_t finalize(uint64_t hash) noexcept
+    {
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccd;
+        hash ^= hash >> 33;
+        return hash;
+    }
+
+    // Finds the end of a chunk that starts at `begin` and must end by `limit`, preferring
+    // a paragraph break, then a line break, then a space in the second half of the chunk.
+    size_t chunkEnd(std::wstring_view text, size_t begin, size_t limit) noexcept
+    {
+        if (limit >= text.size())
+        {
+            return text.size();
+        }
+
+        const auto window = text.substr(begin, limit - begin);
+        const auto minimum = window.size() / 2;
+        for (const auto separator : { std::wstring_view{ L"\n\n" }, std::wstring_view{ L"\n" }, std::wstring_view{ L" " } })
+        {
+            const auto pos = window.rfind(separator);
+            if (pos != std::wstring_view::npos && pos >= minimum)
+            {
+                return begin + pos + separator.size();
+            }
+        }
+        return limit;
+    }
+
+    int64_t lastWriteTime(const std::filesystem::directory_entry& entry, std::error_code& ec)
+    {
+        return entry.last_write_time(ec).time_since_epoch().count();
+    }
+
+    // Each record of the metadata log is prefixed with its size, so that one that was cut short is recognized.
+    void appendRecord(std::string& buffer, std::string_view record)
+    {
+        const auto size = gsl::narrow<uint32_t>(record.size());
+        buffer.append(reinterpret_cast<const char*>(&size), sizeof(size));
+        buffer.append(record);
+    }
+
+    // Splits the next record off `rest`. Fails if there's none or if it's incomplete.
+    bool nextRecord(std::string_view& rest, std::string_view& record) noexcept
+    {
+        uint32_t size = 0;
+        if (rest.size() < sizeof(size))
+        {
+            return false;
+        }
+        memcpy(&size, rest.data(), sizeof(size));
+        if (rest.size() - sizeof(size) < size)
+        {
+            return false;
+        }
+        record = rest.substr(sizeof(size), size);
+        rest.remove_prefix(sizeof(size) + size);
+        return true;
+    }
+}
+
+HashingEmbedder::HashingEmbedder(uint32_t dimensions) :
+    _dimensions{ dimensions },
+    _id{ L"hashing-v1-" + std::to_wstring(dimensions) }
+{
+    THROW_HR_IF(E_INVALIDARG, dimensions == 0);
+}
+
+std::wstring_view HashingEmbedder::Id() const noexcept
+{
+    return _id;
+}
+
+uint32_t HashingEmbedder::Dimensions() const noexcept
+{
+    return _dimensions;
+}
+
+void HashingEmbedder::Embed(std::wstring_view text, std::span<float> vector) const
+{
+    THROW_HR_IF(E_INVALIDARG, vector.size() != _dimensions);
+
+    std::fill(vector.begin(), vector.end(), 0.0f);
+
+    const auto add = [&](uint64_t hash, float weight) {
+        hash = finalize(hash);
+        // The top bit picks the sign, so that collisions cancel out on average instead of piling up.
+        auto& value = vector[gsl::narrow_cast<size_t>(hash % _dimensions)];
+        value += (hash >> 63) ? -weight : weight;
+    };
+
+    uint64_t previous = 0;
+    for (size_t i = 0; i < text.size();)
+    {
+        if (!isWordCharacter(til::at(text, i)))
+        {
+            ++i;
+            continue;
+        }
+
+        auto hash = FnvOffsetBasis;
+        for (; i < text.size() && isWordCharacter(til::at(text, i)); ++i)
+        {
+            hash = (hash ^ toLower(til::at(text, i))) * FnvPrime;
+        }
+
+        add(hash, 1.0f);
+        if (previous)
+        {
+            // Pairs of words weigh less, because they're much rarer, but they
+            // tell "exit code" apart from a text that merely contains both words.
+            add((previous * FnvPrime) ^ hash, 0.5f);
+        }
+        previous = hash;
+    }
+
+    Normalize(vector);
+}
+
+std::vector<TextChunk> Microsoft::Terminal::AI::ChunkText(std::wstring_view text, size_t maxLength, size_t overlap)
+{
+    THROW_HR_IF(E_INVALIDARG, maxLength == 0);
+
+    std::vector<TextChunk> chunks;
+    size_t begin = 0;
+
+    for (;;)
+    {
+        while (begin < text.size() && isWhitespace(til::at(text, begin)))
+        {
+            ++begin;
+        }
+        if (begin >= text.size())
+        {
+            break;
+        }
+
+        const auto end = chunkEnd(text, begin, begin + std::min(maxLength, text.size() - begin));
+        chunks.push_back({ begin, end - begin });
+        if (end >= text.size())
+        {
+            break;
+        }
+
+        // Step back by the overlap, but never more than half a chunk, so that we always make progress.
+        auto next = end - std::min(overlap, (end - begin) / 2);
+        if (next < end)
+        {
+            // Don't start in the middle of a word.
+            while (next < end && !isWhitespace(til::at(text, next - 1)))
+            {
+                ++next;
+            }
+        }
+        begin = next;
+    }
+
+    return chunks;
+}
+
+DocumentIndex::DocumentIndex(std::filesystem::path directory, std::shared_ptr<const IEmbedder> embedder, DocumentIndexOptions options) :
+    _directory{ std::move(directory) },
+    _embedder{ std::move(embedder) },
+    _options{ options },
+    _store{ _prepareDirectory(_directory), _embedder->Dimensions() }
+{
+    THROW_HR_IF(E_INVALIDARG, _options.chunkLength == 0);
+
+    _load();
+    if (_options.useHnsw)
+    {
+        _rebuildGraph();
+    }
+}
+
+size_t DocumentIndex::Sync(std::span<const std::filesystem::path> documents)
+{
+    // Stat the files and pick the ones that changed...
+    std::vector<PendingDocument> pending;
+    std::vector<std::wstring> listed;
+    listed.reserve(documents.size());
+    uint64_t sync = 0;
+    {
+        const std::lock_guard lock{ _lock };
+        sync = ++_syncs;
+
+        for (const auto& path : documents)
+        {
+            std::error_code ec;
+            const std::filesystem::directory_entry entry{ path, ec };
+            if (ec || !entry.is_regular_file(ec))
+            {
+                continue;
+            }
+
+            Document document;
+            document.file = true;
+            document.size = entry.file_size(ec);
+            document.lastWriteTime = lastWriteTime(entry, ec);
+
+            auto name = path.wstring();
+            const auto it = _documents.find(name);
+            if (it == _documents.end() || it->second.size != document.size || it->second.lastWriteTime != document.lastWriteTime)
+            {
+                pending.push_back({ name, std::move(document), {} });
+            }
+            listed.emplace_back(std::move(name));
+        }
+    }
+
+    // ...embed them in parallel without holding the lock, so that searches can continue in the meantime...
+    RunOnThreadPool(pending.size(), [&](size_t i) {
+        auto& document = pending[i];
+        try
+        {
+            const auto content = til::io::read_file_as_utf8_string_if_exists(document.name);
+            _embed(document, til::u8u16(content));
+        }
+        catch (...)
+        {
+            LOG_CAUGHT_EXCEPTION();
+            // Unreadable files are left as they are and retried next time.
+            document.name.clear();
+        }
+    });
+
+    // ...and swap them in.
+    std::unique_lock lock{ _lock };
+
+    if (sync != _syncs)
+    {
+        return 0;
+    }
+
+    std::vector<std::wstring> changed;
+    std::sort(listed.begin(), listed.end());
+    for (auto it = _documents.begin(); it != _documents.end();)
+    {
+        const auto current = it++;
+        if (current->second.file && !std::binary_search(listed.begin(), listed.end(), current->first))
+        {
+            changed.emplace_back(current->first);
+            _remove(current);
+        }
+    }
+
+    size_t indexed = 0;
+    for (auto& document : pending)
+    {
+        if (!document.name.empty())
+        {
+            changed.emplace_back(document.name);
+            _add(std::move(document));
+            ++indexed;
+        }
+    }
+
+    const auto compacted = _compactIfNeeded();
+    if (_hnsw)
+    {
+        _hnsw->Update();
+    }
+    _save(changed);
+    lock.unlock();
+
+    if (compacted && _options.useHnsw)
+    {
+        _rebuildGraph();
+    }
+    return indexed;
+}
+
+void DocumentIndex::Update(std::wstring_view name, std::wstring_view text)
+{
+    PendingDocument pending{ std::wstring{ name }, {}, {} };
+    _embed(pending, text);
+
+    std::unique_lock lock{ _lock };
+    _add(std::move(pending));
+    const auto compacted = _compactIfNeeded();
+    if (_hnsw)
+    {
+        _hnsw->Update();
+    }
+    const std::array changed{ std::wstring{ name } };
+    _save(changed);
+    lock.unlock();
+
+    if (compacted && _options.useHnsw)
+    {
+        _rebuildGraph();
+    }
+}
+
+void DocumentIndex::Remove(std::wstring_view name)
+{
+    std::unique_lock lock{ _lock };
+
+    const auto it = _documents.find(name);
+    if (it == _documents.end())
+    {
+        return;
+    }
+
+    _remove(it);
+    const auto compacted = _compactIfNeeded();
+    if (_hnsw)
+    {
+        _hnsw->Update();
+    }
+    const std::array changed{ std::wstring{ name } };
+    _save(changed);
+    lock.unlock();
+
+    if (compacted && _options.useHnsw)
+    {
+        _rebuildGraph();
+    }
+}
+
+std::vector<DocumentMatch> DocumentIndex::Search(std::wstring_view query, size_t k) const
+{
+    std::vector<float> vector(_embedder->Dimensions());
+    _embedder->Embed(query, vector);
+
+    const std::lock_guard lock{ _lock };
+
+    const auto matches = _hnsw ? _hnsw->Search(vector, k, _alive) : _store.Search(vector, k, _alive);
+
+    std::vector<DocumentMatch> results;
+    results.reserve(matches.size());
+    for (const auto& match : matches)
+    {
+        const auto& owner = til::at(_rows, match.row);
+        if (owner.document)
+        {
+            results.push_back({ owner.document->first, til::at(owner.document->second.chunks, owner.chunk).text, match.score });
+        }
+    }
+    return results;
+}
+
+size_t DocumentIndex::DocumentCount() const
+{
+    const std::lock_guard lock{ _lock };
+    return _documents.size();
+}
+
+size_t DocumentIndex::ChunkCount() const
+{
+    const std::lock_guard lock{ _lock };
+    return _liveRows;
+}
+
+std::filesystem::path DocumentIndex::_prepareDirectory(const std::filesystem::path& directory)
+{
+    if (directory.empty())
+    {
+        return {};
+    }
+    std::filesystem::create_directories(directory);
+    return directory / VectorFileName;
+}
+
+void DocumentIndex::_embed(PendingDocument& pending, std::wstring_view text) const
+{
+    const auto dimensions = _embedder->Dimensions();
+    const auto chunks = ChunkText(text, _options.chunkLength, _options.chunkOverlap);
+
+    pending.vectors.resize(chunks.size() * dimensions);
+    pending.document.chunks.reserve(chunks.size());
+
+    for (size_t i = 0; i < chunks.size(); ++i)
+    {
+        const auto chunk = text.substr(chunks[i].offset, chunks[i].length);
+        _embedder->Embed(chunk, { pending.vectors.data() + i * dimensions, dimensions });
+        pending.document.chunks.push_back({ 0, std::wstring{ chunk } });
+    }
+}
+
+void DocumentIndex::_add(PendingDocument&& pending)
+{
+    if (const auto it = _documents.find(pending.name); it != _documents.end())
+    {
+        _remove(it);
+    }
+
+    const auto dimensions = _embedder->Dimensions();
+    auto& chunks = pending.document.chunks;
+    for (size_t i = 0; i < chunks.size(); ++i)
+    {
+        chunks[i].row = _store.Append({ pending.vectors.data() + i * dimensions, dimensions });
+    }
+
+    const auto& entry = *_documents.emplace(std::move(pending.name), std::move(pending.document)).first;
+    _rows.resize(_store.Size());
+    _alive.resize(_store.Size());
+    for (uint32_t i = 0; i < entry.second.chunks.size(); ++i)
+    {
+        const auto row = entry.second.chunks[i].row;
+        _rows[row] = { &entry, i };
+        _alive[row] = 1;
+    }
+    _liveRows += entry.second.chunks.size();
+}
+
+void DocumentIndex::_remove(DocumentMap::iterator it)
+{
+    // The rows stay in the store until the next compaction.
+    for (const auto& chunk : it->second.chunks)
+    {
+        _rows[chunk.row] = {};
+        _alive[chunk.row] = 0;
+    }
+    _liveRows -= it->second.chunks.size();
+    _liveMetadataBytes -= it->second.recordBytes;
+    _documents.erase(it);
+}
+
+bool DocumentIndex::_compactIfNeeded()
+{
+    // Replaced rows are only reclaimed once they outnumber the live ones,
+    // which keeps the cost of moving the live rows amortized.
+    const auto size = _store.Size();
+    if (size - _liveRows <= _liveRows)
+    {
+        return false;
+    }
+
+    std::vector<uint32_t> keep;
+    std::vector<uint32_t> moved(size);
+    keep.reserve(_liveRows);
+    for (uint32_t row = 0; row < size; ++row)
+    {
+        if (_alive[row])
+        {
+            moved[row] = gsl::narrow_cast<uint32_t>(keep.size());
+            keep.push_back(row);
+        }
+    }
+
+    for (auto& [name, document] : _documents)
+    {
+        for (auto& chunk : document.chunks)
+        {
+            chunk.row = moved[chunk.row];
+        }
+    }
+
+    _store.Compact(keep);
+    _indexRows();
+    // The graph refers to rows by index, so it has to be rebuilt. Until _rebuildGraph()
+    // has done so, searches fall back to comparing the query with every row.
+    _hnsw.reset();
+    return true;
+}
+
+void DocumentIndex::_rebuildGraph()
+{
+    // Building a graph takes a search per row, so it's done on a copy of the rows without
+    // holding the lock. Rows appended in the meantime are added when it's swapped in.
+    uint32_t generation = 0;
+    VectorStore snapshot{ {}, _store.Dimensions() };
+    {
+        const std::lock_guard lock{ _lock };
+        if (_hnsw)
+        {
+            return;
+        }
+        generation = _store.Generation();
+        for (size_t row = 0, size = _store.Size(); row < size; ++row)
+        {
+            snapshot.Append({ _store.Row(row), _store.Dimensions() });
+        }
+    }
+
+    HnswIndex graph{ snapshot, _options.hnsw };
+    graph.Update();
+
+    const std::lock_guard lock{ _lock };
+    // If the store was compacted in the meantime, the rows have moved and whoever
+    // compacted it builds a new graph. Another rebuild may also have won the race.
+    if (_hnsw || _store.Generation() != generation)
+    {
+        return;
+    }
+    graph.Rebind(_store);
+    graph.Update();
+    _hnsw.emplace(std::move(graph));
+}
+
+void DocumentIndex::_indexRows()
+{
+    _rows.assign(_store.Size(), {});
+    _alive.assign(_store.Size(), 0);
+    _liveRows = 0;
+
+    for (const auto& entry : _documents)
+    {
+        for (uint32_t i = 0; i < entry.second.chunks.size(); ++i)
+        {
+            const auto row = entry.second.chunks[i].row;
+            _rows[row] = { &entry, i };
+            _alive[row] = 1;
+        }
+        _liveRows += entry.second.chunks.size();
+    }
+}
+
+// The metadata log starts with a record of the version, the embedder ID, the dimensions and the store
+// generation. Each following record is a document's name, flags, size, last write time and chunks, or
+// the name of a document that was removed. Later records for a name replace earlier ones. The log is
+// only valid for a store of the same generation, since chunks refer to rows by index, which is why it's
+// rewritten whenever the store is compacted. A record cut short by a crash is dropped, and with it the
+// change it recorded.
+void DocumentIndex::_load()
+{
+    // Whether the log has to be written from scratch.
+    auto rewrite = true;
+    if (!_directory.empty())
+    {
+        const auto loaded = [&]() {
+            try
+            {
+                const auto content = til::io::read_file_as_utf8_string_if_exists(_directory / MetadataFileName);
+                std::string_view rest{ content };
+                std::string_view record;
+                if (!nextRecord(rest, record))
+                {
+                    return false;
+                }
+
+                DefinitionReader header{ record };
+                uint32_t version = 0;
+                std::wstring id;
+                uint32_t dimensions = 0;
+                if (!header.Read(version) || version != MetadataVersion || !header.Read(id) || id != _embedder->Id() ||
+                    !header.Read(dimensions) || dimensions != _store.Dimensions() || !header.Read(_metadataGeneration) || _metadataGeneration != _store.Generation())
+                {
+                    return false;
+                }
+                _liveMetadataBytes = sizeof(uint32_t) + record.size();
+
+                const auto size = _store.Size();
+                while (nextRecord(rest, record))
+                {
+                    DefinitionReader reader{ record };
+                    std::wstring name;
+                    uint32_t flags = 0;
+                    if (!reader.Read(name) || !reader.Read(flags))
+                    {
+                        return false;
+                    }
+
+                    const auto it = _documents.find(name);
+                    if (it != _documents.end())
+                    {
+                        _liveMetadataBytes -= it->second.recordBytes;
+                        _documents.erase(it);
+                    }
+                    if (flags & DocumentRemovedFlag)
+                    {
+                        continue;
+                    }
+
+                    uint64_t fileSize = 0;
+                    uint64_t lastWriteTime = 0;
+                    uint32_t chunkCount = 0;
+                    if (!reader.Read(fileSize) || !reader.Read(lastWriteTime) || !reader.Read(chunkCount))
+                    {
+                        return false;
+                    }
+
+                    Document document{ (flags & DocumentFileFlag) != 0, fileSize, static_cast<int64_t>(lastWriteTime), {}, sizeof(uint32_t) + record.size() };
+                    for (uint32_t j = 0; j < chunkCount; ++j)
+                    {
+                        Chunk chunk;
+                        if (!reader.Read(chunk.row) || chunk.row >= size || !reader.Read(chunk.text))
+                        {
+                            return false;
+                        }
+                        document.chunks.emplace_back(std::move(chunk));
+                    }
+                    _liveMetadataBytes += document.recordBytes;
+                    _documents.emplace(std::move(name), std::move(document));
+                }
+
+                _metadataBytes = content.size();
+                // Anything that's left is a record that was cut short.
+                rewrite = !rest.empty();
+                return true;
+            }
+            catch (...)
+            {
+                LOG_CAUGHT_EXCEPTION();
+                return false;
+            }
+        }();
+
+        if (!loaded)
+        {
+            // Whatever is in the store can't be attributed to any document anymore.
+            _documents.clear();
+            _store.Clear();
+        }
+    }
+
+    _indexRows();
+    // Rows that no chunk refers to are from documents that were replaced before the index was last closed.
+    _compactIfNeeded();
+
+    if (!_directory.empty())
+    {
+        // A new or unreadable log is replaced, and so is one for rows that have moved or that's mostly garbage.
+        // The latter also drops the record that a crash may have left half written.
+        if (rewrite || _metadataGeneration != _store.Generation() || _metadataBytes > std::max(MetadataCompactionMinimumBytes, _liveMetadataBytes * 2))
+        {
+            _rewriteMetadata();
+        }
+        else
+        {
+            _openMetadata();
+        }
+    }
+}
+
+// Appends the record of a document to `buffer`, or of its removal if `document` is null, and returns its size.
+size_t DocumentIndex::_appendDocument(std::string& buffer, std::wstring_view name, const Document* document)
+{
+    DefinitionWriter writer;
+    writer.Write(name);
+    if (!document)
+    {
+        writer.Write(DocumentRemovedFlag);
+    }
+    else
+    {
+        writer.Write(document->file ? DocumentFileFlag : 0u);
+        writer.Write(document->size);
+        writer.Write(static_cast<uint64_t>(document->lastWriteTime));
+        writer.Write(gsl::narrow<uint32_t>(document->chunks.size()));
+        for (const auto& chunk : document->chunks)
+        {
+            writer.Write(chunk.row);
+            writer.Write(chunk.text);
+        }
+    }
+
+    const auto record = writer.Take();
+    appendRecord(buffer, record);
+    return sizeof(uint32_t) + record.size();
+}
+
+// Appends a record for each of the `changed` documents to the metadata log,
+// so that the cost of a change doesn't depend on the size of the corpus.
+void DocumentIndex::_save(std::span<const std::wstring> changed)
+{
+    if (_directory.empty())
+    {
+        return;
+    }
+
+    // Compacting the store moved the rows that all records refer to.
+    if (!_metadata || _metadataGeneration != _store.Generation())
+    {
+        _rewriteMetadata();
+        return;
+    }
+
+    try
+    {
+        std::string buffer;
+        for (const auto& name : changed)
+        {
+            const auto it = _documents.find(name);
+            if (it == _documents.end())
+            {
+                _appendDocument(buffer, name, nullptr);
+                continue;
+            }
+            _liveMetadataBytes -= it->second.recordBytes;
+            it->second.recordBytes = _appendDocument(buffer, it->first, &it->second);
+            _liveMetadataBytes += it->second.recordBytes;
+        }
+
+        DWORD written = 0;
+        if (!WriteFile(_metadata.get(), buffer.data(), gsl::narrow<DWORD>(buffer.size()), &written, nullptr) || written != buffer.size())
+        {
+            LOG_LAST_ERROR();
+            // The next change rewrites the log. A partially written record is dropped until then.
+            _metadata.reset();
+            return;
+        }
+        _metadataBytes += buffer.size();
+    }
+    CATCH_LOG();
+
+    if (_metadataBytes > std::max(MetadataCompactionMinimumBytes, _liveMetadataBytes * 2))
+    {
+        _rewriteMetadata();
+    }
+}
+
+void DocumentIndex::_rewriteMetadata()
+{
+    _metadata.reset();
+
+    try
+    {
+        DefinitionWriter header;
+        header.Write(MetadataVersion);
+        header.Write(_embedder->Id());
+        header.Write(_store.Dimensions());
+        header.Write(_store.Generation());
+
+        std::string buffer;
+        appendRecord(buffer, header.Take());
+        _liveMetadataBytes = buffer.size();
+        for (auto& [name, document] : _documents)
+        {
+            document.recordBytes = _appendDocument(buffer, name, &document);
+            _liveMetadataBytes += document.recordBytes;
+        }
+
+        til::io::write_utf8_string_to_file_atomic(_directory / MetadataFileName, buffer);
+        _metadataGeneration = _store.Generation();
+    }
+    catch (...)
+    {
+        LOG_CAUGHT_EXCEPTION();
+        return;
+    }
+
+    _openMetadata();
+}
+
+void DocumentIndex::_openMetadata()
+{
+    _metadata.reset(CreateFileW((_directory / MetadataFileName).c_str(), FILE_APPEND_DATA, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+    if (!_metadata)
+    {
+        LOG_LAST_ERROR();
+        return;
+    }
+
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(_metadata.get(), &size))
+    {
+        LOG_LAST_ERROR();
+        _metadata.reset();
+        return;
+    }
+    _metadataBytes = gsl::narrow_cast<size_t>(size.QuadPart);
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include "pch.h"
+#include "VectorIndex.h"
+
+namespace Microsoft::Terminal::AI
+{
+    // Turns text into a unit-length vector, so that similar texts have a large dot product.
+    // Documents are embedded in parallel, so implementations must be thread-safe.
+    class IEmbedder
+    {
+    public:
+        virtual ~IEmbedder() = default;
+
+        // Identifies the model. An index built with a different embedder is rebuilt from scratch.
+        virtual std::wstring_view Id() const noexcept = 0;
+        virtual uint32_t Dimensions() const noexcept = 0;
+        // Writes the embedding of `text` into `vector`, which has Dimensions() elements.
+        virtual void Embed(std::wstring_view text, std::span<float> vector) const = 0;
+    };
+
+    // Embeds text without a model, by hashing its words and pairs of adjacent words into the
+    // dimensions of the vector ("feature hashing"), so that texts sharing words are similar.
+    // Case-insensitive for ASCII. Being deterministic, it's also the stand-in for a real model in tests.
+    class HashingEmbedder final : public IEmbedder
+    {
+    public:
+        explicit HashingEmbedder(uint32_t dimensions = 256);
+
+        std::wstring_view Id() const noexcept override;
+        uint32_t Dimensions() const noexcept override;
+        void Embed(std::wstring_view text, std::span<float> vector) const override;
+
+    private:
+        uint32_t _dimensions;
+        std::wstring _id;
+    };
+
+    struct TextChunk
+    {
+        size_t offset = 0;
+        size_t length = 0;
+    };
+
+    // Splits `text` into chunks of at most `maxLength` characters, which end at a paragraph,
+    // line or word boundary where possible. Consecutive chunks overlap by up to `overlap`
+    // characters, so that a passage that straddles a boundary is still found whole.
+    std::vector<TextChunk> ChunkText(std::wstring_view text, size_t maxLength, size_t overlap);
+
+    struct DocumentIndexOptions
+    {
+        size_t chunkLength = 1500;
+        size_t chunkOverlap = 200;
+        // Search an HNSW graph instead of comparing the query with every chunk.
+        // Approximate, but much faster for large corpora. The graph is kept in
+        // memory, so it's built from the stored embeddings when the index is opened.
+        bool useHnsw = false;
+        HnswOptions hnsw;
+    };
+
+    struct DocumentMatch
+    {
+        std::wstring document;
+        std::wstring text;
+        float score = 0;
+    };
+
+    // Finds the passages of local documents, like runbooks or man pages, that are most similar
+    // to a query, so that an agent can ground its answers in them without sending everything
+    // to the model. The embeddings are kept in a memory-mapped VectorStore and the chunk texts
+    // in a metadata log next to it, to which each change only appends the documents it touched.
+    // All methods are thread-safe. Only a single instance may use a directory at a time.
+    class DocumentIndex
+    {
+    public:
+        // An empty `directory` keeps the index in memory only.
+        DocumentIndex(std::filesystem::path directory, std::shared_ptr<const IEmbedder> embedder, DocumentIndexOptions options = {});
+
+        // Brings the index up to date with `documents`: files that are new or have changed since they
+        // were indexed (by size and last write time) are chunked and embedded in parallel, and documents
+        // that aren't listed anymore are removed. Returns the number of files that were (re)indexed.
+        // A call that's overtaken by a later one drops its results, so that the latest list wins.
+        size_t Sync(std::span<const std::filesystem::path> documents);
+        // Adds or replaces a document that doesn't come from a file.
+        void Update(std::wstring_view name, std::wstring_view text);
+        void Remove(std::wstring_view name);
+
+        // The `k` chunks most similar to `query`, best first.
+        std::vector<DocumentMatch> Search(std::wstring_view query, size_t k) const;
+
+        size_t DocumentCount() const;
+        size_t ChunkCount() const;
+
+    private:
+        struct Chunk
+        {
+            uint32_t row = 0;
+            std::wstring text;
+        };
+        struct Document
+        {
+            // Whether it was added by Sync(), which then also removes it.
+            bool file = false;
+            uint64_t size = 0;
+            int64_t lastWriteTime = 0;
+            std::vector<Chunk> chunks;
+            // The size of its latest record in the metadata log.
+            size_t recordBytes = 0;
+        };
+        // A document that has been chunked and embedded, but not added yet.
+        struct PendingDocument
+        {
+            std::wstring name;
+            Document document;
+            std::vector<float> vectors;
+        };
+        using DocumentMap = std::map<std::wstring, Document, std::less<>>;
+        // The chunk a row of the store belongs to. `document` is null for rows that were replaced.
+        struct RowOwner
+        {
+            const DocumentMap::value_type* document = nullptr;
+            uint32_t chunk = 0;
+        };
+
+        std::filesystem::path _directory;
+        std::shared_ptr<const IEmbedder> _embedder;
+        DocumentIndexOptions _options;
+
+        mutable std::mutex _lock;
+        VectorStore _store;
+        std::optional<HnswIndex> _hnsw;
+        // A std::map, because _rows points into it.
+        DocumentMap _documents;
+        std::vector<RowOwner> _rows;
+        // 1 for each row of _store that belongs to a chunk, for VectorStore::Search().
+        std::vector<uint8_t> _alive;
+        size_t _liveRows = 0;
+        // The number of Sync() calls so far.
+        uint64_t _syncs = 0;
+
+        wil::unique_hfile _metadata;
+        // The store generation the metadata log was written for.
+        uint32_t _metadataGeneration = 0;
+        size_t _metadataBytes = 0;
+        // What the metadata log would take if it was rewritten.
+        size_t _liveMetadataBytes = 0;
+
+        static std::filesystem::path _prepareDirectory(const std::filesystem::path& directory);
+        void _embed(PendingDocument& pending, std::wstring_view text) const;
+        void _add(PendingDocument&& pending);
+        void _remove(DocumentMap::iterator it);
+        // Returns whether the store was compacted, which drops the HNSW graph.
+        bool _compactIfNeeded();
+        void _rebuildGraph();
+        void _indexRows();
+        void _load();
+        static size_t _appendDocument(std::string& buffer, std::wstring_view name, const Document* document);
+        void _save(std::span<const std::wstring> changed);
+        void _rewriteMetadata();
+        void _openMetadata();
+    };
+}
\ No newline at end of file
@@ -0,0 +1,394 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include "DocumentIndex.h"
+#include "TestUtilities.h"
+
+#include <chrono>
+#include <fstream>
+#include <random>
+
+using namespace Microsoft::Terminal::AI;
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace TerminalAIUnitTests;
+
+namespace
+{
+    std::filesystem::path indexPath(const ScratchDirectory& directory)
+    {
+        return directory.Path() / L"index";
+    }
+
+    std::vector<float> randomVectors(size_t count, uint32_t dimensions, uint32_t seed)
+    {
+        std::mt19937 engine{ seed };
+        std::normal_distribution<float> distribution;
+        std::vector<float> vectors(count * dimensions);
+        for (auto& value : vectors)
+        {
+            value = distribution(engine);
+        }
+        for (size_t i = 0; i < count; ++i)
+        {
+            Normalize({ vectors.data() + i * dimensions, dimensions });
+        }
+        return vectors;
+    }
+
+    void fill(VectorStore& store, const std::vector<float>& vectors)
+    {
+        const auto dimensions = store.Dimensions();
+        for (size_t i = 0; i < vectors.size(); i += dimensions)
+        {
+            store.Append({ vectors.data() + i, dimensions });
+        }
+    }
+
+    float similarity(const IEmbedder& embedder, std::wstring_view a, std::wstring_view b)
+    {
+        std::vector<float> x(embedder.Dimensions());
+        std::vector<float> y(embedder.Dimensions());
+        embedder.Embed(a, x);
+        embedder.Embed(b, y);
+        return DotProduct(x.data(), y.data(), x.size());
+    }
+
+    constexpr std::string_view gitRunbook{
+        "Recovering a detached HEAD\n"
+        "\n"
+        "Run git switch with the name of the branch to reattach HEAD. Commits made while detached "
+        "can be found again with git reflog.\n"
+    };
+    constexpr std::string_view diskRunbook{
+        "Freeing disk space\n"
+        "\n"
+        "Find large files with du and sort, then clear the package cache and old container images.\n"
+    };
+    constexpr std::string_view networkRunbook{
+        "Diagnosing DNS failures\n"
+        "\n"
+        "Check the resolver configuration, flush the DNS cache and query the name server with nslookup.\n"
+    };
+}
+
+class DocumentIndexTests
+{
+    TEST_CLASS(DocumentIndexTests);
+
+    TEST_METHOD(DotProductMatchesScalar)
+    {
+        const auto values = randomVectors(1, 200, 1);
+        // Every length and misalignment exercises the vectorized loops and their tails.
+        for (size_t offset = 0; offset < 4; ++offset)
+        {
+            for (size_t count = 0; count < 100; ++count)
+            {
+                const auto a = values.data() + offset;
+                const auto b = values.data() + 100;
+                double expected = 0;
+                for (size_t i = 0; i < count; ++i)
+                {
+                    expected += double{ a[i] } * b[i];
+                }
+                VERIFY_IS_LESS_THAN(std::abs(DotProduct(a, b, count) - expected), 1e-4);
+            }
+        }
+    }
+
+    TEST_METHOD(TextIsChunkedAtBoundaries)
+    {
+        const std::wstring_view text{ L"First paragraph with some words.\n\nSecond paragraph, which is a little longer than the first one.\n\nThird." };
+
+        const auto chunks = ChunkText(text, 50, 10);
+        VERIFY_ARE_EQUAL(size_t(3), chunks.size());
+        VERIFY_ARE_EQUAL(std::wstring_view{ L"First paragraph with some words.\n\n" }, text.substr(chunks[0].offset, chunks[0].length));
+        for (size_t i = 0; i < chunks.size(); ++i)
+        {
+            VERIFY_IS_LESS_THAN_OR_EQUAL(chunks[i].length, size_t(50));
+            if (i)
+            {
+                // Chunks overlap, but each one starts further along and at the start of a word.
+                VERIFY_IS_GREATER_THAN(chunks[i].offset, chunks[i - 1].offset);
+                VERIFY_IS_LESS_THAN_OR_EQUAL(chunks[i].offset, chunks[i - 1].offset + chunks[i - 1].length);
+                VERIFY_IS_TRUE(text[chunks[i].offset - 1] == L' ' || text[chunks[i].offset - 1] == L'\n');
+            }
+        }
+        VERIFY_ARE_EQUAL(text.size(), chunks.back().offset + chunks.back().length);
+
+        Log::Comment(L"Text without any spaces is cut at the maximum length");
+        const std::wstring solid(95, L'x');
+        const auto solidChunks = ChunkText(solid, 40, 10);
+        VERIFY_ARE_EQUAL(size_t(3), solidChunks.size());
+        VERIFY_ARE_EQUAL(size_t(40), solidChunks[0].length);
+        VERIFY_ARE_EQUAL(solid.size(), solidChunks.back().offset + solidChunks.back().length);
+
+        VERIFY_ARE_EQUAL(size_t(0), ChunkText(L" \r\n\t", 40, 10).size());
+    }
+
+    TEST_METHOD(SimilarTextsHaveSimilarEmbeddings)
+    {
+        const HashingEmbedder embedder;
+
+        std::vector<float> vector(embedder.Dimensions());
+        embedder.Embed(L"Reattach a detached HEAD", vector);
+        VERIFY_IS_LESS_THAN(std::abs(DotProduct(vector.data(), vector.data(), vector.size()) - 1.0f), 1e-5f);
+
+        VERIFY_IS_GREATER_THAN(similarity(embedder, L"git DETACHED head", L"git detached head"), 0.999f);
+        VERIFY_IS_GREATER_THAN(similarity(embedder, L"how do I fix a detached head in git", L"git detached head"),
+                               similarity(embedder, L"how do I fix a detached head in git", L"flush the dns cache"));
+        VERIFY_ARE_NOT_EQUAL(std::wstring{ HashingEmbedder{ 128 }.Id() }, std::wstring{ embedder.Id() });
+    }
+
+    TEST_METHOD(VectorStorePersistsRows)
+    {
+        ScratchDirectory directory{ L"DocumentIndexTests" };
+        std::filesystem::create_directories(indexPath(directory));
+        const auto path = indexPath(directory) / L"vectors.bin";
+        // More than the initial capacity, so that the file is remapped.
+        const auto vectors = randomVectors(1500, 20, 2);
+
+        {
+            VectorStore store{ path, 20 };
+            fill(store, vectors);
+            VERIFY_ARE_EQUAL(size_t(1500), store.Size());
+        }
+
+        VectorStore store{ path, 20 };
+        VERIFY_ARE_EQUAL(size_t(1500), store.Size());
+        VERIFY_IS_TRUE(std::equal(vectors.begin() + 20 * 1499, vectors.end(), store.Row(1499)));
+
+        const auto matches = store.Search({ vectors.data() + 20 * 42, 20 }, 3);
+        VERIFY_ARE_EQUAL(size_t(3), matches.size());
+        VERIFY_ARE_EQUAL(42u, matches[0].row);
+        VERIFY_IS_GREATER_THAN_OR_EQUAL(matches[0].score, matches[1].score);
+        VERIFY_IS_GREATER_THAN_OR_EQUAL(matches[1].score, matches[2].score);
+
+        Log::Comment(L"Rows that aren't alive are skipped");
+        std::vector<uint8_t> alive(store.Size(), 1);
+        alive[42] = 0;
+        VERIFY_ARE_NOT_EQUAL(42u, store.Search({ vectors.data() + 20 * 42, 20 }, 1, alive)[0].row);
+
+        Log::Comment(L"Compacting moves the remaining rows to the front");
+        const auto generation = store.Generation();
+        const std::array<uint32_t, 2> keep{ 7, 1200 };
+        store.Compact(keep);
+        VERIFY_ARE_EQUAL(size_t(2), store.Size());
+        VERIFY_ARE_NOT_EQUAL(generation, store.Generation());
+        VERIFY_IS_TRUE(std::equal(vectors.begin() + 20 * 1200, vectors.begin() + 20 * 1201, store.Row(1)));
+
+        Log::Comment(L"A store with different dimensions starts over");
+        VERIFY_ARE_EQUAL(size_t(0), VectorStore(path, 24).Size());
+    }
+
+    TEST_METHOD(HnswRecall)
+    {
+        static constexpr uint32_t dimensions = 32;
+        static constexpr size_t count = 5000;
+        static constexpr size_t queries = 100;
+        static constexpr size_t k = 10;
+
+        VectorStore store{ {}, dimensions };
+        fill(store, randomVectors(count, dimensions, 3));
+        HnswIndex index{ store };
+        index.Update();
+        VERIFY_ARE_EQUAL(count, index.Size());
+
+        const auto queryVectors = randomVectors(queries, dimensions, 4);
+        size_t found = 0;
+        for (size_t i = 0; i < queries; ++i)
+        {
+            const std::span<const float> query{ queryVectors.data() + i * dimensions, dimensions };
+            const auto exact = store.Search(query, k);
+            const auto approximate = index.Search(query, k);
+            VERIFY_ARE_EQUAL(k, approximate.size());
+            for (const auto& match : exact)
+            {
+                found += std::any_of(approximate.begin(), approximate.end(), [&](const auto& m) { return m.row == match.row; });
+            }
+        }
+
+        const auto recall = static_cast<double>(found) / (queries * k);
+        Log::Comment(NoThrowString().Format(L"Recall@%zu: %.3f", k, recall));
+        VERIFY_IS_GREATER_THAN(recall, 0.9);
+
+        Log::Comment(L"Rows that aren't alive are skipped");
+        const std::span<const float> query{ queryVectors.data(), dimensions };
+        std::vector<uint8_t> alive(count, 1);
+        const auto best = index.Search(query, 1)[0].row;
+        alive[best] = 0;
+        VERIFY_ARE_NOT_EQUAL(best, index.Search(query, 1, alive)[0].row);
+    }
+
+    TEST_METHOD(OnlyChangedDocumentsAreIndexed)
+    {
+        ScratchDirectory directory{ L"DocumentIndexTests" };
+        const auto git = directory.Write(L"git.md", gitRunbook);
+        const auto disk = directory.Write(L"disk.md", diskRunbook);
+        const auto network = directory.Write(L"network.md", networkRunbook);
+        const auto embedder = std::make_shared<HashingEmbedder>();
+        // Small chunks, so that each document has a few.
+        const DocumentIndexOptions options{ .chunkLength = 60, .chunkOverlap = 10 };
+
+        std::vector<std::filesystem::path> documents{ git, disk, network, indexPath(directory) / L"missing.md" };
+        {
+            DocumentIndex index{ indexPath(directory), embedder, options };
+            VERIFY_ARE_EQUAL(size_t(3), index.Sync(documents));
+            VERIFY_ARE_EQUAL(size_t(3), index.DocumentCount());
+            VERIFY_ARE_EQUAL(size_t(0), index.Sync(documents));
+
+            const auto matches = index.Search(L"how do I get my commits back after a detached head", 2);
+            VERIFY_ARE_EQUAL(size_t(2), matches.size());
+            VERIFY_ARE_EQUAL(git.wstring(), matches[0].document);
+            VERIFY_IS_TRUE(matches[0].text.find(L"detached") != std::wstring::npos || matches[0].text.find(L"reflog") != std::wstring::npos);
+        }
+
+        Log::Comment(L"Reopening the index keeps everything that didn't change");
+        DocumentIndex index{ indexPath(directory), embedder, options };
+        VERIFY_ARE_EQUAL(size_t(3), index.DocumentCount());
+        const auto chunks = index.ChunkCount();
+        VERIFY_ARE_EQUAL(git.wstring(), index.Search(L"detached head", 1)[0].document);
+
+        directory.Write(L"disk.md", "Rotating logs\n\nUse logrotate to compress and delete old log files.\n");
+        VERIFY_ARE_EQUAL(size_t(1), index.Sync(documents));
+        VERIFY_ARE_EQUAL(disk.wstring(), index.Search(L"compress old log files", 1)[0].document);
+
+        Log::Comment(L"Documents that aren't listed anymore are removed, but not those that were added directly");
+        index.Update(L"notes", L"The staging server restarts every night at two.");
+        documents.erase(documents.begin() + 2);
+        VERIFY_ARE_EQUAL(size_t(0), index.Sync(documents));
+        VERIFY_ARE_EQUAL(size_t(3), index.DocumentCount());
+        for (const auto& match : index.Search(L"dns name server", 10))
+        {
+            VERIFY_ARE_NOT_EQUAL(network.wstring(), match.document);
+        }
+        VERIFY_ARE_EQUAL(std::wstring{ L"notes" }, index.Search(L"when does the staging server restart", 1)[0].document);
+
+        Log::Comment(L"Replaced chunks are eventually reclaimed");
+        for (auto i = 0; i < 10; ++i)
+        {
+            index.Update(L"notes", L"The staging server restarts every night at " + std::to_wstring(i) + L".");
+        }
+        VERIFY_ARE_EQUAL(std::wstring{ L"The staging server restarts every night at 9." }, index.Search(L"staging server restarts", 1)[0].text);
+        index.Remove(L"notes");
+        VERIFY_ARE_EQUAL(size_t(2), index.DocumentCount());
+        VERIFY_IS_LESS_THAN(index.ChunkCount(), chunks);
+
+        DocumentIndex reopened{ indexPath(directory), embedder, options };
+        VERIFY_ARE_EQUAL(size_t(2), reopened.DocumentCount());
+        VERIFY_ARE_EQUAL(index.ChunkCount(), reopened.ChunkCount());
+        VERIFY_ARE_EQUAL(size_t(0), reopened.Sync(documents));
+
+        Log::Comment(L"An index built with a different embedder starts over");
+        DocumentIndex other{ indexPath(directory), std::make_shared<HashingEmbedder>(128), options };
+        VERIFY_ARE_EQUAL(size_t(0), other.DocumentCount());
+        VERIFY_ARE_EQUAL(size_t(2), other.Sync(documents));
+    }
+
+    TEST_METHOD(MetadataIsAppended)
+    {
+        ScratchDirectory directory{ L"DocumentIndexTests" };
+        const std::array documents{
+            directory.Write(L"git.md", gitRunbook),
+            directory.Write(L"disk.md", diskRunbook),
+            directory.Write(L"network.md", networkRunbook),
+        };
+        const auto embedder = std::make_shared<HashingEmbedder>();
+        const auto metadata = indexPath(directory) / L"documents.bin";
+
+        {
+            DocumentIndex index{ indexPath(directory), embedder };
+            VERIFY_ARE_EQUAL(size_t(3), index.Sync(documents));
+
+            Log::Comment(L"Changes append to the metadata instead of rewriting it");
+            const auto before = til::io::read_file_as_utf8_string_if_exists(metadata);
+            index.Update(L"notes", L"The staging server restarts every night at two.");
+            index.Remove(L"notes");
+            const auto after = til::io::read_file_as_utf8_string_if_exists(metadata);
+            VERIFY_IS_GREATER_THAN(after.size(), before.size());
+            VERIFY_IS_TRUE(after.starts_with(before));
+        }
+
+        Log::Comment(L"A record cut short by a crash only loses the change it recorded");
+        std::filesystem::resize_file(metadata, std::filesystem::file_size(metadata) - 1);
+        {
+            DocumentIndex index{ indexPath(directory), embedder };
+            VERIFY_ARE_EQUAL(size_t(4), index.DocumentCount());
+            VERIFY_ARE_EQUAL(std::wstring{ L"notes" }, index.Search(L"when does the staging server restart", 1)[0].document);
+            VERIFY_ARE_EQUAL(size_t(0), index.Sync(documents));
+        }
+
+        DocumentIndex index{ indexPath(directory), embedder };
+        VERIFY_ARE_EQUAL(size_t(4), index.DocumentCount());
+        VERIFY_ARE_EQUAL(documents[0].wstring(), index.Search(L"detached head", 1)[0].document);
+    }
+
+    TEST_METHOD(HnswDocumentIndex)
+    {
+        ScratchDirectory directory{ L"DocumentIndexTests" };
+        const std::array documents{
+            directory.Write(L"git.md", gitRunbook),
+            directory.Write(L"disk.md", diskRunbook),
+            directory.Write(L"network.md", networkRunbook),
+        };
+        const DocumentIndexOptions options{ .chunkLength = 60, .chunkOverlap = 10, .useHnsw = true };
+
+        {
+            DocumentIndex index{ indexPath(directory), std::make_shared<HashingEmbedder>(), options };
+            VERIFY_ARE_EQUAL(size_t(3), index.Sync(documents));
+        }
+
+        // The graph is rebuilt from the stored embeddings.
+        DocumentIndex index{ indexPath(directory), std::make_shared<HashingEmbedder>(), options };
+        VERIFY_ARE_EQUAL(documents[2].wstring(), index.Search(L"flush the dns cache", 1)[0].document);
+        index.Remove(documents[2].wstring());
+        VERIFY_ARE_NOT_EQUAL(documents[2].wstring(), index.Search(L"flush the dns cache", 1)[0].document);
+
+        // Replacing a document compacts the store once its old rows outnumber the live ones,
+        // after which searches use a graph that's built anew from the compacted rows.
+        for (auto i = 0; i < 32; ++i)
+        {
+            index.Update(L"notes", L"restart the ssh agent after rotating the keys");
+        }
+        VERIFY_ARE_EQUAL(std::wstring{ L"notes" }, index.Search(L"ssh agent keys", 1)[0].document);
+        VERIFY_ARE_EQUAL(documents[0].wstring(), index.Search(L"reattach a detached HEAD", 1)[0].document);
+    }
+
+    TEST_METHOD(SearchPerformance)
+    {
+        static constexpr uint32_t dimensions = 128;
+        static constexpr size_t queries = 20;
+        static constexpr size_t k = 10;
+
+        const auto queryVectors = randomVectors(queries, dimensions, 5);
+        const auto measure = [&](auto&& search) {
+            const auto start = clock::now();
+            for (size_t i = 0; i < queries; ++i)
+            {
+                VERIFY_ARE_EQUAL(k, search(std::span<const float>{ queryVectors.data() + i * dimensions, dimensions }).size());
+            }
+            return millisecondsSince(start) / queries;
+        };
+
+        for (const size_t count : { 10'000, 100'000, 1'000'000 })
+        {
+            VectorStore store{ {}, dimensions };
+            fill(store, randomVectors(count, dimensions, 6));
+
+            const auto flat = measure([&](auto query) { return store.Search(query, k); });
+            Log::Comment(NoThrowString().Format(L"%zu vectors: %.2fms per exact search", count, flat));
+
+            // Building the graph for a million vectors takes minutes, which is too slow for a test.
+            if (count <= 100'000)
+            {
+                HnswIndex index{ store };
+                const auto start = clock::now();
+                index.Update();
+                const auto build = millisecondsSince(start);
+                const auto approximate = measure([&](auto query) { return index.Search(query, k); });
+                Log::Comment(NoThrowString().Format(L"%zu vectors: %.2fms per approximate search, %.0fms to build the graph", count, approximate, build));
+            }
+        }
+    }
+};
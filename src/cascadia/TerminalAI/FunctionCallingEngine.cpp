@@ -1,43 +1,96 @@
 #include "pch.h"
 #include "FunctionCallingEngine.h"
+#include "DefinitionCache.h"
+#include "ThreadPoolBatch.h"
 
 using namespace winrt;
 using namespace Microsoft::Terminal::AI;
 
-FunctionCallingEngine::FunctionCallingEngine()
+namespace
 {
+    // Bump whenever _parseFunctionManifest() changes, to invalidate existing caches.
+    constexpr uint32_t FunctionCacheVersion = 1;
 }
 
-void FunctionCallingEngine::LoadFunctions(std::wstring_view functionsDir)
+FunctionCallingEngine::FunctionCallingEngine() :
+    FunctionCallingEngine(ToolWorkerOptions{})
+{
+}
+
+FunctionCallingEngine::FunctionCallingEngine(ToolWorkerOptions workerOptions) :
+    _workers{ std::make_shared<ToolWorkerPool>(std::move(workerOptions)) }
+{
+}
+
+void FunctionCallingEngine::LoadFunctions(std::wstring_view functionsDir, const std::filesystem::path& cachePath)
 {
     _functionsDirectory = functionsDir;
+    _cachePath = cachePath;
     _loadFunctionDefinitions();
+    _warmWorkersAsync();
 }
 
 winrt::fire_and_forget FunctionCallingEngine::ExecuteFunctionAsync(std::wstring_view functionName, std::wstring_view arguments)
 {
-    auto iter = _functions.find(std::wstring(functionName));
+    // Neither the views nor `this` are guaranteed to outlive the first suspension,
+    // so the function is resolved up front and the task shares ownership of the pool.
+    const auto iter = _functions.find(functionName);
     if (iter == _functions.end())
     {
         co_return;
     }
+    const auto scriptPath = iter->second.scriptPath;
+    const auto runtime = RuntimeForScript(scriptPath);
+    if (!runtime)
+    {
+        co_return;
+    }
+    const std::wstring args{ arguments };
+    const auto workers = _workers;
 
-    const auto& definition = iter->second;
-    const auto scriptPath = definition.scriptPath;
-    
-    // Determine script type by extension and execute accordingly
-    if (scriptPath.ends_with(L".sh") || scriptPath.ends_with(L".bash"))
+    co_await winrt::resume_background();
+
+    try
     {
-        co_await _executeBashFunction(scriptPath, arguments);
+        std::ignore = workers->Invoke(*runtime, scriptPath, args);
     }
-    else if (scriptPath.ends_with(L".js"))
+    CATCH_LOG();
+}
+
+ToolResult FunctionCallingEngine::ExecuteFunction(std::wstring_view functionName, std::wstring_view arguments, const ToolWorkerPool::OutputCallback& onOutput)
+{
+    const auto iter = _functions.find(functionName);
+    if (iter == _functions.end())
     {
-        co_await _executeJavaScriptFunction(scriptPath, arguments);
+        return { "Unknown function: " + til::u16u8(functionName) };
     }
-    else if (scriptPath.ends_with(L".py"))
+
+    // Determine script type by extension and execute accordingly
+    const auto& scriptPath = iter->second.scriptPath;
+    const auto runtime = RuntimeForScript(scriptPath);
+    if (!runtime)
     {
-        co_await _executePythonFunction(scriptPath, arguments);
+        return { "Unsupported script type: " + til::u16u8(scriptPath) };
     }
+
+    return _workers->Invoke(*runtime, scriptPath, arguments, onOutput);
+}
+
+std::vector<ToolResult> FunctionCallingEngine::ExecuteFunctions(const std::vector<FunctionCall>& calls)
+{
+    std::vector<ToolResult> results(calls.size());
+    RunOnThreadPool(calls.size(), [&](size_t i) {
+        try
+        {
+            results[i] = ExecuteFunction(calls[i].name, calls[i].arguments);
+        }
+        catch (...)
+        {
+            LOG_CAUGHT_EXCEPTION();
+            results[i].output = "Failed to run function: " + til::u16u8(calls[i].name);
+        }
+    });
+    return results;
 }
 
 std::vector<FunctionCallingEngine::FunctionDefinition> FunctionCallingEngine::GetAvailableFunctions()
@@ -49,6 +102,9 @@ std::vector<FunctionCallingEngine::FunctionDefinition> FunctionCallingEngine::Ge
     {
         result.push_back(definition);
     }
+
+    // _functions is unordered.
+    std::sort(result.begin(), result.end(), [](const auto& a, const auto& b) { return a.name < b.name; });
     
     return result;
 }
@@ -70,78 +126,24 @@ void FunctionCallingEngine::_loadFunctionDefinitions()
     
     try 
     {
-        // Scan for .json definition files
-        for (const auto& entry : std::filesystem::directory_iterator(funcDir))
+        const auto sources = EnumerateDefinitionSources(funcDir, L".json");
+        DefinitionCache cache{ _cachePath, FunctionCacheVersion };
+        const auto payloads = cache.Resolve(sources, [&](const std::filesystem::path& path) {
+            return _parseFunctionManifest(path, funcDir);
+        });
+
+        for (const auto& payload : payloads)
         {
-            if (!entry.is_regular_file())
-            {
-                continue;
-            }
-            
-            const auto& path = entry.path();
-            if (path.extension() != L".json")
-            {
-                continue;
-            }
-            
-            // Read and parse the JSON function definition
-            const auto jsonContent = til::io::read_file_as_utf8_string_if_exists(path);
-            if (jsonContent.empty())
-            {
-                continue;
-            }
-            
-            try 
+            FunctionDefinition funcDef;
+            DefinitionReader reader{ payload };
+            if (!payload.empty() &&
+                reader.Read(funcDef.name) &&
+                reader.Read(funcDef.description) &&
+                reader.Read(funcDef.parameters) &&
+                reader.Read(funcDef.scriptPath))
             {
-                Json::Value root;
-                std::string errs;
-                const std::unique_ptr<Json::CharReader> reader{ Json::CharReaderBuilder{}.newCharReader() };
-                
-                if (reader->parse(jsonContent.data(), jsonContent.data() + jsonContent.size(), &root, &errs))
-                {
-                    // Parse function definition from JSON
-                    FunctionDefinition funcDef;
-                    
-                    if (root.isMember("name") && root["name"].isString())
-                    {
-                        funcDef.name = til::u8u16(root["name"].asString());
-                    }
-                    
-                    if (root.isMember("description") && root["description"].isString())
-                    {
-                        funcDef.description = til::u8u16(root["description"].asString());
-                    }
-                    
-                    if (root.isMember("parameters"))
-                    {
-                        Json::StreamWriterBuilder builder;
-                        const auto parametersStr = Json::writeString(builder, root["parameters"]);
-                        funcDef.parameters = til::u8u16(parametersStr);
-                    }
-                    
-                    if (root.isMember("scriptPath") && root["scriptPath"].isString())
-                    {
-                        // Handle relative paths by making them relative to the functions directory
-                        const auto scriptPathUtf8 = root["scriptPath"].asString();
-                        std::filesystem::path scriptPath(til::u8u16(scriptPathUtf8));
-                        if (scriptPath.is_relative())
-                        {
-                            scriptPath = funcDir / scriptPath;
-                        }
-                        funcDef.scriptPath = scriptPath.wstring();
-                    }
-                    
-                    // Only add if we have required fields
-                    if (!funcDef.name.empty() && !funcDef.scriptPath.empty())
-                    {
-                        _functions[funcDef.name] = std::move(funcDef);
-                    }
-                }
-            }
-            catch (...)
-            {
-                // Skip malformed JSON files
-                continue;
+                auto name = funcDef.name;
+                _functions.insert_or_assign(std::move(name), std::move(funcDef));
             }
         }
     }
@@ -152,140 +154,105 @@ void FunctionCallingEngine::_loadFunctionDefinitions()
     }
 }
 
-winrt::fire_and_forget FunctionCallingEngine::_executeBashFunction(std::wstring_view scriptPath, std::wstring_view args)
+// Returns the serialized FunctionDefinition of a manifest, or an empty string if it isn't a valid one.
+std::string FunctionCallingEngine::_parseFunctionManifest(const std::filesystem::path& path, const std::filesystem::path& funcDir)
 {
-    co_await winrt::resume_background();
-    
+    // Read and parse the JSON function definition
+    const auto jsonContent = til::io::read_file_as_utf8_string_if_exists(path);
+    if (jsonContent.empty())
+    {
+        return {};
+    }
+
     try 
     {
-        // Build command line: bash.exe "script_path" arguments
-        std::wstring cmdline = L"bash.exe \"";
-        cmdline += scriptPath;
-        cmdline += L"\" ";
-        cmdline += args;
+        Json::Value root;
+        std::string errs;
+        const std::unique_ptr<Json::CharReader> reader{ Json::CharReaderBuilder{}.newCharReader() };
         
-        STARTUPINFOW si = {};
-        si.cb = sizeof(si);
-        si.dwFlags = STARTF_USESTDHANDLES | STARTF_USESHOWWINDOW;
-        si.wShowWindow = SW_HIDE; // Hide the window
+        if (!reader->parse(jsonContent.data(), jsonContent.data() + jsonContent.size(), &root, &errs))
+        {
+            return {};
+        }
+
+        // Parse function definition from JSON
+        FunctionDefinition funcDef;
         
-        PROCESS_INFORMATION pi = {};
+        if (root.isMember("name") && root["name"].isString())
+        {
+            funcDef.name = til::u8u16(root["name"].asString());
+        }
         
-        // Create the process
-        if (CreateProcessW(
-            nullptr,              // Application name (use command line)
-            cmdline.data(),       // Command line
-            nullptr,              // Process attributes
-            nullptr,              // Thread attributes  
-            FALSE,                // Inherit handles
-            CREATE_NO_WINDOW,     // Creation flags - no window
-            nullptr,              // Environment
-            nullptr,              // Current directory
-            &si,                  // Startup info
-            &pi))                 // Process information
+        if (root.isMember("description") && root["description"].isString())
         {
-            // Wait for the process to complete (with a timeout)
-            const DWORD waitResult = WaitForSingleObject(pi.hProcess, 30000); // 30 second timeout
-            
-            // Clean up handles
-            CloseHandle(pi.hProcess);
-            CloseHandle(pi.hThread);
+            funcDef.description = til::u8u16(root["description"].asString());
         }
-    }
-    catch (...)
-    {
-        // Log error or handle failure silently
-    }
-}
-
-winrt::fire_and_forget FunctionCallingEngine::_executeJavaScriptFunction(std::wstring_view scriptPath, std::wstring_view args)
-{
-    co_await winrt::resume_background();
-    
-    try 
-    {
-        // Build command line: node.exe "script_path" arguments
-        std::wstring cmdline = L"node.exe \"";
-        cmdline += scriptPath;
-        cmdline += L"\" ";
-        cmdline += args;
         
-        STARTUPINFOW si = {};
-        si.cb = sizeof(si);
-        si.dwFlags = STARTF_USESTDHANDLES | STARTF_USESHOWWINDOW;
-        si.wShowWindow = SW_HIDE; // Hide the window
+        if (root.isMember("parameters"))
+        {
+            Json::StreamWriterBuilder builder;
+            const auto parametersStr = Json::writeString(builder, root["parameters"]);
+            funcDef.parameters = til::u8u16(parametersStr);
+        }
         
-        PROCESS_INFORMATION pi = {};
+        if (root.isMember("scriptPath") && root["scriptPath"].isString())
+        {
+            // Handle relative paths by making them relative to the functions directory
+            const auto scriptPathUtf8 = root["scriptPath"].asString();
+            std::filesystem::path scriptPath(til::u8u16(scriptPathUtf8));
+            if (scriptPath.is_relative())
+            {
+                scriptPath = funcDir / scriptPath;
+            }
+            funcDef.scriptPath = scriptPath.wstring();
+        }
         
-        // Create the process
-        if (CreateProcessW(
-            nullptr,              // Application name (use command line)
-            cmdline.data(),       // Command line
-            nullptr,              // Process attributes
-            nullptr,              // Thread attributes  
-            FALSE,                // Inherit handles
-            CREATE_NO_WINDOW,     // Creation flags - no window
-            nullptr,              // Environment
-            nullptr,              // Current directory
-            &si,                  // Startup info
-            &pi))                 // Process information
+        // Only add if we have required fields
+        if (funcDef.name.empty() || funcDef.scriptPath.empty())
         {
-            // Wait for the process to complete (with a timeout)
-            const DWORD waitResult = WaitForSingleObject(pi.hProcess, 30000); // 30 second timeout
-            
-            // Clean up handles
-            CloseHandle(pi.hProcess);
-            CloseHandle(pi.hThread);
+            return {};
         }
+
+        DefinitionWriter writer;
+        writer.Write(funcDef.name);
+        writer.Write(funcDef.description);
+        writer.Write(funcDef.parameters);
+        writer.Write(funcDef.scriptPath);
+        return writer.Take();
     }
     catch (...)
     {
-        // Log error or handle failure silently
+        // Skip malformed JSON files
+        return {};
     }
 }
 
-winrt::fire_and_forget FunctionCallingEngine::_executePythonFunction(std::wstring_view scriptPath, std::wstring_view args)
+// Spawns one worker for each runtime used by the loaded functions,
+// so that even the first call doesn't have to wait for an interpreter to start.
+winrt::fire_and_forget FunctionCallingEngine::_warmWorkersAsync()
 {
-    co_await winrt::resume_background();
-    
-    try 
+    std::array<bool, ToolRuntimeCount> used{};
+    for (const auto& [name, definition] : _functions)
     {
-        // Build command line: python.exe "script_path" arguments
-        std::wstring cmdline = L"python.exe \"";
-        cmdline += scriptPath;
-        cmdline += L"\" ";
-        cmdline += args;
-        
-        STARTUPINFOW si = {};
-        si.cb = sizeof(si);
-        si.dwFlags = STARTF_USESTDHANDLES | STARTF_USESHOWWINDOW;
-        si.wShowWindow = SW_HIDE; // Hide the window
-        
-        PROCESS_INFORMATION pi = {};
-        
-        // Create the process
-        if (CreateProcessW(
-            nullptr,              // Application name (use command line)
-            cmdline.data(),       // Command line
-            nullptr,              // Process attributes
-            nullptr,              // Thread attributes  
-            FALSE,                // Inherit handles
-            CREATE_NO_WINDOW,     // Creation flags - no window
-            nullptr,              // Environment
-            nullptr,              // Current directory
-            &si,                  // Startup info
-            &pi))                 // Process information
+        if (const auto runtime = RuntimeForScript(definition.scriptPath))
         {
-            // Wait for the process to complete (with a timeout)
-            const DWORD waitResult = WaitForSingleObject(pi.hProcess, 30000); // 30 second timeout
-            
-            // Clean up handles
-            CloseHandle(pi.hProcess);
-            CloseHandle(pi.hThread);
+            til::at(used, static_cast<size_t>(*runtime)) = true;
         }
     }
-    catch (...)
+
+    const auto workers = _workers;
+    co_await winrt::resume_background();
+
+    for (size_t i = 0; i < used.size(); ++i)
     {
-        // Log error or handle failure silently
+        if (til::at(used, i))
+        {
+            try
+            {
+                workers->Warm(static_cast<ToolRuntime>(i), 1);
+            }
+            // The interpreter may simply not be installed. Calls will fail with a proper error later.
+            CATCH_LOG();
+        }
     }
 }
\ No newline at end of file
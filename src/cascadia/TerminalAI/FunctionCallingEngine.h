@@ -1,6 +1,7 @@
 #pragma once
 
 #include "pch.h"
+#include "ToolWorkerPool.h"
 
 namespace Microsoft::Terminal::AI
 {
@@ -9,6 +10,7 @@ namespace Microsoft::Terminal::AI
     {
     public:
         FunctionCallingEngine();
+        explicit FunctionCallingEngine(ToolWorkerOptions workerOptions);
         
         struct FunctionDefinition
         {
@@ -17,18 +19,34 @@ namespace Microsoft::Terminal::AI
             std::wstring parameters;
             std::wstring scriptPath;
         };
+
+        struct FunctionCall
+        {
+            std::wstring name;
+            std::wstring arguments;
+        };
         
-        void LoadFunctions(std::wstring_view functionsDir);
+        // Loads the function manifests (*.json) in a directory. The parsed manifests are cached
+        // in `cachePath`, if given, so that only manifests that changed are parsed again.
+        void LoadFunctions(std::wstring_view functionsDir, const std::filesystem::path& cachePath = {});
         winrt::fire_and_forget ExecuteFunctionAsync(std::wstring_view functionName, std::wstring_view arguments);
+        // Runs a function on a warm worker and streams its output to `onOutput`.
+        // The arguments (usually a JSON object) are passed to the script as its only argument.
+        ToolResult ExecuteFunction(std::wstring_view functionName, std::wstring_view arguments, const ToolWorkerPool::OutputCallback& onOutput = nullptr);
+        // Runs independent calls, like the tool calls of a single model turn, in parallel.
+        // The results are in the order of `calls`.
+        std::vector<ToolResult> ExecuteFunctions(const std::vector<FunctionCall>& calls);
         std::vector<FunctionDefinition> GetAvailableFunctions();
         
     private:
-        std::map<std::wstring, FunctionDefinition> _functions;
+        til::flat_hash_map<std::wstring, FunctionDefinition> _functions;
         std::wstring _functionsDirectory;
+        std::filesystem::path _cachePath;
+        // Shared with the background task that warms it up.
+        std::shared_ptr<ToolWorkerPool> _workers;
         
         void _loadFunctionDefinitions();
-        winrt::fire_and_forget _executeBashFunction(std::wstring_view scriptPath, std::wstring_view args);
-        winrt::fire_and_forget _executeJavaScriptFunction(std::wstring_view scriptPath, std::wstring_view args);
-        winrt::fire_and_forget _executePythonFunction(std::wstring_view scriptPath, std::wstring_view args);
+        static std::string _parseFunctionManifest(const std::filesystem::path& path, const std::filesystem::path& funcDir);
+        winrt::fire_and_forget _warmWorkersAsync();
     };
 }
\ No newline at end of file
@@ -0,0 +1,313 @@
+#include "pch.h"
+#include "HttpTransport.h"
+
+#include <random>
+#include <thread>
+
+static constexpr wchar_t HttpUserAgent[] = L"Windows-Terminal-AI/1.0";
+
+namespace Microsoft::Terminal::AI
+{
+    namespace
+    {
+        DWORD toTimeout(std::chrono::milliseconds timeout) noexcept
+        {
+            return gsl::narrow_cast<DWORD>(std::clamp<int64_t>(timeout.count(), 0, MAXDWORD));
+        }
+
+        int64_t microsecondsBetween(std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end) noexcept
+        {
+            return std::chrono::duration_cast<std::chrono::microseconds>(end - begin).count();
+        }
+    }
+
+    HttpTransport::HttpTransport(HttpTransportOptions options) :
+        _options{ std::move(options) }
+    {
+        _session.reset(WinHttpOpen(HttpUserAgent, WINHTTP_ACCESS_TYPE_AUTOMATIC_PROXY, WINHTTP_NO_PROXY_NAME, WINHTTP_NO_PROXY_BYPASS, 0));
+        THROW_LAST_ERROR_IF(!_session);
+
+        THROW_IF_WIN32_BOOL_FALSE(WinHttpSetTimeouts(_session.get(), 0, toTimeout(_options.connectTimeout), toTimeout(_options.sendTimeout), toTimeout(_options.receiveTimeout)));
+
+        DWORD maxConnections = _options.maxConnectionsPerServer;
+        THROW_IF_WIN32_BOOL_FALSE(WinHttpSetOption(_session.get(), WINHTTP_OPTION_MAX_CONNS_PER_SERVER, &maxConnections, sizeof(maxConnections)));
+    }
+
+    std::shared_ptr<HttpTransport> HttpTransport::Shared()
+    {
+        static const auto transport = std::make_shared<HttpTransport>();
+        return transport;
+    }
+
+    uint32_t HttpTransport::Send(const HttpEndpoint& endpoint, const HttpRequest& request, const ChunkCallback& onChunk)
+    {
+        static thread_local std::minstd_rand random{ std::random_device{}() };
+        auto& server = _server(endpoint);
+
+        for (uint32_t attempt = 0;; ++attempt)
+        {
+            const auto retriesLeft = attempt < _options.maxRetries;
+            Attempt result;
+            const auto hr = _sendOnce(server, endpoint, request, onChunk, retriesLeft, result);
+
+            if (SUCCEEDED(hr) && (result.cancelled || !retriesLeft || !IsRetryableStatus(result.status)))
+            {
+                if (result.status >= 400)
+                {
+                    server.failures++;
+                }
+                return result.status;
+            }
+
+            // Once the caller has seen part of the body, a retry would duplicate it.
+            if (FAILED(hr) && (result.delivered || !retriesLeft || !IsRetryableError(hr)))
+            {
+                server.failures++;
+                THROW_HR(hr);
+            }
+
+            server.retries++;
+            auto delay = RetryDelay(attempt, _options, gsl::narrow_cast<uint32_t>(random()));
+            if (result.retryAfter > delay)
+            {
+                delay = std::min(result.retryAfter, _options.retryMaxDelay);
+            }
+            std::this_thread::sleep_for(delay);
+        }
+    }
+
+    HttpResponse HttpTransport::Send(const HttpEndpoint& endpoint, const HttpRequest& request)
+    {
+        HttpResponse response;
+        response.status = Send(endpoint, request, [&](uint32_t, std::string_view chunk) {
+            response.body.append(chunk);
+            return true;
+        });
+        return response;
+    }
+
+    HttpEndpointStats HttpTransport::Stats(const HttpEndpoint& endpoint) const
+    {
+        const auto key = endpoint.host + L':' + std::to_wstring(endpoint.port);
+
+        std::lock_guard lock{ _serversLock };
+        const auto it = _servers.find(key);
+        if (it == _servers.end())
+        {
+            return {};
+        }
+
+        const auto& server = *it->second;
+        HttpEndpointStats stats;
+        stats.requests = server.requests.load(std::memory_order_relaxed);
+        stats.retries = server.retries.load(std::memory_order_relaxed);
+        stats.failures = server.failures.load(std::memory_order_relaxed);
+        stats.bytesSent = server.bytesSent.load(std::memory_order_relaxed);
+        stats.bytesReceived = server.bytesReceived.load(std::memory_order_relaxed);
+        stats.totalLatency = std::chrono::microseconds{ server.totalLatency.load(std::memory_order_relaxed) };
+        stats.totalTransferTime = std::chrono::microseconds{ server.totalTransferTime.load(std::memory_order_relaxed) };
+        return stats;
+    }
+
+    bool HttpTransport::IsRetryableStatus(uint32_t status) noexcept
+    {
+        switch (status)
+        {
+        case 408: // Request Timeout
+        case 429: // Too Many Requests
+        case 500: // Internal Server Error
+        case 502: // Bad Gateway
+        case 503: // Service Unavailable
+        case 504: // Gateway Timeout
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    bool HttpTransport::IsRetryableError(HRESULT hr) noexcept
+    {
+        if (HRESULT_FACILITY(hr) != FACILITY_WIN32)
+        {
+            return false;
+        }
+
+        switch (HRESULT_CODE(hr))
+        {
+        case ERROR_WINHTTP_TIMEOUT:
+        case ERROR_WINHTTP_CANNOT_CONNECT:
+        case ERROR_WINHTTP_CONNECTION_ERROR:
+        // What a keep-alive connection that the server has closed in the meantime looks like.
+        case ERROR_WINHTTP_INVALID_SERVER_RESPONSE:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    std::chrono::milliseconds HttpTransport::RetryDelay(uint32_t attempt, const HttpTransportOptions& options, uint32_t random) noexcept
+    {
+        const auto max = std::max<int64_t>(options.retryMaxDelay.count(), 0);
+        auto cap = std::clamp<int64_t>(options.retryBaseDelay.count(), 0, max);
+        for (uint32_t i = 0; i < attempt && cap < max; ++i)
+        {
+            cap = std::min(cap * 2, max);
+        }
+
+        const auto half = cap / 2;
+        return std::chrono::milliseconds{ half + static_cast<int64_t>(random % static_cast<uint64_t>(cap - half + 1)) };
+    }
+
+    HttpTransport::Server& HttpTransport::_server(const HttpEndpoint& endpoint)
+    {
+        const auto key = endpoint.host + L':' + std::to_wstring(endpoint.port);
+
+        std::lock_guard lock{ _serversLock };
+        auto& server = _servers[key];
+        if (!server)
+        {
+            auto newServer = std::make_unique<Server>();
+            newServer->connection.reset(WinHttpConnect(_session.get(), endpoint.host.c_str(), endpoint.port, 0));
+            THROW_LAST_ERROR_IF(!newServer->connection);
+            server = std::move(newServer);
+        }
+        return *server;
+    }
+
+    HRESULT HttpTransport::_sendOnce(Server& server, const HttpEndpoint& endpoint, const HttpRequest& request, const ChunkCallback& onChunk, bool retriesLeft, Attempt& attempt)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        server.requests++;
+
+        const wil::unique_winhttp_hinternet handle{ WinHttpOpenRequest(server.connection.get(), request.method.c_str(), request.path.c_str(), nullptr, WINHTTP_NO_REFERER, WINHTTP_DEFAULT_ACCEPT_TYPES, endpoint.secure ? WINHTTP_FLAG_SECURE : 0) };
+        RETURN_LAST_ERROR_IF(!handle);
+
+        // Both options are unsupported on older versions of Windows, which is fine.
+        if (_options.decompress)
+        {
+            DWORD flags = WINHTTP_DECOMPRESSION_FLAG_ALL;
+            std::ignore = WinHttpSetOption(handle.get(), WINHTTP_OPTION_DECOMPRESSION, &flags, sizeof(flags));
+        }
+        if (_options.http2)
+        {
+            DWORD flags = WINHTTP_PROTOCOL_FLAG_HTTP2;
+            std::ignore = WinHttpSetOption(handle.get(), WINHTTP_OPTION_ENABLE_HTTP_PROTOCOL, &flags, sizeof(flags));
+        }
+
+        const auto bodySize = gsl::narrow<DWORD>(request.body.size());
+#pragma warning(suppress : 26477) // WINHTTP_NO_ADDITIONAL_HEADERS expands to NULL rather than nullptr.
+        const auto headers = request.headers.empty() ? WINHTTP_NO_ADDITIONAL_HEADERS : request.headers.c_str();
+        RETURN_IF_WIN32_BOOL_FALSE(WinHttpSendRequest(handle.get(), headers, static_cast<DWORD>(-1), const_cast<char*>(request.body.data()), bodySize, bodySize, 0));
+        server.bytesSent += bodySize;
+
+        RETURN_IF_WIN32_BOOL_FALSE(WinHttpReceiveResponse(handle.get(), nullptr));
+        const auto headersReceived = std::chrono::steady_clock::now();
+        server.totalLatency += microsecondsBetween(start, headersReceived);
+
+        DWORD status = 0;
+        DWORD size = sizeof(status);
+        RETURN_IF_WIN32_BOOL_FALSE(WinHttpQueryHeaders(handle.get(), WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER, WINHTTP_HEADER_NAME_BY_INDEX, &status, &size, WINHTTP_NO_HEADER_INDEX));
+        attempt.status = status;
+
+        // A response that's going to be retried is drained (so that the connection
+        // can be reused) but never shown to the caller.
+        const auto discard = retriesLeft && IsRetryableStatus(status);
+        if (discard)
+        {
+            DWORD retryAfter = 0;
+            size = sizeof(retryAfter);
+            if (WinHttpQueryHeaders(handle.get(), WINHTTP_QUERY_RETRY_AFTER | WINHTTP_QUERY_FLAG_NUMBER, WINHTTP_HEADER_NAME_BY_INDEX, &retryAfter, &size, WINHTTP_NO_HEADER_INDEX))
+            {
+                attempt.retryAfter = std::chrono::seconds{ retryAfter };
+            }
+        }
+
+        // WinHttpReadData() only returns once the buffer is full or the response has ended.
+        // Asking how much is available first lets us forward streamed responses as they arrive.
+        std::array<char, 16 * 1024> buffer;
+        for (;;)
+        {
+            DWORD available = 0;
+            RETURN_IF_WIN32_BOOL_FALSE(WinHttpQueryDataAvailable(handle.get(), &available));
+            if (available == 0)
+            {
+                break;
+            }
+
+            DWORD read = 0;
+            RETURN_IF_WIN32_BOOL_FALSE(WinHttpReadData(handle.get(), buffer.data(), std::min<DWORD>(available, gsl::narrow_cast<DWORD>(buffer.size())), &read));
+            if (read == 0)
+            {
+                break;
+            }
+
+            server.bytesReceived += read;
+            if (discard)
+            {
+                continue;
+            }
+
+            attempt.delivered = true;
+            if (!onChunk(status, { buffer.data(), read }))
+            {
+                attempt.cancelled = true;
+                break;
+            }
+        }
+
+        server.totalTransferTime += microsecondsBetween(headersReceived, std::chrono::steady_clock::now());
+        return S_OK;
+    }
+
+    HttpStreamingProvider::HttpStreamingProvider(std::shared_ptr<HttpTransport> transport, HttpEndpoint endpoint, std::wstring path, std::wstring apiKey) :
+        _transport{ std::move(transport) },
+        _endpoint{ std::move(endpoint) },
+        _path{ std::move(path) },
+        _headers{ L"Content-Type: application/json\r\nAccept: text/event-stream\r\n" }
+    {
+        if (!apiKey.empty())
+        {
+            _headers.append(L"Authorization: Bearer ").append(apiKey).append(L"\r\n");
+        }
+    }
+
+    void HttpStreamingProvider::Stream(const StreamingRequest& request, const ChunkCallback& onChunk)
+    {
+        const HttpRequest httpRequest{ L"POST", _path, _headers, request.body };
+
+        std::string errorBody;
+        const auto status = _transport->Send(_endpoint, httpRequest, [&](uint32_t code, std::string_view chunk) {
+            if (code >= 200 && code < 300)
+            {
+                return onChunk(chunk);
+            }
+            errorBody.append(chunk);
+            return true;
+        });
+
+        if (status >= 200 && status < 300)
+        {
+            return;
+        }
+
+        // Error responses are plain (possibly pretty-printed) JSON. Turn them into
+        // a single event, so that they're reported like any other stream error.
+        Json::Value root;
+        const std::unique_ptr<Json::CharReader> reader{ Json::CharReaderBuilder{}.newCharReader() };
+        std::string message = "HTTP " + std::to_string(status);
+        if (reader->parse(errorBody.data(), errorBody.data() + errorBody.size(), &root, nullptr) && root.isObject())
+        {
+            const auto& error = root["error"];
+            if (error.isObject() && error["message"].isString())
+            {
+                message = error["message"].asString();
+            }
+        }
+
+        Json::StreamWriterBuilder builder;
+        builder["indentation"] = "";
+        Json::Value event;
+        event["error"]["message"] = message;
+        onChunk("data: " + Json::writeString(builder, event) + "\n\n");
+    }
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include "pch.h"
+#include "AIStreaming.h"
+
+namespace Microsoft::Terminal::AI
+{
+    struct HttpTransportOptions
+    {
+        std::chrono::milliseconds connectTimeout{ 10000 };
+        std::chrono::milliseconds sendTimeout{ 30000 };
+        std::chrono::milliseconds receiveTimeout{ 120000 };
+
+        // Transient failures (connection errors, timeouts, 429 and 5xx responses)
+        // are retried with exponential backoff and jitter, as long as no part
+        // of the response body has been handed to the caller yet.
+        uint32_t maxRetries = 3;
+        std::chrono::milliseconds retryBaseDelay{ 250 };
+        std::chrono::milliseconds retryMaxDelay{ 8000 };
+
+        uint32_t maxConnectionsPerServer = 8;
+        bool decompress = true;
+        bool http2 = true;
+    };
+
+    struct HttpEndpoint
+    {
+        std::wstring host;
+        uint16_t port = 443;
+        bool secure = true;
+    };
+
+    struct HttpRequest
+    {
+        std::wstring method{ L"POST" };
+        std::wstring path;
+        // Additional CRLF-separated request headers.
+        std::wstring headers;
+        std::string body;
+    };
+
+    struct HttpResponse
+    {
+        uint32_t status = 0;
+        std::string body;
+    };
+
+    // Counters accumulated per endpoint. Latency is the time until the response headers
+    // arrived, transfer time the time spent reading the body afterwards.
+    struct HttpEndpointStats
+    {
+        uint64_t requests = 0;
+        uint64_t retries = 0;
+        uint64_t failures = 0;
+        uint64_t bytesSent = 0;
+        uint64_t bytesReceived = 0;
+        std::chrono::microseconds totalLatency{};
+        std::chrono::microseconds totalTransferTime{};
+    };
+
+    // A WinHTTP session shared by all requests to AI providers.
+    // WinHTTP pools keep-alive connections per session, so reusing one session (and one
+    // connect handle per endpoint) avoids a TCP and TLS handshake on every round-trip.
+    // With HTTP/2, concurrent requests to the same endpoint are multiplexed on one connection.
+    class HttpTransport
+    {
+    public:
+        // Receives the status code along with each chunk of the body.
+        // Returning false from the callback cancels the request.
+        using ChunkCallback = std::function<bool(uint32_t status, std::string_view chunk)>;
+
+        explicit HttpTransport(HttpTransportOptions options = {});
+
+        // The process-wide transport used by the AI engines.
+        static std::shared_ptr<HttpTransport> Shared();
+
+        // Sends the request and streams the (decompressed) response body to `onChunk`.
+        // Returns the HTTP status code. Throws if the request failed after all retries.
+        uint32_t Send(const HttpEndpoint& endpoint, const HttpRequest& request, const ChunkCallback& onChunk);
+        HttpResponse Send(const HttpEndpoint& endpoint, const HttpRequest& request);
+
+        HttpEndpointStats Stats(const HttpEndpoint& endpoint) const;
+
+        static bool IsRetryableStatus(uint32_t status) noexcept;
+        // Timeouts and dropped or refused connections. Anything else, like a name that
+        // doesn't resolve or a certificate that isn't trusted, fails the same way next time.
+        static bool IsRetryableError(HRESULT hr) noexcept;
+        // Exponential backoff with "equal jitter": a random delay in [cap/2, cap],
+        // where cap = min(retryMaxDelay, retryBaseDelay * 2^attempt).
+        static std::chrono::milliseconds RetryDelay(uint32_t attempt, const HttpTransportOptions& options, uint32_t random) noexcept;
+
+    private:
+        struct Server
+        {
+            wil::unique_winhttp_hinternet connection;
+            std::atomic<uint64_t> requests{ 0 };
+            std::atomic<uint64_t> retries{ 0 };
+            std::atomic<uint64_t> failures{ 0 };
+            std::atomic<uint64_t> bytesSent{ 0 };
+            std::atomic<uint64_t> bytesReceived{ 0 };
+            std::atomic<int64_t> totalLatency{ 0 };
+            std::atomic<int64_t> totalTransferTime{ 0 };
+        };
+
+        struct Attempt
+        {
+            uint32_t status = 0;
+            std::chrono::milliseconds retryAfter{};
+            bool delivered = false;
+            bool cancelled = false;
+        };
+
+        HttpTransportOptions _options;
+        wil::unique_winhttp_hinternet _session;
+        mutable std::mutex _serversLock;
+        // Servers are heap allocated so that their counters stay put when the map grows.
+        til::flat_hash_map<std::wstring, std::unique_ptr<Server>> _servers;
+
+        Server& _server(const HttpEndpoint& endpoint);
+        // Returns WinHTTP errors. Exceptions, like those thrown by `onChunk`, propagate.
+        HRESULT _sendOnce(Server& server, const HttpEndpoint& endpoint, const HttpRequest& request, const ChunkCallback& onChunk, bool retriesLeft, Attempt& attempt);
+    };
+
+    // Streams chat completions from an OpenAI-compatible endpoint through an HttpTransport.
+    class HttpStreamingProvider : public IStreamingProvider
+    {
+    public:
+        HttpStreamingProvider(std::shared_ptr<HttpTransport> transport, HttpEndpoint endpoint, std::wstring path, std::wstring apiKey);
+
+        void Stream(const StreamingRequest& request, const ChunkCallback& onChunk) override;
+
+    private:
+        std::shared_ptr<HttpTransport> _transport;
+        HttpEndpoint _endpoint;
+        std::wstring _path;
+        std::wstring _headers;
+    };
+}
@@ -0,0 +1,378 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include "HttpTransport.h"
+
+#include <chrono>
+#include <thread>
+
+using namespace Microsoft::Terminal::AI;
+using namespace WEX::Common;
+using namespace WEX::Logging;
+
+namespace
+{
+    // A minimal HTTP/1.1 server on the loopback interface. Every accepted connection is
+    // served on its own thread and kept alive for as long as the client wants.
+    class MockHttpServer
+    {
+    public:
+        // Returns the complete response for a request. An empty response drops the connection.
+        using Handler = std::function<std::string(std::string_view head, std::string_view body)>;
+
+        explicit MockHttpServer(Handler handler) :
+            _handler{ std::move(handler) }
+        {
+            WSADATA data;
+            THROW_IF_WIN32_ERROR(WSAStartup(MAKEWORD(2, 2), &data));
+
+            _listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+            THROW_LAST_ERROR_IF(_listener == INVALID_SOCKET);
+
+            sockaddr_in address{};
+            address.sin_family = AF_INET;
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            THROW_LAST_ERROR_IF(bind(_listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0);
+            THROW_LAST_ERROR_IF(listen(_listener, SOMAXCONN) != 0);
+
+            int size = sizeof(address);
+            THROW_LAST_ERROR_IF(getsockname(_listener, reinterpret_cast<sockaddr*>(&address), &size) != 0);
+            _port = ntohs(address.sin_port);
+
+            _acceptThread = std::thread{ [this]() { _accept(); } };
+        }
+
+        ~MockHttpServer()
+        {
+            closesocket(_listener);
+            _acceptThread.join();
+
+            {
+                std::lock_guard lock{ _lock };
+                for (const auto client : _clients)
+                {
+                    shutdown(client, SD_BOTH);
+                }
+            }
+            for (auto& thread : _threads)
+            {
+                thread.join();
+            }
+            for (const auto client : _clients)
+            {
+                closesocket(client);
+            }
+
+            WSACleanup();
+        }
+
+        HttpEndpoint Endpoint() const
+        {
+            return { L"127.0.0.1", _port, false };
+        }
+
+        size_t Connections() const noexcept
+        {
+            return _connections.load();
+        }
+
+        static std::string Response(std::string_view status, std::string_view body, std::string_view headers = {})
+        {
+            std::string response{ "HTTP/1.1 " };
+            response.append(status);
+            response.append("\r\nContent-Length: ");
+            response.append(std::to_string(body.size()));
+            response.append("\r\n");
+            response.append(headers);
+            response.append("\r\n");
+            response.append(body);
+            return response;
+        }
+
+    private:
+        Handler _handler;
+        SOCKET _listener = INVALID_SOCKET;
+        uint16_t _port = 0;
+        std::atomic<size_t> _connections{ 0 };
+        std::thread _acceptThread;
+        std::mutex _lock;
+        std::vector<SOCKET> _clients;
+        std::vector<std::thread> _threads;
+
+        void _accept()
+        {
+            for (;;)
+            {
+                const auto client = accept(_listener, nullptr, nullptr);
+                if (client == INVALID_SOCKET)
+                {
+                    return;
+                }
+
+                _connections++;
+                std::lock_guard lock{ _lock };
+                _clients.emplace_back(client);
+                _threads.emplace_back([this, client]() { _serve(client); });
+            }
+        }
+
+        void _serve(SOCKET client)
+        {
+            std::string buffer;
+            std::array<char, 4096> chunk;
+            const auto fill = [&](size_t size) {
+                while (buffer.size() < size)
+                {
+                    const auto read = recv(client, chunk.data(), gsl::narrow_cast<int>(chunk.size()), 0);
+                    if (read <= 0)
+                    {
+                        return false;
+                    }
+                    buffer.append(chunk.data(), read);
+                }
+                return true;
+            };
+
+            for (;;)
+            {
+                auto headEnd = buffer.find("\r\n\r\n");
+                while (headEnd == std::string::npos)
+                {
+                    if (!fill(buffer.size() + 1))
+                    {
+                        return;
+                    }
+                    headEnd = buffer.find("\r\n\r\n");
+                }
+                headEnd += 4;
+
+                size_t contentLength = 0;
+                if (const auto pos = buffer.find("Content-Length: "); pos < headEnd)
+                {
+                    contentLength = std::stoul(buffer.substr(pos + 16));
+                }
+                if (!fill(headEnd + contentLength))
+                {
+                    return;
+                }
+
+                const auto response = _handler(std::string_view{ buffer }.substr(0, headEnd), std::string_view{ buffer }.substr(headEnd, contentLength));
+                buffer.erase(0, headEnd + contentLength);
+                if (response.empty() || send(client, response.data(), gsl::narrow_cast<int>(response.size()), 0) != gsl::narrow_cast<int>(response.size()))
+                {
+                    shutdown(client, SD_BOTH);
+                    return;
+                }
+            }
+        }
+    };
+
+    HttpTransportOptions fastRetries()
+    {
+        HttpTransportOptions options;
+        options.retryBaseDelay = std::chrono::milliseconds{ 1 };
+        options.retryMaxDelay = std::chrono::milliseconds{ 4 };
+        return options;
+    }
+}
+
+class HttpTransportTests
+{
+    TEST_CLASS(HttpTransportTests);
+
+    TEST_METHOD(RetryDelay)
+    {
+        HttpTransportOptions options;
+        options.retryBaseDelay = std::chrono::milliseconds{ 100 };
+        options.retryMaxDelay = std::chrono::milliseconds{ 1000 };
+
+        VERIFY_ARE_EQUAL(int64_t{ 50 }, HttpTransport::RetryDelay(0, options, 0).count());
+        VERIFY_ARE_EQUAL(int64_t{ 100 }, HttpTransport::RetryDelay(0, options, 50).count());
+        VERIFY_ARE_EQUAL(int64_t{ 100 }, HttpTransport::RetryDelay(1, options, 0).count());
+        VERIFY_ARE_EQUAL(int64_t{ 200 }, HttpTransport::RetryDelay(1, options, 100).count());
+
+        Log::Comment(L"The delay is capped, no matter the attempt");
+        for (const auto attempt : { 4u, 5u, 63u, 64u, UINT32_MAX })
+        {
+            VERIFY_ARE_EQUAL(int64_t{ 500 }, HttpTransport::RetryDelay(attempt, options, 0).count());
+            VERIFY_ARE_EQUAL(int64_t{ 1000 }, HttpTransport::RetryDelay(attempt, options, 500).count());
+        }
+
+        VERIFY_IS_TRUE(HttpTransport::IsRetryableStatus(429));
+        VERIFY_IS_TRUE(HttpTransport::IsRetryableStatus(503));
+        VERIFY_IS_FALSE(HttpTransport::IsRetryableStatus(400));
+        VERIFY_IS_FALSE(HttpTransport::IsRetryableStatus(401));
+
+        VERIFY_IS_TRUE(HttpTransport::IsRetryableError(HRESULT_FROM_WIN32(ERROR_WINHTTP_TIMEOUT)));
+        VERIFY_IS_TRUE(HttpTransport::IsRetryableError(HRESULT_FROM_WIN32(ERROR_WINHTTP_CONNECTION_ERROR)));
+        VERIFY_IS_FALSE(HttpTransport::IsRetryableError(HRESULT_FROM_WIN32(ERROR_WINHTTP_NAME_NOT_RESOLVED)));
+        VERIFY_IS_FALSE(HttpTransport::IsRetryableError(HRESULT_FROM_WIN32(ERROR_WINHTTP_SECURE_FAILURE)));
+        VERIFY_IS_FALSE(HttpTransport::IsRetryableError(E_OUTOFMEMORY));
+    }
+
+    TEST_METHOD(KeepAlive)
+    {
+        MockHttpServer server{ [](std::string_view, std::string_view body) {
+            return MockHttpServer::Response("200 OK", body);
+        } };
+        HttpTransport transport;
+
+        for (auto i = 0; i < 20; i++)
+        {
+            const auto body = "request " + std::to_string(i);
+            const auto response = transport.Send(server.Endpoint(), { L"POST", L"/echo", {}, body });
+            VERIFY_ARE_EQUAL(200u, response.status);
+            VERIFY_ARE_EQUAL(body, response.body);
+        }
+
+        Log::Comment(L"All requests must have shared a single connection");
+        VERIFY_ARE_EQUAL(size_t(1), server.Connections());
+
+        const auto stats = transport.Stats(server.Endpoint());
+        VERIFY_ARE_EQUAL(uint64_t{ 20 }, stats.requests);
+        VERIFY_ARE_EQUAL(uint64_t{ 0 }, stats.retries);
+        VERIFY_ARE_EQUAL(uint64_t{ 0 }, stats.failures);
+    }
+
+    TEST_METHOD(RetryTransientFailures)
+    {
+        std::atomic<int> calls{ 0 };
+        MockHttpServer server{ [&](std::string_view, std::string_view) {
+            return ++calls <= 2 ? MockHttpServer::Response("503 Service Unavailable", "busy") : MockHttpServer::Response("200 OK", "done");
+        } };
+        HttpTransport transport{ fastRetries() };
+
+        const auto response = transport.Send(server.Endpoint(), { L"GET", L"/" });
+        VERIFY_ARE_EQUAL(200u, response.status);
+        VERIFY_ARE_EQUAL(std::string{ "done" }, response.body);
+        VERIFY_ARE_EQUAL(uint64_t{ 2 }, transport.Stats(server.Endpoint()).retries);
+
+        Log::Comment(L"Retries are given up after maxRetries and the last response is returned");
+        calls = -100;
+        const auto failed = transport.Send(server.Endpoint(), { L"GET", L"/" });
+        VERIFY_ARE_EQUAL(503u, failed.status);
+        VERIFY_ARE_EQUAL(std::string{ "busy" }, failed.body);
+
+        const auto stats = transport.Stats(server.Endpoint());
+        VERIFY_ARE_EQUAL(uint64_t{ 3 + 4 }, stats.requests);
+        VERIFY_ARE_EQUAL(uint64_t{ 2 + 3 }, stats.retries);
+        VERIFY_ARE_EQUAL(uint64_t{ 1 }, stats.failures);
+    }
+
+    TEST_METHOD(RetryDroppedConnection)
+    {
+        std::atomic<int> calls{ 0 };
+        MockHttpServer server{ [&](std::string_view, std::string_view) {
+            return ++calls == 1 ? std::string{} : MockHttpServer::Response("200 OK", "ok");
+        } };
+        HttpTransport transport{ fastRetries() };
+
+        const auto response = transport.Send(server.Endpoint(), { L"GET", L"/" });
+        VERIFY_ARE_EQUAL(200u, response.status);
+        VERIFY_ARE_EQUAL(uint64_t{ 1 }, transport.Stats(server.Endpoint()).retries);
+    }
+
+    TEST_METHOD(CallbackExceptionsPropagate)
+    {
+        MockHttpServer server{ [](std::string_view, std::string_view) {
+            return MockHttpServer::Response("200 OK", "ok");
+        } };
+        HttpTransport transport{ fastRetries() };
+
+        const auto onChunk = [](uint32_t, std::string_view) -> bool {
+            throw std::logic_error{ "callback failed" };
+        };
+        VERIFY_THROWS(transport.Send(server.Endpoint(), { L"GET", L"/" }, onChunk), std::logic_error);
+        VERIFY_ARE_EQUAL(uint64_t{ 0 }, transport.Stats(server.Endpoint()).retries);
+    }
+
+    TEST_METHOD(ReceiveTimeout)
+    {
+        MockHttpServer server{ [](std::string_view, std::string_view) {
+            std::this_thread::sleep_for(std::chrono::milliseconds{ 500 });
+            return MockHttpServer::Response("200 OK", "too late");
+        } };
+
+        auto options = fastRetries();
+        options.receiveTimeout = std::chrono::milliseconds{ 100 };
+        options.maxRetries = 0;
+        HttpTransport transport{ options };
+
+        VERIFY_THROWS(transport.Send(server.Endpoint(), { L"GET", L"/" }), wil::ResultException);
+        VERIFY_ARE_EQUAL(uint64_t{ 1 }, transport.Stats(server.Endpoint()).failures);
+    }
+
+    TEST_METHOD(GzipResponse)
+    {
+        static constexpr char compressed[] = "\x1f\x8b\x08\x00\x00\x00\x00\x00\x02\x03\x0b\xc9\x48\x55\x28\x2c\xcd\x4c\xce\x56\x48\x2a\xca\x2f\xcf\x53\x48\xcb\xaf\x50\xc8\x2a\xcd\x2d\x28\x56\xc8\x2f\x4b\x2d\x52\x28\x01\x4a\xe7\x24\x56\x55\x2a\xa4\xe4\xa7\x03\x00\x39\xa3\x4f\x41\x2b\x00\x00\x00";
+
+        std::string requestHead;
+        MockHttpServer server{ [&](std::string_view head, std::string_view) {
+            requestHead = head;
+            return MockHttpServer::Response("200 OK", { compressed, sizeof(compressed) - 1 }, "Content-Encoding: gzip\r\n");
+        } };
+        HttpTransport transport;
+
+        const auto response = transport.Send(server.Endpoint(), { L"GET", L"/" });
+        VERIFY_ARE_EQUAL(std::string{ "The quick brown fox jumps over the lazy dog" }, response.body);
+        VERIFY_IS_TRUE(requestHead.find("Accept-Encoding: gzip") != std::string::npos);
+    }
+
+    TEST_METHOD(StreamingProviderErrors)
+    {
+        std::string requestHead;
+        MockHttpServer server{ [&](std::string_view head, std::string_view) {
+            requestHead = head;
+            return MockHttpServer::Response("401 Unauthorized", "{\n  \"error\": {\n    \"message\": \"Invalid API key\"\n  }\n}\n");
+        } };
+
+        HttpStreamingProvider provider{ std::make_shared<HttpTransport>(), server.Endpoint(), L"/v1/chat/completions", L"secret" };
+        const auto result = StreamChatCompletion(provider, {}, [](std::wstring_view) { return true; });
+        VERIFY_ARE_EQUAL(std::wstring{ L"Invalid API key" }, result.error);
+        VERIFY_IS_TRUE(requestHead.find("Authorization: Bearer secret\r\n") != std::string::npos);
+    }
+
+    TEST_METHOD(RoundTripPerformance)
+    {
+        static constexpr auto requests = 500;
+        const std::string payload(4096, 'x');
+
+        MockHttpServer server{ [](std::string_view, std::string_view body) {
+            return MockHttpServer::Response("200 OK", body);
+        } };
+
+        const auto measure = [&](HttpTransport& transport, const wchar_t* name) {
+            const auto start = std::chrono::steady_clock::now();
+            for (auto i = 0; i < requests; i++)
+            {
+                VERIFY_ARE_EQUAL(200u, transport.Send(server.Endpoint(), { L"POST", L"/", {}, payload }).status);
+            }
+            const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            const auto stats = transport.Stats(server.Endpoint());
+            Log::Comment(NoThrowString().Format(
+                L"%s: %.0f requests/s, %.1f MB/s, %.1fus average latency",
+                name,
+                requests / seconds,
+                (stats.bytesSent + stats.bytesReceived) / seconds / 1e6,
+                static_cast<double>(stats.totalLatency.count()) / stats.requests));
+        };
+
+        HttpTransport pooled;
+        measure(pooled, L"pooled");
+        VERIFY_ARE_EQUAL(size_t(1), server.Connections());
+
+        Log::Comment(L"For comparison: a new session (and connection) per request");
+        const auto connectionsBefore = server.Connections();
+        const auto start = std::chrono::steady_clock::now();
+        for (auto i = 0; i < requests; i++)
+        {
+            HttpTransport transport;
+            VERIFY_ARE_EQUAL(200u, transport.Send(server.Endpoint(), { L"POST", L"/", {}, payload }).status);
+        }
+        const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        Log::Comment(NoThrowString().Format(L"unpooled: %.0f requests/s", requests / seconds));
+        VERIFY_ARE_EQUAL(size_t(requests), server.Connections() - connectionsBefore);
+    }
+};
@@ -0,0 +1,461 @@
+#include "pch.h"
+#include "ResponseCache.h"
+
+using namespace Microsoft::Terminal::AI;
+
+namespace
+{
+    // The log starts with a magic number and a version, followed by one record per stored response:
+    // its size (excluding the size itself), the key, the creation time, the latency and the UTF-8 text.
+    // Later records for the same key replace earlier ones. A record that was cut short by a crash
+    // ends the log and is dropped along with everything after it by a compaction.
+    constexpr uint32_t LogMagic = 0x43525457; // "WTRC"
+    constexpr uint32_t LogVersion = 1;
+    constexpr size_t LogHeaderSize = 2 * sizeof(uint32_t);
+    constexpr size_t RecordHeaderSize = sizeof(uint32_t) + sizeof(ResponseCacheKey) + 2 * sizeof(int64_t);
+    // Roughly what an entry costs besides its text: the list node, the index slot and the key.
+    constexpr size_t EntryOverhead = 128;
+
+    template<typename T>
+    void append(std::string& buffer, const T& value)
+    {
+        buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    template<typename T>
+    bool consume(std::string_view& rest, T& value) noexcept
+    {
+        if (rest.size() < sizeof(T))
+        {
+            return false;
+        }
+        memcpy(&value, rest.data(), sizeof(T));
+        rest.remove_prefix(sizeof(T));
+        return true;
+    }
+
+    std::string logHeader()
+    {
+        std::string buffer;
+        append(buffer, LogMagic);
+        append(buffer, LogVersion);
+        return buffer;
+    }
+
+    void appendRecord(std::string& buffer, const ResponseCacheKey& key, int64_t createdAt, std::chrono::microseconds latency, std::string_view response)
+    {
+        append(buffer, gsl::narrow<uint32_t>(RecordHeaderSize - sizeof(uint32_t) + response.size()));
+        append(buffer, key);
+        append(buffer, createdAt);
+        append(buffer, static_cast<int64_t>(latency.count()));
+        buffer.append(response);
+    }
+
+    void hashField(BCRYPT_HASH_HANDLE hash, std::wstring_view field)
+    {
+        // Each field is prefixed with its length, so that moving text from one field into the next changes the key.
+        auto length = gsl::narrow<uint32_t>(field.size());
+        THROW_IF_NTSTATUS_FAILED(BCryptHashData(hash, reinterpret_cast<PUCHAR>(&length), sizeof(length), 0));
+        // BCryptHashData is ill-specified in that it leaves off "const" qualification for pbInput
+        THROW_IF_NTSTATUS_FAILED(BCryptHashData(hash, reinterpret_cast<PUCHAR>(const_cast<wchar_t*>(field.data())), gsl::narrow<ULONG>(field.size() * sizeof(wchar_t)), 0));
+    }
+}
+
+ResponseCache::ResponseCache(std::filesystem::path logPath, ResponseCacheOptions options) :
+    _logPath{ std::move(logPath) },
+    _options{ options }
+{
+    if (!_logPath.empty())
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(_logPath.parent_path(), ec);
+        _load();
+    }
+}
+
+ResponseCacheKey ResponseCache::Key(const ResponseCacheRequest& request)
+{
+    const auto prompt = NormalizePrompt(request.prompt);
+
+    wil::unique_bcrypt_hash hash;
+    THROW_IF_NTSTATUS_FAILED(BCryptCreateHash(BCRYPT_SHA256_ALG_HANDLE, &hash, nullptr, 0, nullptr, 0, 0));
+    for (const auto field : { request.provider, request.model, request.systemMessage, std::wstring_view{ prompt }, request.toolSchema })
+    {
+        hashField(hash.get(), field);
+    }
+
+    ResponseCacheKey key;
+    THROW_IF_NTSTATUS_FAILED(BCryptFinishHash(hash.get(), key.data(), gsl::narrow<ULONG>(key.size()), 0));
+    return key;
+}
+
+std::wstring ResponseCache::NormalizePrompt(std::wstring_view prompt)
+{
+    std::wstring result;
+    result.reserve(prompt.size());
+
+    auto pendingSpace = false;
+    for (const auto ch : prompt)
+    {
+        if (ch == L' ' || ch == L'\t' || ch == L'\r' || ch == L'\n')
+        {
+            pendingSpace = !result.empty();
+            continue;
+        }
+        if (pendingSpace)
+        {
+            result.push_back(L' ');
+            pendingSpace = false;
+        }
+        result.push_back(ch);
+    }
+
+    return result;
+}
+
+std::wstring ResponseCache::GetOrFetch(const ResponseCacheRequest& request, const Fetch& fetch, ResponseCacheMode mode)
+{
+    if (mode == ResponseCacheMode::Bypass)
+    {
+        {
+            const std::lock_guard lock{ _lock };
+            _stats.bypassed++;
+        }
+        return fetch();
+    }
+
+    const auto key = Key(request);
+    const auto flight = std::make_shared<InFlight>();
+    {
+        std::unique_lock lock{ _lock };
+
+        for (;;)
+        {
+            if (mode == ResponseCacheMode::Use)
+            {
+                if (auto response = _lookup(key, _now()))
+                {
+                    return std::move(*response);
+                }
+            }
+
+            const auto it = _inFlight.find(key);
+            if (it == _inFlight.end())
+            {
+                break;
+            }
+
+            // An identical request is in flight. Its response is as fresh as the one we'd get, even for a refresh.
+            const auto other = it->second;
+            _inFlightDone.wait(lock, [&]() { return other->done; });
+            if (!other->failed)
+            {
+                _stats.coalesced++;
+                _stats.savedLatency += other->latency;
+                return other->response;
+            }
+        }
+
+        if (mode == ResponseCacheMode::Use)
+        {
+            _stats.misses++;
+        }
+        else
+        {
+            _stats.bypassed++;
+        }
+        _inFlight.emplace(key, flight);
+    }
+
+    const auto complete = [&]() {
+        flight->done = true;
+        _inFlight.erase(key);
+    };
+
+    std::wstring response;
+    const auto start = std::chrono::steady_clock::now();
+    try
+    {
+        response = fetch();
+    }
+    catch (...)
+    {
+        {
+            const std::lock_guard lock{ _lock };
+            flight->failed = true;
+            complete();
+        }
+        _inFlightDone.notify_all();
+        throw;
+    }
+    const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    {
+        const std::lock_guard lock{ _lock };
+        flight->response = response;
+        flight->latency = latency;
+        complete();
+        try
+        {
+            _store(key, response, latency);
+        }
+        CATCH_LOG();
+    }
+    _inFlightDone.notify_all();
+
+    return response;
+}
+
+std::optional<std::wstring> ResponseCache::Lookup(const ResponseCacheKey& key)
+{
+    const std::lock_guard lock{ _lock };
+    auto response = _lookup(key, _now());
+    if (!response)
+    {
+        _stats.misses++;
+    }
+    return response;
+}
+
+void ResponseCache::Store(const ResponseCacheKey& key, std::wstring_view response, std::chrono::microseconds latency)
+{
+    const std::lock_guard lock{ _lock };
+    _store(key, response, latency);
+}
+
+void ResponseCache::Clear()
+{
+    const std::lock_guard lock{ _lock };
+
+    _entries.clear();
+    _index.clear();
+    _memoryBytes = 0;
+    _liveLogBytes = 0;
+    if (!_logPath.empty())
+    {
+        _compact();
+    }
+}
+
+size_t ResponseCache::Size() const
+{
+    const std::lock_guard lock{ _lock };
+    return _entries.size();
+}
+
+ResponseCacheStats ResponseCache::Stats() const
+{
+    const std::lock_guard lock{ _lock };
+    return _stats;
+}
+
+int64_t ResponseCache::_now() noexcept
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+bool ResponseCache::_expired(const Entry& entry, int64_t now) const noexcept
+{
+    return now - entry.createdAt > std::chrono::duration_cast<std::chrono::microseconds>(_options.timeToLive).count();
+}
+
+std::optional<std::wstring> ResponseCache::_lookup(const ResponseCacheKey& key, int64_t now)
+{
+    const auto it = _index.find(key);
+    if (it == _index.end())
+    {
+        return std::nullopt;
+    }
+
+    const auto entry = it->second;
+    if (_expired(*entry, now))
+    {
+        _erase(entry);
+        return std::nullopt;
+    }
+
+    _entries.splice(_entries.begin(), _entries, entry);
+    _stats.hits++;
+    _stats.savedLatency += entry->latency;
+    return entry->response;
+}
+
+void ResponseCache::_store(const ResponseCacheKey& key, std::wstring_view response, std::chrono::microseconds latency)
+{
+    const auto text = til::u16u8(response);
+
+    Entry entry{ key, std::wstring{ response }, _now(), latency, RecordHeaderSize + text.size() };
+
+    if (_log)
+    {
+        std::string record;
+        appendRecord(record, entry.key, entry.createdAt, entry.latency, text);
+        _append(record);
+    }
+
+    _insert(std::move(entry));
+    _evict();
+    _compactIfNeeded();
+}
+
+void ResponseCache::_insert(Entry&& entry)
+{
+    if (const auto it = _index.find(entry.key); it != _index.end())
+    {
+        _erase(it->second);
+    }
+
+    _memoryBytes += entry.response.size() * sizeof(wchar_t) + EntryOverhead;
+    _liveLogBytes += entry.recordBytes;
+    _entries.emplace_front(std::move(entry));
+    _index.emplace(_entries.front().key, _entries.begin());
+}
+
+void ResponseCache::_erase(EntryList::iterator it) noexcept
+{
+    _memoryBytes -= it->response.size() * sizeof(wchar_t) + EntryOverhead;
+    _liveLogBytes -= it->recordBytes;
+    _index.erase(it->key);
+    _entries.erase(it);
+}
+
+void ResponseCache::_evict() noexcept
+{
+    while (_memoryBytes > _options.maxMemoryBytes && !_entries.empty())
+    {
+        _erase(std::prev(_entries.end()));
+        _stats.evictions++;
+    }
+}
+
+void ResponseCache::_append(std::string_view records)
+{
+    DWORD written = 0;
+    if (!WriteFile(_log.get(), records.data(), gsl::narrow<DWORD>(records.size()), &written, nullptr) || written != records.size())
+    {
+        LOG_LAST_ERROR();
+        // Stop persisting. Whatever was written of the record is dropped when the log is loaded next time.
+        _log.reset();
+        return;
+    }
+    _logBytes += records.size();
+}
+
+void ResponseCache::_compactIfNeeded()
+{
+    if (_log && _logBytes > std::max(_options.compactionMinimumBytes, _liveLogBytes * _options.compactionRatio))
+    {
+        _compact();
+    }
+}
+
+// Rewrites the log with only the entries that are still cached, least recently used first,
+// so that loading it restores the order of the LRU.
+void ResponseCache::_compact()
+{
+    _log.reset();
+
+    const auto now = _now();
+    for (auto it = _entries.begin(); it != _entries.end();)
+    {
+        const auto current = it++;
+        if (_expired(*current, now))
+        {
+            _erase(current);
+        }
+    }
+
+    auto buffer = logHeader();
+    buffer.reserve(LogHeaderSize + _liveLogBytes);
+    for (auto it = _entries.rbegin(); it != _entries.rend(); ++it)
+    {
+        appendRecord(buffer, it->key, it->createdAt, it->latency, til::u16u8(it->response));
+    }
+
+    try
+    {
+        til::io::write_utf8_string_to_file_atomic(_logPath, buffer);
+    }
+    catch (...)
+    {
+        LOG_CAUGHT_EXCEPTION();
+        return;
+    }
+
+    _openLog();
+}
+
+void ResponseCache::_load()
+{
+    std::string content;
+    try
+    {
+        content = til::io::read_file_as_utf8_string_if_exists(_logPath);
+    }
+    CATCH_LOG();
+
+    std::string_view rest{ content };
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    auto valid = consume(rest, magic) && magic == LogMagic && consume(rest, version) && version == LogVersion;
+
+    const auto now = _now();
+    while (valid && !rest.empty())
+    {
+        uint32_t size = 0;
+        Entry entry;
+        int64_t latency = 0;
+        if (!consume(rest, size) || size < RecordHeaderSize - sizeof(uint32_t) || size > rest.size() ||
+            !consume(rest, entry.key) || !consume(rest, entry.createdAt) || !consume(rest, latency))
+        {
+            valid = false;
+            break;
+        }
+
+        const auto textSize = size - (RecordHeaderSize - sizeof(uint32_t));
+        const auto text = rest.substr(0, textSize);
+        rest.remove_prefix(textSize);
+
+        if (_expired(entry, now))
+        {
+            continue;
+        }
+        entry.latency = std::chrono::microseconds{ latency };
+        entry.recordBytes = RecordHeaderSize + textSize;
+        entry.response = til::u8u16(text);
+        _insert(std::move(entry));
+    }
+
+    _evict();
+    _stats = {};
+
+    // A new or unreadable log is replaced, and so is one that's mostly garbage.
+    // The latter also drops the record that a crash may have left half written.
+    if (!valid || content.size() > std::max(_options.compactionMinimumBytes, _liveLogBytes * _options.compactionRatio))
+    {
+        _compact();
+    }
+    else
+    {
+        _openLog();
+    }
+}
+
+void ResponseCache::_openLog()
+{
+    _log.reset(CreateFileW(_logPath.c_str(), FILE_APPEND_DATA, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+    if (!_log)
+    {
+        LOG_LAST_ERROR();
+        return;
+    }
+
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(_log.get(), &size))
+    {
+        LOG_LAST_ERROR();
+        _log.reset();
+        return;
+    }
+    _logBytes = gsl::narrow_cast<size_t>(size.QuadPart);
+}
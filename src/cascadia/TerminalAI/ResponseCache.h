@@ -0,0 +1,142 @@
+#pragma once
+
+#include "pch.h"
+
+namespace Microsoft::Terminal::AI
+{
+    struct ResponseCacheOptions
+    {
+        // The least recently used responses are evicted once the cached ones take up more memory than this.
+        size_t maxMemoryBytes = 16 * 1024 * 1024;
+        // Responses older than this are neither returned nor kept when the log is compacted.
+        std::chrono::milliseconds timeToLive{ std::chrono::hours{ 24 } };
+        // The log is rewritten with only the live entries once it's this many times larger than
+        // they are, and larger than compactionMinimumBytes, which keeps appends amortized O(1).
+        size_t compactionRatio = 2;
+        size_t compactionMinimumBytes = 256 * 1024;
+    };
+
+    // Whatever determines a provider's response. Two requests that are equal after
+    // NormalizePrompt() are answered from the same cache entry.
+    struct ResponseCacheRequest
+    {
+        std::wstring_view provider;
+        std::wstring_view model;
+        std::wstring_view systemMessage;
+        std::wstring_view prompt;
+        std::wstring_view toolSchema;
+    };
+
+    enum class ResponseCacheMode
+    {
+        // Return the cached response if there is one, otherwise fetch and cache it.
+        Use,
+        // Fetch a new response and replace the cached one, for "ask again".
+        Refresh,
+        // Fetch a new response and leave the cache alone, for requests with side effects.
+        Bypass,
+    };
+
+    struct ResponseCacheStats
+    {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        // Requests that waited for an identical request that was already in flight.
+        uint64_t coalesced = 0;
+        uint64_t bypassed = 0;
+        uint64_t evictions = 0;
+        // The upstream latency of every response that was served from the cache
+        // or shared with a coalesced request, i.e. the time users didn't have to wait.
+        std::chrono::microseconds savedLatency{};
+    };
+
+    // The SHA-256 of a ResponseCacheRequest.
+    using ResponseCacheKey = std::array<uint8_t, 32>;
+
+    // Caches provider responses, so that repeating an identical request, like "explain this error"
+    // for the same error, doesn't make another round-trip. Responses are kept in a size-bounded LRU
+    // in memory and persisted to an append-only log, which is compacted when it grows too large.
+    // All methods are thread-safe.
+    class ResponseCache
+    {
+    public:
+        // Sends the request upstream and returns the response. Throws if that failed,
+        // in which case nothing is cached. Called on the thread that called GetOrFetch().
+        using Fetch = std::function<std::wstring()>;
+
+        // An empty `logPath` keeps the cache in memory only.
+        explicit ResponseCache(std::filesystem::path logPath, ResponseCacheOptions options = {});
+
+        ResponseCache(const ResponseCache&) = delete;
+        ResponseCache& operator=(const ResponseCache&) = delete;
+
+        static ResponseCacheKey Key(const ResponseCacheRequest& request);
+        // Trims the prompt and collapses each run of whitespace into a single space,
+        // so that differences in line endings or indentation don't cause a miss.
+        static std::wstring NormalizePrompt(std::wstring_view prompt);
+
+        // Returns the cached response to `request`, or calls `fetch` and caches the result.
+        // While a request is in flight, identical ones wait for its response instead of fetching their own.
+        // If the request they waited for fails, they fetch on their own.
+        std::wstring GetOrFetch(const ResponseCacheRequest& request, const Fetch& fetch, ResponseCacheMode mode = ResponseCacheMode::Use);
+
+        std::optional<std::wstring> Lookup(const ResponseCacheKey& key);
+        // `latency` is how long it took to fetch the response, which is what a later hit saves.
+        void Store(const ResponseCacheKey& key, std::wstring_view response, std::chrono::microseconds latency);
+        void Clear();
+
+        size_t Size() const;
+        ResponseCacheStats Stats() const;
+
+    private:
+        struct Entry
+        {
+            ResponseCacheKey key{};
+            std::wstring response;
+            // Microseconds since the Unix epoch, because entries outlive the process.
+            int64_t createdAt = 0;
+            std::chrono::microseconds latency{};
+            // The size of the entry's record in the log.
+            size_t recordBytes = 0;
+        };
+        // A fetch that identical requests can wait for.
+        struct InFlight
+        {
+            bool done = false;
+            bool failed = false;
+            std::wstring response;
+            std::chrono::microseconds latency{};
+        };
+        using EntryList = std::list<Entry>;
+
+        std::filesystem::path _logPath;
+        ResponseCacheOptions _options;
+
+        mutable std::mutex _lock;
+        std::condition_variable _inFlightDone;
+        // Most recently used first.
+        EntryList _entries;
+        til::flat_hash_map<ResponseCacheKey, EntryList::iterator> _index;
+        til::flat_hash_map<ResponseCacheKey, std::shared_ptr<InFlight>> _inFlight;
+        size_t _memoryBytes = 0;
+        // Null if the cache isn't persisted, or writing to the log failed.
+        wil::unique_hfile _log;
+        size_t _logBytes = 0;
+        // What the log would shrink to if it was compacted now.
+        size_t _liveLogBytes = 0;
+        ResponseCacheStats _stats;
+
+        static int64_t _now() noexcept;
+        bool _expired(const Entry& entry, int64_t now) const noexcept;
+        std::optional<std::wstring> _lookup(const ResponseCacheKey& key, int64_t now);
+        void _store(const ResponseCacheKey& key, std::wstring_view response, std::chrono::microseconds latency);
+        void _insert(Entry&& entry);
+        void _erase(EntryList::iterator it) noexcept;
+        void _evict() noexcept;
+        void _append(std::string_view records);
+        void _compactIfNeeded();
+        void _compact();
+        void _load();
+        void _openLog();
+    };
+}
@@ -0,0 +1,230 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include "ResponseCache.h"
+#include "TestUtilities.h"
+
+#include <fstream>
+#include <thread>
+
+using namespace Microsoft::Terminal::AI;
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace TerminalAIUnitTests;
+
+namespace
+{
+    std::filesystem::path logPath(const ScratchDirectory& directory)
+    {
+        return directory.Path() / L"cache" / L"responses.log";
+    }
+
+    ResponseCacheRequest request(std::wstring_view prompt)
+    {
+        return { L"openai", L"gpt-4", L"You are a helpful assistant.", prompt, {} };
+    }
+
+    // Answers with the prompt and counts how often it was called.
+    struct CountingProvider : CallCounter
+    {
+        std::chrono::milliseconds delay{};
+
+        ResponseCache::Fetch Fetch(std::wstring_view prompt)
+        {
+            return Count([this, answer = L"answer to " + std::wstring{ prompt }]() {
+                std::this_thread::sleep_for(delay);
+                return answer;
+            });
+        }
+    };
+}
+
+class ResponseCacheTests
+{
+    TEST_CLASS(ResponseCacheTests);
+
+    TEST_METHOD(KeysIgnoreWhitespace)
+    {
+        VERIFY_ARE_EQUAL(std::wstring{ L"explain this error: exit 1" }, ResponseCache::NormalizePrompt(L"  explain this\terror:\r\n   exit 1 \n"));
+
+        const auto key = ResponseCache::Key(request(L"explain this error"));
+        VERIFY_IS_TRUE(key == ResponseCache::Key(request(L"explain  this\r\nerror ")));
+        VERIFY_IS_FALSE(key == ResponseCache::Key(request(L"Explain this error")));
+
+        auto other = request(L"explain this error");
+        other.model = L"gpt-4o";
+        VERIFY_IS_FALSE(key == ResponseCache::Key(other));
+        other = request(L"explain this error");
+        other.toolSchema = L"[]";
+        VERIFY_IS_FALSE(key == ResponseCache::Key(other));
+
+        Log::Comment(L"Text moved from one field into another changes the key");
+        const ResponseCacheRequest a{ L"openai", L"gpt-4", L"ab", L"c", {} };
+        const ResponseCacheRequest b{ L"openai", L"gpt-4", L"a", L"bc", {} };
+        VERIFY_IS_FALSE(ResponseCache::Key(a) == ResponseCache::Key(b));
+    }
+
+    TEST_METHOD(RepeatedRequestsAreServedFromTheCache)
+    {
+        ResponseCache cache{ {} };
+        CountingProvider provider;
+        provider.delay = std::chrono::milliseconds{ 20 };
+
+        VERIFY_ARE_EQUAL(std::wstring{ L"answer to ls" }, cache.GetOrFetch(request(L"ls"), provider.Fetch(L"ls")));
+        VERIFY_ARE_EQUAL(std::wstring{ L"answer to ls" }, cache.GetOrFetch(request(L" ls\n"), provider.Fetch(L"ls")));
+        VERIFY_ARE_EQUAL(size_t(1), provider.calls.load());
+
+        auto stats = cache.Stats();
+        VERIFY_ARE_EQUAL(1ull, stats.hits);
+        VERIFY_ARE_EQUAL(1ull, stats.misses);
+        VERIFY_IS_GREATER_THAN_OR_EQUAL(stats.savedLatency, std::chrono::microseconds{ std::chrono::milliseconds{ 20 } });
+
+        Log::Comment(L"A refresh fetches a new response and caches it");
+        provider.delay = {};
+        VERIFY_ARE_EQUAL(std::wstring{ L"new" }, cache.GetOrFetch(request(L"ls"), [] { return std::wstring{ L"new" }; }, ResponseCacheMode::Refresh));
+        VERIFY_ARE_EQUAL(std::wstring{ L"new" }, cache.GetOrFetch(request(L"ls"), provider.Fetch(L"ls")));
+
+        Log::Comment(L"A bypass leaves the cache alone");
+        VERIFY_ARE_EQUAL(std::wstring{ L"answer to ls" }, cache.GetOrFetch(request(L"ls"), provider.Fetch(L"ls"), ResponseCacheMode::Bypass));
+        VERIFY_ARE_EQUAL(std::wstring{ L"new" }, *cache.Lookup(ResponseCache::Key(request(L"ls"))));
+        VERIFY_ARE_EQUAL(2ull, cache.Stats().bypassed);
+
+        Log::Comment(L"Failed requests aren't cached");
+        VERIFY_THROWS(cache.GetOrFetch(request(L"pwd"), []() -> std::wstring { throw std::runtime_error{ "offline" }; }), std::runtime_error);
+        VERIFY_IS_FALSE(cache.Lookup(ResponseCache::Key(request(L"pwd"))).has_value());
+    }
+
+    TEST_METHOD(EntriesExpireAndAreEvicted)
+    {
+        ResponseCacheOptions options;
+        options.timeToLive = std::chrono::milliseconds{ 50 };
+        ResponseCache expiring{ {}, options };
+        const auto key = ResponseCache::Key(request(L"ls"));
+        expiring.Store(key, L"answer", {});
+        VERIFY_IS_TRUE(expiring.Lookup(key).has_value());
+        std::this_thread::sleep_for(std::chrono::milliseconds{ 100 });
+        VERIFY_IS_FALSE(expiring.Lookup(key).has_value());
+
+        Log::Comment(L"The least recently used entry is evicted first");
+        options = {};
+        // Room for three of the responses below, but not four.
+        options.maxMemoryBytes = 3 * (1000 * sizeof(wchar_t) + 128);
+        ResponseCache cache{ {}, options };
+        const std::wstring response(1000, L'x');
+        std::vector<ResponseCacheKey> keys;
+        for (auto i = 0; i < 4; ++i)
+        {
+            keys.emplace_back(ResponseCache::Key(request(std::to_wstring(i))));
+        }
+
+        cache.Store(keys[0], response, {});
+        cache.Store(keys[1], response, {});
+        cache.Store(keys[2], response, {});
+        VERIFY_IS_TRUE(cache.Lookup(keys[0]).has_value());
+        cache.Store(keys[3], response, {});
+
+        VERIFY_ARE_EQUAL(size_t(3), cache.Size());
+        VERIFY_ARE_EQUAL(1ull, cache.Stats().evictions);
+        VERIFY_IS_FALSE(cache.Lookup(keys[1]).has_value());
+        VERIFY_IS_TRUE(cache.Lookup(keys[0]).has_value());
+        VERIFY_IS_TRUE(cache.Lookup(keys[3]).has_value());
+    }
+
+    TEST_METHOD(ConcurrentRequestsAreCoalesced)
+    {
+        static constexpr size_t threadCount = 8;
+
+        ResponseCache cache{ {} };
+        CountingProvider provider;
+        provider.delay = std::chrono::milliseconds{ 200 };
+
+        std::vector<std::wstring> responses(threadCount);
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < threadCount; ++i)
+        {
+            threads.emplace_back([&, i]() {
+                responses[i] = cache.GetOrFetch(request(L"git status"), provider.Fetch(L"git status"));
+            });
+        }
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        VERIFY_ARE_EQUAL(size_t(1), provider.calls.load());
+        for (const auto& response : responses)
+        {
+            VERIFY_ARE_EQUAL(std::wstring{ L"answer to git status" }, response);
+        }
+        const auto stats = cache.Stats();
+        VERIFY_ARE_EQUAL(1ull, stats.misses);
+        VERIFY_ARE_EQUAL(uint64_t{ threadCount - 1 }, stats.hits + stats.coalesced);
+        Log::Comment(NoThrowString().Format(L"%llu coalesced, %llu hits, %lldms saved", stats.coalesced, stats.hits, static_cast<long long>(stats.savedLatency.count() / 1000)));
+
+        Log::Comment(L"Requests waiting for one that fails fetch on their own");
+        std::atomic<size_t> calls{ 0 };
+        const auto flaky = [&]() -> std::wstring {
+            if (++calls == 1)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds{ 100 });
+                throw std::runtime_error{ "timeout" };
+            }
+            return L"recovered";
+        };
+        std::thread first{ [&]() { VERIFY_THROWS(cache.GetOrFetch(request(L"pwd"), flaky), std::runtime_error); } };
+        std::this_thread::sleep_for(std::chrono::milliseconds{ 20 });
+        VERIFY_ARE_EQUAL(std::wstring{ L"recovered" }, cache.GetOrFetch(request(L"pwd"), flaky));
+        first.join();
+        VERIFY_ARE_EQUAL(size_t(2), calls.load());
+    }
+
+    TEST_METHOD(ResponsesArePersisted)
+    {
+        ScratchDirectory directory{ L"ResponseCacheTests" };
+        const auto key = ResponseCache::Key(request(L"ls"));
+        const auto other = ResponseCache::Key(request(L"pwd"));
+
+        {
+            ResponseCache cache{ logPath(directory) };
+            cache.Store(key, L"ünïcode answer", std::chrono::milliseconds{ 700 });
+            cache.Store(other, L"other answer", {});
+        }
+
+        {
+            ResponseCache cache{ logPath(directory) };
+            VERIFY_ARE_EQUAL(size_t(2), cache.Size());
+            VERIFY_ARE_EQUAL(std::wstring{ L"ünïcode answer" }, *cache.Lookup(key));
+            VERIFY_ARE_EQUAL(std::chrono::microseconds{ std::chrono::milliseconds{ 700 } }, cache.Stats().savedLatency);
+        }
+
+        Log::Comment(L"A record cut short by a crash is dropped");
+        const auto content = til::io::read_file_as_utf8_string_if_exists(logPath(directory));
+        std::ofstream{ logPath(directory), std::ios::binary }.write(content.data(), content.size() - 3);
+        {
+            ResponseCache cache{ logPath(directory) };
+            VERIFY_ARE_EQUAL(size_t(1), cache.Size());
+            VERIFY_IS_TRUE(cache.Lookup(key).has_value());
+            cache.Store(other, L"stored after the crash", {});
+        }
+        VERIFY_ARE_EQUAL(std::wstring{ L"stored after the crash" }, *ResponseCache{ logPath(directory) }.Lookup(other));
+
+        Log::Comment(L"Replaced responses are compacted away");
+        ResponseCacheOptions options;
+        options.compactionMinimumBytes = 4096;
+        {
+            ResponseCache cache{ logPath(directory), options };
+            for (auto i = 0; i < 1000; ++i)
+            {
+                cache.Store(key, L"answer " + std::to_wstring(i), {});
+            }
+            VERIFY_IS_LESS_THAN(std::filesystem::file_size(logPath(directory)), std::uintmax_t{ 2 * 4096 });
+        }
+        ResponseCache cache{ logPath(directory), options };
+        VERIFY_ARE_EQUAL(size_t(2), cache.Size());
+        VERIFY_ARE_EQUAL(std::wstring{ L"answer 999" }, *cache.Lookup(key));
+
+        cache.Clear();
+        VERIFY_ARE_EQUAL(size_t(0), ResponseCache{ logPath(directory) }.Size());
+    }
+};
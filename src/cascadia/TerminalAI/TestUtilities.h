@@ -0,0 +1,76 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+// Helpers shared by the TerminalAI tests.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+
+namespace TerminalAIUnitTests
+{
+    using clock = std::chrono::steady_clock;
+
+    inline double millisecondsSince(clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(clock::now() - start).count();
+    }
+
+    // A scratch directory in %TEMP% that's deleted along with the object.
+    // `name` should be unique to the test class, so that test runs don't collide.
+    class ScratchDirectory
+    {
+    public:
+        explicit ScratchDirectory(std::wstring_view name) :
+            _path{ std::filesystem::temp_directory_path() / (std::wstring{ name } + L"-" + std::to_wstring(GetCurrentProcessId())) }
+        {
+            std::error_code ec;
+            std::filesystem::remove_all(_path, ec);
+            std::filesystem::create_directories(_path);
+        }
+
+        ~ScratchDirectory()
+        {
+            std::error_code ec;
+            std::filesystem::remove_all(_path, ec);
+        }
+
+        ScratchDirectory(const ScratchDirectory&) = delete;
+        ScratchDirectory& operator=(const ScratchDirectory&) = delete;
+
+        const std::filesystem::path& Path() const noexcept
+        {
+            return _path;
+        }
+
+        // Writes `content` to the file `name` in the directory and returns its path.
+        std::filesystem::path Write(std::wstring_view name, std::string_view content) const
+        {
+            const auto path = _path / name;
+            std::ofstream file{ path, std::ios::binary };
+            file.write(content.data(), content.size());
+            return path;
+        }
+
+    private:
+        std::filesystem::path _path;
+    };
+
+    // Wraps callbacks, like the parser of a DefinitionCache or the fetch of a ResponseCache,
+    // and counts how often they're called, so that a test can tell whether a cache was hit.
+    struct CallCounter
+    {
+        std::atomic<size_t> calls{ 0 };
+
+        template<typename Callback>
+        auto Count(Callback callback)
+        {
+            return [this, callback = std::move(callback)](auto&&... args) {
+                ++calls;
+                return callback(std::forward<decltype(args)>(args)...);
+            };
+        }
+    };
+}
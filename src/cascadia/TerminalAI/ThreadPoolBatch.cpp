@@ -0,0 +1,60 @@
+#include "pch.h"
+#include "ThreadPoolBatch.h"
+
+#include <til/latch.h>
+
+namespace
+{
+    // The participating threads take turns picking the next index off the batch until none are left.
+    struct Batch
+    {
+        const std::function<void(size_t)>& work;
+        size_t count;
+        std::atomic<size_t> next{ 0 };
+        til::latch helpers;
+
+        void Run() noexcept
+        {
+            for (auto i = next.fetch_add(1); i < count; i = next.fetch_add(1))
+            {
+                try
+                {
+                    work(i);
+                }
+                CATCH_LOG();
+            }
+        }
+    };
+}
+
+void Microsoft::Terminal::AI::RunOnThreadPool(size_t count, const std::function<void(size_t)>& work)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    const auto helpers = gsl::narrow_cast<ptrdiff_t>(count - 1);
+    Batch batch{ work, count, {}, til::latch{ helpers } };
+    for (ptrdiff_t i = 0; i < helpers; ++i)
+    {
+        const auto submitted = TrySubmitThreadpoolCallback(
+            [](PTP_CALLBACK_INSTANCE, PVOID context) noexcept {
+                const auto batch = static_cast<Batch*>(context);
+                batch->Run();
+                batch->helpers.count_down();
+            },
+            &batch,
+            nullptr);
+        if (!submitted)
+        {
+            // The remaining indices are picked up by the threads that did start.
+            LOG_LAST_ERROR();
+            batch.helpers.count_down(helpers - i);
+            break;
+        }
+    }
+
+    batch.Run();
+    batch.helpers.wait();
+}
\ No newline at end of file
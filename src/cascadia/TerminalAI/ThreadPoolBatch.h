@@ -0,0 +1,11 @@
+#pragma once
+
+#include "pch.h"
+
+namespace Microsoft::Terminal::AI
+{
+    // Calls `work(i)` once for each i in [0, count), spread over the calling thread and up
+    // to count - 1 thread pool threads, and returns once all calls have finished.
+    // Exceptions escaping `work` are logged and otherwise ignored.
+    void RunOnThreadPool(size_t count, const std::function<void(size_t)>& work);
+}
\ No newline at end of file
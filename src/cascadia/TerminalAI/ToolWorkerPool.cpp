@@ -0,0 +1,388 @@
+#include "pch.h"
+#include "ToolWorkerPool.h"
+
+#include <random>
+
+namespace Microsoft::Terminal::AI
+{
+    namespace
+    {
+        struct ToolProcess
+        {
+            wil::unique_handle job;
+            wil::unique_process_information process;
+            wil::unique_hfile input;
+            wil::unique_hfile output;
+        };
+
+        // Spawns `commandLine` inside a new job object, with pipes for stdin and stdout/stderr.
+        ToolProcess spawnToolProcess(std::wstring commandLine, const ToolWorkerOptions& options)
+        {
+            ToolProcess tool;
+            tool.job.reset(CreateJobObjectW(nullptr, nullptr));
+            THROW_LAST_ERROR_IF(!tool.job);
+
+            JOBOBJECT_EXTENDED_LIMIT_INFORMATION limits{};
+            limits.BasicLimitInformation.LimitFlags = JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE | JOB_OBJECT_LIMIT_DIE_ON_UNHANDLED_EXCEPTION | JOB_OBJECT_LIMIT_JOB_MEMORY;
+            limits.JobMemoryLimit = options.memoryLimitBytes;
+            THROW_IF_WIN32_BOOL_FALSE(SetInformationJobObject(tool.job.get(), JobObjectExtendedLimitInformation, &limits, sizeof(limits)));
+
+            JOBOBJECT_BASIC_UI_RESTRICTIONS restrictions{};
+            restrictions.UIRestrictionsClass = JOB_OBJECT_UILIMIT_DESKTOP | JOB_OBJECT_UILIMIT_DISPLAYSETTINGS | JOB_OBJECT_UILIMIT_EXITWINDOWS |
+                                               JOB_OBJECT_UILIMIT_GLOBALATOMS | JOB_OBJECT_UILIMIT_HANDLES | JOB_OBJECT_UILIMIT_READCLIPBOARD |
+                                               JOB_OBJECT_UILIMIT_SYSTEMPARAMETERS | JOB_OBJECT_UILIMIT_WRITECLIPBOARD;
+            THROW_IF_WIN32_BOOL_FALSE(SetInformationJobObject(tool.job.get(), JobObjectBasicUIRestrictions, &restrictions, sizeof(restrictions)));
+
+            wil::unique_hfile inputRead;
+            wil::unique_hfile outputWrite;
+            THROW_IF_WIN32_BOOL_FALSE(CreatePipe(inputRead.addressof(), tool.input.addressof(), nullptr, 0));
+            THROW_IF_WIN32_BOOL_FALSE(CreatePipe(tool.output.addressof(), outputWrite.addressof(), nullptr, 64 * 1024));
+            THROW_IF_WIN32_BOOL_FALSE(SetHandleInformation(inputRead.get(), HANDLE_FLAG_INHERIT, HANDLE_FLAG_INHERIT));
+            THROW_IF_WIN32_BOOL_FALSE(SetHandleInformation(outputWrite.get(), HANDLE_FLAG_INHERIT, HANDLE_FLAG_INHERIT));
+
+            // The handle list makes sure that workers spawned concurrently
+            // don't inherit each other's pipes, which would keep them open.
+            SIZE_T attributeListSize = 0;
+            InitializeProcThreadAttributeList(nullptr, 2, 0, &attributeListSize);
+            const auto attributeListBuffer = std::make_unique<std::byte[]>(attributeListSize);
+            const auto attributeList = reinterpret_cast<LPPROC_THREAD_ATTRIBUTE_LIST>(attributeListBuffer.get());
+            THROW_IF_WIN32_BOOL_FALSE(InitializeProcThreadAttributeList(attributeList, 2, 0, &attributeListSize));
+            const auto cleanup = wil::scope_exit([&]() noexcept {
+                DeleteProcThreadAttributeList(attributeList);
+            });
+
+            HANDLE inheritedHandles[]{ inputRead.get(), outputWrite.get() };
+            THROW_IF_WIN32_BOOL_FALSE(UpdateProcThreadAttribute(attributeList, 0, PROC_THREAD_ATTRIBUTE_HANDLE_LIST, &inheritedHandles[0], sizeof(inheritedHandles), nullptr, nullptr));
+            // Assigning the job at creation means the interpreter can't spawn anything outside of it.
+            HANDLE jobs[]{ tool.job.get() };
+            THROW_IF_WIN32_BOOL_FALSE(UpdateProcThreadAttribute(attributeList, 0, PROC_THREAD_ATTRIBUTE_JOB_LIST, &jobs[0], sizeof(jobs), nullptr, nullptr));
+
+            STARTUPINFOEXW startupInfo{};
+            startupInfo.StartupInfo.cb = sizeof(startupInfo);
+            startupInfo.StartupInfo.dwFlags = STARTF_USESTDHANDLES;
+            startupInfo.StartupInfo.hStdInput = inputRead.get();
+            startupInfo.StartupInfo.hStdOutput = outputWrite.get();
+            startupInfo.StartupInfo.hStdError = outputWrite.get();
+            startupInfo.lpAttributeList = attributeList;
+
+            THROW_IF_WIN32_BOOL_FALSE(CreateProcessW(nullptr, commandLine.data(), nullptr, nullptr, TRUE, CREATE_NO_WINDOW | EXTENDED_STARTUPINFO_PRESENT, nullptr, nullptr, &startupInfo.StartupInfo, tool.process.addressof()));
+            return tool;
+        }
+
+        // Reads `output` until `onData` returns true or the pipe is closed.
+        // If `timeout` elapses first, the job is terminated, which closes the pipe and
+        // unblocks ReadFile(). Returns true in that case, even if the output was complete
+        // by then, since the process is gone either way.
+        bool pumpOutput(const ToolProcess& tool, std::chrono::milliseconds timeout, const std::function<bool(std::string_view)>& onData)
+        {
+            struct Watchdog
+            {
+                HANDLE job;
+                // Set by whoever comes first: the timer, which then terminates
+                // the job, or the reader once it's done, which cancels the timer.
+                std::atomic<bool> settled{ false };
+            } watchdog{ tool.job.get() };
+
+            const wil::unique_threadpool_timer timer{ CreateThreadpoolTimer(
+                [](PTP_CALLBACK_INSTANCE, PVOID context, PTP_TIMER) noexcept {
+                    const auto watchdog = static_cast<Watchdog*>(context);
+                    if (!watchdog->settled.exchange(true))
+                    {
+                        LOG_IF_WIN32_BOOL_FALSE(TerminateJobObject(watchdog->job, ERROR_TIMEOUT));
+                    }
+                },
+                &watchdog,
+                nullptr) };
+            THROW_LAST_ERROR_IF(!timer);
+
+            // Relative due times are negative, in 100ns units.
+            const auto dueTime = -std::chrono::duration_cast<std::chrono::duration<int64_t, std::ratio<1, 10000000>>>(timeout).count();
+            FILETIME dueFileTime;
+            memcpy(&dueFileTime, &dueTime, sizeof(dueTime));
+            SetThreadpoolTimer(timer.get(), &dueFileTime, 0, 0);
+
+            std::array<char, 16 * 1024> buffer;
+            for (;;)
+            {
+                DWORD read = 0;
+                if (!ReadFile(tool.output.get(), buffer.data(), gsl::narrow_cast<DWORD>(buffer.size()), &read, nullptr) || read == 0)
+                {
+                    break;
+                }
+                if (onData({ buffer.data(), read }))
+                {
+                    break;
+                }
+            }
+
+            const auto fired = watchdog.settled.exchange(true);
+            SetThreadpoolTimer(timer.get(), nullptr, 0, 0);
+            WaitForThreadpoolTimerCallbacks(timer.get(), TRUE);
+            return fired;
+        }
+
+        std::string makeNonce()
+        {
+            static thread_local std::mt19937_64 random{ std::random_device{}() };
+            static constexpr char digits[] = "0123456789abcdef";
+
+            auto value = random();
+            std::string nonce(16, '0');
+            for (auto& ch : nonce)
+            {
+                ch = digits[value & 15];
+                value >>= 4;
+            }
+            return nonce;
+        }
+    }
+
+    class ToolWorkerPool::Worker
+    {
+    public:
+        explicit Worker(ToolRuntime runtime, const ToolWorkerOptions& options) :
+            _tool{ spawnToolProcess(WorkerCommandLine(runtime), options) }
+        {
+        }
+
+        // Returns nothing if the call couldn't be handed to the worker, in which case the tool didn't run.
+        std::optional<ToolResult> Invoke(std::wstring_view scriptPath, std::wstring_view arguments, const ToolWorkerOptions& options, const OutputCallback& onOutput)
+        {
+            ToolResult result;
+            _calls++;
+
+            const auto nonce = makeNonce();
+            const auto request = FormatToolInvocation(nonce, scriptPath, arguments);
+            DWORD written = 0;
+            if (!WriteFile(_tool.input.get(), request.data(), gsl::narrow<DWORD>(request.size()), &written, nullptr) || written != request.size())
+            {
+                LOG_LAST_ERROR();
+                _broken = true;
+                return std::nullopt;
+            }
+
+            const auto forward = [&](std::string_view output) {
+                result.output.append(output);
+                if (onOutput)
+                {
+                    onOutput(output);
+                }
+            };
+            ToolOutputReader reader{ nonce };
+            result.timedOut = pumpOutput(_tool, options.callTimeout, [&](std::string_view chunk) {
+                return reader.Feed(chunk, forward);
+            });
+
+            if (reader.Done())
+            {
+                // The watchdog may have fired right as the call finished. The result
+                // is complete, but the worker was terminated nonetheless.
+                _broken = result.timedOut;
+                result.exitCode = reader.ExitCode();
+                result.timedOut = false;
+            }
+            else
+            {
+                // The worker died (or was killed) in the middle of the call,
+                // for instance because the tool called exit() in-process.
+                _broken = true;
+                reader.Finish(forward);
+                DWORD exitCode = 0;
+                if (!result.timedOut && WaitForSingleObject(_tool.process.hProcess, 1000) == WAIT_OBJECT_0 && GetExitCodeProcess(_tool.process.hProcess, &exitCode))
+                {
+                    result.exitCode = gsl::narrow_cast<int>(exitCode);
+                }
+            }
+            return result;
+        }
+
+        bool Reusable(const ToolWorkerOptions& options) const noexcept
+        {
+            if (_broken || _calls >= options.maxCallsPerWorker)
+            {
+                return false;
+            }
+
+            JOBOBJECT_EXTENDED_LIMIT_INFORMATION info{};
+            if (!QueryInformationJobObject(_tool.job.get(), JobObjectExtendedLimitInformation, &info, sizeof(info), nullptr))
+            {
+                return false;
+            }
+            return info.PeakJobMemoryUsed <= options.recycleMemoryBytes;
+        }
+
+        // Workers can die while they're idle, for instance if a tool left a thread behind that exits the interpreter.
+        bool Alive() const noexcept
+        {
+            return WaitForSingleObject(_tool.process.hProcess, 0) == WAIT_TIMEOUT;
+        }
+
+    private:
+        ToolProcess _tool;
+        uint32_t _calls = 0;
+        bool _broken = false;
+    };
+
+    ToolWorkerPool::ToolWorkerPool(ToolWorkerOptions options) :
+        _options{ std::move(options) }
+    {
+    }
+
+    // Out of line, where Worker is a complete type.
+    ToolWorkerPool::~ToolWorkerPool() = default;
+
+    void ToolWorkerPool::Warm(ToolRuntime runtime, size_t count)
+    {
+        const auto target = std::min(count, _options.maxWorkersPerRuntime);
+        for (;;)
+        {
+            {
+                std::lock_guard lock{ _lock };
+                auto& pool = _runtimes.at(static_cast<size_t>(runtime));
+                if (pool.alive >= target)
+                {
+                    return;
+                }
+                pool.alive++;
+            }
+            _release(runtime, _spawn(runtime));
+        }
+    }
+
+    ToolResult ToolWorkerPool::Invoke(ToolRuntime runtime, std::wstring_view scriptPath, std::wstring_view arguments, const OutputCallback& onOutput)
+    {
+        _calls++;
+
+        // A worker can still die between being checked out and receiving the call.
+        // The tool didn't run then, so it's safe to try again once, on a fresh worker.
+        for (auto fresh : { false, true })
+        {
+            auto worker = _acquire(runtime, fresh);
+            const auto release = wil::scope_exit([&]() noexcept {
+                _release(runtime, std::move(worker));
+            });
+            if (auto result = worker->Invoke(scriptPath, arguments, _options, onOutput))
+            {
+                return std::move(*result);
+            }
+        }
+        return {};
+    }
+
+    ToolResult ToolWorkerPool::InvokeCold(ToolRuntime runtime, std::wstring_view scriptPath, std::wstring_view arguments, const OutputCallback& onOutput) const
+    {
+        auto tool = spawnToolProcess(ColdCommandLine(runtime, scriptPath, arguments), _options);
+        tool.input.reset();
+
+        ToolResult result;
+        result.timedOut = pumpOutput(tool, _options.callTimeout, [&](std::string_view chunk) {
+            result.output.append(chunk);
+            if (onOutput)
+            {
+                onOutput(chunk);
+            }
+            return false;
+        });
+
+        DWORD exitCode = 0;
+        if (!result.timedOut && WaitForSingleObject(tool.process.hProcess, INFINITE) == WAIT_OBJECT_0 && GetExitCodeProcess(tool.process.hProcess, &exitCode))
+        {
+            result.exitCode = gsl::narrow_cast<int>(exitCode);
+        }
+        return result;
+    }
+
+    ToolWorkerStats ToolWorkerPool::Stats() const noexcept
+    {
+        ToolWorkerStats stats;
+        stats.calls = _calls.load(std::memory_order_relaxed);
+        stats.spawned = _spawned.load(std::memory_order_relaxed);
+        stats.recycled = _recycled.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    // Returns an idle worker if there's one that's still alive, or spawns a new one.
+    // If `fresh` is true, the worker is always a new one.
+    std::unique_ptr<ToolWorkerPool::Worker> ToolWorkerPool::_acquire(ToolRuntime runtime, bool fresh)
+    {
+        std::unique_ptr<Worker> retired;
+        {
+            std::unique_lock lock{ _lock };
+            auto& pool = _runtimes.at(static_cast<size_t>(runtime));
+            for (;;)
+            {
+                if (!pool.idle.empty())
+                {
+                    auto worker = std::move(pool.idle.back());
+                    pool.idle.pop_back();
+                    if (!fresh && worker->Alive())
+                    {
+                        return worker;
+                    }
+                    // Its slot goes to the worker spawned below.
+                    retired = std::move(worker);
+                    break;
+                }
+                if (pool.alive < _options.maxWorkersPerRuntime)
+                {
+                    pool.alive++;
+                    break;
+                }
+                _available.wait(lock);
+            }
+        }
+
+        // Closing the job kills the worker, and spawning takes a while, so both happen outside of the lock.
+        if (retired)
+        {
+            retired.reset();
+            _recycled++;
+        }
+        return _spawn(runtime);
+    }
+
+    // Must only be called after reserving a slot by incrementing Runtime::alive.
+    std::unique_ptr<ToolWorkerPool::Worker> ToolWorkerPool::_spawn(ToolRuntime runtime)
+    {
+        try
+        {
+            auto worker = std::make_unique<Worker>(runtime, _options);
+            _spawned++;
+            return worker;
+        }
+        catch (...)
+        {
+            {
+                std::lock_guard lock{ _lock };
+                _runtimes.at(static_cast<size_t>(runtime)).alive--;
+            }
+            _available.notify_one();
+            throw;
+        }
+    }
+
+    void ToolWorkerPool::_release(ToolRuntime runtime, std::unique_ptr<Worker> worker) noexcept
+    {
+        const auto reusable = worker && worker->Reusable(_options);
+        if (!reusable)
+        {
+            // Closing the job kills the worker. Do that outside of the lock.
+            worker.reset();
+            _recycled++;
+        }
+
+        {
+            std::lock_guard lock{ _lock };
+            auto& pool = _runtimes[static_cast<size_t>(runtime)];
+            if (reusable)
+            {
+                pool.idle.emplace_back(std::move(worker));
+            }
+            else
+            {
+                pool.alive--;
+            }
+        }
+        _available.notify_one();
+    }
+}
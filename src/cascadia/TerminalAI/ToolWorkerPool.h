@@ -0,0 +1,92 @@
+#pragma once
+
+#include "pch.h"
+#include "ToolWorkerProtocol.h"
+
+namespace Microsoft::Terminal::AI
+{
+    struct ToolWorkerOptions
+    {
+        // Workers are spawned on demand (or ahead of time by Warm()), up to this many per runtime.
+        // Calls beyond that wait for a worker to become idle.
+        size_t maxWorkersPerRuntime = 4;
+
+        // Workers are replaced after this many calls, or once the peak committed memory of
+        // their job exceeds recycleMemoryBytes, so that state leaked by tools doesn't pile up.
+        uint32_t maxCallsPerWorker = 100;
+        size_t recycleMemoryBytes = 256 * 1024 * 1024;
+        // Hard limit enforced by the job object. Allocations beyond it fail.
+        size_t memoryLimitBytes = 1024 * 1024 * 1024;
+
+        // A call that takes longer is killed along with its worker.
+        std::chrono::milliseconds callTimeout{ 30000 };
+    };
+
+    struct ToolResult
+    {
+        // The UTF-8 stdout and stderr of the tool.
+        std::string output;
+        // -1 if the tool didn't run to completion.
+        int exitCode = -1;
+        bool timedOut = false;
+    };
+
+    struct ToolWorkerStats
+    {
+        uint64_t calls = 0;
+        uint64_t spawned = 0;
+        uint64_t recycled = 0;
+    };
+
+    // Keeps interpreter processes running between tool calls, so that an agent loop
+    // calling many small tools doesn't pay for interpreter startup every time.
+    // Each worker lives in its own job object, which kills it (and everything it spawned)
+    // when the worker is recycled, denies it access to the desktop and the clipboard,
+    // and caps its memory. Invoke() is thread-safe.
+    class ToolWorkerPool
+    {
+    public:
+        using OutputCallback = ToolOutputReader::OutputCallback;
+
+        explicit ToolWorkerPool(ToolWorkerOptions options = {});
+        ~ToolWorkerPool();
+
+        ToolWorkerPool(const ToolWorkerPool&) = delete;
+        ToolWorkerPool& operator=(const ToolWorkerPool&) = delete;
+
+        // Spawns workers until `count` (at most maxWorkersPerRuntime) of them exist for `runtime`.
+        void Warm(ToolRuntime runtime, size_t count);
+
+        // Runs the script in an idle worker and streams its output to `onOutput` as it arrives.
+        // The full output is returned as well.
+        ToolResult Invoke(ToolRuntime runtime, std::wstring_view scriptPath, std::wstring_view arguments, const OutputCallback& onOutput = nullptr);
+
+        // Runs the script in a fresh interpreter, the way tools ran before this pool existed.
+        // Used as the baseline by the benchmark, and for scripts that need a clean process.
+        ToolResult InvokeCold(ToolRuntime runtime, std::wstring_view scriptPath, std::wstring_view arguments, const OutputCallback& onOutput = nullptr) const;
+
+        ToolWorkerStats Stats() const noexcept;
+
+    private:
+        class Worker;
+
+        struct Runtime
+        {
+            std::vector<std::unique_ptr<Worker>> idle;
+            // Idle and busy workers.
+            size_t alive = 0;
+        };
+
+        ToolWorkerOptions _options;
+        std::mutex _lock;
+        std::condition_variable _available;
+        std::array<Runtime, ToolRuntimeCount> _runtimes;
+        std::atomic<uint64_t> _calls{ 0 };
+        std::atomic<uint64_t> _spawned{ 0 };
+        std::atomic<uint64_t> _recycled{ 0 };
+
+        std::unique_ptr<Worker> _acquire(ToolRuntime runtime, bool fresh);
+        std::unique_ptr<Worker> _spawn(ToolRuntime runtime);
+        void _release(ToolRuntime runtime, std::unique_ptr<Worker> worker) noexcept;
+    };
+}
@@ -0,0 +1,341 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "pch.h"
+#include "FunctionCallingEngine.h"
+#include "ToolWorkerPool.h"
+#include "TestUtilities.h"
+
+#include <chrono>
+#include <fstream>
+
+using namespace Microsoft::Terminal::AI;
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace TerminalAIUnitTests;
+
+namespace
+{
+    double percentile(std::vector<double> samples, double p)
+    {
+        std::sort(samples.begin(), samples.end());
+        const auto index = static_cast<size_t>(p * (samples.size() - 1) + 0.5);
+        return samples.at(index);
+    }
+
+    // The pool tests need a Python interpreter on the PATH.
+    bool pythonAvailable()
+    {
+        wchar_t path[MAX_PATH];
+        if (SearchPathW(nullptr, L"python.exe", nullptr, MAX_PATH, &path[0], nullptr) == 0)
+        {
+            Log::Comment(L"python.exe not found");
+            Log::Result(TestResults::Skipped);
+            return false;
+        }
+        return true;
+    }
+}
+
+class ToolWorkerPoolTests
+{
+    TEST_CLASS(ToolWorkerPoolTests);
+
+    TEST_METHOD(OutputReaderSplits)
+    {
+        static constexpr std::string_view output = "one\r\ntwo\n\nabc0123456789ab 1\nthree";
+        static constexpr std::string_view endings[]{ "\n0123456789abcdef 7\n", "\r\n0123456789abcdef 7\r\n" };
+
+        for (const auto ending : endings)
+        {
+            const auto stream = std::string{ output } + std::string{ ending };
+
+            Log::Comment(L"Every split position, and one byte at a time");
+            for (size_t step = 1; step <= stream.size(); step = step == 1 ? 2 : step + 1)
+            {
+                ToolOutputReader reader{ "0123456789abcdef" };
+                std::string received;
+                auto done = false;
+                for (size_t i = 0; i < stream.size(); i += step)
+                {
+                    VERIFY_IS_FALSE(done);
+                    done = reader.Feed(std::string_view{ stream }.substr(i, step), [&](std::string_view chunk) {
+                        VERIFY_IS_FALSE(chunk.empty());
+                        received.append(chunk);
+                    });
+                }
+
+                VERIFY_IS_TRUE(done);
+                VERIFY_IS_TRUE(reader.Done());
+                VERIFY_ARE_EQUAL(7, reader.ExitCode());
+                VERIFY_ARE_EQUAL(std::string{ output }, received);
+            }
+        }
+
+        Log::Comment(L"Only what could be the start of the marker is held back");
+        ToolOutputReader reader{ "0123456789abcdef" };
+        std::string received;
+        const auto append = [&](std::string_view chunk) { received.append(chunk); };
+        VERIFY_IS_FALSE(reader.Feed("first\r\n01", append));
+        VERIFY_ARE_EQUAL(std::string{ "first" }, received);
+        VERIFY_IS_FALSE(reader.Feed("x", append));
+        VERIFY_ARE_EQUAL(std::string{ "first\r\n01x" }, received);
+
+        Log::Comment(L"Held back output is flushed if the worker exits without a marker");
+        VERIFY_IS_FALSE(reader.Feed("\r", append));
+        reader.Finish(append);
+        VERIFY_ARE_EQUAL(std::string{ "first\r\n01x\r" }, received);
+        VERIFY_IS_FALSE(reader.Done());
+        VERIFY_ARE_EQUAL(-1, reader.ExitCode());
+    }
+
+    TEST_METHOD(InvocationFormat)
+    {
+        const auto line = FormatToolInvocation("00ff", L"C:\\tools\\t\u00e9st.py", L"{\"a\":\t\"b\"}\r\n");
+        VERIFY_ARE_EQUAL(std::string{ "00ff\tC:\\tools\\t\xc3\xa9st.py\t{\"a\": \"b\"}  \n" }, line);
+
+        VERIFY_IS_TRUE(RuntimeForScript(L"x.sh") == ToolRuntime::Bash);
+        VERIFY_IS_TRUE(RuntimeForScript(L"x.bash") == ToolRuntime::Bash);
+        VERIFY_IS_TRUE(RuntimeForScript(L"x.py") == ToolRuntime::Python);
+        VERIFY_IS_TRUE(RuntimeForScript(L"x.js") == ToolRuntime::JavaScript);
+        VERIFY_IS_FALSE(RuntimeForScript(L"x.exe").has_value());
+    }
+
+    TEST_METHOD(QuoteArguments)
+    {
+        VERIFY_ARE_EQUAL(std::wstring{ LR"(abc)" }, QuoteCommandLineArgument(LR"(abc)"));
+        VERIFY_ARE_EQUAL(std::wstring{ LR"("")" }, QuoteCommandLineArgument(L""));
+        VERIFY_ARE_EQUAL(std::wstring{ LR"("a b")" }, QuoteCommandLineArgument(LR"(a b)"));
+        VERIFY_ARE_EQUAL(std::wstring{ LR"(a\b)" }, QuoteCommandLineArgument(LR"(a\b)"));
+        VERIFY_ARE_EQUAL(std::wstring{ LR"("a\"b")" }, QuoteCommandLineArgument(LR"(a"b)"));
+        VERIFY_ARE_EQUAL(std::wstring{ LR"("a\\\"b")" }, QuoteCommandLineArgument(LR"(a\"b)"));
+        VERIFY_ARE_EQUAL(std::wstring{ LR"("C:\dir\ x\\")" }, QuoteCommandLineArgument(LR"(C:\dir\ x\)"));
+        VERIFY_ARE_EQUAL(std::wstring{ LR"("{\"path\": \"C:\\\\\"}")" }, QuoteCommandLineArgument(LR"({"path": "C:\\"})"));
+    }
+
+    TEST_METHOD(WarmWorkerRoundTrip)
+    {
+        if (!pythonAvailable())
+        {
+            return;
+        }
+
+        ScratchDirectory scripts{ L"ToolWorkerPoolTests" };
+        const auto echo = scripts.Write(L"echo.py", "import sys\nprint('got ' + sys.argv[1])\nsys.exit(len(sys.argv[1]))\n").wstring();
+        const auto fail = scripts.Write(L"fail.py", "raise ValueError('boom')\n").wstring();
+
+        ToolWorkerPool pool;
+        for (auto i = 0; i < 3; i++)
+        {
+            const auto arguments = L"{\"i\": " + std::to_wstring(i) + L"}";
+            const auto result = pool.Invoke(ToolRuntime::Python, echo, arguments);
+            VERIFY_ARE_EQUAL("got " + til::u16u8(arguments) + "\r\n", result.output);
+            VERIFY_ARE_EQUAL(gsl::narrow_cast<int>(arguments.size()), result.exitCode);
+            VERIFY_IS_FALSE(result.timedOut);
+        }
+
+        Log::Comment(L"Exceptions are reported as output and don't take the worker down");
+        const auto result = pool.Invoke(ToolRuntime::Python, fail, L"");
+        VERIFY_ARE_EQUAL(1, result.exitCode);
+        VERIFY_IS_TRUE(result.output.find("ValueError: boom") != std::string::npos);
+
+        VERIFY_ARE_EQUAL(uint64_t{ 4 }, pool.Stats().calls);
+        VERIFY_ARE_EQUAL(uint64_t{ 1 }, pool.Stats().spawned);
+    }
+
+    TEST_METHOD(StreamedOutput)
+    {
+        if (!pythonAvailable())
+        {
+            return;
+        }
+
+        ScratchDirectory scripts{ L"ToolWorkerPoolTests" };
+        const auto slow = scripts.Write(L"slow.py", "import time\nprint('first')\ntime.sleep(0.5)\nprint('second')\n").wstring();
+
+        ToolWorkerPool pool;
+        std::string streamed;
+        auto firstOutput = 0.0;
+        const auto start = clock::now();
+        const auto result = pool.Invoke(ToolRuntime::Python, slow, L"", [&](std::string_view chunk) {
+            if (streamed.empty())
+            {
+                firstOutput = millisecondsSince(start);
+            }
+            streamed.append(chunk);
+        });
+        const auto total = millisecondsSince(start);
+
+        Log::Comment(NoThrowString().Format(L"first output after %.1fms, done after %.1fms", firstOutput, total));
+        VERIFY_ARE_EQUAL(std::string{ "first\r\nsecond\r\n" }, result.output);
+        VERIFY_ARE_EQUAL(result.output, streamed);
+        VERIFY_IS_LESS_THAN(firstOutput + 250, total);
+    }
+
+    TEST_METHOD(RecycleWorkers)
+    {
+        if (!pythonAvailable())
+        {
+            return;
+        }
+
+        ScratchDirectory scripts{ L"ToolWorkerPoolTests" };
+        const auto pid = scripts.Write(L"pid.py", "import os\nprint(os.getpid(), end='')\n").wstring();
+        const auto hog = scripts.Write(L"hog.py", "import sys\nsys.modules['__hog__'] = bytearray(96 * 1024 * 1024)\n").wstring();
+
+        ToolWorkerOptions options;
+        options.maxWorkersPerRuntime = 1;
+        options.recycleMemoryBytes = 64 * 1024 * 1024;
+
+        {
+            Log::Comment(L"Workers are replaced after maxCallsPerWorker calls");
+            options.maxCallsPerWorker = 2;
+            ToolWorkerPool pool{ options };
+
+            std::vector<std::string> pids;
+            for (auto i = 0; i < 4; i++)
+            {
+                pids.emplace_back(pool.Invoke(ToolRuntime::Python, pid, L"").output);
+            }
+            VERIFY_ARE_EQUAL(pids[0], pids[1]);
+            VERIFY_ARE_NOT_EQUAL(pids[1], pids[2]);
+            VERIFY_ARE_EQUAL(pids[2], pids[3]);
+            VERIFY_ARE_EQUAL(uint64_t{ 2 }, pool.Stats().recycled);
+        }
+
+        {
+            Log::Comment(L"... and once they've used more than recycleMemoryBytes");
+            options.maxCallsPerWorker = 100;
+            ToolWorkerPool pool{ options };
+
+            const auto before = pool.Invoke(ToolRuntime::Python, pid, L"").output;
+            VERIFY_ARE_EQUAL(before, pool.Invoke(ToolRuntime::Python, pid, L"").output);
+            VERIFY_ARE_EQUAL(0, pool.Invoke(ToolRuntime::Python, hog, L"").exitCode);
+            VERIFY_ARE_NOT_EQUAL(before, pool.Invoke(ToolRuntime::Python, pid, L"").output);
+            VERIFY_ARE_EQUAL(uint64_t{ 1 }, pool.Stats().recycled);
+        }
+    }
+
+    TEST_METHOD(FailedWorkers)
+    {
+        if (!pythonAvailable())
+        {
+            return;
+        }
+
+        ScratchDirectory scripts{ L"ToolWorkerPoolTests" };
+        const auto hang = scripts.Write(L"hang.py", "import time\nprint('waiting', flush=True)\ntime.sleep(60)\n").wstring();
+        const auto quit = scripts.Write(L"quit.py", "import os\nos._exit(3)\n").wstring();
+        const auto echo = scripts.Write(L"echo.py", "import sys\nprint(sys.argv[1], end='')\n").wstring();
+
+        ToolWorkerOptions options;
+        options.callTimeout = std::chrono::milliseconds{ 1000 };
+        ToolWorkerPool pool{ options };
+
+        Log::Comment(L"A call that times out is killed along with its worker");
+        const auto start = clock::now();
+        const auto timedOut = pool.Invoke(ToolRuntime::Python, hang, L"");
+        VERIFY_IS_TRUE(timedOut.timedOut);
+        VERIFY_ARE_EQUAL(-1, timedOut.exitCode);
+        VERIFY_ARE_EQUAL(std::string{ "waiting\r\n" }, timedOut.output);
+        VERIFY_IS_LESS_THAN(millisecondsSince(start), 10000.0);
+
+        Log::Comment(L"A tool that exits the interpreter reports the exit code");
+        const auto exited = pool.Invoke(ToolRuntime::Python, quit, L"");
+        VERIFY_IS_FALSE(exited.timedOut);
+        VERIFY_ARE_EQUAL(3, exited.exitCode);
+
+        VERIFY_ARE_EQUAL(std::string{ "still working" }, pool.Invoke(ToolRuntime::Python, echo, L"still working").output);
+        VERIFY_ARE_EQUAL(uint64_t{ 2 }, pool.Stats().recycled);
+
+        Log::Comment(L"A worker that dies while it's idle is replaced when it's checked out");
+        const auto exitLater = scripts.Write(L"exit_later.py", "import os, threading\nthreading.Timer(0.2, lambda: os._exit(5)).start()\n").wstring();
+        VERIFY_ARE_EQUAL(0, pool.Invoke(ToolRuntime::Python, exitLater, L"").exitCode);
+        Sleep(1000);
+        VERIFY_ARE_EQUAL(std::string{ "still working" }, pool.Invoke(ToolRuntime::Python, echo, L"still working").output);
+        VERIFY_ARE_EQUAL(uint64_t{ 3 }, pool.Stats().recycled);
+    }
+
+    TEST_METHOD(ParallelFunctionCalls)
+    {
+        if (!pythonAvailable())
+        {
+            return;
+        }
+
+        ScratchDirectory scripts{ L"ToolWorkerPoolTests" };
+        scripts.Write(L"sleepy.py", "import sys, time\ntime.sleep(0.5)\nprint(sys.argv[1], end='')\n");
+        scripts.Write(L"sleepy.json", R"({ "name": "sleepy", "description": "Sleeps", "scriptPath": "sleepy.py" })");
+
+        ToolWorkerOptions options;
+        options.maxWorkersPerRuntime = 4;
+        FunctionCallingEngine engine{ options };
+        engine.LoadFunctions(scripts.Path().wstring());
+
+        std::vector<FunctionCallingEngine::FunctionCall> calls;
+        for (auto i = 0; i < 4; i++)
+        {
+            calls.push_back({ L"sleepy", std::to_wstring(i) });
+        }
+        calls.push_back({ L"missing", L"" });
+
+        // The first round may include interpreter startup.
+        std::ignore = engine.ExecuteFunctions(calls);
+
+        const auto start = clock::now();
+        const auto results = engine.ExecuteFunctions(calls);
+        const auto elapsed = millisecondsSince(start);
+        Log::Comment(NoThrowString().Format(L"4 calls of 500ms each took %.1fms", elapsed));
+
+        VERIFY_ARE_EQUAL(calls.size(), results.size());
+        for (auto i = 0; i < 4; i++)
+        {
+            VERIFY_ARE_EQUAL(0, results[i].exitCode);
+            VERIFY_ARE_EQUAL(std::to_string(i), results[i].output);
+        }
+        VERIFY_ARE_EQUAL(-1, results[4].exitCode);
+        VERIFY_IS_LESS_THAN(elapsed, 1500.0);
+    }
+
+    TEST_METHOD(LatencyBenchmark)
+    {
+        if (!pythonAvailable())
+        {
+            return;
+        }
+
+        static constexpr auto warmCalls = 200;
+        static constexpr auto coldCalls = 50;
+
+        ScratchDirectory scripts{ L"ToolWorkerPoolTests" };
+        const auto tool = scripts.Write(L"tool.py", "import json, sys\nargs = json.loads(sys.argv[1])\nprint(json.dumps({'sum': args['a'] + args['b']}))\n").wstring();
+        const auto arguments = std::wstring{ LR"({"a": 1, "b": 2})" };
+
+        ToolWorkerPool pool;
+        pool.Warm(ToolRuntime::Python, 1);
+
+        std::vector<double> warm;
+        for (auto i = 0; i < warmCalls; i++)
+        {
+            const auto start = clock::now();
+            const auto result = pool.Invoke(ToolRuntime::Python, tool, arguments);
+            warm.emplace_back(millisecondsSince(start));
+            VERIFY_ARE_EQUAL(0, result.exitCode);
+        }
+
+        std::vector<double> cold;
+        for (auto i = 0; i < coldCalls; i++)
+        {
+            const auto start = clock::now();
+            const auto result = pool.InvokeCold(ToolRuntime::Python, tool, arguments);
+            cold.emplace_back(millisecondsSince(start));
+            VERIFY_ARE_EQUAL(0, result.exitCode);
+        }
+
+        // The warm numbers include replacing the worker after every maxCallsPerWorker calls.
+        Log::Comment(NoThrowString().Format(L"warm worker: p50 %.2fms, p99 %.2fms (%llu spawned)", percentile(warm, 0.5), percentile(warm, 0.99), pool.Stats().spawned));
+        Log::Comment(NoThrowString().Format(L"cold spawn:  p50 %.2fms, p99 %.2fms", percentile(cold, 0.5), percentile(cold, 0.99)));
+
+        VERIFY_IS_LESS_THAN(percentile(warm, 0.5), percentile(cold, 0.5));
+    }
+};
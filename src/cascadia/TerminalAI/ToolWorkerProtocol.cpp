@@ -0,0 +1,271 @@
+#include "pch.h"
+#include "ToolWorkerProtocol.h"
+
+#include <charconv>
+
+namespace Microsoft::Terminal::AI
+{
+    namespace
+    {
+        // The host loops only use the standard library of each interpreter.
+        // Tools run in the worker's process, so their stdin is detached from the
+        // protocol pipe and their stderr is merged into stdout.
+        constexpr std::wstring_view BashHost = LR"(while IFS=$'\t' read -r nonce script args; do
+  ( set -- "$args"; . "$script" ) </dev/null 2>&1
+  printf '\n%s %d\n' "$nonce" "$?"
+done)";
+
+        constexpr std::wstring_view PythonHost = LR"(import os, runpy, sys
+proto, out = sys.stdin, sys.stdout
+for line in proto:
+    nonce, script, args = line.rstrip('\r\n').split('\t', 2)
+    sys.argv = [script, args]
+    sys.stdin = open(os.devnull)
+    sys.stdout = sys.stderr = out
+    code = 0
+    try:
+        runpy.run_path(script, run_name='__main__')
+    except SystemExit as e:
+        code = e.code if isinstance(e.code, int) else int(e.code is not None)
+    except BaseException:
+        import traceback
+        traceback.print_exc(file=out)
+        code = 1
+    sys.stdin.close()
+    out.write('\n%s %d\n' % (nonce, code))
+    out.flush())";
+
+        constexpr std::wstring_view JavaScriptHost = LR"(const rl = require('readline').createInterface({ input: process.stdin, crlfDelay: Infinity });
+rl.on('line', (line) => {
+  const [nonce, script, ...rest] = line.split('\t');
+  let code = 0;
+  try {
+    const file = require.resolve(require('path').resolve(script));
+    process.argv = [process.argv[0], file, rest.join('\t')];
+    process.exitCode = undefined;
+    delete require.cache[file];
+    require(file);
+    code = process.exitCode || 0;
+  } catch (e) {
+    process.stdout.write(String((e && e.stack) || e));
+    code = 1;
+  }
+  process.exitCode = undefined;
+  process.stdout.write('\n' + nonce + ' ' + code + '\n');
+});)";
+
+        void appendSanitized(std::wstring& out, std::wstring_view text)
+        {
+            for (const auto ch : text)
+            {
+                out.push_back(ch == L'\t' || ch == L'\r' || ch == L'\n' ? L' ' : ch);
+            }
+        }
+    }
+
+    std::optional<ToolRuntime> RuntimeForScript(std::wstring_view scriptPath) noexcept
+    {
+        if (scriptPath.ends_with(L".sh") || scriptPath.ends_with(L".bash"))
+        {
+            return ToolRuntime::Bash;
+        }
+        if (scriptPath.ends_with(L".js"))
+        {
+            return ToolRuntime::JavaScript;
+        }
+        if (scriptPath.ends_with(L".py"))
+        {
+            return ToolRuntime::Python;
+        }
+        return std::nullopt;
+    }
+
+    std::string FormatToolInvocation(std::string_view nonce, std::wstring_view scriptPath, std::wstring_view arguments)
+    {
+        std::wstring line;
+        line.reserve(nonce.size() + scriptPath.size() + arguments.size() + 3);
+        line.append(nonce.begin(), nonce.end());
+        line.push_back(L'\t');
+        appendSanitized(line, scriptPath);
+        line.push_back(L'\t');
+        appendSanitized(line, arguments);
+        line.push_back(L'\n');
+        return til::u16u8(line);
+    }
+
+    std::wstring WorkerCommandLine(ToolRuntime runtime)
+    {
+        switch (runtime)
+        {
+        case ToolRuntime::Bash:
+            return L"bash.exe -c " + QuoteCommandLineArgument(BashHost);
+        case ToolRuntime::Python:
+            // -u: unbuffered, so that output is streamed as it's printed.
+            // -X utf8: the pipes use UTF-8 rather than the ANSI code page.
+            return L"python.exe -u -X utf8 -c " + QuoteCommandLineArgument(PythonHost);
+        case ToolRuntime::JavaScript:
+            return L"node.exe -e " + QuoteCommandLineArgument(JavaScriptHost);
+        default:
+            THROW_HR(E_INVALIDARG);
+        }
+    }
+
+    std::wstring ColdCommandLine(ToolRuntime runtime, std::wstring_view scriptPath, std::wstring_view arguments)
+    {
+        std::wstring commandLine;
+        switch (runtime)
+        {
+        case ToolRuntime::Bash:
+            commandLine = L"bash.exe ";
+            break;
+        case ToolRuntime::Python:
+            commandLine = L"python.exe -u -X utf8 ";
+            break;
+        case ToolRuntime::JavaScript:
+            commandLine = L"node.exe ";
+            break;
+        default:
+            THROW_HR(E_INVALIDARG);
+        }
+
+        commandLine.append(QuoteCommandLineArgument(scriptPath));
+        commandLine.push_back(L' ');
+        commandLine.append(QuoteCommandLineArgument(arguments));
+        return commandLine;
+    }
+
+    std::wstring QuoteCommandLineArgument(std::wstring_view argument)
+    {
+        if (!argument.empty() && argument.find_first_of(L" \t\n\v\"") == std::wstring_view::npos)
+        {
+            return std::wstring{ argument };
+        }
+
+        // Backslashes are only special in front of a quote, where each pair
+        // turns into a single backslash and an odd one escapes the quote.
+        std::wstring quoted;
+        quoted.reserve(argument.size() + 2);
+        quoted.push_back(L'"');
+        for (auto it = argument.begin();; ++it)
+        {
+            size_t backslashes = 0;
+            for (; it != argument.end() && *it == L'\\'; ++it)
+            {
+                backslashes++;
+            }
+
+            if (it == argument.end())
+            {
+                quoted.append(backslashes * 2, L'\\');
+                break;
+            }
+
+            quoted.append(*it == L'"' ? backslashes * 2 + 1 : backslashes, L'\\');
+            quoted.push_back(*it);
+        }
+        quoted.push_back(L'"');
+        return quoted;
+    }
+
+    ToolOutputReader::ToolOutputReader(std::string_view nonce)
+    {
+        _marker.reserve(nonce.size() + 2);
+        _marker.push_back('\n');
+        _marker.append(nonce);
+        _marker.push_back(' ');
+    }
+
+    bool ToolOutputReader::Feed(std::string_view chunk, const OutputCallback& onOutput)
+    {
+        if (_done)
+        {
+            return true;
+        }
+
+        _pending.append(chunk);
+
+        if (!_inStatus)
+        {
+            const auto pos = _pending.find(_marker);
+            if (pos == std::string::npos)
+            {
+                // Hold back anything that may turn out to be the start of the marker,
+                // including the CR that Python on Windows puts in front of each LF.
+                const std::string_view pending{ _pending };
+                size_t keep = 0;
+                for (auto n = std::min(pending.size(), _marker.size() - 1); n > 0; --n)
+                {
+                    if (pending.ends_with(std::string_view{ _marker }.substr(0, n)))
+                    {
+                        keep = n;
+                        break;
+                    }
+                }
+                if (keep < pending.size() && pending[pending.size() - keep - 1] == '\r')
+                {
+                    keep++;
+                }
+
+                const auto ready = pending.size() - keep;
+                if (ready && onOutput)
+                {
+                    onOutput({ _pending.data(), ready });
+                }
+                _pending.erase(0, ready);
+                return false;
+            }
+
+            auto end = pos;
+            if (end && _pending[end - 1] == '\r')
+            {
+                end--;
+            }
+            if (end && onOutput)
+            {
+                onOutput({ _pending.data(), end });
+            }
+            _pending.erase(0, pos + _marker.size());
+            _inStatus = true;
+        }
+
+        const auto newline = _pending.find('\n');
+        if (newline == std::string::npos)
+        {
+            return false;
+        }
+
+        std::string_view status{ _pending.data(), newline };
+        if (status.ends_with('\r'))
+        {
+            status.remove_suffix(1);
+        }
+        int exitCode = -1;
+        if (std::from_chars(status.data(), status.data() + status.size(), exitCode).ec == std::errc{})
+        {
+            _exitCode = exitCode;
+        }
+
+        _pending.clear();
+        _done = true;
+        return true;
+    }
+
+    void ToolOutputReader::Finish(const OutputCallback& onOutput)
+    {
+        if (!_done && !_inStatus && !_pending.empty() && onOutput)
+        {
+            onOutput(_pending);
+        }
+        _pending.clear();
+    }
+
+    bool ToolOutputReader::Done() const noexcept
+    {
+        return _done;
+    }
+
+    int ToolOutputReader::ExitCode() const noexcept
+    {
+        return _exitCode;
+    }
+}
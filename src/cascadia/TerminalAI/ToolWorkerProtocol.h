@@ -0,0 +1,61 @@
+#pragma once
+
+#include "pch.h"
+
+namespace Microsoft::Terminal::AI
+{
+    enum class ToolRuntime : uint8_t
+    {
+        Bash,
+        Python,
+        JavaScript,
+    };
+
+    inline constexpr size_t ToolRuntimeCount = 3;
+
+    // Picks the interpreter for a tool script by its extension.
+    std::optional<ToolRuntime> RuntimeForScript(std::wstring_view scriptPath) noexcept;
+
+    // A warm worker is an interpreter running a small host loop (see WorkerCommandLine()).
+    // The host reads one invocation per line from its stdin:
+    //   <nonce> TAB <script path> TAB <arguments> LF
+    // runs the script in-process with `arguments` as its only argument,
+    // and follows the script's output on stdout with an end marker:
+    //   LF <nonce> SP <exit code> LF
+    // The nonce is random for each call, so a tool can't end its own output early.
+    // Tabs and line breaks in the path or the arguments are replaced with spaces.
+    std::string FormatToolInvocation(std::string_view nonce, std::wstring_view scriptPath, std::wstring_view arguments);
+
+    // The command line of a worker running the host loop for `runtime`.
+    std::wstring WorkerCommandLine(ToolRuntime runtime);
+    // The command line that runs a single tool in a fresh interpreter.
+    std::wstring ColdCommandLine(ToolRuntime runtime, std::wstring_view scriptPath, std::wstring_view arguments);
+
+    // Quotes `argument` so that CommandLineToArgvW() (and the CRT) parse it back unchanged.
+    std::wstring QuoteCommandLineArgument(std::wstring_view argument);
+
+    // Splits a worker's output stream into the tool's output and the end marker.
+    // Chunks may be split at arbitrary byte offsets, including in the middle of the marker.
+    class ToolOutputReader
+    {
+    public:
+        using OutputCallback = std::function<void(std::string_view)>;
+
+        explicit ToolOutputReader(std::string_view nonce);
+
+        // Forwards the tool's output to `onOutput` and returns true once the end marker was read.
+        bool Feed(std::string_view chunk, const OutputCallback& onOutput);
+        // Forwards output that was held back, for when the worker exited without an end marker.
+        void Finish(const OutputCallback& onOutput);
+
+        bool Done() const noexcept;
+        int ExitCode() const noexcept;
+
+    private:
+        std::string _marker;
+        std::string _pending;
+        bool _inStatus = false;
+        bool _done = false;
+        int _exitCode = -1;
+    };
+}
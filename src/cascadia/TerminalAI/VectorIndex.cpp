@@ -0,0 +1,585 @@
+#include "pch.h"
+#include "VectorIndex.h"
+#include "ThreadPoolBatch.h"
+
+#include <isa_availability.h>
+#include <thread>
+
+#if defined(TIL_SSE_INTRINSICS)
+#include <immintrin.h>
+#elif defined(TIL_ARM_NEON_INTRINSICS)
+#include <arm_neon.h>
+#endif
+
+extern "C" int __isa_available;
+
+using namespace Microsoft::Terminal::AI;
+
+namespace
+{
+    constexpr uint32_t Magic = 0x56435457; // "WTCV"
+    constexpr uint32_t Version = 1;
+    constexpr size_t MinimumCapacity = 1024;
+    // Stores with fewer rows are scanned on the calling thread only.
+    constexpr size_t ParallelSearchRows = 32 * 1024;
+    // Allows for about e^16 = 9 million nodes with the default m.
+    constexpr uint32_t MaxLevel = 16;
+
+    // For heaps of the best k matches, which keep the worst one on top so it can be replaced.
+    constexpr auto worseMatch = [](const VectorMatch& a, const VectorMatch& b) noexcept {
+        return a.score > b.score;
+    };
+
+    void pushMatch(std::vector<VectorMatch>& heap, size_t k, const VectorMatch& match) noexcept
+    {
+        if (heap.size() < k)
+        {
+            heap.push_back(match);
+            std::push_heap(heap.begin(), heap.end(), worseMatch);
+        }
+        else if (match.score > heap.front().score)
+        {
+            std::pop_heap(heap.begin(), heap.end(), worseMatch);
+            heap.back() = match;
+            std::push_heap(heap.begin(), heap.end(), worseMatch);
+        }
+    }
+}
+
+float Microsoft::Terminal::AI::DotProduct(const float* a, const float* b, size_t count) noexcept
+{
+    size_t i = 0;
+    float sum = 0;
+
+#if defined(TIL_SSE_INTRINSICS)
+    if (__isa_available >= __ISA_AVAILABLE_AVX2)
+    {
+        // Two accumulators, so that each addition doesn't have to wait for the previous one.
+        auto sum0 = _mm256_setzero_ps();
+        auto sum1 = _mm256_setzero_ps();
+        for (; i + 16 <= count; i += 16)
+        {
+            sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+            sum1 = _mm256_add_ps(sum1, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8)));
+        }
+        if (i + 8 <= count)
+        {
+            sum0 = _mm256_add_ps(sum0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+            i += 8;
+        }
+
+        const auto sum256 = _mm256_add_ps(sum0, sum1);
+        auto sum128 = _mm_add_ps(_mm256_castps256_ps128(sum256), _mm256_extractf128_ps(sum256, 1));
+        sum128 = _mm_add_ps(sum128, _mm_movehl_ps(sum128, sum128));
+        sum128 = _mm_add_ss(sum128, _mm_shuffle_ps(sum128, sum128, 1));
+        sum = _mm_cvtss_f32(sum128);
+    }
+    else
+    {
+        auto sum128 = _mm_setzero_ps();
+        for (; i + 4 <= count; i += 4)
+        {
+            sum128 = _mm_add_ps(sum128, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        }
+        sum128 = _mm_add_ps(sum128, _mm_movehl_ps(sum128, sum128));
+        sum128 = _mm_add_ss(sum128, _mm_shuffle_ps(sum128, sum128, 1));
+        sum = _mm_cvtss_f32(sum128);
+    }
+#elif defined(TIL_ARM_NEON_INTRINSICS)
+    auto sum128 = vdupq_n_f32(0);
+    for (; i + 4 <= count; i += 4)
+    {
+        sum128 = vmlaq_f32(sum128, vld1q_f32(a + i), vld1q_f32(b + i));
+    }
+    sum = vaddvq_f32(sum128);
+#endif
+
+    for (; i < count; ++i)
+    {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+void Microsoft::Terminal::AI::Normalize(std::span<float> vector) noexcept
+{
+    const auto length = std::sqrt(DotProduct(vector.data(), vector.data(), vector.size()));
+    if (length > 0)
+    {
+        for (auto& value : vector)
+        {
+            value /= length;
+        }
+    }
+}
+
+VectorStore::VectorStore(std::filesystem::path path, uint32_t dimensions) :
+    _path{ std::move(path) },
+    _dimensions{ dimensions },
+    _stride{ (size_t{ dimensions } + 7) & ~size_t{ 7 } }
+{
+    THROW_HR_IF(E_INVALIDARG, dimensions == 0);
+
+    if (!_path.empty())
+    {
+        _file.reset(CreateFileW(_path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr));
+        THROW_LAST_ERROR_IF(!_file);
+
+        LARGE_INTEGER fileSize{};
+        THROW_IF_WIN32_BOOL_FALSE(GetFileSizeEx(_file.get(), &fileSize));
+        const auto bytes = gsl::narrow_cast<size_t>(fileSize.QuadPart);
+        const auto rowBytes = _stride * sizeof(float);
+        if (bytes >= HeaderSize + rowBytes)
+        {
+            _map((bytes - HeaderSize) / rowBytes);
+            const auto& header = _header();
+            if (header.magic == Magic && header.version == Version && header.dimensions == dimensions && header.size <= _capacity)
+            {
+                return;
+            }
+        }
+    }
+
+    _map(std::max(_capacity, MinimumCapacity));
+    _header() = { Magic, Version, dimensions, 0, 0 };
+}
+
+uint32_t VectorStore::Dimensions() const noexcept
+{
+    return _dimensions;
+}
+
+size_t VectorStore::Size() const noexcept
+{
+    return gsl::narrow_cast<size_t>(_header().size);
+}
+
+uint32_t VectorStore::Generation() const noexcept
+{
+    return _header().generation;
+}
+
+const float* VectorStore::Row(size_t row) const noexcept
+{
+    return _row(row);
+}
+
+uint32_t VectorStore::Append(std::span<const float> vector)
+{
+    THROW_HR_IF(E_INVALIDARG, vector.size() != _dimensions);
+
+    const auto row = Size();
+    if (row == _capacity)
+    {
+        _map(_capacity * 2);
+    }
+
+    const auto destination = _row(row);
+    std::copy(vector.begin(), vector.end(), destination);
+    std::fill(destination + _dimensions, destination + _stride, 0.0f);
+    // Only now, so that a crash can't leave a half written row behind.
+    _header().size = row + 1;
+    return gsl::narrow<uint32_t>(row);
+}
+
+void VectorStore::Compact(std::span<const uint32_t> rows)
+{
+    for (size_t i = 0; i < rows.size(); ++i)
+    {
+        const auto row = til::at(rows, i);
+        if (row != i)
+        {
+            memmove(_row(i), _row(row), _stride * sizeof(float));
+        }
+    }
+
+    auto& header = _header();
+    header.size = rows.size();
+    header.generation++;
+}
+
+void VectorStore::Clear()
+{
+    auto& header = _header();
+    header.size = 0;
+    header.generation++;
+}
+
+std::vector<VectorMatch> VectorStore::Search(std::span<const float> query, size_t k, std::span<const uint8_t> alive) const
+{
+    THROW_HR_IF(E_INVALIDARG, query.size() != _dimensions);
+
+    const auto size = Size();
+    k = std::min(k, size);
+    if (k == 0)
+    {
+        return {};
+    }
+
+    // The rows are padded with zeros and so is the query, which saves
+    // DotProduct() the scalar loop for the last few dimensions.
+    std::vector<float> padded(_stride);
+    std::copy(query.begin(), query.end(), padded.begin());
+
+    const size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    const auto partitions = std::clamp<size_t>(size / ParallelSearchRows, 1, threads);
+    std::vector<std::vector<VectorMatch>> heaps(partitions);
+    for (auto& heap : heaps)
+    {
+        heap.reserve(k);
+    }
+
+    RunOnThreadPool(partitions, [&](size_t i) {
+        _searchRange(padded, size * i / partitions, size * (i + 1) / partitions, k, alive, heaps[i]);
+    });
+
+    auto& result = heaps[0];
+    for (size_t i = 1; i < partitions; ++i)
+    {
+        for (const auto& match : heaps[i])
+        {
+            pushMatch(result, k, match);
+        }
+    }
+
+    // Sorting a heap of "worse" comparisons puts the best match first.
+    std::sort_heap(result.begin(), result.end(), worseMatch);
+    return std::move(result);
+}
+
+VectorStore::Header& VectorStore::_header() const noexcept
+{
+    return *reinterpret_cast<Header*>(_view.get());
+}
+
+float* VectorStore::_row(size_t row) const noexcept
+{
+    return reinterpret_cast<float*>(_view.get() + HeaderSize) + row * _stride;
+}
+
+// Maps the file (or page file) with room for `capacity` rows, growing it if necessary.
+void VectorStore::_map(size_t capacity)
+{
+    ULARGE_INTEGER bytes;
+    bytes.QuadPart = HeaderSize + capacity * _stride * sizeof(float);
+
+    wil::unique_handle mapping{ CreateFileMappingW(_file ? _file.get() : INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, bytes.HighPart, bytes.LowPart, nullptr) };
+    THROW_LAST_ERROR_IF(!mapping);
+    wil::unique_mapview_ptr<std::byte> view{ static_cast<std::byte*>(MapViewOfFile(mapping.get(), FILE_MAP_ALL_ACCESS, 0, 0, 0)) };
+    THROW_LAST_ERROR_IF(!view);
+
+    // A new mapping of the same file sees the existing contents, but one backed by the page file doesn't.
+    if (!_file && _view)
+    {
+        memcpy(view.get(), _view.get(), HeaderSize + Size() * _stride * sizeof(float));
+    }
+
+    _view = std::move(view);
+    _mapping = std::move(mapping);
+    _capacity = capacity;
+}
+
+void VectorStore::_searchRange(std::span<const float> query, size_t begin, size_t end, size_t k, std::span<const uint8_t> alive, std::vector<VectorMatch>& heap) const noexcept
+{
+    for (auto row = begin; row < end; ++row)
+    {
+        if (row < alive.size() && !til::at(alive, row))
+        {
+            continue;
+        }
+        pushMatch(heap, k, { gsl::narrow_cast<uint32_t>(row), DotProduct(query.data(), _row(row), _stride) });
+    }
+}
+
+HnswIndex::HnswIndex(const VectorStore& store, HnswOptions options) :
+    _store{ &store },
+    _options{ options },
+    _levelFactor{ 1.0 / std::log(std::max(2u, options.m)) }
+{
+    THROW_HR_IF(E_INVALIDARG, options.m < 2 || options.efConstruction == 0);
+}
+
+size_t HnswIndex::Size() const noexcept
+{
+    return _nodes.size();
+}
+
+void HnswIndex::Update()
+{
+    for (auto node = _nodes.size(); node < _store->Size(); ++node)
+    {
+        _add(gsl::narrow<uint32_t>(node));
+    }
+}
+
+void HnswIndex::Clear() noexcept
+{
+    _nodes.clear();
+    _links.clear();
+    _entryPoint = 0;
+    _maxLevel = 0;
+    _random = RandomSeed;
+}
+
+void HnswIndex::Rebind(const VectorStore& store) noexcept
+{
+    _store = &store;
+}
+
+std::vector<VectorMatch> HnswIndex::Search(std::span<const float> query, size_t k, std::span<const uint8_t> alive) const
+{
+    THROW_HR_IF(E_INVALIDARG, query.size() != _store->Dimensions());
+
+    std::vector<VectorMatch> result;
+    if (_nodes.empty() || k == 0)
+    {
+        return result;
+    }
+
+    const auto entry = _greedyClosest(query.data(), _entryPoint, _maxLevel, 1);
+    const auto ef = std::max(gsl::narrow<uint32_t>(std::min<size_t>(k, UINT32_MAX)), _options.efSearch);
+    til::flat_hash_set<uint32_t> visited;
+    const auto candidates = _searchLayer(query.data(), entry, ef, 0, [&](uint32_t node) { return visited.insert(node).second; });
+    for (const auto& candidate : candidates)
+    {
+        if (candidate.node < alive.size() && !til::at(alive, candidate.node))
+        {
+            continue;
+        }
+        result.push_back({ candidate.node, candidate.score });
+        if (result.size() == k)
+        {
+            break;
+        }
+    }
+    return result;
+}
+
+float HnswIndex::_score(const float* query, uint32_t node) const noexcept
+{
+    return DotProduct(query, _store->Row(node), _store->Dimensions());
+}
+
+uint32_t HnswIndex::_capacity(uint32_t level) const noexcept
+{
+    return level == 0 ? 2 * _options.m : _options.m;
+}
+
+size_t HnswIndex::_linkOffset(uint32_t node, uint32_t level) const noexcept
+{
+    auto offset = size_t{ til::at(_nodes, node).offset };
+    if (level > 0)
+    {
+        offset += 1 + _capacity(0) + (level - 1) * (1 + _capacity(1));
+    }
+    return offset;
+}
+
+std::span<const uint32_t> HnswIndex::_neighbors(uint32_t node, uint32_t level) const noexcept
+{
+    const auto offset = _linkOffset(node, level);
+    return { _links.data() + offset + 1, til::at(_links, offset) };
+}
+
+void HnswIndex::_setNeighbors(uint32_t node, uint32_t level, std::span<const Candidate> neighbors)
+{
+    const auto offset = _linkOffset(node, level);
+    const auto count = std::min<size_t>(neighbors.size(), _capacity(level));
+    _links[offset] = gsl::narrow_cast<uint32_t>(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        _links[offset + 1 + i] = til::at(neighbors, i).node;
+    }
+}
+
+// Draws from an exponential distribution, so that each level has about 1/m as many nodes as the one below.
+// The generator is seeded with a constant, so that the same rows always produce the same graph.
+uint32_t HnswIndex::_randomLevel() noexcept
+{
+    // xorshift64*
+    _random ^= _random >> 12;
+    _random ^= _random << 25;
+    _random ^= _random >> 27;
+    const auto bits = (_random * 0x2545F4914F6CDD1D) >> 11;
+    // Uniform in (0, 1].
+    const auto uniform = (static_cast<double>(bits) + 1.0) / 9007199254740992.0;
+    return std::min(MaxLevel, static_cast<uint32_t>(-std::log(uniform) * _levelFactor));
+}
+
+// Walks from `entry` towards `query` on the levels fromLevel down to toLevel, one step at a time.
+uint32_t HnswIndex::_greedyClosest(const float* query, uint32_t entry, uint32_t fromLevel, uint32_t toLevel) const noexcept
+{
+    auto closest = entry;
+    auto best = _score(query, closest);
+
+    for (auto level = fromLevel + 1; level-- > toLevel;)
+    {
+        for (auto changed = true; changed;)
+        {
+            changed = false;
+            for (const auto neighbor : _neighbors(closest, level))
+            {
+                if (const auto score = _score(query, neighbor); score > best)
+                {
+                    best = score;
+                    closest = neighbor;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    return closest;
+}
+
+// The best-first search of the HNSW paper. Returns up to `ef` nodes of the given level, best first.
+template<typename Visit>
+std::vector<HnswIndex::Candidate> HnswIndex::_searchLayer(const float* query, uint32_t entry, uint32_t ef, uint32_t level, Visit&& visit) const
+{
+    constexpr auto bestOnTop = [](const Candidate& a, const Candidate& b) noexcept { return a.score < b.score; };
+    constexpr auto worstOnTop = [](const Candidate& a, const Candidate& b) noexcept { return a.score > b.score; };
+
+    visit(entry);
+
+    const Candidate first{ _score(query, entry), entry };
+    std::vector<Candidate> candidates{ first };
+    std::vector<Candidate> results{ first };
+
+    while (!candidates.empty())
+    {
+        std::pop_heap(candidates.begin(), candidates.end(), bestOnTop);
+        const auto current = candidates.back();
+        candidates.pop_back();
+
+        // Everything that's left is worse than what we've got.
+        if (results.size() >= ef && current.score < results.front().score)
+        {
+            break;
+        }
+
+        for (const auto neighbor : _neighbors(current.node, level))
+        {
+            if (!visit(neighbor))
+            {
+                continue;
+            }
+
+            const Candidate candidate{ _score(query, neighbor), neighbor };
+            if (results.size() < ef || candidate.score > results.front().score)
+            {
+                candidates.push_back(candidate);
+                std::push_heap(candidates.begin(), candidates.end(), bestOnTop);
+                results.push_back(candidate);
+                std::push_heap(results.begin(), results.end(), worstOnTop);
+                if (results.size() > ef)
+                {
+                    std::pop_heap(results.begin(), results.end(), worstOnTop);
+                    results.pop_back();
+                }
+            }
+        }
+    }
+
+    std::sort_heap(results.begin(), results.end(), worstOnTop);
+    return results;
+}
+
+std::vector<HnswIndex::Candidate> HnswIndex::_searchLayer(const float* query, uint32_t entry, uint32_t ef, uint32_t level)
+{
+    _visited.resize(_nodes.size());
+    if (++_visitedEpoch == 0)
+    {
+        std::fill(_visited.begin(), _visited.end(), 0);
+        _visitedEpoch = 1;
+    }
+
+    return _searchLayer(query, entry, ef, level, [this](uint32_t node) noexcept {
+        auto& mark = til::at(_visited, node);
+        return std::exchange(mark, _visitedEpoch) != _visitedEpoch;
+    });
+}
+
+// The neighbor selection heuristic of the HNSW paper: `candidates` (best first) are skipped
+// if they're closer to an already selected neighbor than to the base node. This keeps links
+// pointing in different directions, which is what makes the graph navigable.
+std::vector<HnswIndex::Candidate> HnswIndex::_selectNeighbors(std::vector<Candidate> candidates, uint32_t count) const
+{
+    std::vector<Candidate> selected;
+    selected.reserve(count);
+
+    for (const auto& candidate : candidates)
+    {
+        if (selected.size() >= count)
+        {
+            break;
+        }
+
+        const auto row = _store->Row(candidate.node);
+        const auto diverse = std::none_of(selected.begin(), selected.end(), [&](const Candidate& s) {
+            return DotProduct(row, _store->Row(s.node), _store->Dimensions()) > candidate.score;
+        });
+        if (diverse)
+        {
+            selected.push_back(candidate);
+        }
+    }
+
+    return selected;
+}
+
+void HnswIndex::_add(uint32_t node)
+{
+    const auto level = _randomLevel();
+    _nodes.push_back({ gsl::narrow<uint32_t>(_links.size()), level });
+    _links.resize(_links.size() + 1 + _capacity(0) + level * (1 + _capacity(1)));
+
+    if (node == 0)
+    {
+        _entryPoint = node;
+        _maxLevel = level;
+        return;
+    }
+
+    const auto query = _store->Row(node);
+    auto entry = _greedyClosest(query, _entryPoint, _maxLevel, level + 1);
+
+    for (auto l = std::min(level, _maxLevel) + 1; l-- > 0;)
+    {
+        auto candidates = _searchLayer(query, entry, _options.efConstruction, l);
+        entry = candidates.front().node;
+
+        const auto neighbors = _selectNeighbors(std::move(candidates), _options.m);
+        _setNeighbors(node, l, neighbors);
+
+        // Links are bidirectional. A neighbor that has too many afterwards
+        // keeps the best ones, as seen from its own position.
+        for (const auto& neighbor : neighbors)
+        {
+            const auto existing = _neighbors(neighbor.node, l);
+            if (existing.size() < _capacity(l))
+            {
+                const auto offset = _linkOffset(neighbor.node, l);
+                _links[offset + 1 + existing.size()] = node;
+                _links[offset]++;
+                continue;
+            }
+
+            const auto base = _store->Row(neighbor.node);
+            std::vector<Candidate> links;
+            links.reserve(existing.size() + 1);
+            links.push_back({ neighbor.score, node });
+            for (const auto n : existing)
+            {
+                links.push_back({ DotProduct(base, _store->Row(n), _store->Dimensions()), n });
+            }
+            std::sort(links.begin(), links.end(), [](const Candidate& a, const Candidate& b) { return a.score > b.score; });
+            _setNeighbors(neighbor.node, l, _selectNeighbors(std::move(links), _capacity(l)));
+        }
+    }
+
+    if (level > _maxLevel)
+    {
+        _maxLevel = level;
+        _entryPoint = node;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "pch.h"
+
+namespace Microsoft::Terminal::AI
+{
+    // The dot product of two vectors of `count` floats. Uses AVX2 or NEON where available.
+    float DotProduct(const float* a, const float* b, size_t count) noexcept;
+
+    // Scales `vector` to unit length, so that dot products are cosine similarities.
+    void Normalize(std::span<float> vector) noexcept;
+
+    struct VectorMatch
+    {
+        uint32_t row = 0;
+        float score = 0;
+    };
+
+    // Fixed-size float vectors in a flat file that's mapped into memory, so that an index
+    // of a million chunks is usable right after startup without reading it in first.
+    // Rows are padded to a multiple of 8 floats and aligned to 32 bytes.
+    class VectorStore
+    {
+    public:
+        // An empty `path` creates a store backed by the page file that isn't persisted.
+        // An existing file with a different number of dimensions is discarded.
+        VectorStore(std::filesystem::path path, uint32_t dimensions);
+
+        VectorStore(const VectorStore&) = delete;
+        VectorStore& operator=(const VectorStore&) = delete;
+
+        uint32_t Dimensions() const noexcept;
+        size_t Size() const noexcept;
+        // Incremented whenever rows are moved, so that anything that refers
+        // to rows by index can tell whether those indices are still valid.
+        uint32_t Generation() const noexcept;
+        const float* Row(size_t row) const noexcept;
+
+        // Appends a vector of Dimensions() floats and returns its row.
+        uint32_t Append(std::span<const float> vector);
+        // Keeps only the given rows (ascending), moving them to the front in that order.
+        void Compact(std::span<const uint32_t> rows);
+        void Clear();
+
+        // The `k` rows most similar to `query`, best first. If `alive` isn't empty, rows for which
+        // it's 0 are skipped. Large stores are scanned in parallel on the thread pool.
+        std::vector<VectorMatch> Search(std::span<const float> query, size_t k, std::span<const uint8_t> alive = {}) const;
+
+    private:
+        struct Header
+        {
+            uint32_t magic;
+            uint32_t version;
+            uint32_t dimensions;
+            uint32_t generation;
+            uint64_t size;
+        };
+        // The rows start after the header, at a 64 byte boundary.
+        static constexpr size_t HeaderSize = 64;
+
+        std::filesystem::path _path;
+        wil::unique_hfile _file;
+        wil::unique_handle _mapping;
+        wil::unique_mapview_ptr<std::byte> _view;
+        uint32_t _dimensions = 0;
+        // Floats per row.
+        size_t _stride = 0;
+        size_t _capacity = 0;
+
+        Header& _header() const noexcept;
+        float* _row(size_t row) const noexcept;
+        void _map(size_t capacity);
+        void _searchRange(std::span<const float> query, size_t begin, size_t end, size_t k, std::span<const uint8_t> alive, std::vector<VectorMatch>& heap) const noexcept;
+    };
+
+    struct HnswOptions
+    {
+        // The number of neighbors of each node per layer (twice that on the bottom layer).
+        uint32_t m = 16;
+        // The size of the candidate list while inserting and searching.
+        // Larger values improve recall at the expense of speed.
+        uint32_t efConstruction = 100;
+        uint32_t efSearch = 64;
+    };
+
+    // A hierarchical navigable small world graph over the rows of a VectorStore,
+    // for approximate nearest neighbor search in roughly logarithmic time.
+    // Rows are added in order, so that node i is row i of the store.
+    // The graph is kept in memory. Update() must not run concurrently with anything else.
+    class HnswIndex
+    {
+    public:
+        explicit HnswIndex(const VectorStore& store, HnswOptions options = {});
+
+        size_t Size() const noexcept;
+        // Adds the rows of the store that aren't part of the graph yet.
+        void Update();
+        void Clear() noexcept;
+        // Makes the graph refer to `store` instead, whose first Size() rows must be the ones it was built from.
+        // This allows building a graph from a copy of the rows while the original store keeps changing.
+        void Rebind(const VectorStore& store) noexcept;
+
+        // Like VectorStore::Search(), but approximate.
+        std::vector<VectorMatch> Search(std::span<const float> query, size_t k, std::span<const uint8_t> alive = {}) const;
+
+    private:
+        // A node's links are stored in _links, starting at `offset`, one layer after another.
+        // Each layer is a count followed by as many slots as that layer allows.
+        struct Node
+        {
+            uint32_t offset;
+            uint32_t level;
+        };
+        struct Candidate
+        {
+            float score;
+            uint32_t node;
+        };
+
+        const VectorStore* _store;
+        HnswOptions _options;
+        std::vector<Node> _nodes;
+        std::vector<uint32_t> _links;
+        uint32_t _entryPoint = 0;
+        uint32_t _maxLevel = 0;
+        double _levelFactor;
+        static constexpr uint64_t RandomSeed = 0x2545F4914F6CDD1D;
+        uint64_t _random = RandomSeed;
+        // While inserting, nodes are marked as visited with the number of the current search,
+        // which saves clearing a set for each of the thousands of searches it takes to build a graph.
+        std::vector<uint32_t> _visited;
+        uint32_t _visitedEpoch = 0;
+
+        float _score(const float* query, uint32_t node) const noexcept;
+        uint32_t _capacity(uint32_t level) const noexcept;
+        size_t _linkOffset(uint32_t node, uint32_t level) const noexcept;
+        std::span<const uint32_t> _neighbors(uint32_t node, uint32_t level) const noexcept;
+        void _setNeighbors(uint32_t node, uint32_t level, std::span<const Candidate> neighbors);
+        uint32_t _randomLevel() noexcept;
+        uint32_t _greedyClosest(const float* query, uint32_t entry, uint32_t fromLevel, uint32_t toLevel) const noexcept;
+        // `visit` returns whether a node is visited for the first time.
+        template<typename Visit>
+        std::vector<Candidate> _searchLayer(const float* query, uint32_t entry, uint32_t ef, uint32_t level, Visit&& visit) const;
+        std::vector<Candidate> _searchLayer(const float* query, uint32_t entry, uint32_t ef, uint32_t level);
+        std::vector<Candidate> _selectNeighbors(std::vector<Candidate> candidates, uint32_t count) const;
+        void _add(uint32_t node);
+    };
+}
\ No newline at end of file
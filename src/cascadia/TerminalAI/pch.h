@@ -1,6 +1,10 @@
 #pragma once
 
+// Must precede windows.h, which otherwise pulls in the legacy winsock.h.
+#include <winsock2.h>
 #include <windows.h>
+#include <winhttp.h>
+#include <bcrypt.h>
 #include <unknwn.h>
 #include <hstring.h>
 #include <restrictederrorinfo.h>
@@ -12,10 +16,16 @@
 #include <winrt/Microsoft.Terminal.Settings.Model.h>
 
 // Standard library
+#include <array>
 #include <string>
 #include <vector>
+#include <span>
+#include <deque>
+#include <list>
 #include <memory>
 #include <map>
+#include <mutex>
+#include <condition_variable>
 #include <functional>
 #include <filesystem>
 
@@ -23,10 +33,12 @@
 #include <wil/common.h>
 #include <wil/result.h>
 #include <wil/wistd_memory.h>
+#include <wil/resource.h>
 
 // JSON
 #include <json/json.h>
 
 // Manually include til after we include Windows.Foundation to give it winrt superpowers
 #include "til.h"
+#include <til/flat_hash_map.h>
 #include <til/io.h>
\ No newline at end of file
@@ -14,13 +14,16 @@ static constexpr winrt::guid AIChatConnectionType = { 0x8f1e1e1a, 0x2b3c, 0x4d5e
 
 namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
 {
-    AIChatConnection::AIChatConnection()
+    AIChatConnection::AIChatConnection() :
+        _outputThrottler{ std::chrono::milliseconds{ 16 }, [this]() { _flushPendingOutput(); } }
     {
         _aichatEngine = std::make_unique<AI::AIChatEngine>();
         
         // Set up event handlers for AI chat engine
         _aichatEngine->ResponseReceived({ this, &AIChatConnection::_handleAIResponse });
         _aichatEngine->ErrorOccurred({ this, &AIChatConnection::_handleAIError });
+        _aichatEngine->TokenReceived({ this, &AIChatConnection::_handleAIToken });
+        _aichatEngine->ResponseCompleted({ this, &AIChatConnection::_handleAIResponseCompleted });
     }
     
     winrt::guid AIChatConnection::ConnectionType() noexcept
@@ -103,9 +106,19 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
             return;
         }
         
-        // Convert input data to wide string
-        std::string input(reinterpret_cast<const char*>(data.data()), data.size());
-        std::wstring wideInput(input.begin(), input.end());
+        // Convert input data to wide string. Multi-byte sequences may be split across calls.
+        std::wstring wideInput;
+        if (FAILED_LOG(til::u8u16({ reinterpret_cast<const char*>(data.data()), data.size() }, wideInput, _inputState)))
+        {
+            return;
+        }
+        
+        // Ctrl+C cancels a response that's still streaming in.
+        if (_streaming.load(std::memory_order_relaxed) && wideInput.find(L'\x03') != std::wstring::npos)
+        {
+            _cancelResponse();
+            return;
+        }
         
         // Add to input buffer
         _inputBuffer += wideInput;
@@ -146,6 +159,7 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
             return;
         }
         
+        _cancelResponse();
         _connected = false;
         
         // Save session if specified
@@ -224,6 +238,8 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
             {
                 _writeToTerminal(L"AI Chat Commands:\r\n");
                 _writeToTerminal(L"  /help - Show this help\r\n");
+                _writeToTerminal(L"  /command <command> - Get AI assistance with a command\r\n");
+                _writeToTerminal(L"  /command! <command> - Same, but skip the response cache\r\n");
                 _writeToTerminal(L"  /role <role> - Set current role\r\n");
                 _writeToTerminal(L"  /save <session> - Save current session\r\n");
                 _writeToTerminal(L"  /load <session> - Load a session\r\n");
@@ -231,6 +247,15 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
                 _writeToTerminal(L"> ");
                 return;
             }
+            else if (input.starts_with(L"/command ") || input.starts_with(L"/command! "))
+            {
+                // Unlike chat messages, command requests are answered from the response cache.
+                const auto refresh = input[8] == L'!';
+                _streaming.store(true, std::memory_order_relaxed);
+                _receivedTokens.store(false, std::memory_order_relaxed);
+                _aichatEngine->ProcessCommandAsync(input.substr(refresh ? 10 : 9), refresh ? AI::ResponseCacheMode::Refresh : AI::ResponseCacheMode::Use);
+                return;
+            }
             else if (input.starts_with(L"/role "))
             {
                 std::wstring newRole = std::wstring(input.substr(6));
@@ -264,9 +289,10 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
             }
         }
         
-        // Send message to AI chat engine
+        // Send message to AI chat engine. The response is streamed in via the event handlers.
+        _streaming.store(true, std::memory_order_relaxed);
+        _receivedTokens.store(false, std::memory_order_relaxed);
         _aichatEngine->ChatAsync(input);
-        // Response will come via event handler
     }
     
     void AIChatConnection::_writeToTerminal(std::wstring_view text)
@@ -276,23 +302,85 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
             return;
         }
         
-        // Convert to byte array for terminal output
-        std::string output(text.begin(), text.end());
+        std::string output;
+        if (FAILED_LOG(til::u16u8(text, output)))
+        {
+            return;
+        }
+        
         auto outputData = winrt::array_view<uint8_t const>(
             reinterpret_cast<const uint8_t*>(output.data()), 
-            output.size()
+            gsl::narrow_cast<uint32_t>(output.size())
         );
         
         _terminalOutputHandlers(*this, outputData);
     }
     
+    void AIChatConnection::_flushPendingOutput(std::wstring_view suffix)
+    {
+        // The lock is held while writing, so that a late throttler callback
+        // can't reorder its batch after the prompt written on completion.
+        std::lock_guard lock{ _pendingOutputLock };
+        _pendingOutput.append(suffix);
+        if (!_pendingOutput.empty())
+        {
+            _writeToTerminal(_pendingOutput);
+            _pendingOutput.clear();
+        }
+    }
+    
+    void AIChatConnection::_cancelResponse()
+    {
+        if (!_streaming.exchange(false, std::memory_order_relaxed))
+        {
+            return;
+        }
+        
+        _aichatEngine->CancelResponse();
+        _flushPendingOutput(L"^C\r\n\r\n> ");
+    }
+    
     void AIChatConnection::_handleAIResponse(IInspectable const&, winrt::hstring const& response)
     {
         _writeToTerminal(std::wstring(response) + L"\r\n\r\n> ");
     }
     
+    void AIChatConnection::_handleAIToken(IInspectable const&, winrt::hstring const& token)
+    {
+        if (!_streaming.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+        
+        _receivedTokens.store(true, std::memory_order_relaxed);
+        {
+            std::lock_guard lock{ _pendingOutputLock };
+            _pendingOutput.append(token);
+        }
+        _outputThrottler();
+    }
+    
+    void AIChatConnection::_handleAIResponseCompleted(IInspectable const&, winrt::hstring const& response)
+    {
+        if (!_streaming.exchange(false, std::memory_order_relaxed))
+        {
+            _flushPendingOutput(L"\r\n\r\n> ");
+            return;
+        }
+        
+        std::wstring suffix;
+        if (!_receivedTokens.load(std::memory_order_relaxed))
+        {
+            suffix.append(response);
+        }
+        suffix.append(L"\r\n\r\n> ");
+        _flushPendingOutput(suffix);
+    }
+    
     void AIChatConnection::_handleAIError(IInspectable const&, winrt::hstring const& error)
     {
+        _streaming.store(false, std::memory_order_relaxed);
+        _flushPendingOutput();
         _writeToTerminal(L"AI Error: " + std::wstring(error) + L"\r\n> ");
     }
 }
\ No newline at end of file
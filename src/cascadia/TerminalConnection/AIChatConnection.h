@@ -58,13 +58,26 @@ namespace winrt::Microsoft::Terminal::TerminalConnection::implementation
         winrt::hstring _model{ L"gpt-4" };
         winrt::hstring _apiKey;
         std::wstring _inputBuffer;
+        til::u8state _inputState;
         bool _connected = false;
         
+        // Streamed tokens are coalesced and written at most once per frame.
+        std::mutex _pendingOutputLock;
+        std::wstring _pendingOutput;
+        std::atomic<bool> _streaming{ false };
+        // Cached responses complete without streaming any tokens.
+        std::atomic<bool> _receivedTokens{ false };
+        til::throttled_func_trailing<> _outputThrottler;
+        
         winrt::event<Microsoft::Terminal::TerminalConnection::ConnectionStateChangedEventHandler> _connectionStateChangedHandlers;
         winrt::event<Microsoft::Terminal::TerminalConnection::TerminalOutputEventHandler> _terminalOutputHandlers;
         
         void _handleAIResponse(winrt::Windows::Foundation::IInspectable const& sender, winrt::hstring const& response);
         void _handleAIError(winrt::Windows::Foundation::IInspectable const& sender, winrt::hstring const& error);
+        void _handleAIToken(winrt::Windows::Foundation::IInspectable const& sender, winrt::hstring const& token);
+        void _handleAIResponseCompleted(winrt::Windows::Foundation::IInspectable const& sender, winrt::hstring const& response);
+        void _cancelResponse();
+        void _flushPendingOutput(std::wstring_view suffix = {});
         void _writeToTerminal(std::wstring_view text);
         void _processInput(std::wstring_view input);
     };
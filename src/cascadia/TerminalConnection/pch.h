@@ -37,6 +37,7 @@ TRACELOGGING_DECLARE_PROVIDER(g_hTerminalConnectionProvider);
 #include <telemetry/ProjectTelemetry.h>
 
 #include "til.h"
+#include <til/throttled_func.h>
 #include <til/winrt.h>
 
 #include <cppwinrt_utils.h>
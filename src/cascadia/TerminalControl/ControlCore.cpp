@@ -445,10 +445,23 @@ namespace winrt::Microsoft::Terminal::Control::implementation
     // - <none>
     void ControlCore::_sendInputToConnection(std::wstring_view wstr)
     {
-        if (_connection)
+        if (!_connection)
+        {
+            return;
+        }
+
         {
-            _connection.WriteInput(winrt_wstring_to_array_view(wstr));
+            // Keystrokes and replies to queries (DSR, DA, ...) must not end up in the middle of a paste
+            // that's being streamed, so they wait for it in the same queue.
+            const auto guard = _pasteLock.lock_exclusive();
+            if (_pasteWorkerRunning)
+            {
+                _pasteQueue.emplace_back(PendingPaste{ winrt::hstring{ wstr }, _connection, 0, false, true });
+                return;
+            }
         }
+
+        _connection.WriteInput(winrt_wstring_to_array_view(wstr));
     }
 
     // Method Description:
@@ -513,7 +526,14 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         }
         if (out)
         {
-            SendInput(*out);
+            if (ch == L'\x3' || ch == L'\x1b')
+            {
+                _sendInterrupt(*out);
+            }
+            else
+            {
+                SendInput(*out);
+            }
             return true;
         }
         return false;
@@ -671,7 +691,14 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         }
         if (out)
         {
-            SendInput(*out);
+            if (keyDown && (vkey == VK_ESCAPE || (vkey == 'C' && modifiers.IsCtrlPressed() && !modifiers.IsAltPressed())))
+            {
+                _sendInterrupt(*out);
+            }
+            else
+            {
+                SendInput(*out);
+            }
             return true;
         }
         return false;
@@ -684,9 +711,15 @@ namespace winrt::Microsoft::Terminal::Control::implementation
                                      const TerminalInput::MouseButtonState state)
     {
         TerminalInput::OutputType out;
+        std::optional<uint64_t> flushDelay;
         {
             const auto lock = _terminal->LockForReading();
             out = _terminal->SendMouseEvent(viewportPos, uiButton, states, wheelDelta, state);
+            flushDelay = _terminal->GetPendingMouseMotionDelay();
+        }
+        if (flushDelay)
+        {
+            _scheduleMouseMotionFlush(*flushDelay);
         }
         if (out)
         {
@@ -696,6 +729,55 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         return false;
     }
 
+    // If the mouse comes to rest while its motion is held back by the rate limit
+    // (see the MouseMotionRateLimit setting), no further mouse event would report it.
+    // This timer reports it instead, once the rate limit allows it.
+    void ControlCore::_scheduleMouseMotionFlush(const uint64_t delay)
+    {
+        if (!_mouseMotionFlushTimer)
+        {
+            _mouseMotionFlushTimer = _dispatcher.CreateTimer();
+            _mouseMotionFlushTimer.IsRepeating(false);
+            _mouseMotionFlushTimer.Tick([weakSelf = get_weak()](auto&&, auto&&) {
+                if (const auto self = weakSelf.get())
+                {
+                    self->_flushMouseMotion();
+                }
+            });
+        }
+
+        if (!_mouseMotionFlushTimer.IsRunning())
+        {
+            _mouseMotionFlushTimer.Interval(std::chrono::milliseconds{ delay });
+            _mouseMotionFlushTimer.Start();
+        }
+    }
+
+    void ControlCore::_flushMouseMotion()
+    {
+        TerminalInput::OutputType out;
+        std::optional<uint64_t> flushDelay;
+        {
+            const auto lock = _terminal->LockForReading();
+            // Another motion may have been reported since the timer was started,
+            // in which case the pending one isn't due yet.
+            flushDelay = _terminal->GetPendingMouseMotionDelay();
+            if (flushDelay == 0u)
+            {
+                out = _terminal->FlushMouseMotion();
+                flushDelay.reset();
+            }
+        }
+        if (flushDelay)
+        {
+            _scheduleMouseMotionFlush(*flushDelay);
+        }
+        if (out && !out->empty())
+        {
+            SendInput(*out);
+        }
+    }
+
     void ControlCore::UserScrollViewport(const int viewTop)
     {
         {
@@ -1439,21 +1521,49 @@ namespace winrt::Microsoft::Terminal::Control::implementation
     }
 
     // Method Description:
-    // - Pre-process text pasted (presumably from the clipboard)
-    //   before sending it over the terminal's connection.
+    // - Filters the given text for pasting and writes it to the connection, wrapped in
+    //   bracketed paste sequences if the application requested them.
+    // - Large pastes are streamed to the connection in chunks on a background thread, which avoids
+    //   blocking the UI thread and creating a filtered copy of the entire text. PasteProgress
+    //   is raised after each chunk and CancelPaste() stops them.
+    // Arguments:
+    // - hstr: the text to paste
     void ControlCore::PasteText(const winrt::hstring& hstr)
     {
         using namespace ::Microsoft::Console::Utils;
 
-        auto filtered = FilterStringForPaste(hstr, CarriageReturnNewline | ControlCodes);
-        if (BracketedPasteEnabled())
+        const auto bracketed = BracketedPasteEnabled();
+        auto queued = false;
+        auto startWorker = false;
+
+        if (!_isReadOnly)
         {
-            filtered.insert(0, L"\x1b[200~");
-            filtered.append(L"\x1b[201~");
+            const auto guard = _pasteLock.lock_exclusive();
+            // Once a paste is queued, all following ones need to be as well, or they would overtake it.
+            if (hstr.size() > pasteChunkSize || _pasteWorkerRunning)
+            {
+                _pasteQueue.emplace_back(PendingPaste{ hstr, _connection, _pasteGeneration.load(std::memory_order_relaxed), bracketed });
+                queued = true;
+                startWorker = !std::exchange(_pasteWorkerRunning, true);
+            }
         }
 
-        // It's important to not hold the terminal lock while calling this function as sending the data may take a long time.
-        SendInput(filtered);
+        if (!queued)
+        {
+            auto filtered = FilterStringForPaste(hstr, CarriageReturnNewline | ControlCodes);
+            if (bracketed)
+            {
+                filtered.insert(0, L"\x1b[200~");
+                filtered.append(L"\x1b[201~");
+            }
+
+            // It's important to not hold the terminal lock while calling this function as sending the data may take a long time.
+            SendInput(filtered);
+        }
+        else if (startWorker)
+        {
+            _pasteWorker();
+        }
 
         const auto lock = _terminal->LockForWriting();
         _terminal->ClearSelection();
@@ -1461,6 +1571,128 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         _terminal->TrySnapOnInput();
     }
 
+    // Method Description:
+    // - Cancels the pastes that are currently being streamed to the connection or queued to be.
+    //   Bracketed pastes that were already started are still terminated properly.
+    void ControlCore::CancelPaste()
+    {
+        _pasteGeneration.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Ctrl+C and Esc are how users abort what they just did, including a paste that's taking long.
+    // While a paste is being streamed, they cancel it and skip the queue of other input that waits
+    // for it: They're written as soon as the chunk that's in flight and its bracketed paste
+    // terminator are, so that the application doesn't consider them to be part of the paste.
+    void ControlCore::_sendInterrupt(std::wstring_view wstr)
+    {
+        if (!_isReadOnly && _connection)
+        {
+            const auto guard = _pasteLock.lock_exclusive();
+            if (_pasteWorkerRunning)
+            {
+                CancelPaste();
+                const auto it = std::find_if(_pasteQueue.begin(), _pasteQueue.end(), [](const auto& paste) { return !paste.interrupt; });
+                _pasteQueue.emplace(it, PendingPaste{ winrt::hstring{ wstr }, _connection, 0, false, true, true });
+                return;
+            }
+        }
+
+        SendInput(wstr);
+    }
+
+    // Streams the queued pastes to their connection, one after another, on a background thread.
+    safe_void_coroutine ControlCore::_pasteWorker()
+    {
+        // Close() cancels all pastes, so this won't keep us alive for long.
+        const auto strongThis = get_strong();
+
+        co_await winrt::resume_background();
+
+        for (;;)
+        {
+            PendingPaste paste;
+            {
+                const auto guard = _pasteLock.lock_exclusive();
+                if (_pasteQueue.empty())
+                {
+                    _pasteWorkerRunning = false;
+                    break;
+                }
+                paste = std::move(_pasteQueue.front());
+                _pasteQueue.pop_front();
+            }
+
+            try
+            {
+                _streamPaste(paste);
+            }
+            CATCH_LOG();
+        }
+    }
+
+    // Filters the paste one chunk at a time and writes it to the connection. WriteInput() blocks until
+    // the previous chunk has been written, which throttles us to the rate at which the connection
+    // consumes our input, instead of buffering megabytes of it somewhere.
+    void ControlCore::_streamPaste(const PendingPaste& paste)
+    {
+        using namespace ::Microsoft::Console::Utils;
+
+        if (paste.raw)
+        {
+            if (paste.connection)
+            {
+                paste.connection.WriteInput(winrt_wstring_to_array_view(paste.text));
+            }
+            return;
+        }
+
+        const std::wstring_view text{ paste.text };
+        const auto total = text.size();
+        std::wstring chunk;
+        chunk.reserve(pasteChunkSize + 12);
+        wchar_t previous = 0;
+        size_t sent = 0;
+
+        while (sent < total)
+        {
+            if (_pasteGeneration.load(std::memory_order_relaxed) != paste.generation)
+            {
+                // Applications consider all input to be part of the paste until it's terminated.
+                if (sent != 0 && paste.bracketed && paste.connection)
+                {
+                    paste.connection.WriteInput(winrt_wstring_to_array_view(L"\x1b[201~"));
+                }
+                return;
+            }
+
+            auto count = std::min(pasteChunkSize, total - sent);
+            // Connections convert each chunk to UTF-8 on its own, so we must not split surrogate pairs.
+            if (sent + count < total && til::is_leading_surrogate(til::at(text, sent + count - 1)))
+            {
+                --count;
+            }
+
+            chunk.clear();
+            if (sent == 0 && paste.bracketed)
+            {
+                chunk.append(L"\x1b[200~");
+            }
+            FilterStringForPaste(text.substr(sent, count), CarriageReturnNewline | ControlCodes, previous, chunk);
+            sent += count;
+            if (sent == total && paste.bracketed)
+            {
+                chunk.append(L"\x1b[201~");
+            }
+
+            if (paste.connection && !chunk.empty())
+            {
+                paste.connection.WriteInput(winrt_wstring_to_array_view(chunk));
+            }
+
+            PasteProgress.raise(*this, winrt::make<implementation::PasteProgressEventArgs>(sent, total));
+        }
+    }
+
     FontInfo ControlCore::GetFont() const
     {
         return _actualFont;
@@ -1818,6 +2050,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
             _midiAudio.BeginSkip();
         }
 
+        CancelPaste();
         _closeConnection();
     }
 
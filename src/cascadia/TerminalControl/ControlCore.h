@@ -124,6 +124,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
 
         void SendInput(std::wstring_view wstr);
         void PasteText(const winrt::hstring& hstr);
+        void CancelPaste();
         bool CopySelectionToClipboard(bool singleLine, bool withControlSequences, const Windows::Foundation::IReference<CopyFormat>& formats);
         void SelectAll();
         void ClearSelection();
@@ -294,6 +295,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         til::typed_event<IInspectable, Control::UpdateSelectionMarkersEventArgs> UpdateSelectionMarkers;
         til::typed_event<IInspectable, Control::OpenHyperlinkEventArgs> OpenHyperlink;
         til::typed_event<IInspectable, Control::CompletionsChangedEventArgs> CompletionsChanged;
+        til::typed_event<IInspectable, Control::PasteProgressEventArgs> PasteProgress;
         til::typed_event<IInspectable, Control::SearchMissingCommandEventArgs> SearchMissingCommand;
         til::typed_event<> RefreshQuickFixUI;
         til::typed_event<IInspectable, Control::WindowSizeChangedEventArgs> WindowSizeChanged;
@@ -312,6 +314,22 @@ namespace winrt::Microsoft::Terminal::Control::implementation
             std::shared_ptr<ThrottledFuncTrailing<Control::ScrollPositionChangedArgs>> updateScrollBar;
         };
 
+        struct PendingPaste
+        {
+            winrt::hstring text;
+            TerminalConnection::ITerminalConnection connection{ nullptr };
+            uint64_t generation = 0;
+            bool bracketed = false;
+            // Other input that arrived while a paste was being streamed. It's written as is,
+            // after the pastes before it, and isn't affected by CancelPaste().
+            bool raw = false;
+            // Ctrl+C or Esc, which are queued in front of everything else (see _sendInterrupt()).
+            bool interrupt = false;
+        };
+
+        // Pastes longer than this are streamed to the connection in chunks of this size (in UTF-16 code units).
+        static constexpr size_t pasteChunkSize = 64 * 1024;
+
         void _setupDispatcherAndCallbacks();
         void _closeConnection();
 
@@ -322,7 +340,12 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         bool _shouldTryUpdateSelection(const WORD vkey);
 
         void _handleControlC();
+        void _scheduleMouseMotionFlush(uint64_t delay);
+        void _flushMouseMotion();
         void _sendInputToConnection(std::wstring_view wstr);
+        void _sendInterrupt(std::wstring_view wstr);
+        safe_void_coroutine _pasteWorker();
+        void _streamPaste(const PendingPaste& paste);
 
 #pragma region TerminalCoreCallbacks
         void _terminalCopyToClipboard(wil::zwstring_view wstr);
@@ -408,6 +431,7 @@ namespace winrt::Microsoft::Terminal::Control::implementation
 
         // Other stuff.
         winrt::Windows::System::DispatcherQueue _dispatcher{ nullptr };
+        winrt::Windows::System::DispatcherQueueTimer _mouseMotionFlushTimer{ nullptr };
         winrt::com_ptr<ControlSettings> _settings{ nullptr };
         til::point _contextMenuBufferPosition{ 0, 0 };
         Windows::Foundation::Collections::IVector<hstring> _cachedQuickFixes{ nullptr };
@@ -420,6 +444,14 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         bool _isReadOnly{ false };
         bool _closing{ false };
 
+        // Pastes that are waiting to be streamed by _pasteWorker(), which runs while _pasteWorkerRunning is set.
+        // While it runs, all other input is queued here as well, so that it can't end up inside a paste.
+        // CancelPaste() increments _pasteGeneration, which cancels all pastes queued before the call.
+        wil::srwlock _pasteLock;
+        std::deque<PendingPaste> _pasteQueue;
+        bool _pasteWorkerRunning{ false };
+        std::atomic<uint64_t> _pasteGeneration{ 0 };
+
         // ----------------------------------------------------------------------------------------
         // These are ordered last to ensure they're destroyed first.
         // This ensures that their respective contents stops taking dependency on the above.
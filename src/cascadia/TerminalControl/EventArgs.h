@@ -14,6 +14,7 @@
 #include "TransparencyChangedEventArgs.g.h"
 #include "ShowWindowArgs.g.h"
 #include "UpdateSelectionMarkersEventArgs.g.h"
+#include "PasteProgressEventArgs.g.h"
 #include "CompletionsChangedEventArgs.g.h"
 #include "KeySentEventArgs.g.h"
 #include "CharSentEventArgs.g.h"
@@ -164,6 +165,19 @@ namespace winrt::Microsoft::Terminal::Control::implementation
         WINRT_PROPERTY(bool, ClearMarkers, false);
     };
 
+    struct PasteProgressEventArgs : public PasteProgressEventArgsT<PasteProgressEventArgs>
+    {
+    public:
+        PasteProgressEventArgs(const uint64_t sent, const uint64_t total) :
+            _Sent(sent),
+            _Total(total)
+        {
+        }
+
+        WINRT_PROPERTY(uint64_t, Sent, 0);
+        WINRT_PROPERTY(uint64_t, Total, 0);
+    };
+
     struct CompletionsChangedEventArgs : public CompletionsChangedEventArgsT<CompletionsChangedEventArgs>
     {
     public:
@@ -24,6 +24,162 @@ using namespace Microsoft::Console::VirtualTerminal;
 
 using PointTree = interval_tree::IntervalTree<til::point, size_t>;
 
+static constexpr std::wstring_view urlPattern{ LR"(\b(?:https?|ftp|file)://[-A-Za-z0-9+&@#/%?=~_|$!:,.;]*[A-Za-z0-9+&@#/%=~_|$])" };
+
+// Returns a string that every match of the given regex pattern contains, or an empty one if
+// there's no such string or we failed to find it. Searching a line for it is much cheaper
+// than running the regex engine, which allows us to skip most lines without a match.
+// This is conservative and only considers literal characters outside of groups and sets.
+static std::wstring requiredLiteral(const std::wstring_view& pattern)
+{
+    std::wstring best;
+    std::wstring run;
+    const auto endRun = [&]() {
+        if (run.size() > best.size())
+        {
+            best = run;
+        }
+        run.clear();
+    };
+
+    const auto len = pattern.size();
+    size_t depth = 0;
+
+    for (size_t i = 0; i < len; ++i)
+    {
+        const auto ch = til::at(pattern, i);
+        switch (ch)
+        {
+        case L'\\':
+        {
+            if (i + 1 >= len)
+            {
+                return {};
+            }
+            const auto next = til::at(pattern, ++i);
+            if (!iswalnum(next))
+            {
+                // An escaped punctuation character like \. or \/ matches itself.
+                if (depth == 0)
+                {
+                    run.push_back(next);
+                }
+            }
+            else if (std::wstring_view{ L"bBdDsSwWhHvVRXAzZGntrfae" }.find(next) != std::wstring_view::npos)
+            {
+                endRun();
+            }
+            else
+            {
+                // Escapes like \x{...}, \p{...} or \Q...\E span a variable number of characters.
+                endRun();
+                return best;
+            }
+            break;
+        }
+        case L'[':
+        {
+            // Skip the set, including nested ones like [[a-z]&&[^x]].
+            endRun();
+            size_t nesting = 1;
+            if (i + 1 < len && til::at(pattern, i + 1) == L'^')
+            {
+                ++i;
+            }
+            if (i + 1 < len && til::at(pattern, i + 1) == L']')
+            {
+                return {};
+            }
+            while (nesting != 0)
+            {
+                if (++i >= len)
+                {
+                    return {};
+                }
+                switch (til::at(pattern, i))
+                {
+                case L'\\':
+                    ++i;
+                    break;
+                case L'[':
+                    ++nesting;
+                    break;
+                case L']':
+                    --nesting;
+                    break;
+                default:
+                    break;
+                }
+            }
+            break;
+        }
+        case L'(':
+            endRun();
+            // Flags like (?i) or (?x) change what literal characters match.
+            if (i + 1 < len && til::at(pattern, i + 1) == L'?')
+            {
+                for (auto j = i + 2; j < len && (iswalpha(til::at(pattern, j)) || til::at(pattern, j) == L'-'); ++j)
+                {
+                    if (til::at(pattern, j) == L'i' || til::at(pattern, j) == L'x')
+                    {
+                        return {};
+                    }
+                }
+            }
+            ++depth;
+            break;
+        case L')':
+            if (depth == 0)
+            {
+                return {};
+            }
+            --depth;
+            break;
+        case L'|':
+            // A top-level alternation means that none of the characters are required.
+            // Inside a group it only affects the group, which we skip anyway.
+            if (depth == 0)
+            {
+                return {};
+            }
+            break;
+        case L'?':
+        case L'*':
+        case L'{':
+            // These make the preceding character optional.
+            if (depth == 0 && !run.empty())
+            {
+                run.pop_back();
+            }
+            endRun();
+            if (ch == L'{')
+            {
+                i = pattern.find(L'}', i);
+                if (i == std::wstring_view::npos)
+                {
+                    return {};
+                }
+            }
+            break;
+        case L'+':
+        case L'^':
+        case L'$':
+        case L'.':
+            endRun();
+            break;
+        default:
+            if (depth == 0)
+            {
+                run.push_back(ch);
+            }
+            break;
+        }
+    }
+
+    endRun();
+    return best;
+}
+
 #pragma warning(suppress : 26455) // default constructor is throwing, too much effort to rearrange at this time.
 Terminal::Terminal()
 {
@@ -98,6 +254,7 @@ void Terminal::UpdateSettings(ICoreSettings settings)
     }
 
     _getTerminalInput().ForceDisableWin32InputMode(settings.ForceVTInput());
+    _getTerminalInput().SetMouseMotionRateLimit(gsl::narrow_cast<unsigned int>(std::max(0, settings.MouseMotionRateLimit())));
 
     if (settings.TabColor() == nullptr)
     {
@@ -127,7 +284,23 @@ void Terminal::UpdateSettings(ICoreSettings settings)
     {
         // Clear the patterns first
         _detectURLs = settings.DetectURLs();
-        _updateUrlDetection();
+
+        std::vector<std::wstring> patterns;
+        if (const auto detectPatterns = settings.DetectPatterns())
+        {
+            for (const auto& pattern : detectPatterns)
+            {
+                patterns.emplace_back(pattern);
+            }
+        }
+        if (patterns != _patterns)
+        {
+            SetPatterns(std::move(patterns));
+        }
+        else
+        {
+            _updateUrlDetection();
+        }
     }
 }
 
@@ -542,7 +715,8 @@ std::wstring Terminal::GetHyperlinkAtBufferPosition(const til::point bufferPos)
     }
 
     // Case 2 - Step 2: get the auto-detected hyperlink
-    if (result.has_value() && result->value == _hyperlinkPatternId)
+    // Matches of the custom patterns are clickable just like URLs.
+    if (result.has_value())
     {
         return _activeBuffer().GetPlainText(result->start, result->stop);
     }
@@ -571,13 +745,7 @@ std::optional<PointTree::interval> Terminal::GetHyperlinkIntervalFromViewportPos
     const auto results = _patternIntervalTree.findOverlapping({ viewportPos.x + 1, viewportPos.y }, viewportPos);
     if (results.size() > 0)
     {
-        for (const auto& result : results)
-        {
-            if (result.value == _hyperlinkPatternId)
-            {
-                return result;
-            }
-        }
+        return results.front();
     }
     return std::nullopt;
 }
@@ -693,6 +861,21 @@ TerminalInput::OutputType Terminal::SendMouseEvent(til::point viewportPos, const
     return _getTerminalInput().HandleMouse(viewportPos, uiButton, GET_KEYSTATE_WPARAM(states.Value()), wheelDelta, state);
 }
 
+// Method Description:
+// - Returns how long to wait before calling FlushMouseMotion(), if a mouse
+//   motion was held back by the rate limit. See TerminalInput::SetMouseMotionRateLimit().
+std::optional<uint64_t> Terminal::GetPendingMouseMotionDelay() const noexcept
+{
+    return _getTerminalInput().GetPendingMouseMotionDelay();
+}
+
+// Method Description:
+// - Reports the mouse motion that was held back by the rate limit, if any.
+TerminalInput::OutputType Terminal::FlushMouseMotion()
+{
+    return _getTerminalInput().FlushMouseMotion();
+}
+
 // Method Description:
 // - Send this particular character to the terminal.
 // - This method is the counterpart to SendKeyEvent and behaves almost identical.
@@ -1199,12 +1382,108 @@ void Terminal::SetCursorOn(const bool isOn) noexcept
 // - Update our internal knowledge about where regex patterns are on the screen
 // - This is called by TerminalControl (through a throttled function) when the visible
 //   region changes (for example by text entering the buffer or scrolling)
+// - Only lines with rows that were modified since the last call (or that scrolled into view)
+//   are searched again. Whether a row was modified is told by its generation, which
+//   avoids reading the text of the other ones. If no pattern changed, nothing gets invalidated.
 // - INVARIANT: this function can only be called if the caller has the writing lock on the terminal
 void Terminal::UpdatePatternsUnderLock()
 {
-    _InvalidatePatternTree();
-    _patternIntervalTree = _getPatterns(_VisibleStartIndex(), _VisibleEndIndex());
-    _InvalidatePatternTree();
+    if (!_detectURLs)
+    {
+        _patternLineCache.clear();
+        _clearPatternTree();
+        return;
+    }
+
+    if (_patternMatcher.groups.empty())
+    {
+        _compilePatterns();
+    }
+
+    const auto& buffer = _activeBuffer();
+    const auto beg = _VisibleStartIndex();
+    const auto end = _VisibleEndIndex() + 1;
+    decltype(_patternLineCache) lineCache;
+    PointTree::interval_vector intervals;
+    std::vector<uint64_t> generations;
+    std::wstring text;
+
+    for (auto y = beg; y < end;)
+    {
+        // Same as _getPatternLine(), but without reading the text.
+        const auto lineBeg = y;
+        generations.clear();
+        while (y < end)
+        {
+            const auto& row = buffer.GetRowByOffset(y++);
+            generations.emplace_back(row.GetGeneration());
+            if (!row.WasWrapForced())
+            {
+                break;
+            }
+        }
+
+        const auto key = generations.front();
+        const auto matches = [&](const auto& it) {
+            return it->second.generations == generations;
+        };
+
+        // Rows that were never written to share the same generation and may occur more than once in
+        // the viewport, which is why we check the new cache first: We already moved them out of the old one.
+        auto it = lineCache.find(key);
+        if (it == lineCache.end() || !matches(it))
+        {
+            PatternLine line;
+            if (const auto old = _patternLineCache.find(key); old != _patternLineCache.end() && matches(old))
+            {
+                line = std::move(old->second);
+                _patternLineCache.erase(old);
+            }
+            else
+            {
+                line.generations = generations;
+                _getPatternLine(lineBeg, y, text);
+                if (_hasPatternCandidate(text))
+                {
+                    _findPatterns(lineBeg, y, lineBeg, line.intervals);
+                }
+            }
+            it = lineCache.insert_or_assign(key, std::move(line)).first;
+        }
+
+        // The cached intervals are relative to the start of the line, but PointTree is relative to the viewport.
+        for (auto interval : it->second.intervals)
+        {
+            interval.start.y += lineBeg - beg;
+            interval.stop.y += lineBeg - beg;
+            intervals.emplace_back(interval);
+        }
+    }
+
+    _patternLineCache = std::move(lineCache);
+
+    if (intervals != _patternIntervals)
+    {
+        _InvalidatePatternTree();
+        _patternIntervals = std::move(intervals);
+        _patternIntervalTree = PointTree{ PointTree::interval_vector{ _patternIntervals } };
+        _InvalidatePatternTree();
+    }
+}
+
+// Method Description:
+// - Sets the regex patterns that are detected in addition to URLs. Their pattern IDs
+//   start at 1 in the order they're given. Invalid patterns are ignored.
+// - INVARIANT: this function can only be called if the caller has the writing lock on the terminal
+// Arguments:
+// - patterns: the ICU regular expressions to detect
+void Terminal::SetPatterns(std::vector<std::wstring> patterns)
+{
+    _patterns = std::move(patterns);
+    _patternMatcher = {};
+    _patternLineCache.clear();
+    _clearPatternTree();
+    _updateUrlDetection();
 }
 
 // Method Description:
@@ -1219,6 +1498,7 @@ void Terminal::_clearPatternTree()
         _InvalidatePatternTree();
         _patternIntervalTree = {};
     }
+    _patternIntervals.clear();
 }
 
 // Method Description:
@@ -1380,6 +1660,7 @@ void Terminal::_updateUrlDetection()
     }
     else
     {
+        _patternLineCache.clear();
         _clearPatternTree();
     }
 }
@@ -1451,42 +1732,170 @@ private:
 
 static URegularExpressionInterner uregexInterner;
 
-PointTree Terminal::_getPatterns(til::CoordType beg, til::CoordType end) const
+// Compiles the URL pattern and the additional _patterns into a single regex. Since they're
+// combined as alternatives, the first pattern that matches at a position wins and numbered
+// backreferences (\1) won't work. Named groups and backreferences (\k<name>) are fine,
+// as long as no two patterns use the same group name.
+void Terminal::_compilePatterns() const
 {
-    static constexpr std::array<std::wstring_view, 1> patterns{
-        LR"(\b(?:https?|ftp|file)://[-A-Za-z0-9+&@#/%?=~_|$!:,.;]*[A-Za-z0-9+&@#/%=~_|$])",
-    };
+    PatternMatcher matcher;
+    std::wstring combined;
+    std::wstring candidate;
+    int32_t group = 1;
+    auto hasLiterals = true;
+
+    for (size_t id = 0; id <= _patterns.size(); ++id)
+    {
+        const std::wstring_view pattern = id == 0 ? urlPattern : til::at(_patterns, id - 1);
+
+        candidate = combined;
+        if (!candidate.empty())
+        {
+            candidate.push_back(L'|');
+        }
+        candidate.push_back(L'(');
+        candidate.append(pattern);
+        candidate.push_back(L')');
+
+        // Each pattern is checked along with the ones before it, so that a single bad one doesn't break
+        // all others: Besides invalid patterns, that catches ones that reuse a group name, or that are
+        // only valid on their own, like an unterminated \Q quote that would swallow the parenthesis.
+        UErrorCode status = U_ZERO_ERROR;
+        const auto re = til::ICU::CreateRegex(candidate, 0, &status);
+        const auto groupCount = uregex_groupCount(re.get(), &status) - group;
+        if (U_FAILURE(status))
+        {
+            LOG_HR_MSG(E_INVALIDARG, "Ignoring pattern %zu: %.*ls (%hs)", id, gsl::narrow_cast<int>(pattern.size()), pattern.data(), u_errorName(status));
+            matcher.groups.emplace_back(-1);
+            continue;
+        }
+
+        combined = std::move(candidate);
+        matcher.groups.emplace_back(group);
+        group += 1 + groupCount;
+
+        if (hasLiterals)
+        {
+            auto literal = requiredLiteral(pattern);
+            if (literal.empty())
+            {
+                hasLiterals = false;
+                matcher.literals.clear();
+            }
+            else if (std::find(matcher.literals.begin(), matcher.literals.end(), literal) == matcher.literals.end())
+            {
+                matcher.literals.emplace_back(std::move(literal));
+            }
+        }
+    }
+
+    matcher.re = uregexInterner.Intern(combined);
+    _patternMatcher = std::move(matcher);
+}
+
+bool Terminal::_hasPatternCandidate(const std::wstring_view& text) const noexcept
+{
+    const auto& literals = _patternMatcher.literals;
+    return literals.empty() || std::any_of(literals.begin(), literals.end(), [&](const auto& literal) {
+               return text.find(literal) != std::wstring_view::npos;
+           });
+}
 
+PointTree Terminal::_getPatterns(til::CoordType beg, til::CoordType end) const
+{
     if (!_detectURLs)
     {
         return {};
     }
+    if (_patternMatcher.groups.empty())
+    {
+        _compilePatterns();
+    }
 
-    auto text = ICU::UTextFromTextBuffer(_activeBuffer(), beg, end + 1);
-    UErrorCode status = U_ZERO_ERROR;
     PointTree::interval_vector intervals;
+    std::wstring text;
 
-    for (size_t i = 0; i < patterns.size(); ++i)
+    for (auto y = beg; y <= end;)
     {
-        const auto re = uregexInterner.Intern(patterns.at(i));
-        uregex_setUText(re.get(), &text, &status);
-
-        if (uregex_find(re.get(), -1, &status))
+        const auto lineBeg = y;
+        y = _getPatternLine(y, end + 1, text);
+        if (_hasPatternCandidate(text))
         {
-            do
-            {
-                auto range = ICU::BufferRangeFromMatch(&text, re.get());
-                // PointTree uses half-open ranges and viewport-relative coordinates.
-                range.start.y -= beg;
-                range.end.y -= beg;
-                intervals.push_back(PointTree::interval(range.start, range.end, 0));
-            } while (uregex_findNext(re.get(), &status));
+            _findPatterns(lineBeg, y, beg, intervals);
         }
     }
 
     return PointTree{ std::move(intervals) };
 }
 
+// Stores the text of the logical line that starts at row `beg` in `text` and returns the row past its end.
+// A logical line ends at the first row that wasn't wrapped, or at `limit`, whichever comes first.
+// Patterns can't span multiple logical lines, which allows us to search (and cache) them one at a time.
+til::CoordType Terminal::_getPatternLine(til::CoordType beg, til::CoordType limit, std::wstring& text) const
+{
+    const auto& buffer = _activeBuffer();
+    auto y = beg;
+
+    text.clear();
+    while (y < limit)
+    {
+        const auto& row = buffer.GetRowByOffset(y++);
+        text.append(row.GetText());
+        if (!row.WasWrapForced())
+        {
+            break;
+        }
+    }
+
+    return y;
+}
+
+// Finds all patterns in the rows [lineBeg, lineEnd) and appends them to `intervals`,
+// with their y-coordinates relative to the row `origin`.
+void Terminal::_findPatterns(til::CoordType lineBeg, til::CoordType lineEnd, til::CoordType origin, PointTree::interval_vector& intervals) const
+{
+    const auto re = _patternMatcher.re.get();
+    if (!re)
+    {
+        return;
+    }
+
+    const auto& groups = _patternMatcher.groups;
+    auto text = ICU::UTextFromTextBuffer(_activeBuffer(), lineBeg, lineEnd);
+    UErrorCode status = U_ZERO_ERROR;
+    uregex_setUText(re, &text, &status);
+
+    if (uregex_find(re, -1, &status))
+    {
+        do
+        {
+            // Patterns that match nothing would otherwise create empty intervals.
+            if (uregex_start64(re, 0, &status) == uregex_end64(re, 0, &status))
+            {
+                continue;
+            }
+
+            // The pattern that matched is the one whose capture group participated in the match.
+            const auto it = std::find_if(groups.begin(), groups.end(), [&](const int32_t group) {
+                return group > 0 && uregex_start64(re, group, &status) >= 0;
+            });
+            if (it == groups.end())
+            {
+                continue;
+            }
+
+            auto range = ICU::BufferRangeFromMatch(&text, re);
+            // PointTree uses half-open ranges and viewport-relative coordinates.
+            range.start.y -= origin;
+            range.end.y -= origin;
+            intervals.push_back(PointTree::interval(range.start, range.end, gsl::narrow_cast<size_t>(it - groups.begin())));
+        } while (uregex_findNext(re, &status));
+    }
+
+    // The regex is reused across calls, so it must not keep referring to our UText.
+    uregex_setText(re, u"", 0, &status);
+}
+
 // NOTE: This is the version of AddMark that comes from the UI. The VT api call into this too.
 void Terminal::AddMarkFromUI(ScrollbarData mark,
                              til::CoordType y)
@@ -1543,6 +1952,11 @@ std::vector<MarkExtents> Terminal::GetMarkExtents() const
     // hide them.
     return _inAltBuffer() ? std::vector<MarkExtents>{} : _activeBuffer().GetMarkExtents();
 }
+std::vector<CommandContext> Terminal::GetCommandContext(const size_t limit, const size_t maxOutputLength) const
+{
+    // Just like the marks, the commands are hidden in the alt buffer.
+    return _inAltBuffer() ? std::vector<CommandContext>{} : _activeBuffer().GetCommandContext(limit, maxOutputLength);
+}
 
 til::color Terminal::GetColorForMark(const ScrollbarData& markData) const
 {
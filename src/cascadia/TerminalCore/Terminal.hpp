@@ -16,6 +16,7 @@
 #include "../../cascadia/terminalcore/ITerminalInput.hpp"
 
 #include <til/generational.h>
+#include <til/regex.h>
 #include <til/ticket_lock.h>
 #include <til/winrt.h>
 
@@ -120,6 +121,7 @@ public:
 
     std::vector<ScrollMark> GetMarkRows() const;
     std::vector<MarkExtents> GetMarkExtents() const;
+    std::vector<CommandContext> GetCommandContext(size_t limit, size_t maxOutputLength) const;
     void AddMarkFromUI(ScrollbarData mark, til::CoordType y);
 
     til::property<bool> AlwaysNotifyOnBufferRotation;
@@ -181,6 +183,8 @@ public:
 
     void TrySnapOnInput() override;
     bool IsTrackingMouseInput() const noexcept;
+    std::optional<uint64_t> GetPendingMouseMotionDelay() const noexcept;
+    [[nodiscard]] ::Microsoft::Console::VirtualTerminal::TerminalInput::OutputType FlushMouseMotion();
     bool ShouldSendAlternateScroll(const unsigned int uiButton, const int32_t delta) const noexcept;
 
     std::wstring GetHyperlinkAtViewportPosition(const til::point viewportPos);
@@ -245,6 +249,7 @@ public:
     void SetCursorOn(const bool isOn) noexcept;
 
     void UpdatePatternsUnderLock();
+    void SetPatterns(std::vector<std::wstring> patterns);
 
     const std::optional<til::color> GetTabColor() const;
 
@@ -438,6 +443,31 @@ private:
     //      Either way, we should make this behavior controlled by a setting.
 
     interval_tree::IntervalTree<til::point, size_t> _patternIntervalTree;
+    interval_tree::IntervalTree<til::point, size_t>::interval_vector _patternIntervals;
+    // The patterns found in each logical line of the viewport during the last UpdatePatternsUnderLock(),
+    // keyed by the generation of the line's first row (see ROW::GetGeneration()). Lines whose rows
+    // haven't been modified since then, including ones that merely scrolled, reuse these results
+    // instead of being searched again. It is only cleared when the patterns change or detection is disabled.
+    struct PatternLine
+    {
+        std::vector<uint64_t> generations;
+        interval_tree::IntervalTree<til::point, size_t>::interval_vector intervals;
+    };
+    std::unordered_map<uint64_t, PatternLine> _patternLineCache;
+    // Additional patterns to detect, besides URLs. The pattern ID of _patterns[i] is i + 1.
+    std::vector<std::wstring> _patterns;
+    // All patterns compiled into a single regex by _compilePatterns(), so that each line
+    // is scanned once, no matter how many patterns there are. Each pattern is wrapped in a
+    // capture group and `groups` maps pattern IDs to them (-1 if the pattern is invalid).
+    // `literals` contains strings of which at least one must be present in a line for any
+    // pattern to match. It's empty if there's a pattern without such a required string.
+    struct PatternMatcher
+    {
+        til::ICU::unique_uregex re;
+        std::vector<int32_t> groups;
+        std::vector<std::wstring> literals;
+    };
+    mutable PatternMatcher _patternMatcher;
     void _clearPatternTree();
     void _InvalidatePatternTree();
     void _InvalidateFromCoords(const til::point start, const til::point end);
@@ -475,6 +505,10 @@ private:
     TextBuffer& _activeBuffer() const noexcept;
     void _updateUrlDetection();
     interval_tree::IntervalTree<til::point, size_t> _getPatterns(til::CoordType beg, til::CoordType end) const;
+    til::CoordType _getPatternLine(til::CoordType beg, til::CoordType limit, std::wstring& text) const;
+    void _compilePatterns() const;
+    bool _hasPatternCandidate(const std::wstring_view& text) const noexcept;
+    void _findPatterns(til::CoordType lineBeg, til::CoordType lineEnd, til::CoordType origin, interval_tree::IntervalTree<til::point, size_t>::interval_vector& intervals) const;
 
 #pragma region TextSelection
     // These methods are defined in TerminalSelection.cpp
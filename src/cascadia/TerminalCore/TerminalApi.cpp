@@ -394,8 +394,11 @@ void Terminal::NotifyBufferRotation(const int delta)
         }
     }
 
-    // manually erase our pattern intervals since the locations have changed now
-    _patternIntervalTree = {};
+    // manually erase our pattern intervals since the locations have changed now.
+    // This must clear the cached intervals as well, or the next update would find
+    // them unchanged and never rebuild the tree. The lines keep their cached patterns,
+    // since rows retain their generation when the buffer rotates.
+    _clearPatternTree();
 
     const auto oldScrollOffset = _scrollOffset;
     _PreserveUserScrollOffset(delta);
@@ -105,21 +105,12 @@ const std::vector<size_t> Terminal::GetPatternId(const til::point location) cons
     _assertLocked();
 
     // Look through our interval tree for this location
-    const auto intervals = _patternIntervalTree.findOverlapping({ location.x + 1, location.y }, location);
-    if (intervals.size() == 0)
+    std::vector<size_t> result{};
+    for (const auto& interval : _patternIntervalTree.findOverlapping({ location.x + 1, location.y }, location))
     {
-        return {};
+        result.emplace_back(interval.value);
     }
-    else
-    {
-        std::vector<size_t> result{};
-        for (const auto& interval : intervals)
-        {
-            result.emplace_back(interval.value);
-        }
-        return result;
-    }
-    return {};
+    return result;
 }
 
 std::pair<COLORREF, COLORREF> Terminal::GetAttributeColors(const TextAttribute& attr) const noexcept
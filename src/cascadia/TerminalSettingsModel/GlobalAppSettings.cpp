@@ -100,6 +100,14 @@ winrt::com_ptr<GlobalAppSettings> GlobalAppSettings::Copy() const
             globals->_DisabledProfileSources->Append(src);
         }
     }
+    if (_DetectPatterns)
+    {
+        globals->_DetectPatterns = winrt::single_threaded_vector<hstring>();
+        for (const auto& pattern : *_DetectPatterns)
+        {
+            globals->_DetectPatterns->Append(pattern);
+        }
+    }
 
     for (const auto& parent : _parents)
     {
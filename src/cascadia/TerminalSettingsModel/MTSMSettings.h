@@ -34,6 +34,8 @@ Author(s):
     X(bool, UseBackgroundImageForWindow, "experimental.useBackgroundImageForWindow", false)                                                                                                           \
     X(bool, TrimBlockSelection, "trimBlockSelection", true)                                                                                                                                           \
     X(bool, DetectURLs, "experimental.detectURLs", true)                                                                                                                                              \
+    X(winrt::Windows::Foundation::Collections::IVector<winrt::hstring>, DetectPatterns, "experimental.detectPatterns", nullptr)                                                                       \
+    X(int32_t, MouseMotionRateLimit, "experimental.mouseMotionRateLimit", 0)                                                                                                                          \
     X(bool, AlwaysShowTabs, "alwaysShowTabs", true)                                                                                                                                                   \
     X(Model::NewTabPosition, NewTabPosition, "newTabPosition", Model::NewTabPosition::AfterLastTab)                                                                                                   \
     X(bool, ShowTitleInTitlebar, "showTerminalTitleInTitlebar", true)                                                                                                                                 \
@@ -377,6 +377,8 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
         _UseBackgroundImageForWindow = globalSettings.UseBackgroundImageForWindow();
         _TrimBlockSelection = globalSettings.TrimBlockSelection();
         _DetectURLs = globalSettings.DetectURLs();
+        _DetectPatterns = globalSettings.DetectPatterns();
+        _MouseMotionRateLimit = globalSettings.MouseMotionRateLimit();
         _EnableUnfocusedAcrylic = globalSettings.EnableUnfocusedAcrylic();
     }
 
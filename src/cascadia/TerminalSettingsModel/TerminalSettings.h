@@ -99,6 +99,8 @@ namespace winrt::Microsoft::Terminal::Settings::Model::implementation
         INHERITABLE_SETTING(Model::TerminalSettings, bool, AllowVtChecksumReport, false);
         INHERITABLE_SETTING(Model::TerminalSettings, bool, TrimBlockSelection, true);
         INHERITABLE_SETTING(Model::TerminalSettings, bool, DetectURLs, true);
+        INHERITABLE_SETTING(Model::TerminalSettings, Windows::Foundation::Collections::IVector<hstring>, DetectPatterns, nullptr);
+        INHERITABLE_SETTING(Model::TerminalSettings, int32_t, MouseMotionRateLimit, 0);
         INHERITABLE_SETTING(Model::TerminalSettings, bool, AllowVtClipboardWrite, true);
 
         INHERITABLE_SETTING(Model::TerminalSettings, Windows::Foundation::IReference<Microsoft::Terminal::Core::Color>, TabColor, nullptr);
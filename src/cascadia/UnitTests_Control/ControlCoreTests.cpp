@@ -7,6 +7,9 @@
 #include "MockControlSettings.h"
 #include "MockConnection.h"
 #include "../../inc/TestUtils.h"
+#include "../../renderer/uia/UiaRenderer.hpp"
+
+#include <psapi.h>
 
 using namespace Microsoft::Console;
 using namespace WEX::Logging;
@@ -18,6 +21,22 @@ using namespace winrt::Microsoft::Terminal;
 
 namespace ControlUnitTests
 {
+    // Stands in for the automation peer, which receives the UiaEngine's events.
+    struct MockUiaEventDispatcher final : Microsoft::Console::Types::IUiaEventDispatcher
+    {
+        void SignalSelectionChanged() override {}
+        void SignalTextChanged() override {}
+        void SignalCursorChanged() override {}
+        void NotifyNewOutput(std::wstring_view newOutput) override
+        {
+            notifications++;
+            output.append(newOutput);
+        }
+
+        size_t notifications = 0;
+        std::wstring output;
+    };
+
     class ControlCoreTests
     {
         BEGIN_TEST_CLASS(ControlCoreTests)
@@ -48,6 +67,15 @@ namespace ControlUnitTests
 
         TEST_METHOD(TestSimpleClickSelection);
 
+        TEST_METHOD(TestStreamedPaste);
+        TEST_METHOD(TestCancelStreamedPaste);
+        TEST_METHOD(TestInterruptStreamedPaste);
+        TEST_METHOD(StreamedPastePerformance);
+
+        TEST_METHOD(TestUiaNewTextNotifications);
+        TEST_METHOD(TestUiaNewTextElision);
+        TEST_METHOD(UiaNewTextPerformance);
+
         TEST_CLASS_SETUP(ModuleSetup)
         {
             winrt::init_apartment(winrt::apartment_type::single_threaded);
@@ -94,6 +122,32 @@ namespace ControlUnitTests
             VERIFY_IS_TRUE(core->_initializedTerminal);
             VERIFY_ARE_EQUAL(20, core->_terminal->GetViewport().Height());
         }
+
+        // Simulates a frame of the render thread for the given engine.
+        void _paintUiaFrame(Microsoft::Console::Render::UiaEngine& engine)
+        {
+            if (engine.StartPaint() == S_OK)
+            {
+                VERIFY_SUCCEEDED(engine.EndPaint());
+                VERIFY_SUCCEEDED(engine.Present());
+            }
+        }
+
+        bool _waitForPasteWorker(const winrt::com_ptr<Control::implementation::ControlCore>& core)
+        {
+            for (auto i = 0; i < 500; ++i)
+            {
+                {
+                    const auto guard = core->_pasteLock.lock_exclusive();
+                    if (!core->_pasteWorkerRunning)
+                    {
+                        return true;
+                    }
+                }
+                Sleep(10);
+            }
+            return false;
+        }
     };
 
     void ControlCoreTests::ComPtrSettings()
@@ -810,4 +864,257 @@ namespace ControlUnitTests
         }
         VERIFY_IS_TRUE(gotSelectionUpdate);
     }
+
+    void ControlCoreTests::TestStreamedPaste()
+    {
+        using namespace ::Microsoft::Console::Utils;
+        static constexpr auto chunkSize = Control::implementation::ControlCore::pasteChunkSize;
+
+        auto settings = winrt::make_self<MockControlSettings>();
+        auto conn = winrt::make_self<RecordingConnection>();
+        auto core = createCore(*settings, *conn);
+        VERIFY_IS_NOT_NULL(core);
+        _standardInit(core);
+
+        Log::Comment(L"Enable bracketed paste mode");
+        core->_terminal->Write(L"\x1b[?2004h");
+
+        // A CRLF and a surrogate pair that straddle chunk boundaries must not be torn apart.
+        std::wstring text(3 * chunkSize, L'a');
+        til::at(text, chunkSize - 1) = L'\r';
+        til::at(text, chunkSize) = L'\n';
+        til::at(text, 2 * chunkSize - 1) = 0xD83D;
+        til::at(text, 2 * chunkSize) = 0xDE00;
+        til::at(text, 3 * chunkSize - 1) = L'\x7f';
+
+        std::wstring expected{ L"\x1b[200~" };
+        expected.append(FilterStringForPaste(text, CarriageReturnNewline | ControlCodes));
+        expected.append(L"\x1b[201~");
+        Log::Comment(L"Neither typed input nor a short paste that follow a long one may overtake it");
+        expected.append(L"typed");
+        expected.append(L"\x1b[200~short\r\x1b[201~");
+
+        std::atomic<uint64_t> progress{ 0 };
+        core->PasteProgress([&](auto&&, const Control::PasteProgressEventArgs& args) {
+            progress.store(args.Sent());
+        });
+
+        core->PasteText(winrt::hstring{ text });
+        core->SendInput(L"typed");
+        core->PasteText(L"short\n");
+
+        VERIFY_IS_TRUE(conn->WaitForInput(expected.size()));
+        VERIFY_IS_TRUE(_waitForPasteWorker(core));
+        VERIFY_ARE_EQUAL(expected, conn->input);
+        VERIFY_IS_FALSE(conn->splitSurrogatePair);
+        VERIFY_IS_GREATER_THAN(conn->writes, size_t{ 3 });
+        VERIFY_ARE_EQUAL(uint64_t{ 6 }, progress.load());
+    }
+
+    void ControlCoreTests::TestCancelStreamedPaste()
+    {
+        static constexpr auto chunkSize = Control::implementation::ControlCore::pasteChunkSize;
+
+        auto settings = winrt::make_self<MockControlSettings>();
+        auto conn = winrt::make_self<RecordingConnection>();
+        auto core = createCore(*settings, *conn);
+        VERIFY_IS_NOT_NULL(core);
+        _standardInit(core);
+
+        core->_terminal->Write(L"\x1b[?2004h");
+
+        Log::Comment(L"Block the connection after the first chunk and cancel the paste");
+        conn->blockWrites = true;
+        core->PasteText(winrt::hstring(std::wstring(4 * chunkSize, L'a')));
+        VERIFY_IS_TRUE(conn->WaitForInput(SIZE_MAX, 1));
+        core->CancelPaste();
+        conn->blockWrites = false;
+        conn->unblockWrites.SetEvent();
+        VERIFY_IS_TRUE(_waitForPasteWorker(core));
+
+        Log::Comment(L"The started bracketed paste must still be terminated");
+        VERIFY_ARE_EQUAL(size_t{ 2 }, conn->writes);
+        VERIFY_ARE_EQUAL(6 + chunkSize + 6, conn->input.size());
+        VERIFY_IS_TRUE(conn->input.ends_with(L"a\x1b[201~"));
+
+        Log::Comment(L"Pastes after the cancellation aren't affected by it");
+        core->PasteText(L"b");
+        VERIFY_IS_TRUE(conn->WaitForInput(6 + chunkSize + 6 + 13));
+        VERIFY_IS_TRUE(conn->input.ends_with(L"\x1b[200~b\x1b[201~"));
+    }
+
+    void ControlCoreTests::TestInterruptStreamedPaste()
+    {
+        static constexpr auto chunkSize = Control::implementation::ControlCore::pasteChunkSize;
+
+        auto settings = winrt::make_self<MockControlSettings>();
+        auto conn = winrt::make_self<RecordingConnection>();
+        auto core = createCore(*settings, *conn);
+        VERIFY_IS_NOT_NULL(core);
+        _standardInit(core);
+
+        core->_terminal->Write(L"\x1b[?2004h");
+
+        Log::Comment(L"Block the connection after the first chunk and type while the paste is streamed");
+        conn->blockWrites = true;
+        core->PasteText(winrt::hstring(std::wstring(4 * chunkSize, L'a')));
+        VERIFY_IS_TRUE(conn->WaitForInput(SIZE_MAX, 1));
+        core->SendInput(L"typed");
+        VERIFY_IS_TRUE(core->TrySendKeyEvent(VK_ESCAPE, 0, {}, true));
+        conn->blockWrites = false;
+        conn->unblockWrites.SetEvent();
+        VERIFY_IS_TRUE(_waitForPasteWorker(core));
+
+        Log::Comment(L"Esc cancels the paste and is written right after its terminator, ahead of the typed input");
+        std::wstring expected{ L"\x1b[200~" };
+        expected.append(chunkSize, L'a');
+        expected.append(L"\x1b[201~\x1btyped");
+        VERIFY_ARE_EQUAL(expected, conn->input);
+    }
+
+    void ControlCoreTests::StreamedPastePerformance()
+    {
+        auto settings = winrt::make_self<MockControlSettings>();
+        auto conn = winrt::make_self<RecordingConnection>();
+        auto core = createCore(*settings, *conn);
+        VERIFY_IS_NOT_NULL(core);
+        _standardInit(core);
+        conn->recordInput = false;
+
+        // 50 MiB of UTF-16 text in lines of 100 characters, which we expect to turn into CR line endings.
+        static constexpr size_t textSize = 50 * 1024 * 1024 / sizeof(wchar_t);
+        std::wstring text;
+        text.reserve(textSize);
+        size_t lines = 0;
+        while (text.size() + 102 <= textSize)
+        {
+            fmt::format_to(std::back_inserter(text), FMT_COMPILE(L"{:08} {:091}\r\n"), lines, lines);
+            lines++;
+        }
+        const winrt::hstring hstr{ text };
+        const auto expectedSize = text.size() - lines;
+        text = {};
+
+        const auto privateUsage = []() {
+            PROCESS_MEMORY_COUNTERS_EX pmc{};
+            GetProcessMemoryInfo(GetCurrentProcess(), reinterpret_cast<PROCESS_MEMORY_COUNTERS*>(&pmc), sizeof(pmc));
+            return pmc.PrivateUsage;
+        };
+        const auto baseline = privateUsage();
+        std::atomic<size_t> peak{ baseline };
+        core->PasteProgress([&](auto&&, auto&&) {
+            peak.store(std::max(peak.load(), privateUsage()));
+        });
+
+        const auto beg = std::chrono::steady_clock::now();
+        core->PasteText(hstr);
+        const auto returned = std::chrono::steady_clock::now();
+        VERIFY_IS_TRUE(conn->WaitForInput(expectedSize));
+        const auto end = std::chrono::steady_clock::now();
+        VERIFY_IS_TRUE(_waitForPasteWorker(core));
+        VERIFY_ARE_EQUAL(expectedSize, conn->received);
+
+        const auto ms = [](auto duration) { return std::chrono::duration<double, std::milli>(duration).count(); };
+        Log::Comment(NoThrowString().Format(
+            L"Pasted %zu MiB: PasteText() returned after %.3fms, first byte after %.3fms, last byte after %.3fms, peak memory +%zu KiB",
+            hstr.size() * sizeof(wchar_t) / 1024 / 1024,
+            ms(returned - beg),
+            ms(conn->firstWrite - beg),
+            ms(end - beg),
+            (peak.load() - baseline) / 1024));
+    }
+
+    void ControlCoreTests::TestUiaNewTextNotifications()
+    {
+        auto [settings, conn] = _createSettingsAndConnection();
+        auto core = createCore(*settings, *conn);
+        VERIFY_IS_NOT_NULL(core);
+        _standardInit(core);
+
+        MockUiaEventDispatcher dispatcher;
+        Microsoft::Console::Render::UiaEngine engine{ &dispatcher };
+        core->AttachUiaEngine(&engine);
+        auto detach = wil::scope_exit([&]() { core->DetachUiaEngine(&engine); });
+
+        Log::Comment(L"New text is only delivered once the frame is presented");
+        core->_terminal->Write(L"foo\r\n");
+        core->_terminal->Write(L"bar\r\n");
+        VERIFY_ARE_EQUAL(size_t{ 0 }, dispatcher.notifications);
+
+        _paintUiaFrame(engine);
+        VERIFY_ARE_EQUAL(size_t{ 1 }, dispatcher.notifications);
+        VERIFY_ARE_EQUAL(L"foo\nbar\n", dispatcher.output);
+
+        Log::Comment(L"A frame without new text doesn't notify");
+        _paintUiaFrame(engine);
+        VERIFY_ARE_EQUAL(size_t{ 1 }, dispatcher.notifications);
+    }
+
+    void ControlCoreTests::TestUiaNewTextElision()
+    {
+        MockUiaEventDispatcher dispatcher;
+        Microsoft::Console::Render::UiaEngine engine{ &dispatcher };
+
+        std::wstring line;
+        for (auto i = 0; i < 10000; ++i)
+        {
+            line = fmt::format(FMT_COMPILE(L"line {}"), i);
+            VERIFY_SUCCEEDED(engine.NotifyNewText(line));
+        }
+        _paintUiaFrame(engine);
+
+        Log::Comment(NoThrowString().Format(L"Delivered %zu characters in %zu notifications", dispatcher.output.size(), dispatcher.notifications));
+        VERIFY_IS_LESS_THAN_OR_EQUAL(dispatcher.output.size(), size_t{ 4002 });
+        VERIFY_IS_TRUE(dispatcher.output.starts_with(L"line 0\nline 1\n"));
+        VERIFY_IS_TRUE(dispatcher.output.ends_with(L"line 9998\nline 9999\n"));
+        VERIFY_ARE_NOT_EQUAL(std::wstring::npos, dispatcher.output.find(L"\u2026\n"));
+
+        Log::Comment(L"The next frame starts from scratch");
+        dispatcher.output.clear();
+        VERIFY_SUCCEEDED(engine.NotifyNewText(L"done"));
+        _paintUiaFrame(engine);
+        VERIFY_ARE_EQUAL(L"done\n", dispatcher.output);
+    }
+
+    void ControlCoreTests::UiaNewTextPerformance()
+    {
+        auto [settings, conn] = _createSettingsAndConnection();
+        auto core = createCore(*settings, *conn);
+        VERIFY_IS_NOT_NULL(core);
+        _standardInit(core);
+
+        MockUiaEventDispatcher dispatcher;
+        Microsoft::Console::Render::UiaEngine engine{ &dispatcher };
+
+        // Lots of tiny writes, as they'd be produced by a chatty build. A frame is
+        // presented every 1000 writes, which roughly matches 60 FPS at this rate.
+        static constexpr auto writes = 100000;
+        const auto run = [&]() {
+            const auto beg = std::chrono::steady_clock::now();
+            for (auto i = 0; i < writes; ++i)
+            {
+                core->_terminal->Write(L"compiling foo.cpp\r\n");
+                if (i % 1000 == 999)
+                {
+                    _paintUiaFrame(engine);
+                }
+            }
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - beg).count();
+        };
+
+        const auto detached = run();
+
+        core->AttachUiaEngine(&engine);
+        auto detach = wil::scope_exit([&]() { core->DetachUiaEngine(&engine); });
+        const auto attached = run();
+
+        Log::Comment(NoThrowString().Format(
+            L"%d writes: %.1fms without UIA, %.1fms with UIA (%zu notifications, %zu characters)",
+            writes,
+            detached,
+            attached,
+            dispatcher.notifications,
+            dispatcher.output.size()));
+        VERIFY_IS_LESS_THAN_OR_EQUAL(dispatcher.output.size(), size_t{ writes / 1000 * 4002 });
+    }
 }
@@ -29,4 +29,68 @@ namespace ControlUnitTests
         til::event<winrt::Microsoft::Terminal::TerminalConnection::TerminalOutputHandler> TerminalOutput;
         til::typed_event<winrt::Microsoft::Terminal::TerminalConnection::ITerminalConnection, IInspectable> StateChanged;
     };
+
+    // Unlike MockConnection, this one doesn't echo the input, but records it instead. This allows
+    // testing large pastes without the terminal having to parse all of it. If `blockWrites` is set,
+    // WriteInput() blocks after recording the input until `unblockWrites` is signaled, simulating a slow connection.
+    class RecordingConnection : public winrt::implements<RecordingConnection, winrt::Microsoft::Terminal::TerminalConnection::ITerminalConnection>
+    {
+    public:
+        RecordingConnection() noexcept = default;
+
+        void Initialize(const winrt::Windows::Foundation::Collections::ValueSet& /*settings*/){};
+        void Start() noexcept {};
+        void WriteInput(const winrt::array_view<const char16_t> data)
+        {
+            const auto str = winrt_array_to_wstring_view(data);
+            {
+                std::lock_guard guard{ _lock };
+                if (writes++ == 0)
+                {
+                    firstWrite = std::chrono::steady_clock::now();
+                }
+                if (recordInput)
+                {
+                    input.append(str);
+                }
+                received += str.size();
+                splitSurrogatePair |= !str.empty() && til::is_leading_surrogate(str.back());
+                _written.notify_all();
+            }
+
+            if (blockWrites)
+            {
+                unblockWrites.wait();
+            }
+        }
+        void Resize(uint32_t /*rows*/, uint32_t /*columns*/) noexcept {}
+        void Close() noexcept {}
+
+        winrt::guid SessionId() const noexcept { return {}; }
+        winrt::Microsoft::Terminal::TerminalConnection::ConnectionState State() const noexcept { return winrt::Microsoft::Terminal::TerminalConnection::ConnectionState::Connected; }
+
+        // Waits until at least `count` characters or `minWrites` writes have been received. Returns false on timeout.
+        bool WaitForInput(size_t count, size_t minWrites = SIZE_MAX)
+        {
+            std::unique_lock guard{ _lock };
+            return _written.wait_for(guard, std::chrono::seconds{ 5 }, [&]() { return received >= count || writes >= minWrites; });
+        }
+
+        til::event<winrt::Microsoft::Terminal::TerminalConnection::TerminalOutputHandler> TerminalOutput;
+        til::typed_event<winrt::Microsoft::Terminal::TerminalConnection::ITerminalConnection, IInspectable> StateChanged;
+
+        bool recordInput = true;
+        std::atomic<bool> blockWrites{ false };
+        wil::slim_event_manual_reset unblockWrites;
+
+        std::wstring input;
+        size_t received = 0;
+        size_t writes = 0;
+        bool splitSurrogatePair = false;
+        std::chrono::steady_clock::time_point firstWrite;
+
+    private:
+        std::mutex _lock;
+        std::condition_variable _written;
+    };
 }
@@ -52,6 +52,9 @@ class TerminalCoreUnitTests::TerminalBufferTests final
     TEST_METHOD(TestGetReverseTab);
 
     TEST_METHOD(TestURLPatternDetection);
+    TEST_METHOD(TestURLPatternDetectionIncremental);
+    TEST_METHOD(TestCustomPatternDetection);
+    TEST_METHOD(PatternDetectionPerformance);
 
     TEST_METHOD_SETUP(MethodSetup)
     {
@@ -634,3 +637,168 @@ void TerminalBufferTests::TestURLPatternDetection()
     result = term->GetHyperlinkAtBufferPosition(til::point{ urlEndX + 1, 0 });
     VERIFY_IS_TRUE(result.empty(), L"URL is not detected after the actual URL.");
 }
+
+void TerminalBufferTests::TestURLPatternDetectionIncremental()
+{
+    using namespace std::string_view_literals;
+
+    constexpr auto UrlStr = L"https://www.contoso.com/wrapped/around"sv;
+
+    auto originalDetectURLs = term->_detectURLs;
+    auto restoreDetectUrls = wil::scope_exit([&]() {
+        term->_detectURLs = originalDetectURLs;
+    });
+    term->_detectURLs = true;
+
+    auto& termSm = *term->_stateMachine;
+
+    Log::Comment(L"Write a URL that wraps from the 3rd into the 4th row.");
+    termSm.ProcessString(fmt::format(FMT_COMPILE(L"\x1b[1;1Hhttps://a.example\x1b[3;71H{}"), UrlStr));
+    term->UpdatePatternsUnderLock();
+    VERIFY_ARE_EQUAL(size_t{ 2 }, term->_patternIntervals.size());
+    VERIFY_ARE_EQUAL(std::wstring{ UrlStr }, term->GetHyperlinkAtBufferPosition(til::point{ 70, 2 }));
+    VERIFY_ARE_EQUAL(std::wstring{ UrlStr }, term->GetHyperlinkAtBufferPosition(til::point{ 5, 3 }));
+
+    Log::Comment(L"Overwriting the first URL must remove it, while the unchanged one is kept.");
+    termSm.ProcessString(L"\x1b[1;1H\x1b[2Kno URL here");
+    term->UpdatePatternsUnderLock();
+    VERIFY_ARE_EQUAL(size_t{ 1 }, term->_patternIntervals.size());
+    VERIFY_IS_TRUE(term->GetHyperlinkAtBufferPosition(til::point{ 2, 0 }).empty());
+    VERIFY_ARE_EQUAL(std::wstring{ UrlStr }, term->GetHyperlinkAtBufferPosition(til::point{ 70, 2 }));
+
+    Log::Comment(L"After scrolling, the cached URL must be found at its new viewport position.");
+    const auto generation = term->_activeBuffer().GetRowByOffset(2).GetGeneration();
+    termSm.ProcessString(fmt::format(FMT_COMPILE(L"\x1b[{};1H\n"), TerminalViewHeight));
+    term->UpdatePatternsUnderLock();
+    VERIFY_ARE_EQUAL(generation, term->_activeBuffer().GetRowByOffset(2).GetGeneration());
+    VERIFY_IS_TRUE(term->_patternLineCache.contains(generation));
+    VERIFY_ARE_EQUAL(1, term->_VisibleStartIndex());
+    VERIFY_ARE_EQUAL(size_t{ 1 }, term->_patternIntervals.size());
+    VERIFY_ARE_EQUAL((til::point{ 70, 1 }), term->_patternIntervals.front().start);
+    VERIFY_ARE_EQUAL(std::wstring{ UrlStr }, term->GetHyperlinkAtBufferPosition(til::point{ 70, 2 }));
+    VERIFY_ARE_EQUAL(std::wstring{ UrlStr }, term->GetHyperlinkAtBufferPosition(til::point{ 5, 3 }));
+}
+
+void TerminalBufferTests::TestCustomPatternDetection()
+{
+    auto originalDetectURLs = term->_detectURLs;
+    auto restoreDetectUrls = wil::scope_exit([&]() {
+        term->_detectURLs = originalDetectURLs;
+    });
+    term->_detectURLs = true;
+
+    // The 2nd pattern is invalid and the 3rd has capture groups of its own,
+    // neither of which may throw off the IDs of the patterns that follow them.
+    // The last two are only invalid in combination with the others: One reuses
+    // a group name and the other one quotes the rest of the combined regex.
+    term->SetPatterns({
+        LR"(\b[A-Z]{2,}-\d+\b)",
+        LR"(([a-z)",
+        LR"((foo)(bar))",
+        LR"(\b[0-9a-f]{7}\b)",
+        LR"((?<word>contoso))",
+        LR"((?<word>fabrikam))",
+        LR"(\Qfabrikam)",
+    });
+
+    auto& termSm = *term->_stateMachine;
+    termSm.ProcessString(L"TERM-1234 foobar https://www.contoso.com 3ac7d1e");
+    term->UpdatePatternsUnderLock();
+
+    const auto& intervals = term->_patternIntervals;
+    VERIFY_ARE_EQUAL(size_t{ 4 }, intervals.size());
+    VERIFY_ARE_EQUAL(size_t{ 1 }, intervals[0].value);
+    VERIFY_ARE_EQUAL((til::point{ 0, 0 }), intervals[0].start);
+    VERIFY_ARE_EQUAL(size_t{ 3 }, intervals[1].value);
+    VERIFY_ARE_EQUAL((til::point{ 10, 0 }), intervals[1].start);
+    VERIFY_ARE_EQUAL(term->_hyperlinkPatternId, intervals[2].value);
+    VERIFY_ARE_EQUAL((til::point{ 17, 0 }), intervals[2].start);
+    VERIFY_ARE_EQUAL(size_t{ 4 }, intervals[3].value);
+    VERIFY_ARE_EQUAL((til::point{ 41, 0 }), intervals[3].start);
+
+    const auto& groups = term->_patternMatcher.groups;
+    VERIFY_ARE_EQUAL(size_t{ 8 }, groups.size());
+    VERIFY_ARE_EQUAL(-1, groups[2]);
+    VERIFY_IS_GREATER_THAN(groups[5], 0);
+    VERIFY_ARE_EQUAL(-1, groups[6]);
+    VERIFY_ARE_EQUAL(-1, groups[7]);
+
+    Log::Comment(L"Matches of custom patterns are clickable like URLs.");
+    VERIFY_ARE_EQUAL(std::wstring{ L"TERM-1234" }, term->GetHyperlinkAtBufferPosition(til::point{ 2, 0 }));
+    VERIFY_ARE_EQUAL(std::wstring{ L"https://www.contoso.com" }, term->GetHyperlinkAtBufferPosition(til::point{ 20, 0 }));
+    VERIFY_IS_TRUE(term->GetHyperlinkAtBufferPosition(til::point{ 40, 0 }).empty());
+    const auto hovered = term->GetPatternId(til::point{ 2, 0 });
+    VERIFY_ARE_EQUAL(size_t{ 1 }, hovered.size());
+    VERIFY_ARE_EQUAL(size_t{ 1 }, hovered[0]);
+    VERIFY_ARE_EQUAL(term->_hyperlinkPatternId, term->GetPatternId(til::point{ 20, 0 }).at(0));
+
+    Log::Comment(L"Changing the patterns must update the detected ones.");
+    term->SetPatterns({});
+    VERIFY_ARE_EQUAL(size_t{ 1 }, intervals.size());
+    VERIFY_ARE_EQUAL(term->_hyperlinkPatternId, intervals[0].value);
+}
+
+void TerminalBufferTests::PatternDetectionPerformance()
+{
+    static constexpr til::CoordType width = 200;
+    static constexpr til::CoordType height = 60;
+
+    Terminal terminal{ Terminal::TestDummyMarker{} };
+    DummyRenderer renderer{ &terminal };
+    terminal.Create({ width, height }, 0, renderer);
+    terminal._detectURLs = true;
+
+    // Something that looks like a build log: Not every line has something to detect.
+    std::wstring output;
+    for (auto y = 0; y < height - 1; y++)
+    {
+        if (y % 3 == 0)
+        {
+            fmt::format_to(std::back_inserter(output), FMT_COMPILE(L"src/module{}/file{}.cpp:{}: warning C4996: see PROJ{}-{} and https://contoso.com/issues/{} (commit {:07x})\r\n"), y, y * 7, y * 13, y % 50, y * 31, y, y * 104729);
+        }
+        else
+        {
+            fmt::format_to(std::back_inserter(output), FMT_COMPILE(L"{:4} Compiling source file number {} of the project, which takes a little while...\r\n"), y, y * 17);
+        }
+    }
+    terminal._stateMachine->ProcessString(output);
+
+    static constexpr std::array<std::wstring_view, 4> commonPatterns{
+        LR"([\w./-]+\.cpp:\d+)",
+        LR"(\b[0-9a-f]{7,40}\b)",
+        LR"(\bC\d{4}\b)",
+        LR"(\b\d{1,3}(?:\.\d{1,3}){3}\b)",
+    };
+
+    for (const size_t count : { 1u, 10u, 50u })
+    {
+        // 1 pattern means just the built-in URL one.
+        std::vector<std::wstring> patterns;
+        for (size_t i = 1; i < count; i++)
+        {
+            if (i <= commonPatterns.size())
+            {
+                patterns.emplace_back(til::at(commonPatterns, i - 1));
+            }
+            else
+            {
+                patterns.emplace_back(fmt::format(FMT_COMPILE(LR"(\bPROJ{}-\d+\b)"), i));
+            }
+        }
+        terminal.SetPatterns(std::move(patterns));
+
+        static constexpr size_t iterations = 100;
+        const auto beg = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; i++)
+        {
+            // Drop the cached results, so that every iteration scans the entire viewport.
+            terminal._clearPatternTree();
+            terminal.UpdatePatternsUnderLock();
+        }
+        const auto end = std::chrono::steady_clock::now();
+
+        const auto duration = std::chrono::duration<double>(end - beg).count();
+        Log::Comment(NoThrowString().Format(L"%zu patterns: scanned a %dx%d viewport in %.3fms (%zu matches)", count, width, height, duration * 1000.0 / iterations, terminal._patternIntervals.size()));
+        VERIFY_IS_GREATER_THAN_OR_EQUAL(terminal._patternIntervals.size(), size_t{ (height - 1) / 3 });
+    }
+}
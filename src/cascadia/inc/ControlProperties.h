@@ -51,6 +51,8 @@
     X(bool, ForceVTInput, false)                                                                                  \
     X(winrt::hstring, StartingTitle)                                                                              \
     X(bool, DetectURLs, true)                                                                                     \
+    X(winrt::Windows::Foundation::Collections::IVector<winrt::hstring>, DetectPatterns, nullptr)                  \
+    X(int32_t, MouseMotionRateLimit, 0)                                                                           \
     X(bool, AutoMarkPrompts)                                                                                      \
     X(bool, RepositionCursorWithMouse, false)                                                                     \
     X(bool, RainbowSuggestions)                                                                                   \
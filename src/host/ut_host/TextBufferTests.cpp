@@ -132,6 +132,10 @@ class TextBufferTests
     TEST_METHOD(ResizeTraditionalRotationPreservesHighUnicode);
     TEST_METHOD(ScrollBufferRotationPreservesHighUnicode);
 
+    TEST_METHOD(ScrollRowsWithinRange);
+    TEST_METHOD(ScrollMarginsPerformance);
+    TEST_METHOD(RectangularAreaPerformance);
+
     TEST_METHOD(ResizeTraditionalHighUnicodeRowRemoval);
     TEST_METHOD(ResizeTraditionalHighUnicodeColumnRemoval);
 
@@ -144,6 +148,7 @@ class TextBufferTests
     void WriteLinesToBuffer(const std::vector<std::wstring>& text, TextBuffer& buffer);
     TEST_METHOD(GetWordBoundaries);
     TEST_METHOD(MoveByWord);
+    TEST_METHOD(MoveByWordAfterWrite);
     TEST_METHOD(GetGlyphBoundaries);
 
     TEST_METHOD(GetTextRects);
@@ -153,6 +158,7 @@ class TextBufferTests
     TEST_METHOD(NoHyperlinkTrim);
 
     TEST_METHOD(ReflowPromptRegions);
+    TEST_METHOD(GetCommandContext);
 };
 
 void TextBufferTests::TestBufferCreate()
@@ -1700,6 +1706,158 @@ void TextBufferTests::ScrollBufferRotationPreservesHighUnicode()
     VERIFY_ARE_EQUAL(String(fire), String(shouldBeFireText.data(), gsl::narrow<int>(shouldBeFireText.size())));
 }
 
+// ScrollRows() rotates the row storage when the source and target ranges overlap.
+// This verifies that it still behaves exactly like copying the rows one by one,
+// including when the range wraps around the end of the circular buffer.
+void TextBufferTests::ScrollRowsWithinRange()
+{
+    BEGIN_TEST_METHOD_PROPERTIES()
+        TEST_METHOD_PROPERTY(L"Data:firstRow", L"{0, 17}")
+        TEST_METHOD_PROPERTY(L"Data:delta", L"{-5, -1, 1, 5}")
+    END_TEST_METHOD_PROPERTIES();
+
+    til::CoordType firstRow;
+    til::CoordType delta;
+    VERIFY_SUCCEEDED(TestData::TryGetValue(L"firstRow", firstRow));
+    VERIFY_SUCCEEDED(TestData::TryGetValue(L"delta", delta));
+
+    const til::size bufferSize{ 20, 20 };
+    TextBuffer buffer{ bufferSize, TextAttribute{ 0x7f }, 12, false, &_renderer };
+    buffer._firstRow = firstRow;
+
+    std::vector<std::wstring> expected;
+    for (auto y = 0; y < bufferSize.height; y++)
+    {
+        expected.emplace_back(fmt::format(FMT_COMPILE(L"row {:02}"), y));
+        buffer.GetMutableRowByOffset(y).ReplaceCharacters(0, gsl::narrow<til::CoordType>(expected.back().size()), expected.back());
+    }
+
+    const auto scroll = [&](const til::CoordType top, const til::CoordType size) {
+        Log::Comment(NoThrowString().Format(L"Scrolling %d rows from %d by %d", size, top, delta));
+        buffer.ScrollRows(top, size, delta);
+
+        // This is what ScrollRows() used to do before it learned to rotate rows.
+        std::vector<std::wstring> copy{ expected };
+        for (auto y = 0; y < size; y++)
+        {
+            copy[top + y + delta] = expected[top + y];
+        }
+        expected = std::move(copy);
+
+        for (auto y = 0; y < bufferSize.height; y++)
+        {
+            const auto text = buffer.GetRowByOffset(y).GetText();
+            VERIFY_ARE_EQUAL(std::wstring_view{ expected[y] }, text.substr(0, expected[y].size()));
+        }
+    };
+
+    // A margin region that's scrolled up and down.
+    scroll(5 - std::min(0, delta), 10);
+    // The entire buffer, which is what full-screen applications without margins do.
+    scroll(std::max(0, -delta), bufferSize.height - std::abs(delta));
+    // Ranges that don't overlap are copied.
+    scroll(10 - std::min(0, delta), std::abs(delta));
+}
+
+// This replays the output of a pager like "less" which keeps a status line at the
+// bottom of the screen and scrolls the text within the margins above it.
+void TextBufferTests::ScrollMarginsPerformance()
+{
+    auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+    auto& si = gci.GetActiveOutputBuffer().GetActiveBuffer();
+    const auto& tbi = si.GetTextBuffer();
+    auto& stateMachine = si.GetStateMachine();
+    const auto viewport = si.GetViewport();
+    const auto height = viewport.Height();
+
+    std::wstring session;
+    const auto appendLine = [&](const size_t i) {
+        fmt::format_to(std::back_inserter(session), FMT_COMPILE(L"{:>6} The quick brown fox jumps over the lazy dog."), i);
+    };
+
+    // Set the margins to everything but the status line.
+    fmt::format_to(std::back_inserter(session), FMT_COMPILE(L"\x1b[1;{}r"), height - 1);
+
+    constexpr size_t lineCount = 10000;
+    for (size_t i = 0; i < lineCount; i++)
+    {
+        // Scroll forward by a line at the bottom margin, then update the status line.
+        fmt::format_to(std::back_inserter(session), FMT_COMPILE(L"\x1b[{};1H\n"), height - 1);
+        appendLine(i);
+        fmt::format_to(std::back_inserter(session), FMT_COMPILE(L"\x1b[{};1H\x1b[K:line {}"), height, i);
+
+        // Every so often scroll back by a few lines at the top margin.
+        if (i % 100 == 99)
+        {
+            for (size_t j = 1; j <= 5; j++)
+            {
+                session.append(L"\x1b[1;1H\x1bM");
+                appendLine(i - j);
+            }
+        }
+    }
+    session.append(L"\x1b[r");
+
+    const auto beg = std::chrono::steady_clock::now();
+    stateMachine.ProcessString(session);
+    const auto end = std::chrono::steady_clock::now();
+
+    const auto duration = std::chrono::duration<double>(end - beg).count();
+    Log::Comment(NoThrowString().Format(L"Replayed %zu lines in %.3fs (%.0f lines/s)", lineCount, duration, lineCount / duration));
+
+    const auto expectedStatus = fmt::format(FMT_COMPILE(L":line {}"), lineCount - 1);
+    const auto statusRow = tbi.GetRowByOffset(viewport.BottomInclusive()).GetText();
+    VERIFY_ARE_EQUAL(std::wstring_view{ expectedStatus }, statusRow.substr(0, expectedStatus.size()));
+}
+
+void TextBufferTests::RectangularAreaPerformance()
+{
+    auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+    auto& si = gci.GetActiveOutputBuffer().GetActiveBuffer();
+    const auto& tbi = si.GetTextBuffer();
+    auto& stateMachine = si.GetStateMachine();
+    const auto viewport = si.GetViewport();
+    const auto width = viewport.Width();
+    const auto height = viewport.Height();
+
+    // DECSACE: Apply DECCARA and DECRARA to rectangles rather than streams.
+    std::wstring session{ L"\x1b[2*x" };
+    constexpr size_t iterations = 1000;
+    for (size_t i = 0; i < iterations; i++)
+    {
+        const auto ch = L'A' + i % 26;
+        // DECFRA: Fill the entire screen.
+        fmt::format_to(std::back_inserter(session), FMT_COMPILE(L"\x1b[{};1;1;{};{}$x"), ch, height, width);
+        // DECCARA: Make the left half bold and underlined.
+        fmt::format_to(std::back_inserter(session), FMT_COMPILE(L"\x1b[1;1;{};{};1;4$r"), height, width / 2);
+        // DECRARA: Reverse the entire screen.
+        fmt::format_to(std::back_inserter(session), FMT_COMPILE(L"\x1b[1;1;{};{};7$t"), height, width);
+        // DECCRA: Copy the entire screen down by one row.
+        fmt::format_to(std::back_inserter(session), FMT_COMPILE(L"\x1b[1;1;{};{};1;2;1;1$v"), height - 1, width);
+    }
+    session.append(L"\x1b[*x");
+
+    const auto beg = std::chrono::steady_clock::now();
+    stateMachine.ProcessString(session);
+    const auto end = std::chrono::steady_clock::now();
+
+    const auto duration = std::chrono::duration<double>(end - beg).count();
+    const auto operations = iterations * 4;
+    Log::Comment(NoThrowString().Format(L"Applied %zu %dx%d rectangle operations in %.3fs (%.0f ops/s)", operations, width, height, duration, operations / duration));
+
+    Log::Comment(L"The second row should be a copy of the first one");
+    const auto expectedText = std::wstring(width, gsl::narrow_cast<wchar_t>(L'A' + (iterations - 1) % 26));
+    const auto& row = tbi.GetRowByOffset(viewport.Top() + 1);
+    VERIFY_ARE_EQUAL(std::wstring_view{ expectedText }, row.GetText().substr(0, expectedText.size()));
+    const auto leftAttr = row.GetAttrByColumn(0);
+    VERIFY_IS_TRUE(leftAttr.IsIntense());
+    VERIFY_IS_TRUE(leftAttr.IsUnderlined());
+    VERIFY_IS_TRUE(leftAttr.IsReverseVideo());
+    const auto rightAttr = row.GetAttrByColumn(width - 1);
+    VERIFY_IS_FALSE(rightAttr.IsIntense());
+    VERIFY_IS_TRUE(rightAttr.IsReverseVideo());
+}
+
 // This tests that rows removed from the buffer while resizing traditionally will also drop the high unicode
 // characters from the Unicode Storage buffer
 void TextBufferTests::ResizeTraditionalHighUnicodeRowRemoval()
@@ -2334,6 +2492,33 @@ void TextBufferTests::MoveByWord()
     }
 }
 
+void TextBufferTests::MoveByWordAfterWrite()
+{
+    til::size bufferSize{ 80, 10 };
+    UINT cursorSize = 12;
+    TextAttribute attr{ 0x7f };
+    auto _buffer = std::make_unique<TextBuffer>(bufferSize, attr, cursorSize, false, &_renderer);
+
+    WriteLinesToBuffer({ L"word other" }, *_buffer);
+
+    til::point pos{ 0, 0 };
+    VERIFY_IS_TRUE(_buffer->MoveToNextWord(pos, L" "));
+    VERIFY_ARE_EQUAL((til::point{ 5, 0 }), pos);
+
+    Log::Comment(L"Word boundaries must be updated after the row was modified");
+    WriteLinesToBuffer({ L"a b" }, *_buffer);
+
+    pos = { 0, 0 };
+    VERIFY_IS_TRUE(_buffer->MoveToNextWord(pos, L" "));
+    VERIFY_ARE_EQUAL((til::point{ 2, 0 }), pos);
+    VERIFY_ARE_EQUAL((til::point{ 2, 0 }), _buffer->GetWordStart({ 4, 0 }, L" ", true));
+
+    Log::Comment(L"...and when the word delimiters change");
+    pos = { 0, 0 };
+    VERIFY_IS_TRUE(_buffer->MoveToNextWord(pos, L" b"));
+    VERIFY_ARE_EQUAL((til::point{ 3, 0 }), pos);
+}
+
 void TextBufferTests::GetGlyphBoundaries()
 {
     struct ExpectedResult
@@ -2898,3 +3083,78 @@ void TextBufferTests::ReflowPromptRegions()
     Log::Comment(L"========== Checking the host buffer state (after) ==========");
     verifyBuffer(*newBuffer, si.GetViewport().ToExclusive(), false, true);
 }
+
+void TextBufferTests::GetCommandContext()
+{
+    auto& gci = ServiceLocator::LocateGlobals().getConsoleInformation();
+    auto& si = gci.GetActiveOutputBuffer().GetActiveBuffer();
+    auto& tbi = si.GetTextBuffer();
+    auto& sm = si.GetStateMachine();
+
+    auto writePrompt = [&]() {
+        sm.ProcessString(FTCS_D);
+        sm.ProcessString(FTCS_A);
+        sm.ProcessString(L"PWSH C:\\> ");
+        sm.ProcessString(FTCS_B);
+    };
+    auto writeOutput = [&](const auto& output) {
+        sm.ProcessString(FTCS_C);
+        sm.ProcessString(L"\r\n");
+        sm.ProcessString(output);
+    };
+
+    writePrompt(); // y=0
+    sm.ProcessString(L"dir");
+    writeOutput(L"one\r\ntwo  \r\n"); // y=1,2
+    writePrompt(); // y=3
+    sm.ProcessString(L"git status");
+    writeOutput(L"clean\r\n"); // y=4
+    writePrompt(); // y=5
+
+    Log::Comment(L"The prompt without a command is skipped");
+    auto contexts = tbi.GetCommandContext(2, 1000);
+    VERIFY_ARE_EQUAL(2u, contexts.size());
+    VERIFY_ARE_EQUAL(std::wstring{ L"dir" }, contexts[0].command);
+    VERIFY_ARE_EQUAL(std::wstring{ L"one\ntwo" }, contexts[0].output);
+    VERIFY_IS_FALSE(contexts[0].truncated);
+    VERIFY_ARE_EQUAL(std::wstring{ L"git status" }, contexts[1].command);
+    VERIFY_ARE_EQUAL(std::wstring{ L"clean" }, contexts[1].output);
+
+    contexts = tbi.GetCommandContext(1, 1000);
+    VERIFY_ARE_EQUAL(1u, contexts.size());
+    VERIFY_ARE_EQUAL(std::wstring{ L"git status" }, contexts[0].command);
+
+    Log::Comment(L"Typing the next command doesn't invalidate the cached context of the previous one");
+    const auto cached = std::find_if(tbi._commandContextCache.begin(), tbi._commandContextCache.end(), [](const auto& entry) {
+        return entry.context && entry.context->command == L"git status";
+    });
+    VERIFY_IS_TRUE(cached != tbi._commandContextCache.end());
+    cached->context->output = L"cached";
+    sm.ProcessString(L"make");
+
+    contexts = tbi.GetCommandContext(2, 1000);
+    VERIFY_ARE_EQUAL(2u, contexts.size());
+    VERIFY_ARE_EQUAL(std::wstring{ L"cached" }, contexts[0].output);
+    VERIFY_ARE_EQUAL(std::wstring{ L"make" }, contexts[1].command);
+    VERIFY_ARE_EQUAL(std::wstring{ L"" }, contexts[1].output);
+
+    Log::Comment(L"Modifying its output does");
+    tbi.GetMutableRowByOffset(4).ReplaceCharacters(0, 5, L"dirty");
+    contexts = tbi.GetCommandContext(2, 1000);
+    VERIFY_ARE_EQUAL(std::wstring{ L"dirty" }, contexts[0].output);
+
+    Log::Comment(L"Long output is cut down to its beginning and end");
+    writeOutput(L"");
+    for (auto i = 0; i < 100; i++)
+    {
+        sm.ProcessString(fmt::format(FMT_COMPILE(L"line {}\r\n"), i));
+    }
+    writePrompt();
+
+    contexts = tbi.GetCommandContext(1, 40);
+    VERIFY_ARE_EQUAL(1u, contexts.size());
+    VERIFY_ARE_EQUAL(std::wstring{ L"make" }, contexts[0].command);
+    VERIFY_IS_TRUE(contexts[0].truncated);
+    VERIFY_ARE_EQUAL(std::wstring{ L"line 0\nline 1\nline 2" }, contexts[0].output);
+    VERIFY_ARE_EQUAL(std::wstring{ L"e 97\nline 98\nline 99" }, contexts[0].outputTail);
+}
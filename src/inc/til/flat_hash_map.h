@@ -0,0 +1,899 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+#include <bit>
+
+#include "hash.h"
+
+#if (defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)) && !defined(_M_ARM64EC) && !defined(_M_HYBRID_X86_ARM64)
+#define TIL_FLAT_HASH_SSE2
+#include <emmintrin.h>
+#endif
+
+#pragma warning(push)
+#pragma warning(disable : 26432) // If you define or delete any default operation in the type '...', define or delete them all (c.21).
+#pragma warning(disable : 26446) // Prefer to use gsl::at() instead of unchecked subscript operator (bounds.4).
+#pragma warning(disable : 26481) // Don't use pointer arithmetic. Use span instead (bounds.1).
+#pragma warning(disable : 26490) // Don't use reinterpret_cast (type.1).
+
+namespace til // Terminal Implementation Library. Also: "Today I Learned"
+{
+    // A std::hash-like function object on top of til::hasher.
+    // It's transparent, which allows containers with std::wstring keys to be queried with
+    // std::wstring_view or string literals without constructing a temporary std::wstring.
+    // That works, because hash_trait hashes all string types by their contents.
+    struct transparent_hasher
+    {
+        using is_transparent = void;
+
+        size_t operator()(const std::string_view& v) const noexcept
+        {
+            return til::hash(v);
+        }
+
+        size_t operator()(const std::wstring_view& v) const noexcept
+        {
+            return til::hash(v);
+        }
+
+        // Strings are handled above, because arrays (string literals) and pointers
+        // would otherwise be hashed by their address or including their terminator.
+        template<typename T, typename = std::enable_if_t<!std::is_convertible_v<const T&, std::string_view> && !std::is_convertible_v<const T&, std::wstring_view>>>
+        size_t operator()(const T& v) const noexcept
+        {
+            return til::hash(v);
+        }
+    };
+
+    namespace details
+    {
+        template<typename T>
+        inline constexpr bool is_flat_hash_string_v = std::is_convertible_v<const T&, std::string_view> || std::is_convertible_v<const T&, std::wstring_view>;
+
+        // Heterogeneous lookups are only safe for strings, because transparent_hasher hashes all
+        // string types identically. Everything else is converted to the key type first. Otherwise,
+        // looking up an int in a map of uint16_t would hash 4 bytes instead of 2 and find nothing.
+        template<typename K, typename Q>
+        using flat_hash_lookup_t = std::conditional_t<is_flat_hash_string_v<K> && is_flat_hash_string_v<std::remove_cvref_t<Q>>, std::remove_cvref_t<Q>, K>;
+
+        // Each slot in the table has an associated control byte. For occupied slots it contains 7 bits
+        // of the key's hash (the "H2"), which allows us to skip most slots without comparing any keys.
+        // Empty and deleted slots have the high bit set, which makes them easy to find as well.
+        enum class flat_hash_ctrl : int8_t
+        {
+            empty = -128,
+            deleted = -2,
+        };
+
+        // A group is a block of control bytes that we test all at once using SIMD (or SWAR without SSE2).
+        // Tables consist of a power of two number of groups and probe them using triangular numbers,
+        // which visits each group exactly once. Probing starts at the group selected by the hash's
+        // upper bits ("H1") and stops at the first group that contains an empty slot.
+        struct flat_hash_group
+        {
+#if defined(TIL_FLAT_HASH_SSE2)
+            static constexpr size_t width = 16;
+            // Every matching slot is represented by 1 bit in the mask.
+            static constexpr int shift = 0;
+
+            explicit flat_hash_group(const int8_t* ctrl) noexcept :
+                _ctrl{ _mm_load_si128(reinterpret_cast<const __m128i*>(ctrl)) }
+            {
+            }
+
+            uint32_t match(const int8_t h2) const noexcept
+            {
+                return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), _ctrl)));
+            }
+
+            uint32_t match_empty() const noexcept
+            {
+                return match(static_cast<int8_t>(flat_hash_ctrl::empty));
+            }
+
+            uint32_t match_empty_or_deleted() const noexcept
+            {
+                return static_cast<uint32_t>(_mm_movemask_epi8(_ctrl));
+            }
+
+        private:
+            __m128i _ctrl;
+#else
+            static constexpr size_t width = 8;
+            // Every matching slot is represented by the high bit of its byte in the mask.
+            static constexpr int shift = 3;
+
+            explicit flat_hash_group(const int8_t* ctrl) noexcept
+            {
+                memcpy(&_ctrl, ctrl, sizeof(_ctrl));
+            }
+
+            // The borrow of the subtraction may produce false positives in the byte after an
+            // actual match. That's fine, because we compare the keys of all matches anyways.
+            uint64_t match(const int8_t h2) const noexcept
+            {
+                const auto x = _ctrl ^ (lsbs * static_cast<uint8_t>(h2));
+                return (x - lsbs) & ~x & msbs;
+            }
+
+            uint64_t match_empty() const noexcept
+            {
+                // empty (0b10000000) is the only value with the high bit set and bit 1 unset.
+                return _ctrl & ~(_ctrl << 6) & msbs;
+            }
+
+            uint64_t match_empty_or_deleted() const noexcept
+            {
+                return _ctrl & msbs;
+            }
+
+        private:
+            static constexpr uint64_t lsbs = 0x0101010101010101;
+            static constexpr uint64_t msbs = 0x8080808080808080;
+
+            uint64_t _ctrl;
+#endif
+        };
+
+        // The common implementation of flat_hash_map and flat_hash_set.
+        // Policy describes how to get the key out of a slot.
+        template<typename Policy, typename Hash, typename KeyEqual>
+        class flat_hash_table
+        {
+        public:
+            using key_type = typename Policy::key_type;
+            using value_type = typename Policy::slot_type;
+            using size_type = size_t;
+            using difference_type = ptrdiff_t;
+            using hasher = Hash;
+            using key_equal = KeyEqual;
+            using reference = value_type&;
+            using const_reference = const value_type&;
+
+            template<typename T>
+            class basic_iterator
+            {
+            public:
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = std::remove_const_t<T>;
+                using difference_type = ptrdiff_t;
+                using pointer = T*;
+                using reference = T&;
+
+                basic_iterator() = default;
+
+                // Allows converting an iterator into a const_iterator.
+                template<typename U, typename = std::enable_if_t<std::is_convertible_v<U*, T*>>>
+                basic_iterator(const basic_iterator<U>& other) noexcept :
+                    _ctrl{ other._ctrl },
+                    _slot{ other._slot },
+                    _end{ other._end }
+                {
+                }
+
+                [[nodiscard]] reference operator*() const noexcept
+                {
+                    return *_slot;
+                }
+
+                [[nodiscard]] pointer operator->() const noexcept
+                {
+                    return _slot;
+                }
+
+                basic_iterator& operator++() noexcept
+                {
+                    ++_ctrl;
+                    ++_slot;
+                    _skip_free();
+                    return *this;
+                }
+
+                basic_iterator operator++(int) noexcept
+                {
+                    auto tmp = *this;
+                    ++*this;
+                    return tmp;
+                }
+
+                [[nodiscard]] bool operator==(const basic_iterator& other) const noexcept
+                {
+                    return _slot == other._slot;
+                }
+
+                [[nodiscard]] bool operator!=(const basic_iterator& other) const noexcept
+                {
+                    return _slot != other._slot;
+                }
+
+            private:
+                friend class flat_hash_table;
+                template<typename U>
+                friend class basic_iterator;
+
+                basic_iterator(const int8_t* ctrl, T* slot, const int8_t* end) noexcept :
+                    _ctrl{ ctrl },
+                    _slot{ slot },
+                    _end{ end }
+                {
+                }
+
+                void _skip_free() noexcept
+                {
+                    while (_ctrl != _end && *_ctrl < 0)
+                    {
+                        ++_ctrl;
+                        ++_slot;
+                    }
+                }
+
+                const int8_t* _ctrl = nullptr;
+                T* _slot = nullptr;
+                const int8_t* _end = nullptr;
+            };
+
+            using iterator = basic_iterator<value_type>;
+            using const_iterator = basic_iterator<const value_type>;
+
+            flat_hash_table() = default;
+
+            flat_hash_table(const flat_hash_table& other) :
+                _hash{ other._hash },
+                _eq{ other._eq }
+            {
+                _copy_from(other);
+            }
+
+            flat_hash_table& operator=(const flat_hash_table& other)
+            {
+                if (this != &other)
+                {
+                    clear();
+                    _hash = other._hash;
+                    _eq = other._eq;
+                    _copy_from(other);
+                }
+                return *this;
+            }
+
+            flat_hash_table(flat_hash_table&& other) noexcept :
+                _ctrl{ std::exchange(other._ctrl, nullptr) },
+                _slots{ std::exchange(other._slots, nullptr) },
+                _capacity{ std::exchange(other._capacity, 0) },
+                _size{ std::exchange(other._size, 0) },
+                _growth_left{ std::exchange(other._growth_left, 0) },
+                _hash{ std::move(other._hash) },
+                _eq{ std::move(other._eq) }
+            {
+            }
+
+            flat_hash_table& operator=(flat_hash_table&& other) noexcept
+            {
+                if (this != &other)
+                {
+                    _destroy();
+                    _ctrl = std::exchange(other._ctrl, nullptr);
+                    _slots = std::exchange(other._slots, nullptr);
+                    _capacity = std::exchange(other._capacity, 0);
+                    _size = std::exchange(other._size, 0);
+                    _growth_left = std::exchange(other._growth_left, 0);
+                    _hash = std::move(other._hash);
+                    _eq = std::move(other._eq);
+                }
+                return *this;
+            }
+
+            ~flat_hash_table()
+            {
+                _destroy();
+            }
+
+            void swap(flat_hash_table& other) noexcept
+            {
+                std::swap(_ctrl, other._ctrl);
+                std::swap(_slots, other._slots);
+                std::swap(_capacity, other._capacity);
+                std::swap(_size, other._size);
+                std::swap(_growth_left, other._growth_left);
+                std::swap(_hash, other._hash);
+                std::swap(_eq, other._eq);
+            }
+
+            [[nodiscard]] bool empty() const noexcept
+            {
+                return _size == 0;
+            }
+
+            [[nodiscard]] size_type size() const noexcept
+            {
+                return _size;
+            }
+
+            // The number of slots. At most 7/8th of them are used before the table grows.
+            [[nodiscard]] size_type capacity() const noexcept
+            {
+                return _capacity;
+            }
+
+            [[nodiscard]] iterator begin() noexcept
+            {
+                return _make_begin<iterator>(_slots);
+            }
+
+            [[nodiscard]] const_iterator begin() const noexcept
+            {
+                return _make_begin<const_iterator>(_slots);
+            }
+
+            [[nodiscard]] iterator end() noexcept
+            {
+                return _make_iterator<iterator>(_slots, _capacity);
+            }
+
+            [[nodiscard]] const_iterator end() const noexcept
+            {
+                return _make_iterator<const_iterator>(_slots, _capacity);
+            }
+
+            [[nodiscard]] const_iterator cbegin() const noexcept
+            {
+                return begin();
+            }
+
+            [[nodiscard]] const_iterator cend() const noexcept
+            {
+                return end();
+            }
+
+            void clear() noexcept
+            {
+                if (_size)
+                {
+                    for (size_t i = 0; i < _capacity; ++i)
+                    {
+                        if (_ctrl[i] >= 0)
+                        {
+                            std::destroy_at(&_slots[i]);
+                        }
+                    }
+                }
+                if (_capacity)
+                {
+                    memset(_ctrl, static_cast<int>(flat_hash_ctrl::empty), _capacity);
+                }
+                _size = 0;
+                _growth_left = _max_load(_capacity);
+            }
+
+            // Ensures that count items can be stored without growing the table.
+            void reserve(size_type count)
+            {
+                if (count > _size + _growth_left)
+                {
+                    _resize(_capacity_for(count));
+                }
+            }
+
+            template<typename K>
+            [[nodiscard]] iterator find(const K& key)
+            {
+                return _make_iterator<iterator>(_slots, _find(_lookup_key(key)));
+            }
+
+            template<typename K>
+            [[nodiscard]] const_iterator find(const K& key) const
+            {
+                return _make_iterator<const_iterator>(_slots, _find(_lookup_key(key)));
+            }
+
+            template<typename K>
+            [[nodiscard]] bool contains(const K& key) const
+            {
+                return _find(_lookup_key(key)) != _capacity;
+            }
+
+            template<typename K>
+            [[nodiscard]] size_type count(const K& key) const
+            {
+                return contains(key) ? 1 : 0;
+            }
+
+            template<typename K>
+            size_type erase(const K& key)
+            {
+                const auto index = _find(_lookup_key(key));
+                if (index == _capacity)
+                {
+                    return 0;
+                }
+                _erase(index);
+                return 1;
+            }
+
+            // Unlike with std::unordered_map, this doesn't return an iterator to the next item.
+            // If you need to erase while iterating, use erase_if() instead.
+            void erase(const_iterator it) noexcept
+            {
+                _erase(static_cast<size_t>(it._ctrl - _ctrl));
+            }
+
+            // Erases all items for which pred(item) returns true.
+            template<typename Pred>
+            size_type erase_if(Pred&& pred)
+            {
+                size_type erased = 0;
+                for (size_t i = 0; i < _capacity; ++i)
+                {
+                    if (_ctrl[i] >= 0 && pred(std::as_const(_slots[i])))
+                    {
+                        _erase(i);
+                        ++erased;
+                    }
+                }
+                return erased;
+            }
+
+        protected:
+            // Returns key as is for heterogeneous lookups and converts it to key_type otherwise.
+            // See flat_hash_lookup_t.
+            template<typename K>
+            static decltype(auto) _lookup_key(const K& key)
+            {
+                if constexpr (std::is_same_v<flat_hash_lookup_t<key_type, K>, K>)
+                {
+                    return (key);
+                }
+                else
+                {
+                    return static_cast<key_type>(key);
+                }
+            }
+
+            // Finds the item with the given key or, if it doesn't exist, calls construct(slot)
+            // to placement-new a new item with that key into the uninitialized slot.
+            template<typename K, typename F>
+            std::pair<iterator, bool> _emplace(const K& key, F&& construct)
+            {
+                const auto hash = _hash(key);
+                auto index = _find(key, hash);
+                if (index != _capacity)
+                {
+                    return { _make_iterator<iterator>(_slots, index), false };
+                }
+
+                index = _capacity ? _find_free(hash) : 0;
+                // Reusing a deleted slot doesn't reduce the number of empty slots.
+                // We only need to grow if we'd use up an empty one.
+                if (_growth_left == 0 && (!_capacity || _ctrl[index] != static_cast<int8_t>(flat_hash_ctrl::deleted)))
+                {
+                    _grow();
+                    index = _find_free(hash);
+                }
+
+                // If this throws, the table is unchanged, because we haven't marked the slot as occupied yet.
+                construct(&_slots[index]);
+
+                if (_ctrl[index] == static_cast<int8_t>(flat_hash_ctrl::empty))
+                {
+                    --_growth_left;
+                }
+                _ctrl[index] = _h2(hash);
+                ++_size;
+                return { _make_iterator<iterator>(_slots, index), true };
+            }
+
+        private:
+            static constexpr size_t group_width = flat_hash_group::width;
+
+            static constexpr int8_t _h2(size_t hash) noexcept
+            {
+                return static_cast<int8_t>(hash & 0x7f);
+            }
+
+            static constexpr size_t _h1(size_t hash) noexcept
+            {
+                return hash >> 7;
+            }
+
+            static constexpr size_t _alignment() noexcept
+            {
+                return std::max(group_width, alignof(value_type));
+            }
+
+            static constexpr size_t _max_load(size_t capacity) noexcept
+            {
+                return capacity - capacity / 8;
+            }
+
+            static size_t _capacity_for(size_t count) noexcept
+            {
+                // We want count <= capacity * 7/8, which means capacity >= count * 8/7.
+                const auto minimum = std::max(group_width, count + (count + 6) / 7);
+                return std::bit_ceil(minimum);
+            }
+
+            static size_t _lowest(const uint64_t mask) noexcept
+            {
+                return static_cast<size_t>(std::countr_zero(mask)) >> flat_hash_group::shift;
+            }
+
+            // Yields the offsets of the groups to probe.
+            struct probe_sequence
+            {
+                probe_sequence(size_t hash, size_t capacity) noexcept :
+                    _mask{ capacity / group_width - 1 },
+                    _group{ _h1(hash) & _mask }
+                {
+                }
+
+                size_t offset() const noexcept
+                {
+                    return _group * group_width;
+                }
+
+                void next() noexcept
+                {
+                    ++_step;
+                    _group = (_group + _step) & _mask;
+                }
+
+            private:
+                size_t _mask;
+                size_t _group;
+                size_t _step = 0;
+            };
+
+            template<typename It, typename Slot>
+            It _make_iterator(Slot* slots, size_t index) const noexcept
+            {
+                return It{ _ctrl + index, slots + index, _ctrl + _capacity };
+            }
+
+            template<typename It, typename Slot>
+            It _make_begin(Slot* slots) const noexcept
+            {
+                auto it = _make_iterator<It>(slots, 0);
+                it._skip_free();
+                return it;
+            }
+
+            template<typename K>
+            size_t _find(const K& key) const noexcept
+            {
+                return _capacity ? _find(key, _hash(key)) : 0;
+            }
+
+            // Returns the index of the slot holding key or _capacity if it doesn't exist.
+            template<typename K>
+            size_t _find(const K& key, size_t hash) const noexcept
+            {
+                if (!_capacity)
+                {
+                    return 0;
+                }
+
+                const auto h2 = _h2(hash);
+                for (probe_sequence seq{ hash, _capacity };; seq.next())
+                {
+                    const auto offset = seq.offset();
+                    const flat_hash_group group{ _ctrl + offset };
+
+                    for (auto mask = group.match(h2); mask; mask &= mask - 1)
+                    {
+                        const auto index = offset + _lowest(mask);
+                        if (_eq(Policy::key(_slots[index]), key)) [[likely]]
+                        {
+                            return index;
+                        }
+                    }
+
+                    if (group.match_empty())
+                    {
+                        return _capacity;
+                    }
+                }
+            }
+
+            // Returns the index of the first empty or deleted slot in the probe sequence.
+            // The table must have at least 1 empty slot.
+            size_t _find_free(size_t hash) const noexcept
+            {
+                for (probe_sequence seq{ hash, _capacity };; seq.next())
+                {
+                    const auto offset = seq.offset();
+                    const flat_hash_group group{ _ctrl + offset };
+
+                    if (const auto mask = group.match_empty_or_deleted())
+                    {
+                        return offset + _lowest(mask);
+                    }
+                }
+            }
+
+            void _erase(size_t index) noexcept
+            {
+                std::destroy_at(&_slots[index]);
+                --_size;
+
+                // Lookups stop at the first group with an empty slot. If this slot's group has
+                // an empty slot already, no lookup can have continued past it and we may mark
+                // the slot as empty. Otherwise, we must leave a "tombstone" behind.
+                const flat_hash_group group{ _ctrl + (index & ~(group_width - 1)) };
+                if (group.match_empty())
+                {
+                    _ctrl[index] = static_cast<int8_t>(flat_hash_ctrl::empty);
+                    ++_growth_left;
+                }
+                else
+                {
+                    _ctrl[index] = static_cast<int8_t>(flat_hash_ctrl::deleted);
+                }
+            }
+
+            __declspec(noinline) void _grow()
+            {
+                // If the table is mostly full of tombstones, rehashing it
+                // at the same size is enough to get rid of them.
+                const auto capacity = _size < _max_load(_capacity) / 2 ? _capacity : _capacity * 2;
+                _resize(std::max(group_width, capacity));
+            }
+
+            void _resize(size_t capacity)
+            {
+                // The control bytes come first and need to be aligned for the SSE2 loads.
+                // The slots follow after that, at an offset that's aligned for value_type.
+                constexpr auto alignment = _alignment();
+                const auto ctrl_size = (capacity + alignment - 1) & ~(alignment - 1);
+                const auto bytes = ctrl_size + capacity * sizeof(value_type);
+
+                const auto ctrl = static_cast<int8_t*>(::operator new(bytes, std::align_val_t{ alignment }));
+                const auto slots = reinterpret_cast<value_type*>(ctrl + ctrl_size);
+                memset(ctrl, static_cast<int>(flat_hash_ctrl::empty), capacity);
+
+                const auto old_ctrl = std::exchange(_ctrl, ctrl);
+                const auto old_slots = std::exchange(_slots, slots);
+                const auto old_capacity = std::exchange(_capacity, capacity);
+                _growth_left = _max_load(capacity) - _size;
+
+                // This mirrors _emplace(), but without the lookup part,
+                // because we know that all keys are unique already.
+                for (size_t i = 0; i < old_capacity; ++i)
+                {
+                    if (old_ctrl[i] < 0)
+                    {
+                        continue;
+                    }
+
+                    auto& old_slot = old_slots[i];
+                    const auto hash = _hash(Policy::key(old_slot));
+                    const auto index = _find_free(hash);
+                    std::construct_at(&_slots[index], std::move(old_slot));
+                    std::destroy_at(&old_slot);
+                    _ctrl[index] = _h2(hash);
+                }
+
+                if (old_ctrl)
+                {
+                    ::operator delete(old_ctrl, std::align_val_t{ alignment });
+                }
+            }
+
+            void _copy_from(const flat_hash_table& other)
+            {
+                reserve(other._size);
+                for (size_t i = 0; i < other._capacity; ++i)
+                {
+                    if (other._ctrl[i] >= 0)
+                    {
+                        const auto& slot = other._slots[i];
+                        _emplace(Policy::key(slot), [&](value_type* p) { std::construct_at(p, slot); });
+                    }
+                }
+            }
+
+            void _destroy() noexcept
+            {
+                if (_ctrl)
+                {
+                    clear();
+                    ::operator delete(_ctrl, std::align_val_t{ _alignment() });
+                    _ctrl = nullptr;
+                    _slots = nullptr;
+                    _capacity = 0;
+                    _growth_left = 0;
+                }
+            }
+
+            int8_t* _ctrl = nullptr;
+            value_type* _slots = nullptr;
+            size_t _capacity = 0;
+            size_t _size = 0;
+            size_t _growth_left = 0;
+            Hash _hash;
+            KeyEqual _eq;
+        };
+
+        template<typename K, typename V>
+        struct flat_hash_map_policy
+        {
+            using key_type = K;
+            using slot_type = std::pair<K, V>;
+
+            static const K& key(const slot_type& slot) noexcept
+            {
+                return slot.first;
+            }
+        };
+
+        template<typename K>
+        struct flat_hash_set_policy
+        {
+            using key_type = K;
+            using slot_type = K;
+
+            static const K& key(const slot_type& slot) noexcept
+            {
+                return slot;
+            }
+        };
+    }
+
+    // A hash map with open addressing in the style of Abseil's "Swiss tables".
+    // Lookups test 8-16 slots at once using SIMD, which makes them a lot faster than std::unordered_map,
+    // and all items are stored in a single allocation. Unlike std::unordered_map:
+    // * Iterators and references are invalidated by any insertion.
+    // * Iteration order is unspecified and changes when the map grows.
+    // * value_type is std::pair<K, V> and not std::pair<const K, V>. Don't modify the keys.
+    // * All lookups are heterogeneous. With the default transparent_hasher, maps with
+    //   std::wstring keys can be queried with std::wstring_view and string literals.
+    template<typename K, typename V, typename Hash = transparent_hasher, typename KeyEqual = std::equal_to<>>
+    class flat_hash_map : public details::flat_hash_table<details::flat_hash_map_policy<K, V>, Hash, KeyEqual>
+    {
+        using base = details::flat_hash_table<details::flat_hash_map_policy<K, V>, Hash, KeyEqual>;
+
+    public:
+        using mapped_type = V;
+        using typename base::const_iterator;
+        using typename base::iterator;
+        using typename base::key_type;
+        using typename base::value_type;
+
+        flat_hash_map() = default;
+
+        flat_hash_map(std::initializer_list<value_type> items)
+        {
+            base::reserve(items.size());
+            for (const auto& item : items)
+            {
+                insert(item);
+            }
+        }
+
+        // Inserts V(args...) at key, unless key already exists. Unlike std::unordered_map,
+        // key may be of any type that key_type can be constructed from (like std::wstring_view).
+        template<typename Q, typename... Args>
+        std::pair<iterator, bool> try_emplace(Q&& key, Args&&... args)
+        {
+            const auto& lookup = base::_lookup_key(key);
+            return base::_emplace(lookup, [&](value_type* slot) {
+                std::construct_at(slot, std::piecewise_construct, std::forward_as_tuple(std::forward<Q>(key)), std::forward_as_tuple(std::forward<Args>(args)...));
+            });
+        }
+
+        template<typename Q, typename U>
+        std::pair<iterator, bool> emplace(Q&& key, U&& value)
+        {
+            return try_emplace(std::forward<Q>(key), std::forward<U>(value));
+        }
+
+        std::pair<iterator, bool> insert(const value_type& item)
+        {
+            return try_emplace(item.first, item.second);
+        }
+
+        std::pair<iterator, bool> insert(value_type&& item)
+        {
+            return try_emplace(std::move(item.first), std::move(item.second));
+        }
+
+        template<typename Q, typename U>
+        std::pair<iterator, bool> insert_or_assign(Q&& key, U&& value)
+        {
+            auto result = try_emplace(std::forward<Q>(key), std::forward<U>(value));
+            if (!result.second)
+            {
+                result.first->second = std::forward<U>(value);
+            }
+            return result;
+        }
+
+        template<typename Q>
+        V& operator[](Q&& key)
+        {
+            return try_emplace(std::forward<Q>(key)).first->second;
+        }
+
+        template<typename Q>
+        V& at(const Q& key)
+        {
+            const auto it = base::find(key);
+            if (it == base::end())
+            {
+                throw std::out_of_range("flat_hash_map::at");
+            }
+            return it->second;
+        }
+
+        template<typename Q>
+        const V& at(const Q& key) const
+        {
+            const auto it = base::find(key);
+            if (it == base::end())
+            {
+                throw std::out_of_range("flat_hash_map::at");
+            }
+            return it->second;
+        }
+    };
+
+    // The set equivalent of flat_hash_map. See flat_hash_map for details.
+    template<typename K, typename Hash = transparent_hasher, typename KeyEqual = std::equal_to<>>
+    class flat_hash_set : public details::flat_hash_table<details::flat_hash_set_policy<K>, Hash, KeyEqual>
+    {
+        using base = details::flat_hash_table<details::flat_hash_set_policy<K>, Hash, KeyEqual>;
+
+    public:
+        using typename base::const_iterator;
+        using typename base::key_type;
+        using typename base::value_type;
+        // Items in a set must not be modified.
+        using iterator = const_iterator;
+
+        flat_hash_set() = default;
+
+        flat_hash_set(std::initializer_list<value_type> items)
+        {
+            base::reserve(items.size());
+            for (const auto& item : items)
+            {
+                insert(item);
+            }
+        }
+
+        [[nodiscard]] const_iterator begin() const noexcept
+        {
+            return base::begin();
+        }
+
+        [[nodiscard]] const_iterator end() const noexcept
+        {
+            return base::end();
+        }
+
+        template<typename Q>
+        [[nodiscard]] const_iterator find(const Q& key) const noexcept
+        {
+            return base::find(key);
+        }
+
+        // Unlike std::unordered_set, key may be of any type that key_type can be constructed from.
+        template<typename Q>
+        std::pair<const_iterator, bool> insert(Q&& key)
+        {
+            const auto& lookup = base::_lookup_key(key);
+            return base::_emplace(lookup, [&](value_type* slot) {
+                std::construct_at(slot, std::forward<Q>(key));
+            });
+        }
+
+        template<typename Q>
+        std::pair<const_iterator, bool> emplace(Q&& key)
+        {
+            return insert(std::forward<Q>(key));
+        }
+    };
+}
+
+#pragma warning(pop)
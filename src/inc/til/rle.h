@@ -286,6 +286,16 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
         return !(lhs == rhs);
     }
 
+    // rle_edit describes a single "replace [start, end) with value" operation.
+    // See basic_rle::replace_ranges().
+    template<typename T, typename S>
+    struct rle_edit
+    {
+        S start{};
+        S end{};
+        T value{};
+    };
+
     template<typename T, typename S = std::size_t, typename Container = std::vector<rle_pair<T, S>>>
     class basic_rle
     {
@@ -303,6 +313,7 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
         using const_reverse_iterator = std::reverse_iterator<const_iterator>;
 
         using rle_type = rle_pair<value_type, size_type>;
+        using edit_type = rle_edit<value_type, size_type>;
         using container = Container;
 
         // We don't check anywhere whether a size_type value is negative.
@@ -317,7 +328,7 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
         basic_rle& operator=(const basic_rle& other) = default;
 
         basic_rle(basic_rle&& other) noexcept :
-            _runs(std::move(other._runs)), _total_length(other._total_length)
+            _runs(std::move(other._runs)), _total_length(other._total_length), _hint_run(other._hint_run), _hint_start(other._hint_start)
         {
             // C++ fun fact:
             // "std::move" actually doesn't actually promise to _really_ move stuff from A to B,
@@ -333,18 +344,22 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
             {
                 other._total_length = 0;
             }
+            other._reset_hint();
         }
 
         basic_rle& operator=(basic_rle&& other) noexcept
         {
             _runs = std::move(other._runs);
             _total_length = other._total_length;
+            _hint_run = other._hint_run;
+            _hint_start = other._hint_start;
 
             // See basic_rle(basic_rle&&) for why this is necessary.
             if (other._runs.empty())
             {
                 other._total_length = 0;
             }
+            other._reset_hint();
 
             return *this;
         }
@@ -380,6 +395,8 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
         {
             std::swap(_runs, other._runs);
             std::swap(_total_length, other._total_length);
+            std::swap(_hint_run, other._hint_run);
+            std::swap(_hint_start, other._hint_start);
         }
 
         bool empty() const noexcept
@@ -402,19 +419,18 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
 
         container& runs() noexcept
         {
+            // The caller may modify the runs in any way it likes.
+            _reset_hint();
             return _runs;
         }
 
         // Get the value at the position
         const_reference at(size_type position) const
         {
-            const auto begin = _runs.begin();
-            const auto end = _runs.end();
-
-            rle_scanner scanner(begin, end);
+            auto scanner = _scanner(_runs, position);
             auto it = scanner.scan(position).first;
 
-            if (it == end)
+            if (it == _runs.end())
             {
                 throw std::out_of_range("position out of range");
             }
@@ -443,7 +459,7 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
             //
             // --> It's safe to subtract 1 from end_index
 
-            rle_scanner scanner(_runs.begin(), _runs.end());
+            auto scanner = _scanner(_runs, start_index);
             const auto [begin_run, start_run_pos] = scanner.scan(start_index);
             const auto [end_run, end_run_pos] = scanner.scan(end_index - 1);
 
@@ -461,6 +477,25 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
         {
             _check_indices(start_index, end_index);
 
+            // An empty range would otherwise insert a run of length 0.
+            if (start_index == end_index)
+            {
+                return;
+            }
+
+            // Writing the same value over and over again is very common (for instance when
+            // printing plain text), so check whether the range already holds the value
+            // before we split up and re-merge any runs.
+            auto scanner = _scanner(_runs, start_index);
+            const auto [run, pos] = scanner.scan(start_index);
+            _hint_run = gsl::narrow_cast<size_type>(run - _runs.begin());
+            _hint_start = gsl::narrow_cast<size_type>(start_index - pos);
+
+            if (run->value == value && run->length - pos >= end_index - start_index)
+            {
+                return;
+            }
+
             const rle_type replacement{ value, gsl::narrow_cast<size_type>(end_index - start_index) };
             _replace_unchecked(start_index, end_index, { &replacement, 1 });
         }
@@ -503,6 +538,106 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
             }
 
             _compact();
+            _reset_hint();
+        }
+
+        // Replaces the ranges [edit.start, edit.end) with edit.value for every edit.
+        // The edits must be sorted by their start and must not overlap. Each edit.end
+        // is clamped to size() and each edit.start must be smaller or equal to it.
+        // Unlike calling replace() for each edit, this rebuilds the runs in a single pass.
+        // This makes it suitable for applying lots of small edits, like one per word.
+        void replace_ranges(const std::span<const edit_type> edits)
+        {
+            if (edits.empty())
+            {
+                return;
+            }
+
+            container result;
+            result.reserve(_runs.size() + 2 * edits.size());
+
+            auto it = _runs.begin();
+            const auto end = _runs.end();
+            size_type remaining = it != end ? it->length : 0;
+            size_type pos = 0;
+
+            const auto push = [&](const value_type& value, const size_type length) {
+                if (!result.empty() && result.back().value == value)
+                {
+                    result.back().length += length;
+                }
+                else
+                {
+                    result.emplace_back(value, length);
+                }
+            };
+            // Moves pos up to target and copies the existing runs on the way if copy is true.
+            const auto advance = [&](const size_type target, const bool copy) {
+                while (pos < target)
+                {
+                    const auto length = std::min(remaining, gsl::narrow_cast<size_type>(target - pos));
+                    if (copy)
+                    {
+                        push(it->value, length);
+                    }
+
+                    pos += length;
+                    remaining -= length;
+
+                    if (!remaining && ++it != end)
+                    {
+                        remaining = it->length;
+                    }
+                }
+            };
+
+            for (const auto& edit : edits)
+            {
+                const auto edit_end = std::min(edit.end, _total_length);
+
+                if (edit.start < pos || edit.start > edit_end)
+                {
+                    throw std::out_of_range("edits must be sorted and must not overlap");
+                }
+                if (edit.start == edit_end)
+                {
+                    continue;
+                }
+
+                advance(edit.start, true);
+                advance(edit_end, false);
+                push(edit.value, gsl::narrow_cast<size_type>(edit_end - edit.start));
+            }
+
+            advance(_total_length, true);
+
+            _runs = std::move(result);
+            _reset_hint();
+        }
+
+        // Replaces every value in the range [start_index, end_index) with func(value).
+        // func is called once per run instead of once per position, and the resulting
+        // runs are merged wherever func maps neighboring runs to the same value.
+        // If end_index is larger than size() it's set to size().
+        // start_index must be smaller or equal to end_index.
+        template<typename F>
+        void transform(size_type start_index, size_type end_index, F&& func)
+        {
+            _check_indices(start_index, end_index);
+
+            if (start_index == end_index)
+            {
+                return;
+            }
+
+            auto replacements = slice(start_index, end_index);
+            for (auto& run : replacements._runs)
+            {
+                run.value = func(std::as_const(run.value));
+            }
+            replacements._compact();
+
+            _replace_unchecked(start_index, end_index, replacements._runs);
         }
 
         // Adjust the size of the vector.
@@ -513,12 +648,17 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
             if (new_size == 0)
             {
                 _runs.clear();
+                _reset_hint();
             }
             else if (new_size < _total_length)
             {
-                rle_scanner scanner(_runs.begin(), _runs.end());
+                auto scanner = _scanner(_runs, gsl::narrow_cast<size_type>(new_size - 1));
                 auto [run, pos] = scanner.scan(new_size - 1);
 
+                // The hint may point at one of the runs we're about to erase.
+                _hint_run = gsl::narrow_cast<size_type>(run - _runs.begin());
+                _hint_start = gsl::narrow_cast<size_type>(new_size - 1 - pos);
+
                 run->length = ++pos;
 
                 _runs.erase(++run, _runs.end());
@@ -620,8 +760,8 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
         template<typename It>
         struct rle_scanner
         {
-            explicit rle_scanner(It begin, It end) noexcept :
-                it(std::move(begin)), end(std::move(end)) {}
+            explicit rle_scanner(It begin, It end, size_type begin_index = 0) noexcept :
+                it(std::move(begin)), end(std::move(end)), total(begin_index) {}
 
             std::pair<It, size_type> scan(size_type index) noexcept
             {
@@ -655,6 +795,42 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
         {
         }
 
+        // Returns a scanner that starts at a run at or before the given index.
+        //
+        // Runs only store their length and not their position, so finding the run for an index
+        // requires us to sum up the lengths of all preceding runs. To avoid doing that from the
+        // start every time, we remember the run that the last modification touched (the "hint").
+        // Rows are mostly edited from left to right, so the next lookup usually starts right there.
+        // If the index lies before the hint, we walk backwards, unless the beginning is closer.
+        template<typename Runs>
+        [[nodiscard]] auto _scanner(Runs& runs, size_type index) const noexcept
+        {
+            size_t run = _hint_run;
+            size_type start = _hint_start;
+
+            if (run >= runs.size() || index < start / 2)
+            {
+                run = 0;
+                start = 0;
+            }
+            else
+            {
+                while (index < start)
+                {
+                    --run;
+                    start -= runs[run].length;
+                }
+            }
+
+            return rle_scanner{ runs.begin() + run, runs.end(), start };
+        }
+
+        void _reset_hint() noexcept
+        {
+            _hint_run = 0;
+            _hint_start = 0;
+        }
+
         void _compact()
         {
             auto it = _runs.begin();
@@ -866,7 +1042,7 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
 
             // TODO GH#10135: Ensure replacements contains no runs with .length == 0.
 
-            rle_scanner scanner{ _runs.begin(), _runs.end() };
+            auto scanner = _scanner(_runs, start_index);
             auto [begin, begin_pos] = scanner.scan(start_index);
             auto [end, end_pos] = scanner.scan(end_index);
 
@@ -908,6 +1084,7 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
 
                 _runs.erase(begin, end);
                 _total_length -= removed;
+                _reset_hint();
                 return;
             }
 
@@ -1019,10 +1196,18 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
             {
                 _total_length += run.length;
             }
+
+            // The run at begin_index is the first one we wrote to (or joined with).
+            // It's where the next edit most likely starts.
+            _hint_run = gsl::narrow_cast<size_type>(begin_index);
+            _hint_start = gsl::narrow_cast<size_type>(start_index - begin_additional_length);
         }
 
         container _runs;
         S _total_length{ 0 };
+        // The index of a run and the position it starts at. See _scanner().
+        S _hint_run{ 0 };
+        S _hint_start{ 0 };
 
 #ifdef UNIT_TESTING
         friend class ::RunLengthEncodingTests;
@@ -1030,6 +1215,9 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
 
         template<typename It>
         rle_scanner(It b, It e) -> rle_scanner<It>;
+
+        template<typename It>
+        rle_scanner(It b, It e, size_type i) -> rle_scanner<It>;
     };
 
     template<typename T, typename S = std::size_t>
@@ -0,0 +1,328 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#pragma once
+
+// A portable UTF-8 <--> UTF-16 transcoder. It's self-contained, so that tools and
+// non-Windows builds can use it without including any of the platform headers.
+//
+// Both directions consist of a vectorized loop which transcodes ASCII 16 or 32
+// code units at a time and a validating scalar loop for everything else. Invalid
+// input is replaced with U+FFFD the same way MultiByteToWideChar and
+// WideCharToMultiByte do it: UTF-8 is replaced one "maximal subpart" at a time
+// (see "U+FFFD Substitution of Maximal Subparts" in the Unicode standard) and
+// unpaired UTF-16 surrogates are replaced one code unit at a time.
+
+#include <bit>
+#include <cstdint>
+
+#if defined(__AVX2__) && (defined(_M_X64) || defined(__x86_64__)) && !defined(_M_ARM64EC)
+#define TIL_TRANSCODE_AVX2
+#include <immintrin.h>
+#elif (defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)) && !defined(_M_ARM64EC) && !defined(_M_HYBRID_X86_ARM64)
+#define TIL_TRANSCODE_SSE2
+#include <emmintrin.h>
+#elif defined(_M_ARM64) || defined(_M_ARM64EC) || defined(__aarch64__)
+#define TIL_TRANSCODE_NEON
+#include <arm_neon.h>
+#endif
+
+#pragma warning(push)
+#pragma warning(disable : 26429) // Symbol '...' is never tested for nullness, it can be marked as not_null (f.23).
+#pragma warning(disable : 26481) // Don't use pointer arithmetic. Use span instead (bounds.1).
+#pragma warning(disable : 26490) // Don't use reinterpret_cast (type.1).
+
+namespace til
+{
+    namespace details
+    {
+        inline constexpr char16_t transcode_replacement = 0xFFFD;
+
+        // Decodes the non-ASCII UTF-8 sequence at `it` and returns the pointer past it.
+        inline const char* utf8_decode_one(const char* it, const char* end, char16_t*& out) noexcept
+        {
+            const auto lead = static_cast<uint8_t>(*it++);
+            uint32_t cp;
+            int trail;
+            // The valid range of the first continuation byte depends on the lead byte.
+            // This rejects overlong encodings, surrogates and code points past U+10FFFF.
+            uint8_t lo = 0x80;
+            uint8_t hi = 0xBF;
+
+            if (lead >= 0xC2 && lead <= 0xDF)
+            {
+                cp = lead & 0x1F;
+                trail = 1;
+            }
+            else if (lead >= 0xE0 && lead <= 0xEF)
+            {
+                cp = lead & 0x0F;
+                trail = 2;
+                lo = lead == 0xE0 ? 0xA0 : 0x80;
+                hi = lead == 0xED ? 0x9F : 0xBF;
+            }
+            else if (lead >= 0xF0 && lead <= 0xF4)
+            {
+                cp = lead & 0x07;
+                trail = 3;
+                lo = lead == 0xF0 ? 0x90 : 0x80;
+                hi = lead == 0xF4 ? 0x8F : 0xBF;
+            }
+            else
+            {
+                *out++ = transcode_replacement;
+                return it;
+            }
+
+            for (; trail; --trail)
+            {
+                const auto b = it != end ? static_cast<uint8_t>(*it) : uint8_t{ 0 };
+                if (b < lo || b > hi)
+                {
+                    // The bytes consumed so far are the maximal subpart of an
+                    // ill-formed sequence and get replaced by a single U+FFFD.
+                    *out++ = transcode_replacement;
+                    return it;
+                }
+                cp = (cp << 6) | (b & 0x3F);
+                lo = 0x80;
+                hi = 0xBF;
+                ++it;
+            }
+
+            if (cp < 0x10000)
+            {
+                *out++ = static_cast<char16_t>(cp);
+            }
+            else
+            {
+                cp -= 0x10000;
+                *out++ = static_cast<char16_t>(0xD800 | (cp >> 10));
+                *out++ = static_cast<char16_t>(0xDC00 | (cp & 0x3FF));
+            }
+            return it;
+        }
+
+        // Encodes the non-ASCII UTF-16 code point at `it` and returns the pointer past it.
+        inline const char16_t* utf16_encode_one(const char16_t* it, const char16_t* end, char*& out) noexcept
+        {
+            uint32_t cp = *it++;
+
+            if (cp < 0x800)
+            {
+                *out++ = static_cast<char>(0xC0 | (cp >> 6));
+                *out++ = static_cast<char>(0x80 | (cp & 0x3F));
+                return it;
+            }
+
+            if ((cp & 0xF800) == 0xD800)
+            {
+                if (cp <= 0xDBFF && it != end && (*it & 0xFC00) == 0xDC00)
+                {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (*it++ - 0xDC00);
+                    *out++ = static_cast<char>(0xF0 | (cp >> 18));
+                    *out++ = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+                    *out++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+                    *out++ = static_cast<char>(0x80 | (cp & 0x3F));
+                    return it;
+                }
+                cp = transcode_replacement;
+            }
+
+            *out++ = static_cast<char>(0xE0 | (cp >> 12));
+            *out++ = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            *out++ = static_cast<char>(0x80 | (cp & 0x3F));
+            return it;
+        }
+    }
+
+    // Transcodes the UTF-8 string [beg, end) to UTF-16 and returns the end of the written output.
+    // `out` must have room for at least `end - beg` code units. This function doesn't handle
+    // partial sequences at the end of the input specially. They're replaced by U+FFFD.
+    inline char16_t* utf8_to_utf16(const char* beg, const char* end, char16_t* out) noexcept
+    {
+        auto it = beg;
+
+        while (it != end)
+        {
+            // The vector loops write a full vector of output even if only a part of it is ASCII.
+            // That's safe, because each code unit of output consumes at least one byte of input,
+            // which means that there's always room for as many code units as there's input left.
+#if defined(TIL_TRANSCODE_AVX2)
+            while (end - it >= 32)
+            {
+                const auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(it));
+                const auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(v));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm256_cvtepu8_epi16(_mm256_castsi256_si128(v)));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 16), _mm256_cvtepu8_epi16(_mm256_extracti128_si256(v, 1)));
+                const auto ascii = mask ? std::countr_zero(mask) : 32;
+                it += ascii;
+                out += ascii;
+                if (mask)
+                {
+                    break;
+                }
+            }
+#elif defined(TIL_TRANSCODE_SSE2)
+            while (end - it >= 16)
+            {
+                const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+                const auto mask = static_cast<uint32_t>(_mm_movemask_epi8(v));
+                const auto z = _mm_setzero_si128();
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi8(v, z));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 8), _mm_unpackhi_epi8(v, z));
+                const auto ascii = mask ? std::countr_zero(mask) : 16;
+                it += ascii;
+                out += ascii;
+                if (mask)
+                {
+                    break;
+                }
+            }
+#elif defined(TIL_TRANSCODE_NEON)
+            while (end - it >= 16)
+            {
+                const auto v = vld1q_u8(reinterpret_cast<const uint8_t*>(it));
+                if (vmaxvq_u8(v) >= 0x80)
+                {
+                    break;
+                }
+                vst1q_u16(reinterpret_cast<uint16_t*>(out), vmovl_u8(vget_low_u8(v)));
+                vst1q_u16(reinterpret_cast<uint16_t*>(out + 8), vmovl_high_u8(v));
+                it += 16;
+                out += 16;
+            }
+#endif
+
+            // Scalar loop for the tail of the input and for runs of non-ASCII text.
+            // It returns to the vector loop as soon as it has seen an ASCII character
+            // following a non-ASCII one, since that's typically where ASCII runs begin.
+            for (auto nonAscii = false; it != end;)
+            {
+                const auto ch = static_cast<uint8_t>(*it);
+                if (ch < 0x80)
+                {
+                    if (nonAscii)
+                    {
+                        break;
+                    }
+                    *out++ = ch;
+                    ++it;
+                }
+                else
+                {
+                    it = details::utf8_decode_one(it, end, out);
+                    nonAscii = true;
+                }
+            }
+        }
+
+        return out;
+    }
+
+    // Transcodes the UTF-16 string [beg, end) to UTF-8 and returns the end of the written output.
+    // `out` must have room for at least `3 * (end - beg)` code units. This function doesn't handle
+    // partial surrogate pairs at the end of the input specially. They're replaced by U+FFFD.
+    inline char* utf16_to_utf8(const char16_t* beg, const char16_t* end, char* out) noexcept
+    {
+        auto it = beg;
+
+        while (it != end)
+        {
+            // Just like in utf8_to_utf16 we write full vectors even if they're only partially ASCII.
+            // Each code unit of input produces at least 1 and at most 3 bytes of output,
+            // so there's always room for at least 3 times as many bytes as there's input left.
+#if defined(TIL_TRANSCODE_AVX2)
+            while (end - it >= 32)
+            {
+                const auto a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(it));
+                const auto b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(it + 16));
+                const auto highBits = _mm256_set1_epi16(static_cast<short>(0xff80));
+                const auto z = _mm256_setzero_si256();
+                const auto asciiA = _mm256_cmpeq_epi16(_mm256_and_si256(a, highBits), z);
+                const auto asciiB = _mm256_cmpeq_epi16(_mm256_and_si256(b, highBits), z);
+                // _mm256_pack*_epi16 work on each 128-bit lane separately, which interleaves
+                // the 64-bit halves of the result. The permute puts them back in order.
+                const auto packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0b11'01'10'00);
+                const auto asciiMask = _mm256_permute4x64_epi64(_mm256_packs_epi16(asciiA, asciiB), 0b11'01'10'00);
+                const auto mask = ~static_cast<uint32_t>(_mm256_movemask_epi8(asciiMask));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), packed);
+                const auto ascii = mask ? std::countr_zero(mask) : 32;
+                it += ascii;
+                out += ascii;
+                if (mask)
+                {
+                    break;
+                }
+            }
+#elif defined(TIL_TRANSCODE_SSE2)
+            while (end - it >= 16)
+            {
+                const auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+                const auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it + 8));
+                const auto highBits = _mm_set1_epi16(static_cast<short>(0xff80));
+                const auto z = _mm_setzero_si128();
+                const auto asciiA = _mm_cmpeq_epi16(_mm_and_si128(a, highBits), z);
+                const auto asciiB = _mm_cmpeq_epi16(_mm_and_si128(b, highBits), z);
+                const auto mask = ~static_cast<uint32_t>(_mm_movemask_epi8(_mm_packs_epi16(asciiA, asciiB))) & 0xffff;
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(a, b));
+                const auto ascii = mask ? std::countr_zero(mask) : 16;
+                it += ascii;
+                out += ascii;
+                if (mask)
+                {
+                    break;
+                }
+            }
+#elif defined(TIL_TRANSCODE_NEON)
+            while (end - it >= 16)
+            {
+                const auto a = vld1q_u16(reinterpret_cast<const uint16_t*>(it));
+                const auto b = vld1q_u16(reinterpret_cast<const uint16_t*>(it + 8));
+                if (vmaxvq_u16(vorrq_u16(a, b)) >= 0x80)
+                {
+                    break;
+                }
+                vst1q_u8(reinterpret_cast<uint8_t*>(out), vcombine_u8(vmovn_u16(a), vmovn_u16(b)));
+                it += 16;
+                out += 16;
+            }
+#endif
+
+            for (auto nonAscii = false; it != end;)
+            {
+                const auto ch = *it;
+                if (ch < 0x80)
+                {
+                    if (nonAscii)
+                    {
+                        break;
+                    }
+                    *out++ = static_cast<char>(ch);
+                    ++it;
+                }
+                else
+                {
+                    it = details::utf16_encode_one(it, end, out);
+                    nonAscii = true;
+                }
+            }
+        }
+
+        return out;
+    }
+
+#if WCHAR_MAX == 0xFFFF
+    inline wchar_t* utf8_to_utf16(const char* beg, const char* end, wchar_t* out) noexcept
+    {
+        return reinterpret_cast<wchar_t*>(utf8_to_utf16(beg, end, reinterpret_cast<char16_t*>(out)));
+    }
+
+    inline char* utf16_to_utf8(const wchar_t* beg, const wchar_t* end, char* out) noexcept
+    {
+        return utf16_to_utf8(reinterpret_cast<const char16_t*>(beg), reinterpret_cast<const char16_t*>(end), out);
+    }
+#endif
+}
+
+#pragma warning(pop)
@@ -9,11 +9,12 @@ Abstract:
 - Defines classes which hold the status of the current partials handling.
 - Defines functions for converting between UTF-8 and UTF-16 strings.
 
-Tests have been made in order to investigate whether or not own algorithms
-could overcome disadvantages of syscalls. Test results can be read up
-in PR #4093 and the test algorithms are available in src\tools\U8U16Test.
-Based on the results the decision was made to keep using the platform
-functions MultiByteToWideChar and WideCharToMultiByte.
+The conversions used to call MultiByteToWideChar and WideCharToMultiByte.
+They now use the transcoder in til/transcode.h, which is portable and replaces
+invalid input the same way. Only runs of ASCII are vectorized; all other text
+goes through a scalar loop, which PR #4093 found to be no faster than the
+platform functions. src\tools\U8U16Test and u8u16convertTests time both,
+but no results have been recorded yet, so don't assume either is faster.
 
 Author(s):
 - Steffen Illhardt (german-one), Leonard Hecker (lhecker) 2020-2021
@@ -21,6 +22,8 @@ Author(s):
 
 #pragma once
 
+#include "transcode.h"
+
 namespace til // Terminal Implementation Library. Also: "Today I Learned"
 {
     // state structure for maintenance of UTF-8 partials
@@ -56,7 +59,6 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
     // - S_OK          - the conversion succeeded
     // - E_OUTOFMEMORY - the function failed to allocate memory for the resulting string
     // - E_ABORT       - the resulting string length would exceed the upper boundary of an int and thus, the conversion was aborted before the conversion has been completed
-    // - E_UNEXPECTED  - the underlying conversion function failed
     // - HRESULT value converted from a caught exception
     template<class outT>
     [[nodiscard]] HRESULT u8u16(const std::string_view& in, outT& out) noexcept
@@ -69,11 +71,11 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
             int lengthRequired{};
             // The worst ratio of UTF-8 code units to UTF-16 code units is 1 to 1 if UTF-8 consists of ASCII only.
             RETURN_HR_IF(E_ABORT, !base::MakeCheckedNum(in.length()).AssignIfValid(&lengthRequired));
-            out.resize(in.length()); // avoid to call MultiByteToWideChar twice only to get the required size
-            const int lengthOut = MultiByteToWideChar(CP_UTF8, 0ul, in.data(), lengthRequired, out.data(), lengthRequired);
-            out.resize(gsl::narrow_cast<size_t>(lengthOut));
+            out.resize(in.length());
+            const auto end = utf8_to_utf16(in.data(), in.data() + in.length(), out.data());
+            out.resize(gsl::narrow_cast<size_t>(end - out.data()));
 
-            return lengthOut == 0 ? E_UNEXPECTED : S_OK;
+            return S_OK;
         }
         CATCH_RETURN();
     }
@@ -90,7 +92,6 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
     // - S_OK          - the conversion succeeded
     // - E_OUTOFMEMORY - the function failed to allocate memory for the resulting string
     // - E_ABORT       - the resulting string length would exceed the upper boundary of an int and thus, the conversion was aborted before the conversion has been completed
-    // - E_UNEXPECTED  - the underlying conversion function failed
     // - HRESULT value converted from a caught exception
     template<class outT>
     [[nodiscard]] HRESULT u8u16(const std::string_view& in, outT& out, u8state& state) noexcept
@@ -120,8 +121,7 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
                     return S_OK;
                 }
 
-                len16 = MultiByteToWideChar(CP_UTF8, 0UL, &state.partials[0], gsl::narrow_cast<int>(state.have), out.data(), capa16);
-                RETURN_HR_IF(E_UNEXPECTED, !len16);
+                len16 = gsl::narrow_cast<int>(utf8_to_utf16(&state.partials[0], &state.partials[state.have], out.data()) - out.data());
 
                 capa16 -= len16;
                 len8 -= copyable;
@@ -158,10 +158,8 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
 
             if (len8)
             {
-                const auto convLen{ MultiByteToWideChar(CP_UTF8, 0UL, cursor8, len8, out.data() + len16, capa16) };
-                RETURN_HR_IF(E_UNEXPECTED, !convLen);
-
-                len16 += convLen;
+                const auto end{ utf8_to_utf16(cursor8, cursor8 + len8, out.data() + len16) };
+                len16 = gsl::narrow_cast<int>(end - out.data());
             }
 
             out.resize(gsl::narrow_cast<size_t>(len16));
@@ -180,7 +178,6 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
     // - S_OK          - the conversion succeeded
     // - E_OUTOFMEMORY - the function failed to allocate memory for the resulting string
     // - E_ABORT       - the resulting string length would exceed the upper boundary of an int and thus, the conversion was aborted before the conversion has been completed
-    // - E_UNEXPECTED  - the underlying conversion function failed
     // - HRESULT value converted from a caught exception
     template<class outT>
     [[nodiscard]] HRESULT u16u8(const std::wstring_view& in, outT& out) noexcept
@@ -196,11 +193,11 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
             // Code Points >U+FFFF: 2 UTF-16 code units --> 4 UTF-8 code units.
             // Thus, the worst ratio of UTF-16 code units to UTF-8 code units is 1 to 3.
             RETURN_HR_IF(E_ABORT, !base::MakeCheckedNum(in.length()).AssignIfValid(&lengthIn) || !base::CheckMul(lengthIn, 3).AssignIfValid(&lengthRequired));
-            out.resize(gsl::narrow_cast<size_t>(lengthRequired)); // avoid to call WideCharToMultiByte twice only to get the required size
-            const int lengthOut = WideCharToMultiByte(CP_UTF8, 0ul, in.data(), lengthIn, out.data(), lengthRequired, nullptr, nullptr);
-            out.resize(gsl::narrow_cast<size_t>(lengthOut));
+            out.resize(gsl::narrow_cast<size_t>(lengthRequired));
+            const auto end = utf16_to_utf8(in.data(), in.data() + in.length(), out.data());
+            out.resize(gsl::narrow_cast<size_t>(end - out.data()));
 
-            return lengthOut == 0 ? E_UNEXPECTED : S_OK;
+            return S_OK;
         }
         CATCH_RETURN();
     }
@@ -217,7 +214,6 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
     // - S_OK          - the conversion succeeded without any change of the represented code points
     // - E_OUTOFMEMORY - the function failed to allocate memory for the resulting string
     // - E_ABORT       - the resulting string length would exceed the upper boundary of an int and thus, the conversion was aborted before the conversion has been completed
-    // - E_UNEXPECTED  - the underlying conversion function failed
     // - HRESULT value converted from a caught exception
     template<class outT>
     [[nodiscard]] HRESULT u16u8(const std::wstring_view& in, outT& out, u16state& state) noexcept
@@ -238,8 +234,7 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
             if (state.partials[0])
             {
                 state.partials[1] = *cursor16;
-                len8 = WideCharToMultiByte(CP_UTF8, 0UL, &state.partials[0], 2, out.data(), capa8, nullptr, nullptr);
-                RETURN_HR_IF(E_UNEXPECTED, !len8);
+                len8 = gsl::narrow_cast<int>(utf16_to_utf8(&state.partials[0], &state.partials[2], out.data()) - out.data());
 
                 state.reset();
                 capa8 -= len8;
@@ -259,10 +254,8 @@ namespace til // Terminal Implementation Library. Also: "Today I Learned"
 
             if (len16)
             {
-                const auto convLen{ WideCharToMultiByte(CP_UTF8, 0UL, cursor16, len16, out.data() + len8, capa8, nullptr, nullptr) };
-                RETURN_HR_IF(E_UNEXPECTED, !convLen);
-
-                len8 += convLen;
+                const auto end{ utf16_to_utf8(cursor16, cursor16 + len16, out.data() + len8) };
+                len8 = gsl::narrow_cast<int>(end - out.data());
             }
 
             out.resize(gsl::narrow_cast<size_t>(len8));
@@ -1483,6 +1483,50 @@ class UiaTextRangeTests
         VERIFY_ARE_EQUAL(L"M", std::wstring_view{ text });
     }
 
+    TEST_METHOD(WordNavigationPerformance)
+    {
+        // Simulate a screen reader reading the buffer word by word, which for every word
+        // moves the range, expands it and retrieves its text. We count how many
+        // of these UIA calls a client can make per second.
+        const auto width = _pTextBuffer->GetSize().Width();
+        std::wstring line;
+        while (line.size() < gsl::narrow_cast<size_t>(width))
+        {
+            line.append(L"lorem ipsum, dolor sit amet ");
+        }
+        line.resize(width);
+
+        const auto rows = _pTextBuffer->TotalRowCount() / 2;
+        for (auto y = 0; y < rows; ++y)
+        {
+            _pTextBuffer->Write(OutputCellIterator{ line }, { 0, y }, false);
+        }
+
+        Microsoft::WRL::ComPtr<UiaTextRange> utr;
+        THROW_IF_FAILED(Microsoft::WRL::MakeAndInitialize<UiaTextRange>(&utr, _pUiaData, &_dummyProvider, origin, origin));
+
+        size_t calls = 0;
+        int moveAmt;
+        const auto beg = std::chrono::steady_clock::now();
+        for (auto i = 0; i < 5000; ++i)
+        {
+            wil::unique_bstr text;
+            THROW_IF_FAILED(utr->Move(TextUnit_Word, 1, &moveAmt));
+            THROW_IF_FAILED(utr->ExpandToEnclosingUnit(TextUnit_Word));
+            THROW_IF_FAILED(utr->GetText(-1, text.put()));
+            calls += 3;
+        }
+        for (auto i = 0; i < 5000; ++i)
+        {
+            THROW_IF_FAILED(utr->Move(TextUnit_Word, -1, &moveAmt));
+            calls++;
+        }
+        const auto end = std::chrono::steady_clock::now();
+
+        const auto seconds = std::chrono::duration<double>(end - beg).count();
+        Log::Comment(NoThrowString().Format(L"%zu UIA calls in %.1fms: %.0f calls/s", calls, seconds * 1000.0, calls / seconds));
+    }
+
     TEST_METHOD(ScrollIntoView)
     {
         const auto viewportSize{ _pUiaData->GetViewport() };
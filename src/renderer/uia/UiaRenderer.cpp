@@ -5,11 +5,19 @@
 
 #include "UiaRenderer.hpp"
 
+#include <til/unicode.h>
+
 #pragma hdrstop
 
 using namespace Microsoft::Console::Render;
 using namespace Microsoft::Console::Types;
 
+// Screen readers can't meaningfully announce more than a few thousand characters per frame anyway.
+// During heavy output we thus only keep the beginning and the end of the new text of each frame.
+static constexpr size_t maxNewOutputHead = 2000;
+static constexpr size_t maxNewOutputTail = 2000;
+static constexpr std::wstring_view newOutputElisionMarker{ L"\u2026\n" };
+
 // Routine Description:
 // - Constructs a UIA engine for console text
 //   which primarily notifies automation clients of any activity
@@ -19,6 +27,7 @@ UiaEngine::UiaEngine(IUiaEventDispatcher* dispatcher) :
     _selectionChanged{ false },
     _textBufferChanged{ false },
     _cursorChanged{ false },
+    _newOutputElided{ false },
     _isEnabled{ true },
     _prevCursorRegion{},
     RenderEngineBase()
@@ -51,6 +60,8 @@ UiaEngine::UiaEngine(IUiaEventDispatcher* dispatcher) :
     // back around to actually paint, we will just no-op. No sense in keeping
     // the data buffered.
     _newOutput = std::wstring{};
+    _newOutputTail = std::wstring{};
+    _newOutputElided = false;
 
     return S_OK;
 }
@@ -153,14 +164,57 @@ try
 
     if (!newText.empty())
     {
-        _newOutput.append(newText);
-        _newOutput.push_back(L'\n');
+        _appendNewOutput(newText);
+        _appendNewOutput(L"\n");
         _textBufferChanged = true;
     }
     return S_OK;
 }
 CATCH_LOG_RETURN_HR(E_FAIL);
 
+// Routine Description:
+// - Appends text to the new output of this frame, while ensuring that the buffered
+//   text stays bounded no matter how much is written between two frames.
+// Arguments:
+// - text - the text to append
+void UiaEngine::_appendNewOutput(std::wstring_view text)
+{
+    // Fill up the head first...
+    if (_newOutput.size() < maxNewOutputHead && _newOutputTail.empty() && !_newOutputElided)
+    {
+        auto count = std::min(text.size(), maxNewOutputHead - _newOutput.size());
+        // Don't split surrogate pairs between the head and the tail.
+        if (count < text.size() && count != 0 && til::is_leading_surrogate(text[count - 1]))
+        {
+            count--;
+        }
+        _newOutput.append(text.substr(0, count));
+        text = text.substr(count);
+    }
+
+    if (text.empty())
+    {
+        return;
+    }
+
+    // ...and then only keep the most recent text in the tail. To amortize the cost
+    // of dropping text at the front, we let the tail grow to twice its size first.
+    if (text.size() >= maxNewOutputTail)
+    {
+        _newOutputTail.assign(text.substr(text.size() - maxNewOutputTail));
+        _newOutputElided = true;
+    }
+    else
+    {
+        _newOutputTail.append(text);
+        if (_newOutputTail.size() > 2 * maxNewOutputTail)
+        {
+            _newOutputTail.erase(0, _newOutputTail.size() - maxNewOutputTail);
+            _newOutputElided = true;
+        }
+    }
+}
+
 // Routine Description:
 // - Prepares internal structures for a painting operation.
 // Arguments:
@@ -198,6 +252,32 @@ CATCH_LOG_RETURN_HR(E_FAIL);
     // worth of text data.
     std::swap(_queuedOutput, _newOutput);
     _newOutput.clear();
+
+    try
+    {
+        if (!_newOutputTail.empty())
+        {
+            std::wstring_view tail{ _newOutputTail };
+            if (tail.size() > maxNewOutputTail)
+            {
+                tail = tail.substr(tail.size() - maxNewOutputTail);
+                _newOutputElided = true;
+            }
+            if (_newOutputElided)
+            {
+                // Don't start the tail with half a surrogate pair.
+                if (til::is_trailing_surrogate(tail.front()))
+                {
+                    tail = tail.substr(1);
+                }
+                _queuedOutput.append(newOutputElisionMarker);
+            }
+            _queuedOutput.append(tail);
+        }
+    }
+    CATCH_LOG();
+    _newOutputTail.clear();
+    _newOutputElided = false;
     return S_OK;
 }
 
@@ -69,9 +69,16 @@ namespace Microsoft::Console::Render
         bool _selectionChanged;
         bool _textBufferChanged;
         bool _cursorChanged;
+        bool _newOutputElided;
+        // NotifyNewText() fills _newOutput with up to maxNewOutputHead characters. Once it's full, the
+        // most recent maxNewOutputTail characters are kept in _newOutputTail and everything in between
+        // is dropped. EndPaint() then joins the two, separated by an elision marker if needed.
         std::wstring _newOutput;
+        std::wstring _newOutputTail;
         std::wstring _queuedOutput;
 
+        void _appendNewOutput(std::wstring_view text);
+
         Microsoft::Console::Types::IUiaEventDispatcher* _dispatcher;
 
         til::rect _prevCursorRegion;
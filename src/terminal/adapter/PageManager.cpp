@@ -108,6 +108,61 @@ void PageManager::Reset()
     _activePageNumber = 1;
     _visiblePageNumber = 1;
     _buffers = {};
+    _blankAttributes = {};
+}
+
+// Releases the page buffers that aren't needed anymore, turning them back
+// into blank pages. That's the case for pages that have no content, as well
+// as the visible page, whose content is held in the main buffer. The active
+// page is always retained, because it holds the current cursor state.
+void PageManager::Trim()
+{
+    for (auto pageNumber = 1; pageNumber <= MAX_PAGES; pageNumber++)
+    {
+        auto& buffer = til::at(_buffers, pageNumber - 1);
+        if (buffer == nullptr)
+        {
+            continue;
+        }
+        if (pageNumber == _visiblePageNumber)
+        {
+            // The content of the visible page will be saved back into a new
+            // buffer when another page is made visible.
+            buffer.reset();
+            continue;
+        }
+        if (pageNumber == _activePageNumber)
+        {
+            continue;
+        }
+
+        // Rows that were never committed are blank in the attributes we
+        // recorded, otherwise it's whatever the first cell was erased with.
+        auto& blankAttributes = til::at(_blankAttributes, pageNumber - 1);
+        if (buffer->GetCommittedMemory() != 0)
+        {
+            blankAttributes = buffer->GetRowByOffset(0).GetAttrByColumn(0);
+        }
+        if (buffer->IsBlank(0, buffer->GetSize().Height(), blankAttributes))
+        {
+            buffer.reset();
+        }
+    }
+}
+
+// Returns the amount of memory committed for the rows of the page buffers.
+// This doesn't include the visible page, which is held in the main buffer.
+size_t PageManager::GetCommittedMemory() const noexcept
+{
+    size_t total = 0;
+    for (const auto& buffer : _buffers)
+    {
+        if (buffer)
+        {
+            total += buffer->GetCommittedMemory();
+        }
+    }
+    return total;
 }
 
 Page PageManager::Get(const til::CoordType pageNumber) const
@@ -169,16 +224,8 @@ void PageManager::MoveTo(const til::CoordType pageNumber, const bool makeVisible
     // ever has to deal with the main buffer.
     if (makeVisible && _visiblePageNumber != newPageNumber)
     {
-        const auto& newBuffer = _getBuffer(newPageNumber, pageSize);
-        auto& saveBuffer = _getBuffer(_visiblePageNumber, pageSize);
-        for (auto i = 0; i < pageSize.height; i++)
-        {
-            visibleBuffer.CopyRow(visibleTop + i, i, saveBuffer);
-        }
-        for (auto i = 0; i < pageSize.height; i++)
-        {
-            newBuffer.CopyRow(i, visibleTop + i, visibleBuffer);
-        }
+        _savePage(_visiblePageNumber, visibleBuffer, visibleTop, pageSize);
+        _restorePage(newPageNumber, visibleBuffer, visibleTop, pageSize);
         _visiblePageNumber = newPageNumber;
         redrawRequired = true;
     }
@@ -244,7 +291,9 @@ TextBuffer& PageManager::_getBuffer(const til::CoordType pageNumber, const til::
     {
         // Page buffers are created on demand, and are sized to match the active
         // page dimensions without any scrollback rows.
-        buffer = std::make_unique<TextBuffer>(pageSize, TextAttribute{}, 0, false, _renderer);
+        // Their rows will be committed as they're written to, and until then
+        // they're blank, using the attributes recorded for the blank page.
+        buffer = std::make_unique<TextBuffer>(pageSize, til::at(_blankAttributes, pageNumber - 1), 0, false, _renderer);
     }
     else if (buffer->GetSize().Dimensions() != pageSize)
     {
@@ -256,3 +305,50 @@ TextBuffer& PageManager::_getBuffer(const til::CoordType pageNumber, const til::
     }
     return *buffer;
 }
+
+// Copies the content of the visible page into the buffer of the given page
+// number. If the content is blank, we only need to record the attributes it
+// was filled with, and can release the buffer instead.
+void PageManager::_savePage(const til::CoordType pageNumber, const TextBuffer& visibleBuffer, const til::CoordType visibleTop, const til::size pageSize)
+{
+    const auto blankAttributes = visibleBuffer.GetRowByOffset(visibleTop).GetAttrByColumn(0);
+    if (visibleBuffer.IsBlank(visibleTop, visibleTop + pageSize.height, blankAttributes))
+    {
+        til::at(_blankAttributes, pageNumber - 1) = blankAttributes;
+        til::at(_buffers, pageNumber - 1).reset();
+        return;
+    }
+
+    auto& saveBuffer = _getBuffer(pageNumber, pageSize);
+    for (auto i = 0; i < pageSize.height; i++)
+    {
+        visibleBuffer.CopyRow(visibleTop + i, i, saveBuffer);
+    }
+}
+
+// Copies the content of the given page number into the visible page. Blank
+// pages don't need to be copied (or even have a buffer), so for those we
+// just erase the rows. Either way, the rows keep their shell integration
+// marks, since those belong to the main buffer rather than to a page.
+void PageManager::_restorePage(const til::CoordType pageNumber, TextBuffer& visibleBuffer, const til::CoordType visibleTop, const til::size pageSize) const
+{
+    const auto& buffer = til::at(_buffers, pageNumber - 1);
+    const auto& blankAttributes = til::at(_blankAttributes, pageNumber - 1);
+    if (buffer == nullptr || buffer->IsBlank(0, buffer->GetSize().Height(), blankAttributes))
+    {
+        for (auto i = 0; i < pageSize.height; i++)
+        {
+            auto& row = visibleBuffer.GetMutableRowByOffset(visibleTop + i);
+            auto scrollbarData = row.GetScrollbarData();
+            row.Reset(blankAttributes);
+            row.SetScrollbarData(std::move(scrollbarData));
+        }
+        return;
+    }
+
+    const auto& newBuffer = _getBuffer(pageNumber, pageSize);
+    for (auto i = 0; i < pageSize.height; i++)
+    {
+        newBuffer.CopyRow(i, visibleTop + i, visibleBuffer);
+    }
+}
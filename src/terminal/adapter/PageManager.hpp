@@ -49,6 +49,8 @@ namespace Microsoft::Console::VirtualTerminal
     public:
         PageManager(ITerminalApi& api, Renderer* renderer) noexcept;
         void Reset();
+        void Trim();
+        size_t GetCommittedMemory() const noexcept;
         Page Get(const til::CoordType pageNumber) const;
         Page ActivePage() const;
         Page VisiblePage() const;
@@ -58,6 +60,8 @@ namespace Microsoft::Console::VirtualTerminal
 
     private:
         TextBuffer& _getBuffer(const til::CoordType pageNumber, const til::size pageSize) const;
+        void _savePage(const til::CoordType pageNumber, const TextBuffer& visibleBuffer, const til::CoordType visibleTop, const til::size pageSize);
+        void _restorePage(const til::CoordType pageNumber, TextBuffer& visibleBuffer, const til::CoordType visibleTop, const til::size pageSize) const;
 
         ITerminalApi& _api;
         Renderer* _renderer;
@@ -65,5 +69,7 @@ namespace Microsoft::Console::VirtualTerminal
         til::CoordType _visiblePageNumber = 1;
         static constexpr til::CoordType MAX_PAGES = 6;
         mutable std::array<std::unique_ptr<TextBuffer>, MAX_PAGES> _buffers;
+        // A page without a buffer is blank, filled with these attributes.
+        std::array<TextAttribute, MAX_PAGES> _blankAttributes;
     };
 }
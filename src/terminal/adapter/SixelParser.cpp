@@ -89,6 +89,7 @@ std::function<bool(wchar_t)> SixelParser::DefineImage(const VTInt macroParameter
         _initImageBuffer();
         _state = States::Normal;
         _parameters.clear();
+        _pendingSixelCount = 0;
         return [&](const auto ch) {
             _parseCommandChar(ch);
             return true;
@@ -110,11 +111,17 @@ void SixelParser::_parseCommandChar(const wchar_t ch)
         // When preceded by a repeat command, the repeat parameter value denotes
         // the number of times that the following sixel should be repeated.
         const auto repeatCount = _applyPendingCommand();
-        _writeToImageBuffer(ch - L'?', repeatCount);
+        _queueSixelValue(ch - L'?', repeatCount);
+        return;
     }
+
+    // Anything other than a sixel value ends the current run of sixels, so
+    // that needs to be written out before the next command can be processed.
+    _flushPendingSixels();
+
     // Characters `0` to `9` and `;` are used to represent parameter values for
     // commands that require them.
-    else if ((ch >= '0' && ch <= '9') || ch == ';')
+    if ((ch >= '0' && ch <= '9') || ch == ';')
     {
         _parseParameterChar(ch);
     }
@@ -202,6 +209,35 @@ void SixelParser::_parseParameterChar(const wchar_t ch)
     }
 }
 
+void SixelParser::_queueSixelValue(const int sixelValue, const int repeatCount)
+{
+    // Rather than rendering every sixel as soon as it's received, we collect
+    // consecutive identical values into a single run, which can then be
+    // written to the image buffer with one wide fill per pixel row. This is
+    // common in the flat areas of plots, where encoders often emit a sequence
+    // of short runs that aren't worth the overhead of a repeat command. The
+    // run can never be wider than the image, so we clamp it to that size.
+    if (_pendingSixelCount > 0 && sixelValue == _pendingSixelValue)
+    {
+        _pendingSixelCount = std::min(_pendingSixelCount + repeatCount, _imageMaxWidth);
+    }
+    else
+    {
+        _flushPendingSixels();
+        _pendingSixelValue = sixelValue;
+        _pendingSixelCount = std::min(repeatCount, _imageMaxWidth);
+    }
+}
+
+void SixelParser::_flushPendingSixels()
+{
+    if (_pendingSixelCount > 0)
+    {
+        _writeToImageBuffer(_pendingSixelValue, _pendingSixelCount);
+        _pendingSixelCount = 0;
+    }
+}
+
 int SixelParser::_applyPendingCommand()
 {
     if (_state != States::Normal) [[unlikely]]
@@ -551,6 +587,8 @@ void SixelParser::_defineColor(const size_t colorNumber, const COLORREF color)
         const auto tableIndex = til::at(_colorMap, colorNumber);
         til::at(_colorTable, tableIndex) = color;
         _colorTableChanged = true;
+        // Any existing pixels using this entry must then be rendered again.
+        _invalidateImageBuffer();
         // If some image content has already been defined at this point, and
         // we're processing the last character in the packet, this is likely an
         // attempt to animate the palette, so we should flush the image.
@@ -572,6 +610,9 @@ void SixelParser::_defineColor(const size_t colorNumber, const COLORREF color)
             til::at(_colorMap, colorNumber) = gsl::narrow_cast<IndexType>(tableIndex);
             til::at(_colorTable, tableIndex) = color;
             _colorTableChanged = true;
+            // Pixels that were drawn with the default mapping may already be
+            // using this table entry, so they'll need to be rendered again.
+            _invalidateImageBuffer();
         }
         else if (_conformanceLevel == 2)
         {
@@ -641,6 +682,7 @@ void SixelParser::_initImageBuffer()
     _imageCursor = {};
     _imageWidth = 0;
     _imageMaxWidth = _availablePixelWidth;
+    _imageDirtyTop = til::CoordTypeMax;
     _imageLineCount = 0;
     _resizeImageBuffer(_sixelHeight);
 
@@ -694,6 +736,7 @@ void SixelParser::_fillImageBackground(const int backgroundHeight)
     const auto backgroundWidth = std::min(_backgroundSize.width, _availablePixelWidth);
     const auto backgroundOffset = _imageCursor.y * _imageMaxWidth;
     auto dst = std::next(_imageBuffer.begin(), backgroundOffset);
+    _invalidateImageBuffer(_imageCursor.y);
     for (auto i = 0; i < backgroundHeight; i++)
     {
         std::fill_n(dst, backgroundWidth, backgroundPixel);
@@ -739,25 +782,35 @@ void SixelParser::_writeToImageBuffer(int sixelValue, int repeatCount)
     // Then we need to render the 6 vertical pixels that are represented by the
     // bits in the sixel value. Although note that each of these sixel pixels
     // may cover more than one device pixel, depending on the aspect ratio.
-    const auto targetOffset = _imageCursor.y * _imageMaxWidth + _imageCursor.x;
-    auto imageBufferPtr = std::next(_imageBuffer.data(), targetOffset);
+    // We only visit the bits that are actually set, since sparse values are
+    // the norm for line plots and the edges of shapes.
     repeatCount = std::min(repeatCount, _imageMaxWidth - _imageCursor.x);
-    for (auto i = 0; i < 6; i++)
-    {
-        if (sixelValue & 1)
+    if (sixelValue != 0 && repeatCount > 0)
+    {
+        const auto targetOffset = _imageCursor.y * _imageMaxWidth + _imageCursor.x;
+        const auto imageBufferPtr = std::next(_imageBuffer.data(), targetOffset);
+        const auto sixelStride = _imageMaxWidth * _pixelAspectRatio;
+        auto remainingBits = gsl::narrow_cast<unsigned long>(sixelValue);
+        unsigned long bitIndex;
+        while (_BitScanForward(&bitIndex, remainingBits))
         {
+            remainingBits &= remainingBits - 1;
+            auto rowPtr = std::next(imageBufferPtr, gsl::narrow_cast<ptrdiff_t>(bitIndex) * sixelStride);
             auto repeatAspectRatio = _pixelAspectRatio;
             do
             {
-                std::fill_n(imageBufferPtr, repeatCount, _foregroundPixel);
-                std::advance(imageBufferPtr, _imageMaxWidth);
+                if (repeatCount == 1)
+                {
+                    *rowPtr = _foregroundPixel;
+                }
+                else
+                {
+                    std::fill_n(rowPtr, repeatCount, _foregroundPixel);
+                }
+                std::advance(rowPtr, _imageMaxWidth);
             } while (--repeatAspectRatio > 0);
         }
-        else
-        {
-            std::advance(imageBufferPtr, _imageMaxWidth * _pixelAspectRatio);
-        }
-        sixelValue >>= 1;
+        _invalidateImageBuffer(_imageCursor.y);
     }
     _imageCursor.x += repeatCount;
 }
@@ -779,6 +832,42 @@ void SixelParser::_eraseImageBufferRows(const int rowCount, const til::CoordType
         _imageBuffer.erase(_imageBuffer.begin() + bufferOffset, _imageBuffer.begin() + bufferOffsetEnd);
         _imageCursor.y -= pixelCount;
     }
+    // Erasing from the middle of the buffer shifts the remaining content up,
+    // so everything from the erased offset onwards has to be rendered again.
+    // When erasing from the top, the image origin is moved down by the caller
+    // and the rows that remain will still line up with what was rendered.
+    _imageDirtyTop = rowOffset > 0 ? std::min(_imageDirtyTop, rowOffset * _cellSize.height) : std::max(_imageDirtyTop - pixelCount, 0);
+}
+
+void SixelParser::_invalidateImageBuffer(const til::CoordType fromPixelRow) noexcept
+{
+    _imageDirtyTop = std::min(_imageDirtyTop, fromPixelRow);
+}
+
+void SixelParser::_internImageSlices(Page& page)
+{
+    // Once the image is complete, its slices are handed over to the buffer's
+    // image store, so rows with identical content (e.g. when the same image is
+    // output repeatedly) share a single copy of their pixels. This is also the
+    // point at which we evict images that have scrolled into the history, if
+    // we're using more memory than we'd like to retain.
+    if (_imageMaxWidth > 0)
+    {
+        auto& buffer = page.Buffer();
+        auto& imageStore = buffer.GetImageStore();
+        const auto imagePixelRows = gsl::narrow_cast<til::CoordType>(_imageBuffer.size() / _imageMaxWidth);
+        const auto imageRows = (imagePixelRows + _cellSize.height - 1) / _cellSize.height;
+        const auto rowBegin = std::max(_imageOriginCell.y, 0);
+        const auto rowEnd = std::min(_imageOriginCell.y + imageRows, page.Bottom());
+        for (auto y = rowBegin; y < rowEnd; y++)
+        {
+            if (buffer.GetRowByOffset(y).GetImageSlice())
+            {
+                imageStore.Intern(*buffer.GetMutableRowByOffset(y).GetMutableImageSlice());
+            }
+        }
+        buffer.TrimImageContent(page.Top(), MAX_RETAINED_IMAGE_BYTES);
+    }
 }
 
 void SixelParser::_maybeFlushImageBuffer(const bool endOfSequence)
@@ -833,10 +922,24 @@ void SixelParser::_maybeFlushImageBuffer(const bool endOfSequence)
         // so the only visible change will be the scrolling.
         if (_imageWidth > 0)
         {
+            // The color table lookups are resolved once per flush, rather than
+            // being converted from a COLORREF for every pixel that is copied.
+            for (size_t tableIndex = 0; tableIndex < _maxColors; tableIndex++)
+            {
+                til::at(_flushColors, tableIndex) = _makeRGBQUAD(til::at(_colorTable, tableIndex));
+            }
+
+            // Rows above the dirty offset haven't changed since the last flush,
+            // so we can skip straight to the first cell row that needs to be
+            // updated. Without this, streamed images would be copied in their
+            // entirety every time a new line was received.
+            const auto bufferPixelRows = gsl::narrow_cast<til::CoordType>(_imageBuffer.size() / _imageMaxWidth);
+            const auto skippedPixelRows = std::min(_imageDirtyTop / _cellSize.height * _cellSize.height, bufferPixelRows);
+
             const auto columnBegin = _imageOriginCell.x;
             const auto columnEnd = _imageOriginCell.x + (_imageWidth + _cellSize.width - 1) / _cellSize.width;
-            auto rowOffset = _imageOriginCell.y;
-            auto srcIterator = _imageBuffer.begin();
+            auto rowOffset = _imageOriginCell.y + skippedPixelRows / _cellSize.height;
+            auto srcIterator = std::next(_imageBuffer.begin(), skippedPixelRows * _imageMaxWidth);
             while (srcIterator < _imageBuffer.end() && rowOffset < page.Bottom())
             {
                 if (rowOffset >= 0)
@@ -856,8 +959,7 @@ void SixelParser::_maybeFlushImageBuffer(const bool endOfSequence)
                             const auto srcPixel = til::at(srcIterator, pixelColumn);
                             if (!srcPixel.transparent)
                             {
-                                const auto srcColor = _colorFromIndex(srcPixel.colorIndex);
-                                til::at(dstIterator, pixelColumn) = _makeRGBQUAD(srcColor);
+                                til::at(dstIterator, pixelColumn) = til::at(_flushColors, srcPixel.colorIndex);
                             }
                         }
                         std::advance(srcIterator, _imageMaxWidth);
@@ -876,9 +978,17 @@ void SixelParser::_maybeFlushImageBuffer(const bool endOfSequence)
             }
 
             // Trigger a redraw of the affected rows in the renderer.
-            const auto topRowOffset = std::max(_imageOriginCell.y, 0);
-            const auto dirtyView = Viewport::FromExclusive({ 0, topRowOffset, page.Width(), rowOffset });
-            page.Buffer().TriggerRedraw(dirtyView);
+            const auto topRowOffset = std::max(_imageOriginCell.y + skippedPixelRows / _cellSize.height, 0);
+            if (rowOffset > topRowOffset)
+            {
+                const auto dirtyView = Viewport::FromExclusive({ 0, topRowOffset, page.Width(), rowOffset });
+                page.Buffer().TriggerRedraw(dirtyView);
+            }
+
+            // Anything below the last row we rendered is still dirty, and so is
+            // the current sixel line, because it may yet be extended past the
+            // image width that was used for this flush.
+            _imageDirtyTop = std::min((rowOffset - _imageOriginCell.y) * _cellSize.height, _imageCursor.y);
 
             // If the start of the image is now above the top of the page, we
             // won't be making any further updates to that content, so we can
@@ -897,6 +1007,7 @@ void SixelParser::_maybeFlushImageBuffer(const bool endOfSequence)
         // And at the end of the sequence, we update the text cursor position.
         if (endOfSequence)
         {
+            _internImageSlices(page);
             _updateTextCursor(page.Cursor());
         }
     }
@@ -41,6 +41,9 @@ namespace Microsoft::Console::VirtualTerminal
         // change the IndexType to uint16_t, and use a bit field in IndexedPixel
         // to retain the 16-bit size.
         static constexpr size_t MAX_COLORS = 256;
+        // Once this much image memory is in use, the images that have scrolled
+        // out of the viewport start being evicted, oldest first.
+        static constexpr size_t MAX_RETAINED_IMAGE_BYTES = 128 * 1024 * 1024;
         using IndexType = uint8_t;
         struct IndexedPixel
         {
@@ -54,6 +57,8 @@ namespace Microsoft::Console::VirtualTerminal
 
         void _parseCommandChar(const wchar_t ch);
         void _parseParameterChar(const wchar_t ch);
+        void _queueSixelValue(const int sixelValue, const int repeatCount);
+        void _flushPendingSixels();
         int _applyPendingCommand();
         void _executeCarriageReturn() noexcept;
         void _executeNextLine();
@@ -68,6 +73,8 @@ namespace Microsoft::Console::VirtualTerminal
         };
         States _state = States::Normal;
         std::vector<VTParameter> _parameters;
+        int _pendingSixelValue = 0;
+        int _pendingSixelCount = 0;
 
         bool _initTextBufferBoundaries();
         void _initRasterAttributes(const VTInt macroParameter, const DispatchTypes::SixelBackground backgroundSelect) noexcept;
@@ -115,15 +122,19 @@ namespace Microsoft::Console::VirtualTerminal
         void _decreaseFilledBackgroundHeight(const int decreasedHeight) noexcept;
         void _writeToImageBuffer(const int sixelValue, const int repeatCount);
         void _eraseImageBufferRows(const int rowCount, const til::CoordType startRow = 0) noexcept;
+        void _invalidateImageBuffer(const til::CoordType fromPixelRow = 0) noexcept;
         void _maybeFlushImageBuffer(const bool endOfSequence = false);
+        void _internImageSlices(Page& page);
 
         std::vector<IndexedPixel> _imageBuffer;
         til::point _imageOriginCell;
         til::point _imageCursor;
         til::CoordType _imageWidth = 0;
         til::CoordType _imageMaxWidth = 0;
+        til::CoordType _imageDirtyTop = 0;
         size_t _imageLineCount = 0;
         size_t _lastFlushLine = 0;
+        std::array<RGBQUAD, MAX_COLORS> _flushColors = {};
         std::chrono::steady_clock::time_point _lastFlushTime;
     };
 }
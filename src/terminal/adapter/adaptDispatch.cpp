@@ -954,32 +954,28 @@ void AdaptDispatch::_ChangeRectAttributes(const Page& page, const til::rect& cha
 {
     if (changeRect)
     {
-        for (auto row = changeRect.top; row < changeRect.bottom; row++)
-        {
-            auto& rowBuffer = page.Buffer().GetMutableRowByOffset(row);
-            for (auto col = changeRect.left; col < changeRect.right; col++)
+        // The change is applied a run at a time, so this lambda is only called
+        // once for each distinct attribute run in the affected rows.
+        page.Buffer().ChangeAttributes(changeRect, [&](const TextAttribute& original) {
+            auto attr = original;
+            auto characterAttributes = attr.GetCharacterAttributes();
+            characterAttributes &= changeOps.andAttrMask;
+            characterAttributes ^= changeOps.xorAttrMask;
+            attr.SetCharacterAttributes(characterAttributes);
+            if (changeOps.foreground)
             {
-                auto attr = rowBuffer.GetAttrByColumn(col);
-                auto characterAttributes = attr.GetCharacterAttributes();
-                characterAttributes &= changeOps.andAttrMask;
-                characterAttributes ^= changeOps.xorAttrMask;
-                attr.SetCharacterAttributes(characterAttributes);
-                if (changeOps.foreground)
-                {
-                    attr.SetForeground(*changeOps.foreground);
-                }
-                if (changeOps.background)
-                {
-                    attr.SetBackground(*changeOps.background);
-                }
-                if (changeOps.underlineColor)
-                {
-                    attr.SetUnderlineColor(*changeOps.underlineColor);
-                }
-                rowBuffer.ReplaceAttributes(col, col + 1, attr);
+                attr.SetForeground(*changeOps.foreground);
             }
-        }
-        page.Buffer().TriggerRedraw(Viewport::FromExclusive(changeRect));
+            if (changeOps.background)
+            {
+                attr.SetBackground(*changeOps.background);
+            }
+            if (changeOps.underlineColor)
+            {
+                attr.SetUnderlineColor(*changeOps.underlineColor);
+            }
+            return attr;
+        });
         _api.NotifyAccessibilityChange(changeRect);
     }
 }
@@ -1188,30 +1184,8 @@ void AdaptDispatch::CopyRectangularArea(const VTInt top, const VTInt left, const
     {
         // If the source is bigger than the available space at the destination
         // it needs to be clipped, so we only care about the destination size.
-        const auto srcView = Viewport::FromDimensions(srcRect.origin(), dstRect.size());
-        const auto dstView = Viewport::FromDimensions(dstRect.origin(), dstRect.size());
-        const auto walkDirection = Viewport::DetermineWalkDirection(srcView, dstView);
-        auto srcPos = srcView.GetWalkOrigin(walkDirection);
-        auto dstPos = dstView.GetWalkOrigin(walkDirection);
-        // Note that we read two cells from the source before we start writing
-        // to the target, so a two-cell DBCS character can't accidentally delete
-        // itself when moving one cell horizontally.
-        auto next = OutputCell(*src.Buffer().GetCellDataAt(srcPos));
-        do
-        {
-            const auto current = next;
-            const auto currentSrcPos = srcPos;
-            srcView.WalkInBounds(srcPos, walkDirection);
-            next = OutputCell(*src.Buffer().GetCellDataAt(srcPos));
-            // If the source position is offscreen (which can occur on double
-            // width lines), then we shouldn't copy anything to the destination.
-            if (currentSrcPos.x < src.Buffer().GetLineWidth(currentSrcPos.y))
-            {
-                dst.Buffer().WriteLine(OutputCellIterator({ &current, 1 }), dstPos);
-            }
-        } while (dstView.WalkInBounds(dstPos, walkDirection));
-        // Copy any image content in the affected area.
-        ImageSlice::CopyBlock(src.Buffer(), srcView.ToExclusive(), dst.Buffer(), dstView.ToExclusive());
+        const auto copyRect = til::rect{ srcRect.origin(), dstRect.size() };
+        src.Buffer().CopyRect(copyRect, dstRect.origin(), dst.Buffer());
         _api.NotifyAccessibilityChange(dstRect);
     }
 }
@@ -2986,6 +2960,9 @@ void AdaptDispatch::SoftReset()
     {
         _sixelParser->SoftReset();
     }
+
+    // Release any page buffers that are no longer needed.
+    _pages.Trim();
 }
 
 //Routine Description:
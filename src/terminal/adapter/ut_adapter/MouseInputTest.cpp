@@ -601,4 +601,73 @@ public:
         mouseInput.SetInputMode(TerminalInput::Mode::AlternateScroll, true);
         VERIFY_ARE_EQUAL(TerminalInput::MakeUnhandled(), mouseInput.HandleMouse({ 0, 0 }, WM_MOUSEWHEEL, noModifierKeys, WHEEL_DELTA, {}));
     }
+
+    TEST_METHOD(CoalesceMouseMotionTests)
+    {
+        Log::Comment(L"Starting test...");
+        TerminalInput mouseInput;
+        const short noModifierKeys = 0;
+
+        mouseInput.SetInputMode(TerminalInput::Mode::SgrMouseEncoding, true);
+        mouseInput.SetInputMode(TerminalInput::Mode::AnyEventMouseTracking, true);
+
+        Log::Comment(L"Motion within the same cell is only reported once");
+        VERIFY_ARE_EQUAL(TerminalInput::MakeOutput(L"\x1b[<35;2;2M"), mouseInput.HandleMouse({ 1, 1 }, WM_MOUSEMOVE, noModifierKeys, 0, {}));
+        VERIFY_ARE_EQUAL(TerminalInput::MakeUnhandled(), mouseInput.HandleMouse({ 1, 1 }, WM_MOUSEMOVE, noModifierKeys, 0, {}));
+        VERIFY_ARE_EQUAL(TerminalInput::MakeUnhandled(), mouseInput.HandleMouse({ 1, 1 }, WM_MOUSEMOVE, noModifierKeys, 0, {}));
+        VERIFY_ARE_EQUAL(TerminalInput::MakeOutput(L"\x1b[<35;3;2M"), mouseInput.HandleMouse({ 2, 1 }, WM_MOUSEMOVE, noModifierKeys, 0, {}));
+
+        const auto stats = mouseInput.GetMouseStatistics();
+        VERIFY_ARE_EQUAL(uint64_t{ 4 }, stats.eventsReceived);
+        VERIFY_ARE_EQUAL(uint64_t{ 2 }, stats.reportsEmitted);
+
+        mouseInput.ResetMouseStatistics();
+        VERIFY_ARE_EQUAL(uint64_t{ 0 }, mouseInput.GetMouseStatistics().eventsReceived);
+
+        Log::Comment(L"Events are only counted while they're being tracked");
+        mouseInput.SetInputMode(TerminalInput::Mode::AnyEventMouseTracking, false);
+        VERIFY_ARE_EQUAL(TerminalInput::MakeUnhandled(), mouseInput.HandleMouse({ 3, 1 }, WM_MOUSEMOVE, noModifierKeys, 0, {}));
+        VERIFY_ARE_EQUAL(uint64_t{ 0 }, mouseInput.GetMouseStatistics().eventsReceived);
+    }
+
+    TEST_METHOD(RateLimitedMouseMotionTests)
+    {
+        Log::Comment(L"Starting test...");
+        TerminalInput mouseInput;
+        const short noModifierKeys = 0;
+        const TerminalInput::MouseButtonState leftButtonDown{ true, false, false };
+
+        mouseInput.SetInputMode(TerminalInput::Mode::SgrMouseEncoding, true);
+        mouseInput.SetInputMode(TerminalInput::Mode::AnyEventMouseTracking, true);
+        // A single report per second is slow enough that none of the
+        // events below will pass the rate limit after the first one.
+        mouseInput.SetMouseMotionRateLimit(1);
+
+        Log::Comment(L"The first motion is reported immediately, later ones are held back");
+        VERIFY_ARE_EQUAL(TerminalInput::MakeOutput(L"\x1b[<35;1;1M"), mouseInput.HandleMouse({ 0, 0 }, WM_MOUSEMOVE, noModifierKeys, 0, {}));
+        VERIFY_ARE_EQUAL(TerminalInput::MakeOutput(L""), mouseInput.HandleMouse({ 1, 0 }, WM_MOUSEMOVE, noModifierKeys, 0, {}));
+        VERIFY_ARE_EQUAL(TerminalInput::MakeOutput(L""), mouseInput.HandleMouse({ 2, 0 }, WM_MOUSEMOVE, noModifierKeys, 0, {}));
+        VERIFY_ARE_EQUAL(TerminalInput::MakeOutput(L""), mouseInput.HandleMouse({ 3, 0 }, WM_MOUSEMOVE, noModifierKeys, 0, {}));
+
+        Log::Comment(L"A button press is preceded by the latest pending motion");
+        VERIFY_ARE_EQUAL(TerminalInput::MakeOutput(L"\x1b[<35;4;1M\x1b[<0;4;1M"), mouseInput.HandleMouse({ 3, 0 }, WM_LBUTTONDOWN, noModifierKeys, 0, leftButtonDown));
+
+        Log::Comment(L"Pending motion can be flushed explicitly, once it's due");
+        VERIFY_IS_FALSE(mouseInput.GetPendingMouseMotionDelay().has_value());
+        VERIFY_ARE_EQUAL(TerminalInput::MakeOutput(L""), mouseInput.HandleMouse({ 4, 0 }, WM_MOUSEMOVE, noModifierKeys, 0, leftButtonDown));
+        const auto delay = mouseInput.GetPendingMouseMotionDelay();
+        VERIFY_IS_TRUE(delay.has_value());
+        VERIFY_IS_LESS_THAN_OR_EQUAL(*delay, uint64_t{ 1000 });
+        VERIFY_ARE_EQUAL(TerminalInput::MakeOutput(L"\x1b[<32;5;1M"), mouseInput.FlushMouseMotion());
+        VERIFY_ARE_EQUAL(TerminalInput::MakeUnhandled(), mouseInput.FlushMouseMotion());
+        VERIFY_IS_FALSE(mouseInput.GetPendingMouseMotionDelay().has_value());
+
+        const auto stats = mouseInput.GetMouseStatistics();
+        VERIFY_ARE_EQUAL(uint64_t{ 6 }, stats.eventsReceived);
+        VERIFY_ARE_EQUAL(uint64_t{ 4 }, stats.reportsEmitted);
+
+        Log::Comment(L"Removing the limit reports every cell change again");
+        mouseInput.SetMouseMotionRateLimit(0);
+        VERIFY_ARE_EQUAL(TerminalInput::MakeOutput(L"\x1b[<32;6;1M"), mouseInput.HandleMouse({ 5, 0 }, WM_MOUSEMOVE, noModifierKeys, 0, leftButtonDown));
+    }
 };
@@ -3983,6 +3983,54 @@ public:
         _pDispatch->PagePositionAbsolute(1);
     }
 
+    TEST_METHOD(PageMemoryTests)
+    {
+        _testGetSet->PrepData();
+        auto& pages = _pDispatch->_pages;
+        const auto logMemory = [&](const wchar_t* when) {
+            Log::Comment(NoThrowString().Format(L"Committed page memory %s: %zu KiB", when, pages.GetCommittedMemory() / 1024));
+        };
+
+        Log::Comment(L"Probing for paging support leaves the pages idle");
+        for (auto page = 1; page <= 6; page++)
+        {
+            _pDispatch->PagePositionAbsolute(page);
+        }
+        _pDispatch->PagePositionAbsolute(1);
+        logMemory(L"after PPA to every page");
+        VERIFY_ARE_EQUAL(size_t{ 0 }, pages.GetCommittedMemory());
+
+        Log::Comment(L"Pages commit memory once they're written to");
+        _pDispatch->PagePositionAbsolute(3);
+        _pDispatch->PrintString(L"Page 3");
+        _pDispatch->PagePositionAbsolute(1);
+        logMemory(L"after writing to page 3");
+        const auto writtenMemory = pages.GetCommittedMemory();
+        VERIFY_IS_GREATER_THAN(writtenMemory, size_t{ 0 });
+
+        Log::Comment(L"Making a blank page visible doesn't commit memory");
+        auto& mainBuffer = *_testGetSet->_textBuffer;
+        const auto markRow = _testGetSet->_viewport.top;
+        mainBuffer.SetScrollbarData({ MarkCategory::Prompt }, markRow);
+        _pDispatch->SetMode(DispatchTypes::ModeParams::DECPCCM_PageCursorCouplingMode);
+        _pDispatch->PagePositionAbsolute(2);
+        VERIFY_IS_TRUE(mainBuffer.GetRowByOffset(markRow).GetScrollbarData().has_value(), L"The shell integration marks are kept");
+        _pDispatch->PagePositionAbsolute(1);
+        _pDispatch->ResetMode(DispatchTypes::ModeParams::DECPCCM_PageCursorCouplingMode);
+        logMemory(L"after making page 2 visible");
+        VERIFY_ARE_EQUAL(writtenMemory, pages.GetCommittedMemory());
+        VERIFY_IS_TRUE(mainBuffer.GetRowByOffset(markRow).GetScrollbarData().has_value());
+
+        Log::Comment(L"DECSTR releases pages that are blank again");
+        _pDispatch->PagePositionAbsolute(3);
+        _pDispatch->SetGraphicsRendition({});
+        _pDispatch->EraseInLine(DispatchTypes::EraseType::All);
+        _pDispatch->PagePositionAbsolute(1);
+        _pDispatch->SoftReset();
+        logMemory(L"after erasing page 3 and DECSTR");
+        VERIFY_ARE_EQUAL(size_t{ 0 }, pages.GetCommittedMemory());
+    }
+
     TEST_METHOD(SendC1ControlTest)
     {
         const auto S7C1T = L"\033 F";
@@ -37,6 +37,7 @@ public:
     TEST_METHOD(BackarrowKeyModeTest);
     TEST_METHOD(AutoRepeatModeTest);
     TEST_METHOD(SendC1ControlTest);
+    TEST_METHOD(KeyEncodingPerformance);
 
     wchar_t GetModifierChar(const bool fShift, const bool fAlt, const bool fCtrl)
     {
@@ -808,3 +809,68 @@ void InputTest::SendC1ControlTest()
     TestKey(TerminalInput::MakeOutput(L"\x1b[H"), input, 0, VK_HOME);
     TestKey(TerminalInput::MakeOutput(L"\x1bOP"), input, 0, VK_F1);
 }
+
+void InputTest::KeyEncodingPerformance()
+{
+    struct Key
+    {
+        WORD vkey;
+        wchar_t ch;
+        DWORD state;
+    };
+    // A mix of keys that are looked up in the key map and ones that produce characters.
+    static constexpr std::array keys{
+        Key{ VK_UP, 0, 0 },
+        Key{ VK_DOWN, 0, LEFT_CTRL_PRESSED },
+        Key{ VK_LEFT, 0, SHIFT_PRESSED },
+        Key{ VK_RIGHT, 0, LEFT_ALT_PRESSED },
+        Key{ VK_F5, 0, 0 },
+        Key{ VK_DELETE, 0, LEFT_CTRL_PRESSED },
+        Key{ VK_RETURN, L'\r', 0 },
+        Key{ VK_BACK, L'\b', 0 },
+        Key{ 'A', L'a', 0 },
+        Key{ 'B', L'B', SHIFT_PRESSED },
+        Key{ 'C', L'\x03', LEFT_CTRL_PRESSED },
+        Key{ 'D', L'd', LEFT_ALT_PRESSED },
+    };
+
+    const auto measure = [](const wchar_t* name, TerminalInput& input) {
+        static constexpr size_t iterations = 100000;
+        INPUT_RECORD event{};
+        event.EventType = KEY_EVENT;
+        event.Event.KeyEvent.bKeyDown = TRUE;
+        event.Event.KeyEvent.wRepeatCount = 1;
+        size_t outputLength = 0;
+
+        const auto beg = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; i++)
+        {
+            const auto& key = til::at(keys, i % keys.size());
+            event.Event.KeyEvent.wVirtualKeyCode = key.vkey;
+            event.Event.KeyEvent.uChar.UnicodeChar = key.ch;
+            event.Event.KeyEvent.dwControlKeyState = key.state;
+            const auto output = input.HandleKey(event);
+            outputLength += output ? output->size() : 0;
+        }
+        const auto end = std::chrono::steady_clock::now();
+
+        const auto ns = std::chrono::duration<double, std::nano>(end - beg).count() / iterations;
+        Log::Comment(NoThrowString().Format(L"%s: %.1f ns/key (%zu characters)", name, ns, outputLength));
+        VERIFY_ARE_NOT_EQUAL(size_t{ 0 }, outputLength);
+    };
+
+    TerminalInput normal;
+    measure(L"Normal mode", normal);
+
+    TerminalInput cursorKeys;
+    cursorKeys.SetInputMode(TerminalInput::Mode::CursorKey, true);
+    measure(L"Application cursor keys", cursorKeys);
+
+    TerminalInput vt52;
+    vt52.SetInputMode(TerminalInput::Mode::Ansi, false);
+    measure(L"VT52 mode", vt52);
+
+    TerminalInput win32;
+    win32.SetInputMode(TerminalInput::Mode::Win32, true);
+    measure(L"win32-input-mode", win32);
+}
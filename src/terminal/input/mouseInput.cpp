@@ -290,6 +290,13 @@ bool TerminalInput::IsTrackingMouseInput() const noexcept
 // - Returns a string if we successfully translated it into a VT input sequence.
 TerminalInput::OutputType TerminalInput::HandleMouse(const til::point position, const unsigned int button, const short modifierKeyState, const short delta, const MouseButtonState state)
 {
+    // Only events that the application asked for are counted, so that the
+    // statistics tell how many of them were coalesced.
+    if (IsTrackingMouseInput())
+    {
+        _mouseStatistics.eventsReceived++;
+    }
+
     if (Utils::Sign(delta) != Utils::Sign(_mouseInputState.accumulatedDelta))
     {
         // This works for wheel and non-wheel events and transitioning between wheel/non-wheel.
@@ -357,22 +364,37 @@ TerminalInput::OutputType TerminalInput::HandleMouse(const til::point position,
                 _mouseInputState.lastButton = button;
             }
 
-            if (_inputMode.test(Mode::Utf8MouseEncoding))
-            {
-                return _GenerateUtf8Sequence(position, realButton, isHover, modifierKeyState, delta);
-            }
-            else if (_inputMode.test(Mode::SgrMouseEncoding))
+            if (isHover && _mouseMotionInterval)
             {
-                // For SGR encoding, if no physical buttons were pressed,
-                // then we want to handle hovers with WM_MOUSEMOVE.
-                // However, if we're dragging (WM_MOUSEMOVE with a button pressed),
-                //      then use that pressed button instead.
-                return _GenerateSGRSequence(position, physicalButtonPressed ? realButton : button, _isButtonUp(button), isHover, modifierKeyState, delta);
+                const auto now = GetTickCount64();
+                if (now - _mouseInputState.lastMotionTime < _mouseMotionInterval)
+                {
+                    // We've sent a motion report too recently. Hold on to this one instead,
+                    // replacing any older pending motion, as only the latest position matters.
+                    _mouseInputState.pendingMotion = MouseMotion{ position, modifierKeyState, state };
+                    return MakeOutput({});
+                }
+                _mouseInputState.lastMotionTime = now;
+                _mouseInputState.pendingMotion.reset();
             }
-            else
+
+            auto out = _GenerateMouseReport(position, button, modifierKeyState, delta, state);
+
+            // A button or wheel event must never overtake a motion we've held back,
+            // or the application would see the click at the wrong position.
+            if (auto pending = _takePendingMouseMotion(); !pending.empty())
             {
-                return _GenerateDefaultSequence(position, realButton, isHover, modifierKeyState, delta);
+                pending.append(out.value_or(StringType{}));
+                out = std::move(pending);
             }
+            return out;
+        }
+
+        if (isHover && _mouseInputState.pendingMotion && GetTickCount64() - _mouseInputState.lastMotionTime >= _mouseMotionInterval)
+        {
+            // The mouse came to rest in the cell of the pending motion. Now that we
+            // aren't rate limited anymore, we can finally report where it ended up.
+            return FlushMouseMotion();
         }
     }
 
@@ -384,6 +406,139 @@ TerminalInput::OutputType TerminalInput::HandleMouse(const til::point position,
     return {};
 }
 
+// Routine Description:
+// - Limits how often mouse motion gets reported while mouse tracking is enabled.
+//     High resolution mice can generate thousands of motion events per second. With a limit
+//     in place, motion events that arrive too soon after the previous report are coalesced
+//     and only the most recent one is reported. Button and wheel events are never delayed.
+// Parameters:
+// - reportsPerSecond - the maximum number of motion reports per second, or 0 for no limit.
+// Return value:
+// - <none>
+void TerminalInput::SetMouseMotionRateLimit(const unsigned int reportsPerSecond) noexcept
+{
+    // Rates above 1000 reports per second still need to be limited, but can't be
+    // any finer than our clock. 0 would disable the limit, so it's clamped to 1ms.
+    _mouseMotionInterval = reportsPerSecond ? std::max<uint64_t>(1, 1000 / reportsPerSecond) : 0;
+    _mouseInputState.pendingMotion.reset();
+}
+
+// Routine Description:
+// - Returns how long the caller should wait before calling FlushMouseMotion, which
+//     ensures that the application learns about the final position of the mouse.
+// Parameters:
+// - <none>
+// Return value:
+// - The delay in milliseconds, or an empty optional if no motion is pending.
+std::optional<uint64_t> TerminalInput::GetPendingMouseMotionDelay() const noexcept
+{
+    if (!_mouseInputState.pendingMotion)
+    {
+        return std::nullopt;
+    }
+
+    const auto elapsed = GetTickCount64() - _mouseInputState.lastMotionTime;
+    return elapsed < _mouseMotionInterval ? _mouseMotionInterval - elapsed : 0;
+}
+
+// Routine Description:
+// - Generates the report for a mouse motion that was held back by the rate limit.
+//     Callers that use SetMouseMotionRateLimit should call this once the mouse has come
+//     to rest, so that the application learns about the final position of the mouse.
+// Parameters:
+// - <none>
+// Return value:
+// - Returns an empty optional if no motion was pending.
+// - Returns a string with the VT sequence of the pending motion otherwise.
+TerminalInput::OutputType TerminalInput::FlushMouseMotion()
+{
+    if (!_mouseInputState.pendingMotion)
+    {
+        return {};
+    }
+
+    _mouseInputState.lastMotionTime = GetTickCount64();
+    if (auto out = _takePendingMouseMotion(); !out.empty())
+    {
+        return out;
+    }
+    return {};
+}
+
+// Routine Description:
+// - Returns the number of mouse events we received and the number of reports
+//     we sent in response. The difference between the two is the number of events
+//     that were coalesced or not reported for other reasons.
+TerminalInput::MouseStatistics TerminalInput::GetMouseStatistics() const noexcept
+{
+    return _mouseStatistics;
+}
+
+// Routine Description:
+// - Resets the counters returned by GetMouseStatistics.
+void TerminalInput::ResetMouseStatistics() noexcept
+{
+    _mouseStatistics = {};
+}
+
+// Routine Description:
+// - Encodes the given mouse event according to the current mouse encoding mode.
+// Parameters:
+// - position - The windows coordinates (top,left = 0,0) of the mouse event
+// - button - the message to decode.
+// - modifierKeyState - the modifier keys pressed with this button
+// - delta - the amount that the scroll wheel changed (should be 0 unless button is a WM_MOUSE*WHEEL)
+// - state - the state of the mouse buttons at this moment
+// Return value:
+// - The generated sequence. Will be empty if we couldn't generate.
+TerminalInput::OutputType TerminalInput::_GenerateMouseReport(const til::point position, const unsigned int button, const short modifierKeyState, const short delta, const MouseButtonState state)
+{
+    const auto isHover = _isHoverMsg(button);
+    const auto realButton = isHover ? s_GetPressedButton(state) : button;
+    const auto physicalButtonPressed = realButton != WM_LBUTTONUP;
+
+    OutputType out;
+    if (_inputMode.test(Mode::Utf8MouseEncoding))
+    {
+        out = _GenerateUtf8Sequence(position, realButton, isHover, modifierKeyState, delta);
+    }
+    else if (_inputMode.test(Mode::SgrMouseEncoding))
+    {
+        // For SGR encoding, if no physical buttons were pressed,
+        // then we want to handle hovers with WM_MOUSEMOVE.
+        // However, if we're dragging (WM_MOUSEMOVE with a button pressed),
+        //      then use that pressed button instead.
+        out = _GenerateSGRSequence(position, physicalButtonPressed ? realButton : button, _isButtonUp(button), isHover, modifierKeyState, delta);
+    }
+    else
+    {
+        out = _GenerateDefaultSequence(position, realButton, isHover, modifierKeyState, delta);
+    }
+
+    if (out && !out->empty())
+    {
+        _mouseStatistics.reportsEmitted++;
+    }
+    return out;
+}
+
+// Routine Description:
+// - Generates the report for the pending mouse motion, if any, and clears it.
+// Return value:
+// - The generated sequence. Will be empty if no motion was pending.
+TerminalInput::StringType TerminalInput::_takePendingMouseMotion()
+{
+    StringType out;
+    if (const auto pending = std::exchange(_mouseInputState.pendingMotion, std::nullopt); pending && IsTrackingMouseInput())
+    {
+        if (auto report = _GenerateMouseReport(pending->position, WM_MOUSEMOVE, pending->modifierKeyState, 0, pending->state))
+        {
+            out = std::move(*report);
+        }
+    }
+    return out;
+}
+
 // Routine Description:
 // - Generates a sequence encoding the mouse event according to the default scheme.
 //     see http://invisible-island.net/xterm/ctlseqs/ctlseqs.html#h2-Mouse-Tracking
@@ -497,10 +652,10 @@ TerminalInput::OutputType TerminalInput::_makeAlternateScrollOutput(const short
 {
     if (delta > 0)
     {
-        return MakeOutput(_keyMap.at(VK_UP));
+        return MakeOutput(_getKeySequence(VK_UP));
     }
     else
     {
-        return MakeOutput(_keyMap.at(VK_DOWN));
+        return MakeOutput(_getKeySequence(VK_DOWN));
     }
 }
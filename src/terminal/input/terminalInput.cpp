@@ -49,12 +49,14 @@ void TerminalInput::SetInputMode(const Mode mode, const bool enabled) noexcept
         _inputMode.reset(Mode::Utf8MouseEncoding, Mode::SgrMouseEncoding);
     }
 
+    const auto changed = _inputMode.test(mode) != enabled;
     _inputMode.set(mode, enabled);
 
     // If we've changed one of the modes that alter the VT input sequences,
-    // we'll need to regenerate our keyboard map.
+    // we'll need to regenerate our keyboard map. Applications tend to set
+    // these modes repeatedly (e.g. with every prompt), so we skip no-ops.
     static constexpr auto keyMapModes = til::enumset<Mode>{ Mode::LineFeed, Mode::Ansi, Mode::Keypad, Mode::CursorKey, Mode::BackarrowKey, Mode::SendC1 };
-    if (keyMapModes.test(mode))
+    if (changed && keyMapModes.test(mode))
     {
         _initKeyboardMap();
     }
@@ -70,6 +72,7 @@ void TerminalInput::ResetInputModes() noexcept
     _inputMode = { Mode::Ansi, Mode::AutoRepeat, Mode::AlternateScroll };
     _mouseInputState.lastPos = { -1, -1 };
     _mouseInputState.lastButton = 0;
+    _mouseInputState.pendingMotion.reset();
     _initKeyboardMap();
 }
 
@@ -224,10 +227,9 @@ TerminalInput::OutputType TerminalInput::HandleKey(const INPUT_RECORD& event)
     WI_SetFlagIf(keyCombo, Alt, altIsPressed);
     WI_SetFlagIf(keyCombo, Shift, shiftIsPressed);
     WI_SetFlagIf(keyCombo, Enhanced, enhancedReturnKey);
-    const auto keyMatch = _keyMap.find(keyCombo);
-    if (keyMatch != _keyMap.end())
+    if (const auto index = til::at(_keyMap, keyCombo))
     {
-        return keyMatch->second;
+        return til::at(_keySequences, index);
     }
 
     // If it's not in the key map, we'll use the UnicodeChar, if provided,
@@ -327,31 +329,37 @@ TerminalInput::OutputType TerminalInput::HandleFocus(const bool focused) const
 void TerminalInput::_initKeyboardMap() noexcept
 try
 {
-    auto defineKeyWithUnusedModifiers = [this](const int keyCode, const std::wstring& sequence) {
+    auto defineKey = [this](const int keyCombo, std::wstring sequence) {
+        _keySequences.emplace_back(std::move(sequence));
+        _keyMap.at(keyCombo) = gsl::narrow_cast<uint16_t>(_keySequences.size() - 1);
+    };
+    auto defineKeyWithUnusedModifiers = [&](const int keyCode, const std::wstring& sequence) {
         for (auto m = 0; m < 8; m++)
-            _keyMap[VTModifier(m) + keyCode] = sequence;
+            defineKey(VTModifier(m) + keyCode, sequence);
     };
-    auto defineKeyWithAltModifier = [this](const int keyCode, const std::wstring& sequence) {
-        _keyMap[keyCode] = sequence;
-        _keyMap[Alt + keyCode] = L"\x1B" + sequence;
+    auto defineKeyWithAltModifier = [&](const int keyCode, const std::wstring& sequence) {
+        defineKey(keyCode, sequence);
+        defineKey(Alt + keyCode, L"\x1B" + sequence);
     };
-    auto defineKeypadKey = [this](const int keyCode, const wchar_t* prefix, const wchar_t finalChar) {
-        _keyMap[keyCode] = fmt::format(FMT_COMPILE(L"{}{}"), prefix, finalChar);
+    auto defineKeypadKey = [&](const int keyCode, const wchar_t* prefix, const wchar_t finalChar) {
+        defineKey(keyCode, fmt::format(FMT_COMPILE(L"{}{}"), prefix, finalChar));
         for (auto m = 1; m < 8; m++)
-            _keyMap[VTModifier(m) + keyCode] = fmt::format(FMT_COMPILE(L"{}1;{}{}"), _csi, m + 1, finalChar);
+            defineKey(VTModifier(m) + keyCode, fmt::format(FMT_COMPILE(L"{}1;{}{}"), _csi, m + 1, finalChar));
     };
-    auto defineEditingKey = [this](const int keyCode, const int parm) {
-        _keyMap[keyCode] = fmt::format(FMT_COMPILE(L"{}{}~"), _csi, parm);
+    auto defineEditingKey = [&](const int keyCode, const int parm) {
+        defineKey(keyCode, fmt::format(FMT_COMPILE(L"{}{}~"), _csi, parm));
         for (auto m = 1; m < 8; m++)
-            _keyMap[VTModifier(m) + keyCode] = fmt::format(FMT_COMPILE(L"{}{};{}~"), _csi, parm, m + 1);
+            defineKey(VTModifier(m) + keyCode, fmt::format(FMT_COMPILE(L"{}{};{}~"), _csi, parm, m + 1));
     };
-    auto defineNumericKey = [this](const int keyCode, const wchar_t finalChar) {
-        _keyMap[keyCode] = fmt::format(FMT_COMPILE(L"{}{}"), _ss3, finalChar);
+    auto defineNumericKey = [&](const int keyCode, const wchar_t finalChar) {
+        defineKey(keyCode, fmt::format(FMT_COMPILE(L"{}{}"), _ss3, finalChar));
         for (auto m = 1; m < 8; m++)
-            _keyMap[VTModifier(m) + keyCode] = fmt::format(FMT_COMPILE(L"{}{}{}"), _ss3, m + 1, finalChar);
+            defineKey(VTModifier(m) + keyCode, fmt::format(FMT_COMPILE(L"{}{}{}"), _ss3, m + 1, finalChar));
     };
 
-    _keyMap.clear();
+    _keyMap.fill(0);
+    _keySequences.clear();
+    _keySequences.emplace_back();
 
     // The CSI and SS3 introducers are C1 control codes, which can either be
     // sent as a single codepoint, or as a two character escape sequence.
@@ -532,6 +540,12 @@ try
 }
 CATCH_LOG()
 
+// Returns the predefined sequence for the given key combination, or an empty string if there's none.
+const TerminalInput::StringType& TerminalInput::_getKeySequence(const int keyCombo) const noexcept
+{
+    return til::at(_keySequences, til::at(_keyMap, keyCombo));
+}
+
 DWORD TerminalInput::_trackControlKeyState(const KEY_EVENT_RECORD& key)
 {
     // First record which key state bits were previously off but are now on.
@@ -18,6 +18,12 @@ namespace Microsoft::Console::VirtualTerminal
             bool isRightButtonDown;
         };
 
+        struct MouseStatistics
+        {
+            uint64_t eventsReceived;
+            uint64_t reportsEmitted;
+        };
+
         [[nodiscard]] static OutputType MakeUnhandled() noexcept;
         [[nodiscard]] static OutputType MakeOutput(const std::wstring_view& str);
         [[nodiscard]] OutputType HandleKey(const INPUT_RECORD& pInEvent);
@@ -58,6 +64,11 @@ namespace Microsoft::Console::VirtualTerminal
 
         bool IsTrackingMouseInput() const noexcept;
         bool ShouldSendAlternateScroll(const unsigned int button, const short delta) const noexcept;
+        void SetMouseMotionRateLimit(const unsigned int reportsPerSecond) noexcept;
+        std::optional<uint64_t> GetPendingMouseMotionDelay() const noexcept;
+        [[nodiscard]] OutputType FlushMouseMotion();
+        MouseStatistics GetMouseStatistics() const noexcept;
+        void ResetMouseStatistics() noexcept;
 #pragma endregion
 
 #pragma region MouseInputState Management
@@ -74,7 +85,12 @@ namespace Microsoft::Console::VirtualTerminal
         DWORD _lastControlKeyState = 0;
         uint64_t _lastLeftCtrlTime = 0;
         uint64_t _lastRightAltTime = 0;
-        std::unordered_map<int, std::wstring> _keyMap;
+        // Maps key combinations (a virtual key code plus modifier flags) to an index into _keySequences,
+        // where index 0 is the empty string, used for combinations without a predefined sequence.
+        // Both are rebuilt by _initKeyboardMap() when one of the modes that affect the sequences
+        // changes, so that HandleKey() only needs to do two array lookups instead of hashing.
+        std::array<uint16_t, 4096> _keyMap{};
+        std::vector<StringType> _keySequences;
         std::wstring _focusInSequence;
         std::wstring _focusOutSequence;
 
@@ -85,6 +101,7 @@ namespace Microsoft::Console::VirtualTerminal
         const wchar_t* _ss3 = L"\x1BO";
 
         void _initKeyboardMap() noexcept;
+        const StringType& _getKeySequence(const int keyCombo) const noexcept;
         DWORD _trackControlKeyState(const KEY_EVENT_RECORD& key);
         std::array<byte, 256> _getKeyboardState(const WORD virtualKeyCode, const DWORD controlKeyState) const;
         [[nodiscard]] static wchar_t _makeCtrlChar(const wchar_t ch);
@@ -95,18 +112,32 @@ namespace Microsoft::Console::VirtualTerminal
 
 #pragma region MouseInputState Management
         // These methods are defined in mouseInputState.cpp
+        struct MouseMotion
+        {
+            til::point position;
+            short modifierKeyState;
+            MouseButtonState state;
+        };
+
         struct MouseInputState
         {
             bool inAlternateBuffer{ false };
             til::point lastPos{ -1, -1 };
             unsigned int lastButton{ 0 };
             int accumulatedDelta{ 0 };
+            uint64_t lastMotionTime{ 0 };
+            std::optional<MouseMotion> pendingMotion;
         };
 
         MouseInputState _mouseInputState;
+        MouseStatistics _mouseStatistics{};
+        // The minimum time in milliseconds between two motion reports, or 0 if motion isn't rate limited.
+        uint64_t _mouseMotionInterval{ 0 };
 #pragma endregion
 
 #pragma region MouseInput
+        [[nodiscard]] OutputType _GenerateMouseReport(til::point position, unsigned int button, short modifierKeyState, short delta, MouseButtonState state);
+        [[nodiscard]] StringType _takePendingMouseMotion();
         [[nodiscard]] OutputType _GenerateDefaultSequence(til::point position, unsigned int button, bool isHover, short modifierKeyState, short delta);
         [[nodiscard]] OutputType _GenerateUtf8Sequence(til::point position, unsigned int button, bool isHover, short modifierKeyState, short delta);
         [[nodiscard]] OutputType _GenerateSGRSequence(til::point position, unsigned int button, bool isRelease, bool isHover, short modifierKeyState, short delta);
@@ -0,0 +1,135 @@
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT license.
+
+#include "precomp.h"
+
+#include <til/flat_hash_map.h>
+
+using namespace std::string_view_literals;
+using namespace WEX::Common;
+using namespace WEX::Logging;
+using namespace WEX::TestExecution;
+
+class FlatHashMapTests
+{
+    TEST_CLASS(FlatHashMapTests);
+
+    TEST_METHOD(Basic)
+    {
+        til::flat_hash_map<std::wstring, int> map;
+        VERIFY_IS_TRUE(map.empty());
+        VERIFY_IS_TRUE(map.find(L"foo") == map.end());
+
+        const auto [it1, inserted1] = map.emplace(L"foo", 1);
+        VERIFY_IS_TRUE(inserted1);
+        const auto [it2, inserted2] = map.emplace(L"foo", 2);
+        VERIFY_IS_FALSE(inserted2);
+        VERIFY_IS_TRUE(it1 == it2);
+        VERIFY_ARE_EQUAL(1, it2->second);
+
+        map[L"bar"] = 3;
+        map.insert_or_assign(L"foo", 4);
+        VERIFY_ARE_EQUAL(2u, map.size());
+        VERIFY_ARE_EQUAL(4, map.at(L"foo"));
+        VERIFY_ARE_EQUAL(3, map.at(L"bar"));
+        VERIFY_THROWS(map.at(L"baz"), std::out_of_range);
+
+        VERIFY_ARE_EQUAL(1u, map.erase(L"foo"));
+        VERIFY_ARE_EQUAL(0u, map.erase(L"foo"));
+        VERIFY_IS_FALSE(map.contains(L"foo"));
+        VERIFY_IS_TRUE(map.contains(L"bar"));
+    }
+
+    TEST_METHOD(HeterogeneousLookup)
+    {
+        til::flat_hash_map<std::wstring, int> map;
+        map.try_emplace(L"hello"sv, 1);
+
+        const std::wstring key{ L"hello world" };
+        VERIFY_IS_TRUE(map.contains(std::wstring_view{ key }.substr(0, 5)));
+        VERIFY_IS_TRUE(map.contains(L"hello"));
+        VERIFY_IS_TRUE(map.contains(std::wstring{ L"hello" }));
+
+        // Integer keys are converted to the key type before hashing.
+        til::flat_hash_map<uint16_t, std::wstring> ids;
+        ids[uint16_t{ 42 }] = L"foo";
+        VERIFY_IS_TRUE(ids.contains(42));
+        VERIFY_ARE_EQUAL(L"foo"sv, ids.at(42));
+    }
+
+    TEST_METHOD(GrowAndErase)
+    {
+        til::flat_hash_map<size_t, size_t> map;
+
+        for (size_t i = 0; i < 10000; ++i)
+        {
+            map.emplace(i, i * 2);
+        }
+        VERIFY_ARE_EQUAL(10000u, map.size());
+
+        // Erase every other item. This leaves tombstones behind,
+        // which must be skipped by lookups and reused by insertions.
+        VERIFY_ARE_EQUAL(5000u, map.erase_if([](const auto& item) { return item.first % 2 != 0; }));
+        VERIFY_ARE_EQUAL(5000u, map.size());
+
+        const auto capacity = map.capacity();
+        for (size_t round = 0; round < 10; ++round)
+        {
+            for (size_t i = 1; i < 10000; i += 2)
+            {
+                map.emplace(i, i * 2);
+            }
+            for (size_t i = 1; i < 10000; i += 2)
+            {
+                map.erase(i);
+            }
+        }
+        VERIFY_ARE_EQUAL(capacity, map.capacity());
+
+        size_t count = 0;
+        for (const auto& [key, value] : map)
+        {
+            VERIFY_ARE_EQUAL(0u, key % 2);
+            VERIFY_ARE_EQUAL(key * 2, value);
+            ++count;
+        }
+        VERIFY_ARE_EQUAL(5000u, count);
+    }
+
+    TEST_METHOD(CopyAndMove)
+    {
+        til::flat_hash_map<std::wstring, std::wstring> map;
+        for (auto i = 0; i < 100; ++i)
+        {
+            map.emplace(std::to_wstring(i), std::to_wstring(i * i));
+        }
+
+        auto copy = map;
+        VERIFY_ARE_EQUAL(map.size(), copy.size());
+        for (const auto& [key, value] : map)
+        {
+            VERIFY_ARE_EQUAL(value, copy.at(key));
+        }
+
+        const auto moved = std::move(copy);
+        VERIFY_ARE_EQUAL(map.size(), moved.size());
+        VERIFY_IS_TRUE(copy.empty());
+
+        map.clear();
+        VERIFY_IS_TRUE(map.empty());
+        VERIFY_IS_FALSE(map.contains(L"1"));
+        VERIFY_ARE_EQUAL(L"81"sv, moved.at(L"9"));
+    }
+
+    TEST_METHOD(Set)
+    {
+        til::flat_hash_set<std::wstring> set{ L"foo", L"bar" };
+        VERIFY_ARE_EQUAL(2u, set.size());
+        VERIFY_IS_FALSE(set.insert(L"foo"sv).second);
+        VERIFY_IS_TRUE(set.insert(L"baz"sv).second);
+        VERIFY_IS_TRUE(set.contains(L"baz"));
+        VERIFY_ARE_EQUAL(1u, set.erase(L"bar"));
+        VERIFY_IS_TRUE(set.find(L"bar") == set.end());
+        VERIFY_ARE_EQUAL(2u, set.size());
+    }
+};
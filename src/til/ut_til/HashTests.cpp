@@ -3,6 +3,9 @@
 
 #include "precomp.h"
 
+#include <chrono>
+
+#include <til/flat_hash_map.h>
 #include <til/hash.h>
 
 using namespace WEX::Common;
@@ -43,4 +46,63 @@ class HashTests
 #endif
         }
     }
+
+    template<typename Map, typename Key>
+    static void measureMap(const wchar_t* name, const std::vector<Key>& keys)
+    {
+        const auto measure = [&](auto&& func) {
+            const auto beg = std::chrono::steady_clock::now();
+            func();
+            const auto end = std::chrono::steady_clock::now();
+            return std::chrono::duration<double, std::nano>(end - beg).count() / keys.size();
+        };
+
+        Map map;
+        size_t found = 0;
+
+        const auto insert = measure([&] {
+            for (size_t i = 0; i < keys.size(); ++i)
+            {
+                map.emplace(keys[i], i);
+            }
+        });
+        const auto lookup = measure([&] {
+            for (const auto& key : keys)
+            {
+                found += map.find(key) != map.end();
+            }
+        });
+        const auto erase = measure([&] {
+            for (const auto& key : keys)
+            {
+                map.erase(key);
+            }
+        });
+
+        Log::Comment(NoThrowString().Format(L"%-28s insert %6.1f ns, lookup %6.1f ns, erase %6.1f ns", name, insert, lookup, erase));
+        VERIFY_ARE_EQUAL(keys.size(), found);
+        VERIFY_IS_TRUE(map.empty());
+    }
+
+    TEST_METHOD(MapPerformance)
+    {
+        // URIs as used by TextBuffer's hyperlink map and
+        // short identifiers, as used for command and function names.
+        std::vector<std::wstring> uris;
+        std::vector<std::wstring> names;
+        std::vector<uint32_t> ids;
+        for (uint32_t i = 0; i < 100000; ++i)
+        {
+            uris.emplace_back(fmt::format(FMT_COMPILE(L"https://example.com/path/to/{}"), i * 7919));
+            names.emplace_back(fmt::format(FMT_COMPILE(L"cmd{}"), i));
+            ids.emplace_back(i * 7919);
+        }
+
+        measureMap<std::unordered_map<std::wstring, size_t>>(L"std::unordered_map (URIs)", uris);
+        measureMap<til::flat_hash_map<std::wstring, size_t>>(L"til::flat_hash_map (URIs)", uris);
+        measureMap<std::unordered_map<std::wstring, size_t>>(L"std::unordered_map (names)", names);
+        measureMap<til::flat_hash_map<std::wstring, size_t>>(L"til::flat_hash_map (names)", names);
+        measureMap<std::unordered_map<uint32_t, size_t>>(L"std::unordered_map (ids)", ids);
+        measureMap<til::flat_hash_map<uint32_t, size_t>>(L"til::flat_hash_map (ids)", ids);
+    }
 };
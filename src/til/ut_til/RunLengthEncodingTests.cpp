@@ -3,6 +3,8 @@
 
 #include "precomp.h"
 
+#include <chrono>
+
 #include "til/rle.h"
 #include "consoletaeftemplates.hpp"
 
@@ -429,6 +431,166 @@ class RunLengthEncodingTests
         }
     }
 
+    TEST_METHOD(Transform)
+    {
+        struct TestCase
+        {
+            std::string_view source;
+
+            size_t start_index;
+            size_t end_index;
+            value_type and_mask;
+            value_type xor_mask;
+
+            std::string_view expected;
+        };
+
+        std::array<TestCase, 7> test_cases{
+            {
+                // empty source
+                { "", 0, 0, 0xff, 1, "" },
+                // empty range
+                { "1|2|3", 1, 1, 0xff, 1, "1|2|3" },
+                // entire source
+                { "2 2|3|4 4", 0, 5, 0xff, 1, "3 3|2|5 5" },
+                // partial runs
+                { "4 4 4|5 5", 1, 4, 0xfe, 0, "4 4 4 4|5" },
+                // merge within the range
+                { "2|3|4|5", 0, 4, 0xfe, 0, "2 2|4 4" },
+                // merge with the neighboring runs
+                { "3|2|3", 1, 2, 0xff, 1, "3 3 3" },
+                // end_index past the end
+                { "1|2 2", 1, 9, 0xff, 3, "1 1 1" },
+            }
+        };
+
+        auto idx = 0;
+
+        for (const auto& test_case : test_cases)
+        {
+            rle_vector rle{ rle_encode(test_case.source) };
+            rle.transform(gsl::narrow_cast<value_type>(test_case.start_index), gsl::narrow_cast<value_type>(test_case.end_index), [&](const value_type& value) {
+                return gsl::narrow_cast<value_type>((value & test_case.and_mask) ^ test_case.xor_mask);
+            });
+
+            VERIFY_ARE_EQUAL(
+                test_case.expected,
+                rle,
+                NoThrowString().Format(
+                    L"test case: %d\nsource:    %hs\nrange:     [%zu, %zu)\nexpected:  %hs\nactual:    %s",
+                    idx,
+                    test_case.source.data(),
+                    test_case.start_index,
+                    test_case.end_index,
+                    test_case.expected.data(),
+                    rle.to_string().c_str()));
+            ++idx;
+        }
+    }
+
+    TEST_METHOD(ReplaceRanges)
+    {
+        using edit_type = rle_vector::edit_type;
+
+        struct TestCase
+        {
+            std::string_view source;
+            std::vector<edit_type> edits;
+            std::string_view expected;
+        };
+
+        const std::array<TestCase, 7> test_cases{
+            {
+                // no edits
+                { "1|2|3", {}, "1|2|3" },
+                // empty edits
+                { "1|2|3", { { 0, 0, 4 }, { 2, 2, 4 } }, "1|2|3" },
+                // single edit within a run
+                { "1 1 1 1", { { 1, 3, 2 } }, "1|2 2|1" },
+                // disjoint edits across runs
+                { "1 1 1|2 2 2|3 3 3", { { 0, 1, 4 }, { 2, 4, 5 }, { 7, 8, 6 } }, "4|1|5 5|2 2|3|6|3" },
+                // adjacent edits and merges with the neighboring runs
+                { "1 1|2 2|1 1", { { 2, 3, 1 }, { 3, 4, 1 } }, "1 1 1 1 1 1" },
+                // edits which merge with each other, but not with the source
+                { "1 1 1 1", { { 0, 2, 3 }, { 2, 4, 3 } }, "3 3 3 3" },
+                // end past the end
+                { "1|2 2", { { 1, 9, 3 } }, "1|3 3" },
+            }
+        };
+
+        auto idx = 0;
+
+        for (const auto& test_case : test_cases)
+        {
+            rle_vector rle{ rle_encode(test_case.source) };
+            rle.replace_ranges(test_case.edits);
+
+            VERIFY_ARE_EQUAL(
+                test_case.expected,
+                rle,
+                NoThrowString().Format(
+                    L"test case: %d\nsource:    %hs\nexpected:  %hs\nactual:    %s",
+                    idx,
+                    test_case.source.data(),
+                    test_case.expected.data(),
+                    rle.to_string().c_str()));
+            ++idx;
+        }
+
+        // unsorted and overlapping edits
+        {
+            rle_vector rle{ rle_encode("1 1 1 1"sv) };
+            const std::array<edit_type, 2> unsorted{ { { 2, 3, 2 }, { 0, 1, 2 } } };
+            const std::array<edit_type, 2> overlapping{ { { 0, 2, 2 }, { 1, 3, 2 } } };
+
+            VERIFY_THROWS(rle.replace_ranges(unsorted), std::out_of_range);
+            VERIFY_THROWS(rle.replace_ranges(overlapping), std::out_of_range);
+            VERIFY_ARE_EQUAL("1 1 1 1"sv, rle);
+        }
+    }
+
+    TEST_METHOD(ReplaceInAnyOrder)
+    {
+        // replace() remembers the run it touched last and starts the next lookup from there.
+        // This ensures that lookups before, at and after that run all produce the same results.
+        constexpr std::string_view expected{ "1|2 2|3|1 1|4 4 4|2|5|1" };
+        constexpr std::array<size_type, 8> orders[]{
+            { 0, 1, 2, 3, 4, 5, 6, 7 },
+            { 7, 6, 5, 4, 3, 2, 1, 0 },
+            { 4, 0, 7, 2, 5, 1, 6, 3 },
+        };
+        // The [start, end) and value of each edit.
+        constexpr std::array<std::array<size_type, 3>, 8> edits{ {
+            { 0, 1, 1 },
+            { 1, 3, 2 },
+            { 3, 4, 3 },
+            { 4, 6, 1 },
+            { 6, 9, 4 },
+            { 9, 10, 2 },
+            { 10, 11, 5 },
+            { 11, 12, 1 },
+        } };
+
+        for (const auto& order : orders)
+        {
+            rle_vector rle(12, 0);
+
+            for (const auto i : order)
+            {
+                const auto& edit = edits[i];
+                rle.replace(edit[0], edit[1], edit[2]);
+                VERIFY_ARE_EQUAL(edit[2], rle.at(edit[0]));
+            }
+
+            VERIFY_ARE_EQUAL(expected, rle);
+
+            rle.resize_trailing_extent(5);
+            VERIFY_ARE_EQUAL(expected.substr(0, 9), rle);
+            rle.replace(4, 5, 2);
+            VERIFY_ARE_EQUAL("1 2 2 3 2"sv, rle);
+        }
+    }
+
     TEST_METHOD(ResizeTrailingExtent)
     {
         constexpr std::string_view data{ "133211155" };
@@ -601,4 +763,72 @@ class RunLengthEncodingTests
             VERIFY_ARE_EQUAL(-static_cast<difference_type>(1), lower - upper);
         }
     }
+
+    TEST_METHOD(ColorizedOutputPerformance)
+    {
+        // Simulates the attribute edits of colorized output like `ls --color` or syntax highlighted
+        // source code, which change the SGR for every word. Each row consists of 5 character words
+        // of varying color, each followed by a single default colored space.
+        using row_attributes = til::small_rle<value_type, size_type, 1>;
+        using edit_type = row_attributes::edit_type;
+        static constexpr size_type columns = 240;
+        static constexpr size_type wordLength = 5;
+        static constexpr auto rows = 20000;
+
+        const auto measure = [&](auto&& writeRow) {
+            size_t runs = 0;
+            const auto beg = std::chrono::steady_clock::now();
+            for (auto i = 0; i < rows; ++i)
+            {
+                row_attributes attributes(columns, 0);
+                writeRow(attributes);
+                runs += attributes.runs().size();
+            }
+            const auto end = std::chrono::steady_clock::now();
+            return std::pair{ runs, std::chrono::duration<double, std::nano>(end - beg).count() / rows };
+        };
+
+        std::vector<edit_type> edits;
+        {
+            value_type color = 1;
+            for (size_type column = 0; column + wordLength < columns; column += wordLength + 1)
+            {
+                edits.push_back({ column, gsl::narrow_cast<size_type>(column + wordLength), color });
+                color = color % 7 + 1;
+            }
+        }
+
+        // This is what TextBuffer::Write() does: one ROW::ReplaceAttributes() call per write.
+        const auto writeWords = [&](row_attributes& attributes) {
+            for (const auto& edit : edits)
+            {
+                attributes.replace(edit.start, edit.end, edit.value);
+                attributes.replace(edit.end, gsl::narrow_cast<size_type>(edit.end + 1), value_type{ 0 });
+            }
+        };
+        const auto [replaceRuns, replaceDuration] = measure(writeWords);
+
+        // Rewriting a row with the attributes it already has is just as common,
+        // for instance when redrawing a prompt. These edits shouldn't modify any runs.
+        row_attributes colorized(columns, 0);
+        writeWords(colorized);
+        const auto [rewriteRuns, rewriteDuration] = measure([&](row_attributes& attributes) {
+            attributes = colorized;
+            writeWords(attributes);
+        });
+
+        const auto [bulkRuns, bulkDuration] = measure([&](row_attributes& attributes) {
+            attributes.replace_ranges(edits);
+        });
+
+        Log::Comment(NoThrowString().Format(L"replace():         %7.0f ns/row", replaceDuration));
+        Log::Comment(NoThrowString().Format(L"replace() rewrite: %7.0f ns/row", rewriteDuration));
+        Log::Comment(NoThrowString().Format(L"replace_ranges():  %7.0f ns/row", bulkDuration));
+
+        // Every word and every space is its own run.
+        const auto expectedRuns = size_t{ rows } * 2 * edits.size();
+        VERIFY_ARE_EQUAL(expectedRuns, replaceRuns);
+        VERIFY_ARE_EQUAL(expectedRuns, rewriteRuns);
+        VERIFY_ARE_EQUAL(expectedRuns, bulkRuns);
+    }
 };
@@ -4,6 +4,11 @@
 #include "precomp.h"
 #include "WexTestClass.h"
 
+#include <chrono>
+#include <random>
+
+#include <til/unicode.h>
+
 using namespace WEX::Common;
 using namespace WEX::Logging;
 using namespace WEX::TestExecution;
@@ -17,8 +22,54 @@ class Utf8Utf16ConvertTests
     TEST_METHOD(TestU8ToU16Partials);
     TEST_METHOD(TestU16ToU8Partials);
     TEST_METHOD(TestU8ToU16OneByOne);
+    TEST_METHOD(TestU8ToU16Invalid);
+    TEST_METHOD(TestU16ToU8Invalid);
+    TEST_METHOD(TestAgainstPlatform);
+    TEST_METHOD(TestThroughput);
 };
 
+namespace
+{
+    // Builds a string of roughly `length` UTF-16 code units by randomly picking from `alphabet`.
+    std::wstring randomText(std::mt19937& rng, const std::wstring_view& alphabet, size_t length)
+    {
+        std::wstring text;
+        text.reserve(length + 1);
+        std::uniform_int_distribution<size_t> dist{ 0, alphabet.size() - 1 };
+        while (text.size() < length)
+        {
+            auto i = dist(rng);
+            // Keep surrogate pairs intact.
+            if (til::is_trailing_surrogate(alphabet[i]))
+            {
+                --i;
+            }
+            text.push_back(alphabet[i]);
+            if (til::is_leading_surrogate(alphabet[i]))
+            {
+                text.push_back(alphabet[i + 1]);
+            }
+        }
+        return text;
+    }
+
+    std::wstring platformU8U16(const std::string_view& in)
+    {
+        std::wstring out(in.size(), L'\0');
+        const auto len = MultiByteToWideChar(CP_UTF8, 0, in.data(), gsl::narrow<int>(in.size()), out.data(), gsl::narrow<int>(out.size()));
+        out.resize(gsl::narrow_cast<size_t>(len));
+        return out;
+    }
+
+    std::string platformU16U8(const std::wstring_view& in)
+    {
+        std::string out(in.size() * 3, '\0');
+        const auto len = WideCharToMultiByte(CP_UTF8, 0, in.data(), gsl::narrow<int>(in.size()), out.data(), gsl::narrow<int>(out.size()), nullptr, nullptr);
+        out.resize(gsl::narrow_cast<size_t>(len));
+        return out;
+    }
+}
+
 void Utf8Utf16ConvertTests::TestU8ToU16()
 {
     const std::string u8String{
@@ -191,3 +242,140 @@ void Utf8Utf16ConvertTests::TestU8ToU16OneByOne()
     VERIFY_SUCCEEDED(til::u8u16(u8String1_4, u16Out1, state));
     VERIFY_ARE_EQUAL(u16StringComp1, u16Out1);
 }
+
+void Utf8Utf16ConvertTests::TestU8ToU16Invalid()
+{
+    static constexpr struct
+    {
+        std::string_view input;
+        std::wstring_view expected;
+    } testCases[]{
+        { "\x80", L"\xFFFD" }, // unexpected continuation byte
+        { "a\xFF" "b", L"a\xFFFD" L"b" }, // invalid lead byte
+        { "\xC0\xAF", L"\xFFFD\xFFFD" }, // overlong 2 byte sequence
+        { "\xE0\x80\x80", L"\xFFFD\xFFFD\xFFFD" }, // overlong 3 byte sequence
+        { "\xED\xA0\x80", L"\xFFFD\xFFFD\xFFFD" }, // encoded surrogate
+        { "\xF4\x90\x80\x80", L"\xFFFD\xFFFD\xFFFD\xFFFD" }, // past U+10FFFF
+        { "\xE2\x82z", L"\xFFFDz" }, // truncated sequence = 1 maximal subpart
+        { "\xF0\xA4\xBD", L"\xFFFD" }, // truncated at the end of the input
+        { "0123456789abcdef\xC3\xB6\x80", L"0123456789abcdef\x00F6\xFFFD" }, // invalid byte after the vectorized part
+    };
+
+    for (const auto& test : testCases)
+    {
+        std::wstring u16Out{};
+        VERIFY_SUCCEEDED(til::u8u16(test.input, u16Out));
+        VERIFY_ARE_EQUAL(std::wstring{ test.expected }, u16Out);
+    }
+}
+
+void Utf8Utf16ConvertTests::TestU16ToU8Invalid()
+{
+    static constexpr struct
+    {
+        std::wstring_view input;
+        std::string_view expected;
+    } testCases[]{
+        { L"\xDC00", "\xEF\xBF\xBD" }, // unpaired low surrogate
+        { L"a\xD800" L"b", "a\xEF\xBF\xBD" "b" }, // unpaired high surrogate
+        { L"\xDC00\xD800", "\xEF\xBF\xBD\xEF\xBF\xBD" }, // reversed surrogate pair
+        { L"0123456789abcdef\xDC00", "0123456789abcdef\xEF\xBF\xBD" }, // unpaired surrogate after the vectorized part
+    };
+
+    for (const auto& test : testCases)
+    {
+        std::string u8Out{};
+        VERIFY_SUCCEEDED(til::u16u8(test.input, u8Out));
+        VERIFY_ARE_EQUAL(std::string{ test.expected }, u8Out);
+    }
+}
+
+void Utf8Utf16ConvertTests::TestAgainstPlatform()
+{
+    // ASCII, Latin-1, Cyrillic, CJK and a surrogate pair (U+1F4F7 CAMERA).
+    static constexpr std::wstring_view alphabet{ L"aZ0 ~\x00F6\x00DF\x0416\x044F\x20AC\x4E2D\x6587\xD83D\xDCF7" };
+    std::mt19937 rng{ 0x12345678 };
+
+    for (size_t length = 0; length < 200; ++length)
+    {
+        const auto u16String = randomText(rng, alphabet, length);
+        const auto u8String = platformU16U8(u16String);
+
+        std::string u8Out{};
+        VERIFY_SUCCEEDED(til::u16u8(u16String, u8Out));
+        VERIFY_ARE_EQUAL(u8String, u8Out);
+
+        std::wstring u16Out{};
+        VERIFY_SUCCEEDED(til::u8u16(u8String, u16Out));
+        VERIFY_ARE_EQUAL(platformU8U16(u8String), u16Out);
+    }
+}
+
+void Utf8Utf16ConvertTests::TestThroughput()
+{
+    static constexpr struct
+    {
+        std::wstring_view name;
+        std::wstring_view alphabet;
+    } texts[]{
+        { L"ASCII", L"The quick brown fox jumps over the lazy dog." },
+        { L"Latin", L"Falsches \x00DC" L"ben von Xylophonmusik qu\x00E4lt jeden gr\x00F6\x00DF" L"eren Zwerg." },
+        { L"CJK", L"\x4E2D\x6587\x65E5\x672C\x8A9E\xD55C\xAD6D\xC5B4" },
+        { L"Mixed", L"ls -la \x2502 \x251C\x2500 \xD83D\xDCF7 \x001B[38;5;208m" },
+    };
+    static constexpr size_t chunkSizes[]{ 16, 256, 4096 };
+    constexpr size_t totalLength = 4 * 1024 * 1024;
+
+    std::mt19937 rng{ 0x12345678 };
+    std::wstring u16Out;
+    std::string u8Out;
+
+    for (const auto& text : texts)
+    {
+        const auto u16String = randomText(rng, text.alphabet, totalLength);
+        const auto u8String = platformU16U8(u16String);
+
+        for (const auto chunkSize : chunkSizes)
+        {
+            // Measures the time it takes to convert `input` in chunks of roughly `chunkSize` bytes.
+            // The chunks are cut at arbitrary positions, so this also exercises the partials handling.
+            const auto measure = [&](const auto& input, auto&& convert) {
+                const auto beg = std::chrono::steady_clock::now();
+                for (size_t i = 0; i < input.size(); i += chunkSize)
+                {
+                    convert(input.substr(i, chunkSize));
+                }
+                const auto end = std::chrono::steady_clock::now();
+                const auto bytes = input.size() * sizeof(input[0]);
+                return bytes / std::chrono::duration<double>(end - beg).count() / (1024 * 1024);
+            };
+
+            til::u8state u8State{};
+            const auto u8u16Til = measure(std::string_view{ u8String }, [&](const auto& chunk) {
+                THROW_IF_FAILED(til::u8u16(chunk, u16Out, u8State));
+            });
+            const auto u8u16Platform = measure(std::string_view{ u8String }, [&](const auto& chunk) {
+                u16Out.resize(chunk.size());
+                MultiByteToWideChar(CP_UTF8, 0, chunk.data(), gsl::narrow_cast<int>(chunk.size()), u16Out.data(), gsl::narrow_cast<int>(u16Out.size()));
+            });
+
+            til::u16state u16State{};
+            const auto u16u8Til = measure(std::wstring_view{ u16String }, [&](const auto& chunk) {
+                THROW_IF_FAILED(til::u16u8(chunk, u8Out, u16State));
+            });
+            const auto u16u8Platform = measure(std::wstring_view{ u16String }, [&](const auto& chunk) {
+                u8Out.resize(chunk.size() * 3);
+                WideCharToMultiByte(CP_UTF8, 0, chunk.data(), gsl::narrow_cast<int>(chunk.size()), u8Out.data(), gsl::narrow_cast<int>(u8Out.size()), nullptr, nullptr);
+            });
+
+            Log::Comment(NoThrowString().Format(
+                L"%-5s chunk %4zu: u8u16 %7.0f MB/s (platform %7.0f MB/s), u16u8 %7.0f MB/s (platform %7.0f MB/s)",
+                text.name.data(),
+                chunkSize,
+                u8u16Til,
+                u8u16Platform,
+                u16u8Til,
+                u16u8Platform));
+        }
+    }
+}
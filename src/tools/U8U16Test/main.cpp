@@ -3,6 +3,8 @@
 // NOTE The functions u8u16 and u16u8 contain own algorithms. Tests have shown that they perform
 // worse than the platform API functions.
 // Thus, these functions are *unrelated* to the til::u8u16 and til::u16u8 implementation.
+// The CompNaturalLang tests additionally measure til::utf8_to_utf16 and til::utf16_to_utf8,
+// which til::u8u16 and til::u16u8 are based on.
 
 #include <iostream>
 #include <memory>
@@ -12,6 +14,7 @@
 #include <sstream>
 
 #include "U8U16Test.hpp"
+#include "../../inc/til/transcode.h"
 
 typedef NTSTATUS(WINAPI* t_RtlUTF8ToUnicodeN)(PWSTR, ULONG, PULONG, PCCH, ULONG);
 typedef NTSTATUS(WINAPI* t_RtlUnicodeToUTF8N)(PCHAR, ULONG, PULONG, PCWSTR, ULONG);
@@ -354,6 +357,13 @@ void CompNaturalLang_WholeString(const std::string& fileName)
     duration = GetDuration();
     std::cout << " u8u16_ptr           length " << u16Str.length() << " elapsed " << duration << std::endl;
 
+    GetDuration();
+    u16Buffer = std::make_unique<wchar_t[]>(u8Str.length());
+    length = static_cast<int>(til::utf8_to_utf16(u8Str.data(), u8Str.data() + u8Str.length(), u16Buffer.get()) - u16Buffer.get());
+    duration = GetDuration();
+    u16Buffer.reset();
+    std::cout << " til::utf8_to_utf16  length " << length << " elapsed " << duration << std::endl;
+
     GetDuration();
     std::unique_ptr<char[]> u8Buffer{ std::make_unique<char[]>(u16Str.length() * 3) };
     length = WideCharToMultiByte(65001, 0, u16Str.data(), static_cast<int>(u16Str.length()), u8Buffer.get(), static_cast<int>(u16Str.length()) * 3, nullptr, nullptr);
@@ -366,6 +376,13 @@ void CompNaturalLang_WholeString(const std::string& fileName)
     hRes = u16u8_ptr(u16Str, u8StrOut);
     duration = GetDuration();
     std::cout << " u16u8_ptr           length " << u8StrOut.length() << " elapsed " << duration << std::endl;
+
+    GetDuration();
+    u8Buffer = std::make_unique<char[]>(u16Str.length() * 3);
+    length = static_cast<int>(til::utf16_to_utf8(u16Str.data(), u16Str.data() + u16Str.length(), u8Buffer.get()) - u8Buffer.get());
+    duration = GetDuration();
+    u8Buffer.reset();
+    std::cout << " til::utf16_to_utf8  length " << length << " elapsed " << duration << std::endl;
 }
 
 void CompNaturalLang_Chunks(const std::string& fileName)
@@ -395,6 +412,10 @@ void CompNaturalLang_Chunks(const std::string& fileName)
     double durTotalWC2MB{};
     double durTotalU8U16{};
     double durTotalU16U8{};
+    size_t lenTotalTilU8U16{};
+    size_t lenTotalTilU16U8{};
+    double durTotalTilU8U16{};
+    double durTotalTilU16U8{};
 
     GetDuration();
     std::unique_ptr<wchar_t[]> u16Buffer{ std::make_unique<wchar_t[]>(chunkSize) };
@@ -412,6 +433,15 @@ void CompNaturalLang_Chunks(const std::string& fileName)
     std::string u8StrOut{};
     durTotalU16U8 += GetDuration();
 
+    // til::utf8_to_utf16 needs room for as many code units as there are bytes of input.
+    GetDuration();
+    std::unique_ptr<wchar_t[]> tilU16Buffer{ std::make_unique<wchar_t[]>(chunkSize * 3) };
+    durTotalTilU8U16 += GetDuration();
+
+    GetDuration();
+    std::unique_ptr<char[]> tilU8Buffer{ std::make_unique<char[]>(chunkSize * 3) };
+    durTotalTilU16U8 += GetDuration();
+
     for (size_t idx = 0u; idx < u16Str.length(); idx += chunkSize)
     {
         std::wstring u16Chunk{ u16Str.substr(idx, chunkSize) };
@@ -434,12 +464,22 @@ void CompNaturalLang_Chunks(const std::string& fileName)
         hRes = u16u8_ptr(u16Chunk, u8StrOut);
         durTotalU16U8 += GetDuration();
         lenTotalU16U8 += u8StrOut.length();
+
+        GetDuration();
+        lenTotalTilU8U16 += til::utf8_to_utf16(u8Chunk.data(), u8Chunk.data() + u8Chunk.length(), tilU16Buffer.get()) - tilU16Buffer.get();
+        durTotalTilU8U16 += GetDuration();
+
+        GetDuration();
+        lenTotalTilU16U8 += til::utf16_to_utf8(u16Chunk.data(), u16Chunk.data() + u16Chunk.length(), tilU8Buffer.get()) - tilU8Buffer.get();
+        durTotalTilU16U8 += GetDuration();
     }
 
     std::cout << " MultiByteToWideChar length " << lenTotalMB2WC << " elapsed " << durTotalMB2WC << std::endl;
     std::cout << " u8u16_ptr           length " << lenTotalU8U16 << " elapsed " << durTotalU8U16 << std::endl;
     std::cout << " WideCharToMultiByte length " << lenTotalWC2MB << " elapsed " << durTotalWC2MB << std::endl;
     std::cout << " u16u8_ptr           length " << lenTotalU16U8 << " elapsed " << durTotalU16U8 << std::endl;
+    std::cout << " til::utf8_to_utf16  length " << lenTotalTilU8U16 << " elapsed " << durTotalTilU8U16 << std::endl;
+    std::cout << " til::utf16_to_utf8  length " << lenTotalTilU16U8 << " elapsed " << durTotalTilU16U8 << std::endl;
 }
 
 int main()
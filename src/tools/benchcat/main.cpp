@@ -250,6 +250,141 @@ char* buffer_append_number(char* dst, uint8_t val)
     return dst;
 }
 
+static char* buffer_append_decimal(char* dst, uint32_t val)
+{
+    char digits[10];
+    int count = 0;
+    do
+    {
+        digits[count++] = static_cast<char>('0' + val % 10);
+        val /= 10;
+    } while (val);
+    while (count)
+    {
+        *dst++ = digits[--count];
+    }
+    return dst;
+}
+
+// Generates a sixel image of the given size with a 16 color palette. Each sixel
+// band is split into per-color passes which mix literal sixels with repeat
+// commands, similar to what encoders like libsixel produce for plots.
+static char* generate_sixel_image(char* dst, uint32_t size, pcg_engines::oneseq_dxsm_64_32& rng)
+{
+    dst = buffer_append_string(dst, "\x1bP0;1q\"1;1;");
+    dst = buffer_append_decimal(dst, size);
+    *dst++ = ';';
+    dst = buffer_append_decimal(dst, size);
+
+    for (uint32_t color = 0; color < 16; ++color)
+    {
+        *dst++ = '#';
+        dst = buffer_append_decimal(dst, color);
+        dst = buffer_append_string(dst, ";2;");
+        dst = buffer_append_decimal(dst, color * 6);
+        *dst++ = ';';
+        dst = buffer_append_decimal(dst, 100 - color * 6);
+        *dst++ = ';';
+        dst = buffer_append_decimal(dst, (color * 37) % 100);
+    }
+
+    for (uint32_t y = 0; y < size; y += 6)
+    {
+        for (uint32_t color = 0; color < 16; color += 4)
+        {
+            *dst++ = '#';
+            dst = buffer_append_decimal(dst, color);
+
+            for (uint32_t x = 0; x < size;)
+            {
+                const auto r = rng();
+                const auto sixel = static_cast<char>('?' + (r & 63));
+                auto run = 1 + ((r >> 8) & 15);
+                run = min<uint32_t>(run, size - x);
+                if (run > 3)
+                {
+                    *dst++ = '!';
+                    dst = buffer_append_decimal(dst, run);
+                    *dst++ = sixel;
+                }
+                else
+                {
+                    for (uint32_t i = 0; i < run; ++i)
+                    {
+                        *dst++ = sixel;
+                    }
+                }
+                x += run;
+            }
+
+            *dst++ = '$';
+        }
+        *dst++ = '-';
+    }
+
+    return buffer_append_string(dst, "\x1b\\");
+}
+
+// Returns the number of pixels covered by all the sixel images in the given
+// data. This doesn't account for the pixel aspect ratio, since we're only
+// interested in how many sixel pixels the terminal had to decode.
+static LONGLONG count_sixel_pixels(const char* data, size_t size)
+{
+    LONGLONG pixels = 0;
+    const auto end = data + size;
+    auto p = data;
+
+    while (p < end)
+    {
+        // Find the next DCS ... q introducer.
+        if (*p++ != '\x1b' || p == end || *p++ != 'P')
+        {
+            continue;
+        }
+        while (p < end && ((*p >= '0' && *p <= '9') || *p == ';'))
+        {
+            ++p;
+        }
+        if (p == end || *p++ != 'q')
+        {
+            continue;
+        }
+
+        LONGLONG x = 0;
+        LONGLONG width = 0;
+        LONGLONG bands = 1;
+        LONGLONG repeat = 1;
+        for (; p < end && *p != '\x1b'; ++p)
+        {
+            const auto ch = *p;
+            if (ch >= '?' && ch <= '~')
+            {
+                x += repeat;
+                repeat = 1;
+            }
+            else if (ch == '!')
+            {
+                repeat = 0;
+                for (; p + 1 < end && p[1] >= '0' && p[1] <= '9'; ++p)
+                {
+                    repeat = repeat * 10 + (p[1] - '0');
+                }
+                repeat = max<LONGLONG>(repeat, 1);
+            }
+            else if (ch == '$' || ch == '-')
+            {
+                width = max(width, x);
+                x = 0;
+                bands += ch == '-';
+            }
+        }
+        width = max(width, x);
+        pixels += width * bands * 6;
+    }
+
+    return pixels;
+}
+
 struct FormatResult
 {
     LONGLONG integral;
@@ -429,6 +564,7 @@ int __stdcall main() noexcept
     VtMode vt = VtMode::Off;
     uint64_t seed = 0;
     bool has_seed = false;
+    uint32_t sixel_size = 0;
 
     {
         int argc;
@@ -461,6 +597,11 @@ int __stdcall main() noexcept
                     break;
                 }
             }
+            else if (const auto suffix = split_prefix(argv[i], L"-x"))
+            {
+                sixel_size = parse_number_with_suffix(suffix);
+                vt = VtMode::On;
+            }
             else if (has_suffix(argv[i], L"-s"))
             {
                 seed = parse_number_with_suffix(suffix);
@@ -477,13 +618,14 @@ int __stdcall main() noexcept
         }
     }
 
-    if (!path || !chunk_size || !repeat)
+    if ((!path && !sixel_size) || !chunk_size || !repeat)
     {
         eprintf(
             "bc [options] <filename>\r\n"
             "  -v        enable VT\r\n"
             "  -vi       print as italic\r\n"
             "  -vc       print colorized\r\n"
+            "  -x{d}     print a synthetic {d}x{d} sixel image instead of a file\r\n"
             "  -c{d}{u}  chunk size, defaults to 128Ki\r\n"
             "  -r{d}{u}  repeats, defaults to 1\r\n"
             "  -s{d}     RNG seed\r\n"
@@ -511,14 +653,27 @@ int __stdcall main() noexcept
     pcg_engines::oneseq_dxsm_64_32 rng{ seed };
 
     const auto stdout = GetStdHandle(STD_OUTPUT_HANDLE);
-    const auto file = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
-    if (file == INVALID_HANDLE_VALUE)
+    size_t file_size = 0;
+    char* file_data = nullptr;
+
+    acquire_lock_memory_privilege();
+
+    if (sixel_size)
     {
-        print_last_error("open file");
+        // Every band emits 4 color passes of at most 1 byte per column (since runs
+        // longer than 3 are compressed), plus the color selection and the palette.
+        const auto bands = (static_cast<size_t>(sixel_size) + 5) / 6;
+        file_data = allocate(bands * (4 * (static_cast<size_t>(sixel_size) + 8) + 2) + 1024);
+        file_size = static_cast<size_t>(generate_sixel_image(file_data, sixel_size, rng) - file_data);
     }
-
-    size_t file_size = 0;
+    else
     {
+        const auto file = CreateFileW(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            print_last_error("open file");
+        }
+
 #ifdef _WIN64
         LARGE_INTEGER i;
         if (!GetFileSizeEx(file, &i))
@@ -535,15 +690,9 @@ int __stdcall main() noexcept
             print_last_error("open file");
         }
 #endif
-    }
-
-    acquire_lock_memory_privilege();
 
-    const auto file_data = allocate(file_size);
-    auto stdout_size = file_size;
-    auto stdout_data = file_data;
+        file_data = allocate(file_size);
 
-    {
         auto read_data = file_data;
         DWORD read = 0;
 
@@ -557,6 +706,10 @@ int __stdcall main() noexcept
         }
     }
 
+    auto stdout_size = file_size;
+    auto stdout_data = file_data;
+    const auto sixel_pixels = vt == VtMode::Off ? 0 : count_sixel_pixels(file_data, file_size);
+
     switch (vt)
     {
     case VtMode::Italic:
@@ -662,9 +815,9 @@ int __stdcall main() noexcept
     const auto throughput = format_size(bytes_per_second);
 
     char status[128];
-    const auto status_length = format(
+    auto status_length = format(
         &status[0],
-        1024,
+        sizeof(status),
         FORMAT_RESULT_FMT "B, " FORMAT_RESULT_FMT "s, " FORMAT_RESULT_FMT "B/s",
         FORMAT_RESULT_ARGS(written),
         FORMAT_RESULT_ARGS(duration),
@@ -675,6 +828,21 @@ int __stdcall main() noexcept
         clean_exit(1);
     }
 
+    if (sixel_pixels > 0)
+    {
+        const auto pixels_per_second = (sixel_pixels * static_cast<LONGLONG>(repeat) * frequency.QuadPart) / elapsed_ticks;
+        const auto pixel_throughput = format_size(pixels_per_second);
+        const auto length = format(
+            &status[status_length],
+            sizeof(status) - status_length,
+            ", " FORMAT_RESULT_FMT "px/s",
+            FORMAT_RESULT_ARGS(pixel_throughput));
+        if (length > 0)
+        {
+            status_length += length;
+        }
+    }
+
     char buffer[256];
     char* buffer_end = &buffer[0];
 
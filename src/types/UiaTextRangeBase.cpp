@@ -992,15 +992,10 @@ std::wstring UiaTextRangeBase::_getTextValue(til::CoordType maxLength) const
         };
         THROW_HR_IF(E_FAIL, !isValid(_start) || !isValid(_end));
 
+        // Screen readers often ask for the first few characters of very large ranges.
+        // Passing the limit along avoids copying all of the rows past it.
         const auto req = TextBuffer::CopyRequest{ buffer, _start, _end, _blockRange, true, false, false, true };
-        auto plainText = buffer.GetPlainText(req);
-
-        if (plainText.size() > maxLengthAsSize)
-        {
-            plainText.resize(maxLengthAsSize);
-        }
-
-        textData = std::move(plainText);
+        textData = buffer.GetPlainText(req, maxLengthAsSize);
     }
 
     return textData;
@@ -80,6 +80,7 @@ namespace Microsoft::Console::Utils
     DEFINE_ENUM_FLAG_OPERATORS(FilterOption)
 
     std::wstring FilterStringForPaste(const std::wstring_view wstr, const FilterOption option);
+    void FilterStringForPaste(const std::wstring_view wstr, const FilterOption option, wchar_t& previous, std::wstring& filtered);
 
     constexpr uint16_t EndianSwap(uint16_t value)
     {
@@ -23,6 +23,7 @@ class UtilsTests
     TEST_METHOD(TestGuidToString);
     TEST_METHOD(TestSplitString);
     TEST_METHOD(TestFilterStringForPaste);
+    TEST_METHOD(TestFilterStringForPasteChunked);
     TEST_METHOD(TestStringToUint);
     TEST_METHOD(TestColorFromXTermColor);
 
@@ -201,6 +202,26 @@ void UtilsTests::TestFilterStringForPaste()
                      FilterStringForPaste(unicodeString, FilterOption::CarriageReturnNewline | FilterOption::ControlCodes));
 }
 
+void UtilsTests::TestFilterStringForPasteChunked()
+{
+    const std::wstring_view input = L"Hello\r\nWorld\n\x01\r\n123\r\r\n\x1b[A";
+    const auto option = FilterOption::CarriageReturnNewline | FilterOption::ControlCodes;
+    const auto expected = FilterStringForPaste(input, option);
+    VERIFY_ARE_EQUAL(L"Hello\rWorld\r\r123\r\r[A", expected);
+
+    // Every chunk size makes some of them end in between a \r and a \n.
+    for (size_t chunkSize = 1; chunkSize <= input.size(); ++chunkSize)
+    {
+        std::wstring actual;
+        wchar_t previous = 0;
+        for (size_t i = 0; i < input.size(); i += chunkSize)
+        {
+            FilterStringForPaste(input.substr(i, chunkSize), option, previous, actual);
+        }
+        VERIFY_ARE_EQUAL(expected, actual);
+    }
+}
+
 void UtilsTests::TestStringToUint()
 {
     auto success = false;
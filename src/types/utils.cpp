@@ -630,7 +630,22 @@ std::wstring Utils::FilterStringForPaste(const std::wstring_view wstr, const Fil
 {
     std::wstring filtered;
     filtered.reserve(wstr.length());
+    wchar_t previous = 0;
+    FilterStringForPaste(wstr, option, previous, filtered);
+    return filtered;
+}
 
+// Routine Description:
+// - Pre-process text pasted (presumably from the clipboard) with provided option
+//   and append the result to the given string. This allows filtering large strings
+//   in chunks, as long as the same `previous` is passed to each call.
+// Arguments:
+// - wstr - String to process.
+// - option - option to use.
+// - previous - The last character of the previous chunk (or 0). Updated to the last character of wstr.
+// - filtered - The string to append the result to.
+void Utils::FilterStringForPaste(const std::wstring_view wstr, const FilterOption option, wchar_t& previous, std::wstring& filtered)
+{
     const auto isControlCode = [](wchar_t c) {
         if (c >= L'\x20' && c < L'\x7f')
         {
@@ -648,10 +663,9 @@ std::wstring Utils::FilterStringForPaste(const std::wstring_view wstr, const Fil
         return c != L'\x09' && c != L'\x0a' && c != L'\x0d';
     };
 
-    std::wstring::size_type pos = 0;
     std::wstring::size_type begin = 0;
 
-    while (pos < wstr.size())
+    for (std::wstring::size_type pos = 0; pos < wstr.size(); ++pos)
     {
         const auto c = til::at(wstr, pos);
 
@@ -659,45 +673,26 @@ std::wstring Utils::FilterStringForPaste(const std::wstring_view wstr, const Fil
         {
             // copy up to but not including the \n
             filtered.append(wstr.cbegin() + begin, wstr.cbegin() + pos);
-            if (!(pos > 0 && (til::at(wstr, pos - 1) == L'\r')))
+            if (previous != L'\r')
             {
                 // there was no \r before the \n we did not copy,
                 // so append our own \r (this effectively replaces the \n
                 // with a \r)
                 filtered.push_back(L'\r');
             }
-            ++pos;
-            begin = pos;
+            begin = pos + 1;
         }
         else if (WI_IsFlagSet(option, FilterOption::ControlCodes) && isControlCode(c))
         {
             // copy up to but not including the control code
             filtered.append(wstr.cbegin() + begin, wstr.cbegin() + pos);
-            ++pos;
-            begin = pos;
+            begin = pos + 1;
         }
-        else
-        {
-            ++pos;
-        }
-    }
 
-    // If we entered the while loop even once, begin would be non-zero
-    // (because we set begin = pos right after incrementing pos)
-    // So, if begin is still zero at this point it means we never found a newline
-    // and we can just write the original string
-    if (begin == 0)
-    {
-        return std::wstring{ wstr };
-    }
-    else
-    {
-        filtered.append(wstr.cbegin() + begin, wstr.cend());
-        // we may have removed some characters, so we may not need as much space
-        // as we reserved earlier
-        filtered.shrink_to_fit();
-        return filtered;
+        previous = c;
     }
+
+    filtered.append(wstr.cbegin() + begin, wstr.cend());
 }
 
 // Routine Description: